@@ -184,6 +184,11 @@ enum {
 	BOOL ignoreAnchorPointForPosition_;
 
 	BOOL isReorderChildDirty_;	
+
+	// Flattened world transforms of the scene this node belongs to. See CC_NODE_TRANSFORM_CACHE
+	struct _ccTransformCache *transformCache_;
+	unsigned int transformSlot_;
+	BOOL ownsTransformCache_;
 }
 
 /** The z order of the node relative to its "siblings": children of the same parent 
@@ -395,6 +400,13 @@ x,y轴的倾斜角度
  don't call this manually unless a child added needs to be removed in the same frame  存储所有子节点 */
 - (void) sortAllChildren;
 
+/** Sorts the children by zOrder, then by orderOfArrival, even if they were not reordered.
+ The sort is stable and O(n) for most children arrays, see ccOrderSort.h. Used by sortAllChildren.
+ Returns YES if few children were out of place and they were insertion sorted in place, NO if ccOrderSort was used.
+ @since v2.0
+ */
+-(BOOL) sortChildrenByZOrder;
+
 /** Event that is called when the running node is no longer running (eg: its CCScene is being removed from the "stage" ).
  On cleanup you should break any possible circular references.
  CCNode's cleanup removes any possible scheduled timer and/or any possible action.
@@ -546,6 +558,12 @@ x,y轴的倾斜角度
 转换节点空间坐标系为父类的空间坐标系；返回矩阵以像素为单位
  */
 - (CGAffineTransform)nodeToParentTransform;
+/** Marks the transform as dirty. Subclasses that override nodeToParentTransform to read values that aren't
+ properties of CCNode (eg: the position of a physics body) must call it when those values change.
+ The setters of CCNode call it already.
+ @since v2.0
+ */
+-(void) markTransformDirty;
 /** Returns the matrix that transform parent's space coordinates to the node's (local) space coordinates.
  The matrix is in Pixels.
 父类转子类
@@ -36,6 +36,8 @@
 #import "Support/CGPointExtension.h"
 #import "Support/ccCArray.h"
 #import "Support/TransformUtils.h"
+#import "Support/ccTransformCache.h"
+#import "Support/ccOrderSort.h"
 #import "ccMacros.h"
 #import "CCGLProgram.h"
 //节点，网格，导演，运动管理，摄像，调度，配置，宏，点扩展，数组，着色方案
@@ -53,6 +55,23 @@
 #define RENDER_IN_SUBPIXEL (NSInteger)
 #endif
 
+#if CC_NODE_TRANSFORM_CACHE
+// Marks the transform as dirty and queues the node for the transform cache of its scene
+#define SET_TRANSFORM_DIRTY() {														\
+					isTransformDirty_ = isInverseDirty_ = YES;						\
+					if( transformCache_ )											\
+						ccTransformCacheQueue(transformCache_, transformSlot_);	\
+				}
+
+// Cache of the scene that is being visited. NULL below nodes that use the matrix stack
+static ccTransformCache *visitTransformCache_ = NULL;
+
+// Node whose cached modelview matrix is on top of the matrix stack
+static CCNode *loadedTransformNode_ = nil;
+#else
+#define SET_TRANSFORM_DIRTY() { isTransformDirty_ = isInverseDirty_ = YES; }
+#endif
+
 
 @interface CCNode ()
 // lazy allocs
@@ -62,6 +81,16 @@
 // used internally to alter the zOrder variable. DON'T call this method manually 不要手动调用
 -(void) _setZOrder:(NSInteger) z;
 -(void) detachChild:(CCNode *)child cleanup:(BOOL)doCleanup;
+#if CC_NODE_TRANSFORM_CACHE
+-(void) visitWithTransformCache;
+-(void) visitCached;
+-(void) addToTransformCache:(ccTransformCache*)cache parent:(int)parent;
+-(void) leaveTransformCache:(ccTransformCache*)cache;
+-(unsigned int) transformCacheSize;
+-(void) childEntersTransformCache:(CCNode*)child;
+-(void) childLeavesTransformCache:(CCNode*)child;
+-(void) updateTransformCacheLocal;
+#endif
 @end
 
 @implementation CCNode
@@ -69,6 +98,9 @@
 // XXX: Yes, nodes might have a sort problem once every 15 days if the game runs at 60 FPS and each frame sprites are reordered.
 static NSUInteger globalOrderOfArrival = 1;
 
+// Shared by all the nodes, they are sorted on the cocos2d thread
+static ccOrderSort *childrenOrderSort_ = NULL;
+
 @synthesize children = children_;
 @synthesize visible = visible_;
 @synthesize parent = parent_;
@@ -181,6 +213,14 @@ static NSUInteger globalOrderOfArrival = 1;
 	[shaderProgram_ release];
 	[userObject_ release];
 
+#if CC_NODE_TRANSFORM_CACHE
+	if( ownsTransformCache_ && transformCache_ ) {
+		ccTransformCache *cache = transformCache_;
+		[self leaveTransformCache:cache];
+		ccTransformCacheFree(cache);
+	}
+#endif
+
 	// children
 	CCNode *child;
 	CCARRAY_FOREACH(children_, child)
@@ -197,44 +237,44 @@ static NSUInteger globalOrderOfArrival = 1;
 -(void) setRotation: (float)newRotation
 {
 	rotation_ = newRotation;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 -(void) setScaleX: (float)newScaleX
 {
 	scaleX_ = newScaleX;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 -(void) setScaleY: (float)newScaleY
 {
 	scaleY_ = newScaleY;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 -(void) setSkewX:(float)newSkewX
 {
 	skewX_ = newSkewX;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 -(void) setSkewY:(float)newSkewY
 {
 	skewY_ = newSkewY;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 -(void) setPosition: (CGPoint)newPosition
 {
 	position_ = newPosition;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 -(void) setIgnoreAnchorPointForPosition: (BOOL)newValue
 {
 	if( newValue != ignoreAnchorPointForPosition_ ) {
 		ignoreAnchorPointForPosition_ = newValue;
-		isTransformDirty_ = isInverseDirty_ = YES;
+		SET_TRANSFORM_DIRTY();
 	}
 }
 
@@ -243,7 +283,7 @@ static NSUInteger globalOrderOfArrival = 1;
 	if( ! CGPointEqualToPoint(point, anchorPoint_) ) {
 		anchorPoint_ = point;
 		anchorPointInPoints_ = ccp( contentSize_.width * anchorPoint_.x, contentSize_.height * anchorPoint_.y );
-		isTransformDirty_ = isInverseDirty_ = YES;
+		SET_TRANSFORM_DIRTY();
 	}
 }
 
@@ -253,7 +293,7 @@ static NSUInteger globalOrderOfArrival = 1;
 		contentSize_ = size;
 
 		anchorPointInPoints_ = ccp( contentSize_.width * anchorPoint_.x, contentSize_.height * anchorPoint_.y );
-		isTransformDirty_ = isInverseDirty_ = YES;
+		SET_TRANSFORM_DIRTY();
 	}
 }
 
@@ -266,6 +306,11 @@ static NSUInteger globalOrderOfArrival = 1;
 -(void) setVertexZ:(float)vertexZ
 {
 	vertexZ_ = vertexZ;
+
+#if CC_NODE_TRANSFORM_CACHE
+	if( transformCache_ )
+		ccTransformCacheQueue(transformCache_, transformSlot_);
+#endif
 }
 
 -(float) scale
@@ -277,7 +322,7 @@ static NSUInteger globalOrderOfArrival = 1;
 -(void) setScale:(float) s
 {
 	scaleX_ = scaleY_ = s;
-	isTransformDirty_ = isInverseDirty_ = YES;
+	SET_TRANSFORM_DIRTY();
 }
 
 - (void) setZOrder:(NSInteger)zOrder
@@ -412,6 +457,10 @@ static NSUInteger globalOrderOfArrival = 1;
 		if (cleanup)
 			[c cleanup];
 
+#if CC_NODE_TRANSFORM_CACHE
+		[self childLeavesTransformCache:c];
+#endif
+
 		// set parent nil at the end (issue #476)
 		[c setParent:nil];
 	}
@@ -435,6 +484,10 @@ static NSUInteger globalOrderOfArrival = 1;
 	if (doCleanup)
 		[child cleanup];
 
+#if CC_NODE_TRANSFORM_CACHE
+	[self childLeavesTransformCache:child];
+#endif
+
 	// set parent nil at the end (issue #476)
 	[child setParent:nil];
 
@@ -454,6 +507,10 @@ static NSUInteger globalOrderOfArrival = 1;
 
 	ccArrayAppendObjectWithResize(children_->data, child);
 	[child _setZOrder:z];
+
+#if CC_NODE_TRANSFORM_CACHE
+	[self childEntersTransformCache:child];
+#endif
 }
 
 -(void) reorderChild:(CCNode*) child z:(NSInteger)z
@@ -470,24 +527,7 @@ static NSUInteger globalOrderOfArrival = 1;
 {
 	if (isReorderChildDirty_)
 	{
-		NSInteger i,j,length = children_->data->num;
-		CCNode ** x = children_->data->arr;
-		CCNode *tempItem;
-
-		// insertion sort
-		for(i=1; i<length; i++)
-		{
-			tempItem = x[i];
-			j = i-1;
-
-			//continue moving element downwards while zOrder is smaller or when zOrder is the same but mutatedIndex is smaller
-			while(j>=0 && ( tempItem.zOrder < x[j].zOrder || ( tempItem.zOrder== x[j].zOrder && tempItem.orderOfArrival < x[j].orderOfArrival ) ) )
-			{
-				x[j+1] = x[j];
-				j = j-1;
-			}
-			x[j+1] = tempItem;
-		}
+		[self sortChildrenByZOrder];
 
 		//don't need to check children recursively, that's done in visit of each child
 
@@ -495,6 +535,53 @@ static NSUInteger globalOrderOfArrival = 1;
 	}
 }
 
+-(BOOL) sortChildrenByZOrder
+{
+	NSUInteger length = children_->data->num;
+	if( length < 2 )
+		return YES;
+
+	CCNode **x = children_->data->arr;
+
+	// Few children out of place: insertion sort them in place. It gives up after the budget of
+	// ccOrderSortEntries(), the children are then in a valid order for it, equal children are never swapped.
+	unsigned long moves = 0, maxMoves = ccOrderSortInsertionMoves((unsigned int)length);
+	NSUInteger i;
+	for( i = 1; i < length && moves <= maxMoves; i++ ) {
+		CCNode *tempItem = x[i];
+		NSUInteger j = i;
+
+		while( j > 0 && ( tempItem->zOrder_ < x[j-1]->zOrder_ || ( tempItem->zOrder_ == x[j-1]->zOrder_ && tempItem->orderOfArrival_ < x[j-1]->orderOfArrival_ ) ) ) {
+			x[j] = x[j-1];
+			j--;
+		}
+		x[j] = tempItem;
+		moves += i - j;
+	}
+
+	if( i >= length && moves <= maxMoves )
+		return YES;
+
+	if( ! childrenOrderSort_ )
+		childrenOrderSort_ = ccOrderSortNew();
+
+	ccOrderSortReserve(childrenOrderSort_, (unsigned int)length);
+
+	ccOrderEntry *entries = childrenOrderSort_->entries;
+	for( i = 0; i < length; i++ ) {
+		entries[i].zOrder = x[i]->zOrder_;
+		entries[i].orderOfArrival = x[i]->orderOfArrival_;
+		entries[i].object = x[i];
+	}
+
+	if( ccOrderSortEntries(childrenOrderSort_, (unsigned int)length) ) {
+		for( i = 0; i < length; i++ )
+			x[i] = entries[i].object;
+	}
+
+	return NO;
+}
+
 #pragma mark CCNode Draw
 
 -(void) draw
@@ -507,6 +594,25 @@ static NSUInteger globalOrderOfArrival = 1;
 	if (!visible_)
 		return;
 
+#if CC_NODE_TRANSFORM_CACHE
+	// Grids and cameras modify the matrix stack, so they can't use the cached matrices
+	if( !(grid_ && grid_.active) && !camera_ ) {
+		if( ownsTransformCache_ ) {
+			[self visitWithTransformCache];
+			return;
+		}
+
+		if( transformCache_ && transformCache_ == visitTransformCache_ ) {
+			[self visitCached];
+			return;
+		}
+	}
+
+	// The children use the matrix stack as well
+	ccTransformCache *cache = visitTransformCache_;
+	visitTransformCache_ = NULL;
+#endif
+
 	kmGLPushMatrix();
 
 	if ( grid_ && grid_.active)
@@ -549,8 +655,190 @@ static NSUInteger globalOrderOfArrival = 1;
 		[grid_ afterDraw:self];
 
 	kmGLPopMatrix();
+
+#if CC_NODE_TRANSFORM_CACHE
+	visitTransformCache_ = cache;
+#endif
+}
+
+#if CC_NODE_TRANSFORM_CACHE
+
+#pragma mark CCNode - Transform cache
+
+static void UpdateLocalTransform(ccTransformCache *cache, unsigned int slot, void *node)
+{
+	[(CCNode *)node updateTransformCacheLocal];
+}
+
+// Loads the cached modelview matrix of node, unless it is loaded already.
+// The parent of a node must be loaded before visiting it: children that don't use the cache
+// (grids, cameras, batch nodes) multiply their own transform into it.
+static inline void LoadCachedTransform(CCNode *node, ccTransformCache *cache, unsigned int slot)
+{
+	if( loadedTransformNode_ != node ) {
+		kmGLLoadMatrix((const kmMat4 *)ccTransformCacheGetModelview(cache, slot));
+		loadedTransformNode_ = node;
+	}
+}
+
+-(void) updateTransformCacheLocal
+{
+	CGAffineTransform t = [self nodeToParentTransform];
+	ccTransformCacheSetLocal(transformCache_, transformSlot_, t.a, t.b, t.c, t.d, t.tx, t.ty, vertexZ_);
+}
+
+-(void) addToTransformCache:(ccTransformCache*)cache parent:(int)parent
+{
+	transformCache_ = cache;
+	transformSlot_ = ccTransformCacheAdd(cache, parent, self);
+	[self updateTransformCacheLocal];
+
+	CCNode *child;
+	CCARRAY_FOREACH(children_, child) {
+		// Nodes that own a cache are visited with their own one
+		if( ! child->ownsTransformCache_ )
+			[child addToTransformCache:cache parent:transformSlot_];
+	}
+}
+
+-(void) leaveTransformCache:(ccTransformCache*)cache
+{
+	if( transformCache_ != cache )
+		return;
+
+	transformCache_ = NULL;
+
+	CCNode *child;
+	CCARRAY_FOREACH(children_, child)
+		[child leaveTransformCache:cache];
+}
+
+-(unsigned int) transformCacheSize
+{
+	unsigned int size = 1;
+
+	CCNode *child;
+	CCARRAY_FOREACH(children_, child) {
+		if( ! child->ownsTransformCache_ )
+			size += [child transformCacheSize];
+	}
+
+	return size;
+}
+
+-(void) childEntersTransformCache:(CCNode*)child
+{
+	ccTransformCache *cache = transformCache_;
+
+	// An invalid cache is rebuilt with the child before it is used
+	if( ! cache || cache->invalid || child->ownsTransformCache_ )
+		return;
+
+	unsigned int slot = ccTransformCacheInsert(cache, transformSlot_, [child transformCacheSize]);
+	[child addToTransformCache:cache parent:transformSlot_];
+
+	// The child can be visited before the next update of the cache
+	ccTransformCacheUpdateSubtree(cache, slot);
+}
+
+-(void) childLeavesTransformCache:(CCNode*)child
+{
+	ccTransformCache *cache = transformCache_;
+	if( ! cache || child->ownsTransformCache_ )
+		return;
+
+	if( ! cache->invalid )
+		ccTransformCacheRemove(cache, child->transformSlot_);
+
+	[child leaveTransformCache:cache];
+}
+
+// Root of a cached visit: brings the cache up to date and draws the tree with it.
+-(void) visitWithTransformCache
+{
+	if( ! transformCache_ ) {
+		transformCache_ = ccTransformCacheNew();
+		ccTransformCacheInvalidate(transformCache_);
+	}
+
+	ccTransformCache *cache = transformCache_;
+	if( cache->invalid ) {
+		ccTransformCacheClear(cache);
+		[self addToTransformCache:cache parent:-1];
+	} else
+		ccTransformCacheFlush(cache, UpdateLocalTransform);
+
+	kmMat4 base;
+	kmGLGetMatrix(KM_GL_MODELVIEW, &base);
+	ccTransformCacheSetBase(cache, base.mat);
+	ccTransformCacheUpdate(cache);
+
+	kmGLPushMatrix();
+
+	ccTransformCache *previousCache = visitTransformCache_;
+	CCNode *previousLoaded = loadedTransformNode_;
+	visitTransformCache_ = cache;
+	loadedTransformNode_ = nil;
+
+	[self visitCached];
+
+	visitTransformCache_ = previousCache;
+	loadedTransformNode_ = previousLoaded;
+
+	kmGLPopMatrix();
+}
+
+// Same as visit, but the transform is read from the cache instead of multiplied into the matrix stack
+-(void) visitCached
+{
+	ccTransformCache *cache = transformCache_;
+	unsigned int slot = transformSlot_;
+
+	// The transform changed after the cache was updated. eg: CCParallaxNode moves its children in visit
+	if( ccTransformCacheIsQueued(cache, slot) ) {
+		[self updateTransformCacheLocal];
+		ccTransformCacheUpdateSubtree(cache, slot);
+	}
+
+	if(children_) {
+
+		[self sortAllChildren];
+
+		ccArray *arrayData = children_->data;
+		NSUInteger i = 0;
+
+		// draw children zOrder < 0
+		for( ; i < arrayData->num; i++ ) {
+			CCNode *child = arrayData->arr[i];
+			if ( [child zOrder] < 0 ) {
+				LoadCachedTransform(self, cache, slot);
+				[child visit];
+			} else
+				break;
+		}
+
+		// self draw
+		LoadCachedTransform(self, cache, slot);
+		[self draw];
+
+		// draw children zOrder >= 0
+		for( ; i < arrayData->num; i++ ) {
+			CCNode *child =  arrayData->arr[i];
+			LoadCachedTransform(self, cache, slot);
+			[child visit];
+		}
+
+	} else {
+		LoadCachedTransform(self, cache, slot);
+		[self draw];
+	}
+
+	// reset for next frame
+	orderOfArrival_ = 0;
 }
 
+#endif // CC_NODE_TRANSFORM_CACHE
+
 #pragma mark CCNode - Transformations
 
 -(void) transformAncestors
@@ -752,6 +1040,11 @@ static NSUInteger globalOrderOfArrival = 1;
 
 #pragma mark CCNode Transform
 
+-(void) markTransformDirty
+{
+	SET_TRANSFORM_DIRTY();
+}
+
 - (CGAffineTransform)nodeToParentTransform
 {
 	if ( isTransformDirty_ ) {
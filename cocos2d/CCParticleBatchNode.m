@@ -401,8 +401,10 @@
 //sets a 0'd quad into the quads array
 -(void) disableParticle:(NSUInteger)particleIndex
 {
-	ccV3F_C4B_T2F_Quad* quad = &((textureAtlas_.quads)[particleIndex]);
+	ccV3F_C4B_T2F_Quad* quad = &((textureAtlas_.rawQuads)[particleIndex]);
 	quad->br.vertices.x = quad->br.vertices.y = quad->tr.vertices.x = quad->tr.vertices.y = quad->tl.vertices.x = quad->tl.vertices.y = quad->bl.vertices.x = quad->bl.vertices.y = 0.0f;
+
+	[textureAtlas_ markDirtyQuadsFromIndex:particleIndex amount:1];
 }
 
 #pragma mark CCParticleBatchNode - add / remove / reorder helper methods
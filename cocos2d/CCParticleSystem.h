@@ -262,8 +262,10 @@ typedef void (*CC_UPDATE_PARTICLE_IMP)(id, SEL, tCCParticle*, CGPoint);
 	// end angle ariance
 	float endSpinVar;
 
-	// Array of particles 粒子数组
+	// Array of particles 粒子数组, NULL if particleArrays_ is used
 	tCCParticle *particles;
+	// the particles in a structure of arrays, see CC_PARTICLE_SYSTEM_ARRAYS
+	struct _ccParticleArrays *particleArrays_;
 	// Maximum particles 最大值
 	NSUInteger totalParticles;
 	// Count of active particles  激活的粒子
@@ -444,6 +446,16 @@ typedef void (*CC_UPDATE_PARTICLE_IMP)(id, SEL, tCCParticle*, CGPoint);
 
 //! should be overriden by subclasses
 -(void) updateQuadWithParticle:(tCCParticle*)particle newPosition:(CGPoint)pos;
+/** should be overriden by subclasses that return YES in usesParticleArrays.
+ Updates the quads of all the live particles. currentPosition is the position used for kCCPositionTypeFree and kCCPositionTypeRelative.
+ @since v2.0
+ */
+-(void) updateQuadsWithCurrentPosition:(CGPoint)currentPosition;
+/** whether the particles are kept in a structure of arrays instead of the particles array. It is called once, by initWithTotalParticles:.
+ Returns NO by default.
+ @since v2.0
+ */
+-(BOOL) usesParticleArrays;
 //! should be overriden by subclasses 子类重载
 -(void) postStep;
 
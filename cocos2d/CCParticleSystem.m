@@ -60,6 +60,7 @@
 #import "Support/base64.h"
 #import "Support/ZipUtils.h"
 #import "Support/CCFileUtils.h"
+#import "Support/ccParticleArrays.h"
 
 @interface CCParticleSystem ()
 -(void) updateBlendFunc;
@@ -275,9 +276,12 @@
 
 		totalParticles = numberOfParticles;
 
-		particles = calloc( totalParticles, sizeof(tCCParticle) );
+		if( [self usesParticleArrays] )
+			particleArrays_ = ccParticleArraysNew( (unsigned int) totalParticles );
+		else
+			particles = calloc( totalParticles, sizeof(tCCParticle) );
 
-		if( ! particles ) {
+		if( ! particles && ! particleArrays_ ) {
 			CCLOG(@"Particle system: not enough memory");
 			[self release];
 			return nil;
@@ -324,6 +328,7 @@
 	[self unscheduleUpdate];
 
 	free( particles );
+	ccParticleArraysFree( particleArrays_ );
 
 	[texture_ release];
 
@@ -425,11 +430,59 @@
 	}
 }
 
+// Copies a particle into the particle arrays
+static void StoreParticle(ccParticleArrays *arrays, NSUInteger i, const tCCParticle *p, NSInteger mode)
+{
+	arrays->timeToLive[i] = p->timeToLive;
+	arrays->posX[i] = p->pos.x;
+	arrays->posY[i] = p->pos.y;
+	arrays->startPosX[i] = p->startPos.x;
+	arrays->startPosY[i] = p->startPos.y;
+
+	arrays->colorR[i] = p->color.r;
+	arrays->colorG[i] = p->color.g;
+	arrays->colorB[i] = p->color.b;
+	arrays->colorA[i] = p->color.a;
+	arrays->deltaColorR[i] = p->deltaColor.r;
+	arrays->deltaColorG[i] = p->deltaColor.g;
+	arrays->deltaColorB[i] = p->deltaColor.b;
+	arrays->deltaColorA[i] = p->deltaColor.a;
+
+	arrays->size[i] = p->size;
+	arrays->deltaSize[i] = p->deltaSize;
+	arrays->rotation[i] = p->rotation;
+	arrays->deltaRotation[i] = p->deltaRotation;
+
+	if( mode == kCCParticleModeGravity ) {
+		arrays->mode.A.dirX[i] = p->mode.A.dir.x;
+		arrays->mode.A.dirY[i] = p->mode.A.dir.y;
+		arrays->mode.A.radialAccel[i] = p->mode.A.radialAccel;
+		arrays->mode.A.tangentialAccel[i] = p->mode.A.tangentialAccel;
+	} else {
+		arrays->mode.B.angle[i] = p->mode.B.angle;
+		arrays->mode.B.degreesPerSecond[i] = p->mode.B.degreesPerSecond;
+		arrays->mode.B.radius[i] = p->mode.B.radius;
+		arrays->mode.B.deltaRadius[i] = p->mode.B.deltaRadius;
+	}
+}
+
 -(BOOL) addParticle
 {
 	if( [self isFull] )
 		return NO;
 
+	if( particleArrays_ ) {
+		tCCParticle particle;
+		memset( &particle, 0, sizeof(particle) );
+
+		[self initParticle: &particle];
+		StoreParticle( particleArrays_, particleCount, &particle, emitterMode_ );
+		particleCount++;
+		particleArrays_->count = (unsigned int) particleCount;
+
+		return YES;
+	}
+
 	tCCParticle * particle = &particles[ particleCount ];
 
 	[self initParticle: particle];
@@ -449,6 +502,13 @@
 {
 	active = YES;
 	elapsed = 0;
+
+	if( particleArrays_ ) {
+		for(particleIdx = 0; particleIdx < particleCount; ++particleIdx)
+			particleArrays_->timeToLive[particleIdx] = 0;
+		return;
+	}
+
 	for(particleIdx = 0; particleIdx < particleCount; ++particleIdx) {
 		tCCParticle *p = &particles[particleIdx];
 		p->timeToLive = 0;
@@ -493,8 +553,38 @@
 	else if( positionType_ == kCCPositionTypeRelative )
 		currentPosition = position_;
 
-	if (visible_)
+	if (visible_ && particleArrays_)
+	{
+		NSUInteger oldCount = particleCount;
+
+		if( emitterMode_ == kCCParticleModeGravity )
+			particleCount = ccParticleArraysUpdateGravity(particleArrays_, dt, mode.A.gravity.x, mode.A.gravity.y);
+		else
+			particleCount = ccParticleArraysUpdateRadius(particleArrays_, dt);
+
+		// the live particles are the first ones, disable the quads of the ones that died
+		if (batchNode_)
+		{
+			for( NSUInteger i = particleCount; i < oldCount; i++ )
+				[batchNode_ disableParticle:(atlasIndex_+i)];
+		}
+
+		[self updateQuadsWithCurrentPosition:currentPosition];
+		particleIdx = particleCount;
+
+		if( particleCount == 0 && oldCount > 0 && autoRemoveOnFinish_ ) {
+			[self unscheduleUpdate];
+			[parent_ removeChild:self cleanup:YES];
+			return;
+		}
+
+		transformSystemDirty_ = NO;
+	}
+	else if (visible_)
 	{
+		// the quads written into the batch node are [atlasIndex_, atlasIndex_ + dirtyCount)
+		NSUInteger dirtyCount = 0;
+
 		while( particleIdx < particleCount )
 		{
 			tCCParticle *p = &particles[particleIdx];
@@ -572,6 +662,8 @@
 				{
 					newPos.x+=position_.x;
 					newPos.y+=position_.y;
+
+					dirtyCount = MAX( dirtyCount, p->atlasIndex+1 );
 				}
 
 				updateParticleImp(self, updateParticleSel, p, newPos);
@@ -604,6 +696,10 @@
 				}
 			}
 		}//while
+
+		if (batchNode_ && dirtyCount)
+			[[batchNode_ textureAtlas] markDirtyQuadsFromIndex:atlasIndex_ amount:dirtyCount];
+
 		transformSystemDirty_ = NO;
 	}
 
@@ -623,6 +719,16 @@
 	// should be overriden
 }
 
+-(void) updateQuadsWithCurrentPosition:(CGPoint)currentPosition
+{
+	// should be overriden
+}
+
+-(BOOL) usesParticleArrays
+{
+	return NO;
+}
+
 -(void) postStep
 {
 	// should be overriden
@@ -848,7 +954,8 @@
 
 		batchNode_ = batchNode; // weak reference
 
-		if( batchNode ) {
+		// the particle arrays use the quads in order
+		if( batchNode && particles ) {
 			//each particle needs a unique index
 			for (int i = 0; i < totalParticles; i++)
 			{
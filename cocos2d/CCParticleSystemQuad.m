@@ -49,6 +49,7 @@
 #import "Support/CGPointExtension.h"
 #import "Support/TransformUtils.h"
 #import "Support/NSThread+performBlock.h"
+#import "Support/ccParticleArrays.h"
 
 // extern
 #import "kazmath/GL/matrix.h"
@@ -116,19 +117,24 @@
         size_t quadsSize = sizeof(quads_[0]) * tp * 1;
         size_t indicesSize = sizeof(indices_[0]) * tp * 6 * 1;
         
-        tCCParticle* particlesNew = realloc(particles, particlesSize);
+        tCCParticle* particlesNew = particleArrays_ ? NULL : realloc(particles, particlesSize);
         ccV3F_C4B_T2F_Quad *quadsNew = realloc(quads_, quadsSize);
         GLushort* indicesNew = realloc(indices_, indicesSize);
         
-        if (particlesNew && quadsNew && indicesNew)
+        if ((particlesNew || particleArrays_) && quadsNew && indicesNew)
         {
             // Assign pointers
             particles = particlesNew;
             quads_ = quadsNew;
             indices_ = indicesNew;
             
+            // the particle arrays keep the live particles
+            if (particleArrays_)
+                ccParticleArraysResize(particleArrays_, (unsigned int)tp);
+            
             // Clear the memory
-            memset(particles, 0, particlesSize);
+            if (particles)
+                memset(particles, 0, particlesSize);
             memset(quads_, 0, quadsSize);
             memset(indices_, 0, indicesSize);
             
@@ -148,7 +154,7 @@
         totalParticles = tp;
         
         // Init particles
-        if (batchNode_)
+        if (batchNode_ && particles)
 		{
 			for (int i = 0; i < totalParticles; i++)
 			{
@@ -256,9 +262,11 @@
 	NSUInteger start, end;
 	if (batchNode_)
 	{
-		quads = [[batchNode_ textureAtlas] quads];
+		CCTextureAtlas *atlas = [batchNode_ textureAtlas];
+		quads = [atlas rawQuads];
 		start = atlasIndex_;
 		end = atlasIndex_ + totalParticles;
+		[atlas markDirtyQuadsFromIndex:start amount:totalParticles];
 	}
 	else
 	{
@@ -328,9 +336,10 @@
 {
 	ccV3F_C4B_T2F_Quad *quad;
 
+	// the quads of a batch node are marked as modified once, by update:
 	if (batchNode_)
 	{
-		ccV3F_C4B_T2F_Quad *batchQuads = [[batchNode_ textureAtlas] quads];
+		ccV3F_C4B_T2F_Quad *batchQuads = [[batchNode_ textureAtlas] rawQuads];
 		quad = &(batchQuads[atlasIndex_+p->atlasIndex]);
 	}
 	else
@@ -402,6 +411,40 @@
 	}
 }
 
+-(BOOL) usesParticleArrays
+{
+#if CC_PARTICLE_SYSTEM_ARRAYS && CC_PARTICLE_ARRAYS_SIMD
+	// subclasses that update the particles or their quads one by one need the particles array
+	SEL updateSel = @selector(update:);
+	SEL updateQuadSel = @selector(updateQuadWithParticle:newPosition:);
+	return [self methodForSelector:updateSel] == [CCParticleSystemQuad instanceMethodForSelector:updateSel] &&
+		[self methodForSelector:updateQuadSel] == [CCParticleSystemQuad instanceMethodForSelector:updateQuadSel];
+#else
+	return NO;
+#endif
+}
+
+-(void) updateQuadsWithCurrentPosition:(CGPoint)currentPosition
+{
+	ccV3F_C4B_T2F_Quad *quads = quads_;
+	CGPoint offset = CGPointZero;
+
+	if (batchNode_)
+	{
+		CCTextureAtlas *atlas = [batchNode_ textureAtlas];
+		quads = [atlas rawQuads] + atlasIndex_;
+		[atlas markDirtyQuadsFromIndex:atlasIndex_ amount:particleCount];
+
+		// translate to the correct position, since matrix transform isn't performed in batchnode
+		offset = position_;
+	}
+
+	BOOL startPositions = ( positionType_ == kCCPositionTypeFree || positionType_ == kCCPositionTypeRelative );
+
+	ccParticleArraysUpdateQuads(particleArrays_, (float*)quads, currentPosition.x, currentPosition.y,
+								startPositions, offset.x, offset.y, opacityModifyRGB_);
+}
+
 -(void) postStep
 {
 	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0] );
@@ -454,9 +497,10 @@
 		else if( ! oldBatch )
 		{
 			// copy current state to batch
-			ccV3F_C4B_T2F_Quad *batchQuads = [[batchNode_ textureAtlas] quads];
-			ccV3F_C4B_T2F_Quad *quad = &(batchQuads[atlasIndex_] );
+			CCTextureAtlas *atlas = [batchNode_ textureAtlas];
+			ccV3F_C4B_T2F_Quad *quad = &([atlas rawQuads][atlasIndex_] );
 			memcpy( quad, quads_, totalParticles * sizeof(quads_[0]) );
+			[atlas markDirtyQuadsFromIndex:atlasIndex_ amount:totalParticles];
 
 			if (quads_)
 				free(quads_);
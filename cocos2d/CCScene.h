@@ -36,6 +36,9 @@
  additional logic.
 
  It is a good practice to use and CCScene as the parent of all your nodes.
+
+ If CC_NODE_TRANSFORM_CACHE is enabled, the scene keeps the world transforms of its nodes
+ in a ccTransformCache, and the nodes load their modelview matrix from it when they are visited.
 */
 @interface CCScene : CCNode
 {
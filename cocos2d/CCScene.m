@@ -38,6 +38,11 @@
 		self.ignoreAnchorPointForPosition = YES;
 		anchorPoint_ = ccp(0.5f, 0.5f);
 		[self setContentSize:s];
+
+#if CC_NODE_TRANSFORM_CACHE
+		// the scene keeps the world transforms of all its nodes
+		ownsTransformCache_ = YES;
+#endif
 	}
 
 	return self;
@@ -624,24 +624,7 @@
 {
 	if (isReorderChildDirty_)
 	{
-		NSInteger i,j,length = children_->data->num;
-		CCNode** x = children_->data->arr;
-		CCNode *tempItem;
-
-		// insertion sort
-		for(i=1; i<length; i++)
-		{
-			tempItem = x[i];
-			j = i-1;
-
-			//continue moving element downwards while zOrder is smaller or when zOrder is the same but orderOfArrival is smaller
-			while(j>=0 && ( tempItem.zOrder < x[j].zOrder || ( tempItem.zOrder == x[j].zOrder && tempItem.orderOfArrival < x[j].orderOfArrival ) ) )
-			{
-				x[j+1] = x[j];
-				j = j-1;
-			}
-			x[j+1] = tempItem;
-		}
+		[self sortChildrenByZOrder];
 
 		if ( batchNode_)
 			[children_ makeObjectsPerformSelector:@selector(sortAllChildren)];
@@ -58,6 +58,9 @@
 
 	// all descendants: chlidren, gran children, etc... 所有子对象
 	CCArray	*descendants_;
+
+	// new order of the descendants and quads, see sortAllChildren
+	struct _ccOrderPermutation *atlasOrder_;
 }
 
 /** returns the TextureAtlas that is used  返回纹理集*/
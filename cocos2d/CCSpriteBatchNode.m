@@ -40,6 +40,7 @@
 #import "Support/CGPointExtension.h"
 #import "Support/TransformUtils.h"
 #import "Support/CCProfiling.h"
+#import "Support/ccOrderSort.h"
 //配置，精灵，网格，绘制单元，着色缓存，着色方案，状态缓存，导演，点扩展，过渡，分析器
 // external
 #import "kazmath/GL/matrix.h"
@@ -50,7 +51,9 @@ const NSUInteger defaultCapacity = 29;
 #pragma mark CCSpriteBatchNode
 
 @interface CCSpriteBatchNode (private)
--(void) updateAtlasIndex:(CCSprite*) sprite currentIndex:(NSInteger*) curIndex;
+-(void) updateAtlasIndex:(CCSprite*) sprite currentIndex:(NSInteger*) curIndex swap:(BOOL) swap;
+-(void) moveSprite:(CCSprite*) sprite toAtlasIndex:(NSInteger*) curIndex swap:(BOOL) swap;
+-(void) reorderAtlas;
 -(void) swap:(NSInteger) oldIndex withNewIndex:(NSInteger) newIndex;
 -(void) updateBlendFunc;
 @end
@@ -130,6 +133,7 @@ const NSUInteger defaultCapacity = 29;
 {
 	[textureAtlas_ release];
 	[descendants_ release];
+	ccOrderPermutationFree(atlasOrder_);
 
 	[super dealloc];
 }
@@ -237,26 +241,9 @@ const NSUInteger defaultCapacity = 29;
 {
 	if (isReorderChildDirty_)
 	{
-		NSInteger i,j,length = children_->data->num;
-		CCNode ** x = children_->data->arr;
-		CCNode *tempItem;
 		CCSprite *child;
 
-		//insertion sort
-		for(i=1; i<length; i++)
-		{
-			tempItem = x[i];
-			j = i-1;
-
-			//continue moving element downwards while zOrder is smaller or when zOrder is the same but orderOfArrival is smaller
-			while(j>=0 && ( tempItem.zOrder < x[j].zOrder || ( tempItem.zOrder == x[j].zOrder && tempItem.orderOfArrival < x[j].orderOfArrival ) ) )
-			{
-				x[j+1] = x[j];
-				j--;
-			}
-
-			x[j+1] = tempItem;
-		}
+		BOOL fewMoved = [self sortChildrenByZOrder];
 
 		//sorted now check all children
 		if ([children_ count] > 0)
@@ -266,31 +253,46 @@ const NSUInteger defaultCapacity = 29;
 
 			NSInteger index=0;
 
-			//fast dispatch, give every child a new atlasIndex based on their relative zOrder (keep parent -> child relations intact)
-			// and at the same time reorder descedants and the quads to the right index
-			CCARRAY_FOREACH(children_, child)
-				[self updateAtlasIndex:child currentIndex:&index];
+			// few children moved: swapping them one by one is cheaper than moving every descendant and quad
+			BOOL swap = fewMoved;
+
+			if( ! swap ) {
+				NSUInteger count = [descendants_ count];
+				if( ! atlasOrder_ )
+					atlasOrder_ = ccOrderPermutationNew();
+				ccOrderPermutationReserve(atlasOrder_, (unsigned int)count);
+
+				//fast dispatch, give every child a new atlasIndex based on their relative zOrder (keep parent -> child relations intact)
+				// then move the descendants and the quads to their new index at once
+				CCARRAY_FOREACH(children_, child)
+					[self updateAtlasIndex:child currentIndex:&index swap:NO];
+
+				if( index == count && ccOrderPermutationIsValid(atlasOrder_, (unsigned int)count) )
+					[self reorderAtlas];
+				else {
+					// the children don't match the descendants, reorder them one by one
+					swap = YES;
+				}
+			}
+
+			if( swap ) {
+				index = 0;
+				CCARRAY_FOREACH(children_, child)
+					[self updateAtlasIndex:child currentIndex:&index swap:YES];
+			}
 		}
 
 		isReorderChildDirty_=NO;
 	}
 }
 
--(void) updateAtlasIndex:(CCSprite*) sprite currentIndex:(NSInteger*) curIndex
+-(void) updateAtlasIndex:(CCSprite*) sprite currentIndex:(NSInteger*) curIndex swap:(BOOL) swap
 {
 	CCArray *array = [sprite children];
 	NSUInteger count = [array count];
-	NSInteger oldIndex;
 
 	if( count == 0 )
-	{
-		oldIndex = sprite.atlasIndex;
-		sprite.atlasIndex = *curIndex;
-		sprite.orderOfArrival = 0;
-		if (oldIndex != *curIndex)
-			[self swap:oldIndex withNewIndex:*curIndex];
-		(*curIndex)++;
-	}
+		[self moveSprite:sprite toAtlasIndex:curIndex swap:swap];
 	else
 	{
 		BOOL needNewIndex=YES;
@@ -298,12 +300,7 @@ const NSUInteger defaultCapacity = 29;
 		if (((CCSprite*) (array->data->arr[0])).zOrder >= 0)
 		{
 			//all children are in front of the parent
-			oldIndex = sprite.atlasIndex;
-			sprite.atlasIndex = *curIndex;
-			sprite.orderOfArrival = 0;
-			if (oldIndex != *curIndex)
-				[self swap:oldIndex withNewIndex:*curIndex];
-			(*curIndex)++;
+			[self moveSprite:sprite toAtlasIndex:curIndex swap:swap];
 
 			needNewIndex = NO;
 		}
@@ -313,35 +310,74 @@ const NSUInteger defaultCapacity = 29;
 		{
 			if (needNewIndex && child.zOrder >= 0)
 			{
-				oldIndex = sprite.atlasIndex;
-				sprite.atlasIndex = *curIndex;
-				sprite.orderOfArrival = 0;
-				if (oldIndex != *curIndex)
-					[self swap:oldIndex withNewIndex:*curIndex];
-				(*curIndex)++;
+				[self moveSprite:sprite toAtlasIndex:curIndex swap:swap];
 				needNewIndex = NO;
 
 			}
 
-			[self updateAtlasIndex:child currentIndex:curIndex];
+			[self updateAtlasIndex:child currentIndex:curIndex swap:swap];
 		}
 
 		if (needNewIndex)
 		{//all children have a zOrder < 0)
-			oldIndex=sprite.atlasIndex;
-			sprite.atlasIndex=*curIndex;
-			sprite.orderOfArrival=0;
-			if (oldIndex!=*curIndex)
-				[self swap:oldIndex withNewIndex:*curIndex];
-			(*curIndex)++;
+			[self moveSprite:sprite toAtlasIndex:curIndex swap:swap];
 		}
 	}
 }
+
+// Gives the sprite the next atlas index. With swap, the sprite and its quad are swapped into place right away.
+// Otherwise its current index is recorded, and reorderAtlas moves all of them later
+-(void) moveSprite:(CCSprite*) sprite toAtlasIndex:(NSInteger*) curIndex swap:(BOOL) swap
+{
+	if( swap ) {
+		NSInteger oldIndex = sprite.atlasIndex;
+		sprite.atlasIndex = *curIndex;
+		sprite.orderOfArrival = 0;
+		if (oldIndex != *curIndex)
+			[self swap:oldIndex withNewIndex:*curIndex];
+	}
+
+	// sortAllChildren falls back to swapping when there are more sprites than descendants
+	else if( (NSUInteger)*curIndex < atlasOrder_->capacity )
+		atlasOrder_->from[*curIndex] = (unsigned int)sprite.atlasIndex;
+
+	(*curIndex)++;
+}
+
+// Moves the descendants and the quads to the atlas indexes recorded by moveSprite:toAtlasIndex:swap:, in one pass
+-(void) reorderAtlas
+{
+	NSUInteger count = [descendants_ count];
+	const unsigned int *from = atlasOrder_->from;
+
+	NSUInteger first = 0;
+	while( first < count && from[first] == first )
+		first++;
+
+	if( first < count ) {
+		NSUInteger last = count - 1;
+		while( from[last] == last )
+			last--;
+
+		ccOrderPermute(atlasOrder_, descendants_->data->arr, sizeof(id), (unsigned int)count);
+		ccOrderPermute(atlasOrder_, textureAtlas_.rawQuads, sizeof(ccV3F_C4B_T2F_Quad), (unsigned int)count);
+
+		[textureAtlas_ markDirtyQuadsFromIndex:first amount:last - first + 1];
+	}
+
+	CCSprite *sprite;
+	NSUInteger i = 0;
+	CCARRAY_FOREACH(descendants_, sprite) {
+		sprite.atlasIndex = i++;
+		sprite.orderOfArrival = 0;
+	}
+}
+
 //交换
 - (void) swap:(NSInteger) oldIndex withNewIndex:(NSInteger) newIndex
 {
 	id* x = descendants_->data->arr;
-	ccV3F_C4B_T2F_Quad* quads = textureAtlas_.quads;
+	ccV3F_C4B_T2F_Quad* quads = textureAtlas_.rawQuads;
 
 	id tempItem = x[oldIndex];
 	ccV3F_C4B_T2F_Quad tempItemQuad=quads[oldIndex];
@@ -353,6 +389,9 @@ const NSUInteger defaultCapacity = 29;
 	quads[oldIndex]=quads[newIndex];
 	x[newIndex]=tempItem;
 	quads[newIndex]=tempItemQuad;
+
+	[textureAtlas_ markDirtyQuadsFromIndex:oldIndex amount:1];
+	[textureAtlas_ markDirtyQuadsFromIndex:newIndex amount:1];
 }
 
 - (void) reorderBatch:(BOOL) reorder
@@ -27,6 +27,7 @@
 #import "CCTexture2D.h"
 #import "ccTypes.h"
 #import "ccConfig.h"
+#import "Support/ccDirtyRanges.h"
 
 /** A class that implements a Texture Atlas. 实现纹理集；
  * 具有属性：可以是pvr,png任意格式的纹理；更新，增加，移除，排序在运行中，容量变化，opengl组件；
@@ -50,11 +51,12 @@
 	GLushort			*indices_;
 	CCTexture2D			*texture_;
 	
-	GLuint				buffersVBO_[2]; //0: vertex  1: indices
-	BOOL				dirty_;			//indicates whether or not the array buffer of the VBO needs to be updated
+	GLuint				buffersVBO_[CC_TEXTURE_ATLAS_VBO_COUNT + 1]; //0 to count-1: vertex  count: indices
+	GLuint				currentVBO_;	//the vertex buffer that is drawn
+	ccDirtyRanges		dirtyRanges_[CC_TEXTURE_ATLAS_VBO_COUNT];	//the quads that must be uploaded to each vertex buffer
 
 #if CC_TEXTURE_ATLAS_USE_VAO
-	GLuint				VAOname_;
+	GLuint				VAOname_[CC_TEXTURE_ATLAS_VBO_COUNT];
 #endif
 }
 
@@ -64,8 +66,14 @@
 @property (nonatomic,readonly) NSUInteger capacity;
 /** Texture of the texture atlas 纹理地图 */
 @property (nonatomic,retain) CCTexture2D *texture;
-/** Quads that are going to be rendered */
+/** Quads that are going to be rendered.
+ Reading this property marks all the quads as modified. Use rawQuads and markDirtyQuadsFromIndex:amount: to upload less.
+ */
 @property (nonatomic,readwrite) ccV3F_C4B_T2F_Quad *quads;
+/** Quads that are going to be rendered. Reading this property doesn't mark them as modified.
+ @since v2.0
+ */
+@property (nonatomic,readonly) ccV3F_C4B_T2F_Quad *rawQuads;
 
 /** creates a TextureAtlas with an filename and with an initial capacity for Quads.
  * The TextureAtlas capacity can be increased in runtime.
@@ -101,6 +109,12 @@
  */
 -(void) updateQuad:(ccV3F_C4B_T2F_Quad*)quad atIndex:(NSUInteger)index;
 
+/** Marks an amount of quads starting from index as modified.
+ Call it after writing into the rawQuads array. Only the modified quads are uploaded to the VBO before the next draw.
+ @since v2.0
+ */
+-(void) markDirtyQuadsFromIndex:(NSUInteger)index amount:(NSUInteger)amount;
+
 /** Inserts a Quad (texture, vertex and color) at a certain index
  index must be between 0 and the atlas capacity - 1
  @since v0.8 插入
@@ -40,6 +40,7 @@
 @interface CCTextureAtlas ()
 -(void) setupIndices;
 -(void) mapBuffers;
+-(void) uploadQuadsFromIndex:(NSUInteger)start amount:(NSUInteger)n;
 
 #if CC_TEXTURE_ATLAS_USE_VAO
 -(void) setupVBOandVAO;
@@ -50,6 +51,15 @@
 
 //According to some tests GL_TRIANGLE_STRIP is slower, MUCH slower. Probably I'm doing something very wrong
 
+// buffersVBO_ holds the vertex buffers followed by the index buffer
+#define kCCIndexVBO CC_TEXTURE_ATLAS_VBO_COUNT
+
+// Uploads the quads [begin, end) into the bound GL_ARRAY_BUFFER. Called by ccDirtyRangesFlush()
+static void uploadQuads(unsigned int begin, unsigned int end, void *quads)
+{
+	glBufferSubData(GL_ARRAY_BUFFER, sizeof(ccV3F_C4B_T2F_Quad)*begin, sizeof(ccV3F_C4B_T2F_Quad)*(end - begin), (ccV3F_C4B_T2F_Quad*)quads + begin);
+}
+
 @implementation CCTextureAtlas
 
 @synthesize totalQuads = totalQuads_, capacity = capacity_;
@@ -117,8 +127,6 @@
 #else	
 		[self setupVBO];
 #endif
-
-		dirty_ = YES;
 	}
 
 	return self;
@@ -136,10 +144,10 @@
 	free(quads_);
 	free(indices_);
 
-	glDeleteBuffers(2, buffersVBO_);
+	glDeleteBuffers(CC_TEXTURE_ATLAS_VBO_COUNT + 1, buffersVBO_);
 
 #if CC_TEXTURE_ATLAS_USE_VAO
-	glDeleteVertexArrays(1, &VAOname_);
+	glDeleteVertexArrays(CC_TEXTURE_ATLAS_VBO_COUNT, VAOname_);
 #endif
 
 	[texture_ release];
@@ -180,30 +188,36 @@
 	// https://devforums.apple.com/thread/145566?tstart=0
 
 	void (^createVAO)(void) = ^{
-		glGenVertexArrays(1, &VAOname_);
-		glBindVertexArray(VAOname_);
+		glGenVertexArrays(CC_TEXTURE_ATLAS_VBO_COUNT, VAOname_);
 
 	#define kQuadSize sizeof(quads_[0].bl)
 
-		glGenBuffers(2, &buffersVBO_[0]);
+		glGenBuffers(CC_TEXTURE_ATLAS_VBO_COUNT + 1, &buffersVBO_[0]);
 
-		glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0]);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * capacity_, quads_, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[kCCIndexVBO]);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices_[0]) * capacity_ * 6, indices_, GL_STATIC_DRAW);
 
-		// vertices
-		glEnableVertexAttribArray(kCCVertexAttrib_Position);
-		glVertexAttribPointer(kCCVertexAttrib_Position, 3, GL_FLOAT, GL_FALSE, kQuadSize, (GLvoid*) offsetof( ccV3F_C4B_T2F, vertices));
+		// one VAO per vertex buffer, they share the index buffer
+		for( NSUInteger i = 0; i < CC_TEXTURE_ATLAS_VBO_COUNT; i++ ) {
+			glBindVertexArray(VAOname_[i]);
 
-		// colors
-		glEnableVertexAttribArray(kCCVertexAttrib_Color);
-		glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, kQuadSize, (GLvoid*) offsetof( ccV3F_C4B_T2F, colors));
+			glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[i]);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * capacity_, quads_, GL_DYNAMIC_DRAW);
 
-		// tex coords
-		glEnableVertexAttribArray(kCCVertexAttrib_TexCoords);
-		glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, kQuadSize, (GLvoid*) offsetof( ccV3F_C4B_T2F, texCoords));
+			// vertices
+			glEnableVertexAttribArray(kCCVertexAttrib_Position);
+			glVertexAttribPointer(kCCVertexAttrib_Position, 3, GL_FLOAT, GL_FALSE, kQuadSize, (GLvoid*) offsetof( ccV3F_C4B_T2F, vertices));
 
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[1]);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices_[0]) * capacity_ * 6, indices_, GL_STATIC_DRAW);
+			// colors
+			glEnableVertexAttribArray(kCCVertexAttrib_Color);
+			glVertexAttribPointer(kCCVertexAttrib_Color, 4, GL_UNSIGNED_BYTE, GL_TRUE, kQuadSize, (GLvoid*) offsetof( ccV3F_C4B_T2F, colors));
+
+			// tex coords
+			glEnableVertexAttribArray(kCCVertexAttrib_TexCoords);
+			glVertexAttribPointer(kCCVertexAttrib_TexCoords, 2, GL_FLOAT, GL_FALSE, kQuadSize, (GLvoid*) offsetof( ccV3F_C4B_T2F, texCoords));
+
+			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[kCCIndexVBO]);
+		}
 
 		glBindVertexArray(0);
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
@@ -221,7 +235,7 @@
 #else // CC_TEXTURE_ATLAS_USE_VAO
 -(void) setupVBO
 {
-	glGenBuffers(2, &buffersVBO_[0]);
+	glGenBuffers(CC_TEXTURE_ATLAS_VBO_COUNT + 1, &buffersVBO_[0]);
 	
 	[self mapBuffers];
 }
@@ -230,23 +244,57 @@
 
 -(void) mapBuffers
 {
-	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0]);
-	glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * capacity_, quads_, GL_DYNAMIC_DRAW);
+	for( NSUInteger i = 0; i < CC_TEXTURE_ATLAS_VBO_COUNT; i++ ) {
+		glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[i]);
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * capacity_, quads_, GL_DYNAMIC_DRAW);
+		ccDirtyRangesClear(&dirtyRanges_[i]);
+	}
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[1]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[kCCIndexVBO]);
 	glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(indices_[0]) * capacity_ * 6, indices_, GL_STATIC_DRAW);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
 
 	CHECK_GL_ERROR_DEBUG();
 }
 
+// Uploads the modified quads in [start, start+n). With more than one vertex buffer they are uploaded into
+// the next one, the GPU might still be drawing from the current one.
+-(void) uploadQuadsFromIndex:(NSUInteger)start amount:(NSUInteger)n
+{
+	unsigned int begin = (unsigned int)start, end = (unsigned int)(start + n);
+
+	if( ! ccDirtyRangesCount(&dirtyRanges_[currentVBO_], begin, end) )
+		return;
+
+	currentVBO_ = (currentVBO_ + 1) % CC_TEXTURE_ATLAS_VBO_COUNT;
+	ccDirtyRanges *ranges = &dirtyRanges_[currentVBO_];
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[currentVBO_]);
+
+	// If most of the quads changed, the whole buffer is specified again. Its old storage is orphaned,
+	// so the driver doesn't wait until it is no longer used.
+	if( 2 * ccDirtyRangesCount(ranges, begin, end) > capacity_ ) {
+		glBufferData(GL_ARRAY_BUFFER, sizeof(quads_[0]) * capacity_, quads_, GL_DYNAMIC_DRAW);
+		ccDirtyRangesClear(ranges);
+	}
+	else
+		ccDirtyRangesFlush(ranges, begin, end, uploadQuads, quads_);
+
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 #pragma mark TextureAtlas - Update, Insert, Move & Remove
 
 -(ccV3F_C4B_T2F_Quad *) quads
 {
 	//if someone accesses the quads directly, presume that changes will be made
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:0 amount:capacity_];
+	return quads_;
+}
+
+-(ccV3F_C4B_T2F_Quad *) rawQuads
+{
 	return quads_;
 }
 
@@ -258,7 +306,15 @@
 
 	quads_[n] = *quad;
 
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:n amount:1];
+}
+
+-(void) markDirtyQuadsFromIndex:(NSUInteger)index amount:(NSUInteger)amount
+{
+	NSAssert(index + amount <= capacity_, @"markDirtyQuadsFromIndex: Invalid index");
+
+	for( NSUInteger i = 0; i < CC_TEXTURE_ATLAS_VBO_COUNT; i++ )
+		ccDirtyRangesAdd(&dirtyRanges_[i], (unsigned int)index, (unsigned int)(index + amount));
 }
 
 -(void) insertQuad:(ccV3F_C4B_T2F_Quad*)quad atIndex:(NSUInteger)index
@@ -278,7 +334,7 @@
 
 	quads_[index] = *quad;
 
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:index amount:MAX(totalQuads_, index+1) - index];
 }
 
 -(void) insertQuads:(ccV3F_C4B_T2F_Quad*)quads atIndex:(NSUInteger)index amount:(NSUInteger) amount
@@ -308,7 +364,7 @@
 		j++;
 	}
 
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:max-amount amount:MAX(totalQuads_, max) - (max-amount)];
 }
 
 -(void) insertQuadFromIndex:(NSUInteger)oldIndex atIndex:(NSUInteger)newIndex
@@ -332,7 +388,7 @@
 	memmove( &quads_[dst],&quads_[src], sizeof(quads_[0]) * howMany );
 	quads_[newIndex] = quadsBackup;
 
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:MIN(oldIndex, newIndex) amount:howMany+1];
 }
 
 -(void) moveQuadsFromIndex:(NSUInteger)oldIndex amount:(NSUInteger) amount atIndex:(NSUInteger)newIndex
@@ -362,7 +418,8 @@
 
 	free(tempQuads);
 
-	dirty_ = YES;
+	NSUInteger first = MIN(oldIndex, newIndex);
+	[self markDirtyQuadsFromIndex:first amount:MAX(oldIndex, newIndex) + amount - first];
 }
 
 -(void) removeQuadAtIndex:(NSUInteger) index
@@ -377,7 +434,7 @@
 
 	totalQuads_--;
 
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:index amount:remaining];
 }
 
 -(void) removeQuadsAtIndex:(NSUInteger) index amount:(NSUInteger) amount
@@ -391,7 +448,7 @@
 	if ( remaining )
 		memmove( &quads_[index], &quads_[index+amount], sizeof(quads_[0]) * remaining );
 
-	dirty_ = YES;
+	[self markDirtyQuadsFromIndex:index amount:remaining];
 }
 
 -(void) removeAllQuads
@@ -438,8 +495,6 @@
 	[self setupIndices];
 	[self mapBuffers];
 
-	dirty_ = YES;
-
 	return YES;
 }
 
@@ -456,6 +511,7 @@
 		quads_[i] = quad;
 	}
 
+	[self markDirtyQuadsFromIndex:index amount:amount];
 }
 -(void) increaseTotalQuadsWith:(NSUInteger) amount
 {
@@ -467,6 +523,8 @@
 	NSAssert(newIndex + (totalQuads_ - index) <= capacity_, @"moveQuadsFromIndex move is out of bounds");
 
 	memmove(quads_ + newIndex,quads_ + index, (totalQuads_ - index) * sizeof(quads_[0]));
+
+	[self markDirtyQuadsFromIndex:newIndex amount:totalQuads_ - index];
 }
 
 #pragma mark TextureAtlas - Drawing
@@ -492,15 +550,9 @@
 	//
 
 	// XXX: update is done in draw... perhaps it should be done in a timer
-	if (dirty_) {
-		glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0]);
-		glBufferSubData(GL_ARRAY_BUFFER, sizeof(quads_[0])*start, sizeof(quads_[0]) * n , &quads_[start] );
-		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	[self uploadQuadsFromIndex:start amount:n];
 
-		dirty_ = NO;
-	}
-
-	glBindVertexArray( VAOname_ );
+	glBindVertexArray( VAOname_[currentVBO_] );
 
 #if CC_TEXTURE_ATLAS_USE_TRIANGLE_STRIP
 	glDrawElements(GL_TRIANGLE_STRIP, (GLsizei) n*6, GL_UNSIGNED_SHORT, (GLvoid*) (start*6*sizeof(indices_[0])) );
@@ -518,13 +570,11 @@
 	//
 
 #define kQuadSize sizeof(quads_[0].bl)
-	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[0]);
-    
+
 	// XXX: update is done in draw... perhaps it should be done in a timer
-	if (dirty_) {
-		glBufferSubData(GL_ARRAY_BUFFER, sizeof(quads_[0])*start, sizeof(quads_[0]) * n , &quads_[start] );
-		dirty_ = NO;
-	}
+	[self uploadQuadsFromIndex:start amount:n];
+
+	glBindBuffer(GL_ARRAY_BUFFER, buffersVBO_[currentVBO_]);
 
 	ccGLEnableVertexAttribs( kCCVertexAttribFlag_PosColorTex );
 
@@ -539,7 +589,7 @@
 
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 
-	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[1]);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffersVBO_[kCCIndexVBO]);
 
 #if CC_TEXTURE_ATLAS_USE_TRIANGLE_STRIP
 	glDrawElements(GL_TRIANGLE_STRIP, (GLsizei) n*6, GL_UNSIGNED_SHORT, (GLvoid*) (start*6*sizeof(indices_[0])) );
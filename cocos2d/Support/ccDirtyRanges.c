@@ -0,0 +1,141 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include "ccDirtyRanges.h"
+
+// Stores count sorted ranges, merging the closest ones while there are too many.
+// begin and end have room for CC_DIRTY_RANGES_MAX + 1 ranges.
+static void StoreRanges(ccDirtyRanges *ranges, unsigned int *begin, unsigned int *end, unsigned int count)
+{
+	while( count > CC_DIRTY_RANGES_MAX ) {
+		unsigned int closest = 0;
+		for( unsigned int i = 1; i + 1 < count; i++ ) {
+			if( begin[i+1] - end[i] < begin[closest+1] - end[closest] )
+				closest = i;
+		}
+
+		end[closest] = end[closest+1];
+		for( unsigned int i = closest + 1; i + 1 < count; i++ ) {
+			begin[i] = begin[i+1];
+			end[i] = end[i+1];
+		}
+		count--;
+	}
+
+	for( unsigned int i = 0; i < count; i++ ) {
+		ranges->begin[i] = begin[i];
+		ranges->end[i] = end[i];
+	}
+	ranges->count = count;
+}
+
+void ccDirtyRangesAdd(ccDirtyRanges *ranges, unsigned int begin, unsigned int end)
+{
+	if( begin >= end )
+		return;
+
+	unsigned int newBegin[CC_DIRTY_RANGES_MAX + 1], newEnd[CC_DIRTY_RANGES_MAX + 1];
+	unsigned int count = 0;
+	unsigned int i = 0;
+
+	// the ranges before the new one
+	for( ; i < ranges->count && ranges->end[i] < begin; i++ ) {
+		newBegin[count] = ranges->begin[i];
+		newEnd[count] = ranges->end[i];
+		count++;
+	}
+
+	// the ranges that overlap or touch it are merged into it
+	for( ; i < ranges->count && ranges->begin[i] <= end; i++ ) {
+		if( ranges->begin[i] < begin )
+			begin = ranges->begin[i];
+		if( ranges->end[i] > end )
+			end = ranges->end[i];
+	}
+
+	newBegin[count] = begin;
+	newEnd[count] = end;
+	count++;
+
+	// the ranges after it
+	for( ; i < ranges->count; i++ ) {
+		newBegin[count] = ranges->begin[i];
+		newEnd[count] = ranges->end[i];
+		count++;
+	}
+
+	StoreRanges(ranges, newBegin, newEnd, count);
+}
+
+unsigned int ccDirtyRangesCount(const ccDirtyRanges *ranges, unsigned int begin, unsigned int end)
+{
+	unsigned int total = 0;
+
+	for( unsigned int i = 0; i < ranges->count; i++ ) {
+		unsigned int b = ranges->begin[i] > begin ? ranges->begin[i] : begin;
+		unsigned int e = ranges->end[i] < end ? ranges->end[i] : end;
+		if( b < e )
+			total += e - b;
+	}
+
+	return total;
+}
+
+void ccDirtyRangesFlush(ccDirtyRanges *ranges, unsigned int begin, unsigned int end, ccDirtyRangesFunc func, void *userData)
+{
+	if( begin >= end )
+		return;
+
+	unsigned int newBegin[CC_DIRTY_RANGES_MAX + 1], newEnd[CC_DIRTY_RANGES_MAX + 1];
+	unsigned int count = 0;
+
+	for( unsigned int i = 0; i < ranges->count; i++ ) {
+		unsigned int rangeBegin = ranges->begin[i];
+		unsigned int rangeEnd = ranges->end[i];
+
+		if( rangeEnd <= begin || rangeBegin >= end ) {
+			newBegin[count] = rangeBegin;
+			newEnd[count] = rangeEnd;
+			count++;
+			continue;
+		}
+
+		func(rangeBegin > begin ? rangeBegin : begin, rangeEnd < end ? rangeEnd : end, userData);
+
+		// Only one range can contain [begin, end) and be split in two, so there is room for the parts
+		if( rangeBegin < begin ) {
+			newBegin[count] = rangeBegin;
+			newEnd[count] = begin;
+			count++;
+		}
+		if( rangeEnd > end ) {
+			newBegin[count] = end;
+			newEnd[count] = rangeEnd;
+			count++;
+		}
+	}
+
+	StoreRanges(ranges, newBegin, newEnd, count);
+}
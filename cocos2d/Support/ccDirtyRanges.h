@@ -0,0 +1,78 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** @file ccDirtyRanges.h
+ A small set of dirty index ranges, used by CCTextureAtlas to upload only the quads that changed.
+
+ The ranges are sorted and disjoint. Ranges that overlap or touch are merged, and when there are
+ more than CC_DIRTY_RANGES_MAX of them the two closest ones are merged too, so a range may cover
+ some clean indexes. Nothing that was marked is ever lost.
+
+ This file is plain C and doesn't depend on Objective-C or OpenGL.
+ */
+
+#ifndef __CC_DIRTY_RANGES_H
+#define __CC_DIRTY_RANGES_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of disjoint ranges. */
+#define CC_DIRTY_RANGES_MAX	8
+
+/** A set of half open ranges [begin, end). */
+typedef struct _ccDirtyRanges
+{
+	unsigned int count;
+	unsigned int begin[CC_DIRTY_RANGES_MAX];
+	unsigned int end[CC_DIRTY_RANGES_MAX];
+} ccDirtyRanges;
+
+/** Called by ccDirtyRangesFlush() for each dirty range. */
+typedef void (*ccDirtyRangesFunc)(unsigned int begin, unsigned int end, void *userData);
+
+/** Removes all the ranges. */
+static inline void ccDirtyRangesClear(ccDirtyRanges *ranges)
+{
+	ranges->count = 0;
+}
+
+/** Marks the indexes [begin, end) as dirty. Empty ranges are ignored. */
+void ccDirtyRangesAdd(ccDirtyRanges *ranges, unsigned int begin, unsigned int end);
+
+/** Returns the number of dirty indexes in [begin, end). */
+unsigned int ccDirtyRangesCount(const ccDirtyRanges *ranges, unsigned int begin, unsigned int end);
+
+/** Calls func for each dirty range in [begin, end), clipped to it, and marks [begin, end) as clean.
+ The dirty indexes outside of [begin, end) are kept.
+ */
+void ccDirtyRangesFlush(ccDirtyRanges *ranges, unsigned int begin, unsigned int end, ccDirtyRangesFunc func, void *userData);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CC_DIRTY_RANGES_H
@@ -0,0 +1,349 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ccOrderSort.h"
+
+typedef struct SortKey {
+	unsigned long long key;
+	unsigned int index;
+} SortKey;
+
+static void *ResizeArray(void *arr, unsigned int count, size_t size)
+{
+	void *ret = realloc(arr, count * size);
+	assert(ret && "ccOrderSort: out of memory");
+	return ret;
+}
+
+ccOrderSort* ccOrderSortNew(void)
+{
+	ccOrderSort *sort = calloc(1, sizeof(ccOrderSort));
+	assert(sort && "ccOrderSort: out of memory");
+	return sort;
+}
+
+void ccOrderSortFree(ccOrderSort *sort)
+{
+	if( sort == NULL )
+		return;
+
+	free(sort->entries);
+	free(sort->tmpEntries);
+	free(sort->keys);
+	free(sort->tmpKeys);
+	free(sort);
+}
+
+void ccOrderSortReserve(ccOrderSort *sort, unsigned int count)
+{
+	if( count <= sort->capacity )
+		return;
+
+	unsigned int capacity = sort->capacity ? sort->capacity : 64;
+	while( capacity < count )
+		capacity *= 2;
+
+	sort->entries = ResizeArray(sort->entries, capacity, sizeof(ccOrderEntry));
+	sort->tmpEntries = ResizeArray(sort->tmpEntries, capacity, sizeof(ccOrderEntry));
+	sort->keys = ResizeArray(sort->keys, capacity, sizeof(SortKey));
+	sort->tmpKeys = ResizeArray(sort->tmpKeys, capacity, sizeof(SortKey));
+	sort->capacity = capacity;
+}
+
+static inline int Less(const ccOrderEntry *a, const ccOrderEntry *b)
+{
+	return a->zOrder < b->zOrder || ( a->zOrder == b->zOrder && a->orderOfArrival < b->orderOfArrival );
+}
+
+// Same as the insertion sort that CCNode used to run, starting at entry first.
+// Gives up after moving the entries maxMoves times, returns 0 if it did.
+static int InsertionSort(ccOrderEntry *entries, unsigned int first, unsigned int count, unsigned long maxMoves)
+{
+	unsigned long moves = 0;
+
+	for( unsigned int i = first; i < count; i++ ) {
+		ccOrderEntry entry = entries[i];
+		unsigned int j = i;
+
+		while( j > 0 && Less(&entry, &entries[j-1]) ) {
+			entries[j] = entries[j-1];
+			j--;
+		}
+		entries[j] = entry;
+
+		moves += i - j;
+		if( moves > maxMoves )
+			return 0;
+	}
+
+	return 1;
+}
+
+// Bottom up merge sort, for keys that don't fit in 64 bits
+static void MergeSort(ccOrderSort *sort, unsigned int count)
+{
+	ccOrderEntry *src = sort->entries;
+	ccOrderEntry *dst = sort->tmpEntries;
+
+	for( unsigned int width = 1; width < count; width *= 2 ) {
+		for( unsigned int begin = 0; begin < count; begin += 2*width ) {
+			unsigned int middle = begin + width < count ? begin + width : count;
+			unsigned int end = begin + 2*width < count ? begin + 2*width : count;
+			unsigned int i = begin, j = middle, k = begin;
+
+			// take from the left run when equal, so the sort is stable
+			while( i < middle && j < end )
+				dst[k++] = Less(&src[j], &src[i]) ? src[j++] : src[i++];
+			while( i < middle )
+				dst[k++] = src[i++];
+			while( j < end )
+				dst[k++] = src[j++];
+		}
+
+		ccOrderEntry *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	if( src != sort->entries )
+		memcpy(sort->entries, src, count*sizeof(ccOrderEntry));
+}
+
+static unsigned int BitCount(unsigned long long value)
+{
+	unsigned int bits = 0;
+	while( value ) {
+		bits++;
+		value >>= 1;
+	}
+	return bits;
+}
+
+// LSD radix sort of the keys, one byte per pass. Passes where every key has the same byte are skipped.
+static void RadixSort(ccOrderSort *sort, unsigned int count, unsigned int keyBytes)
+{
+	SortKey *src = sort->keys;
+	SortKey *dst = sort->tmpKeys;
+
+	for( unsigned int byte = 0; byte < keyBytes; byte++ ) {
+		unsigned int shift = 8*byte;
+		unsigned int offsets[256] = {0};
+
+		for( unsigned int i = 0; i < count; i++ )
+			offsets[(src[i].key >> shift) & 0xff]++;
+
+		if( offsets[(src[0].key >> shift) & 0xff] == count )
+			continue;
+
+		unsigned int total = 0;
+		for( unsigned int digit = 0; digit < 256; digit++ ) {
+			unsigned int n = offsets[digit];
+			offsets[digit] = total;
+			total += n;
+		}
+
+		for( unsigned int i = 0; i < count; i++ )
+			dst[offsets[(src[i].key >> shift) & 0xff]++] = src[i];
+
+		SortKey *swap = src;
+		src = dst;
+		dst = swap;
+	}
+
+	ccOrderEntry *entries = sort->entries;
+	ccOrderEntry *sorted = sort->tmpEntries;
+	for( unsigned int i = 0; i < count; i++ )
+		sorted[i] = entries[src[i].index];
+
+	memcpy(entries, sorted, count*sizeof(ccOrderEntry));
+}
+
+int ccOrderSortEntries(ccOrderSort *sort, unsigned int count)
+{
+	assert( count <= sort->capacity && "ccOrderSort: reserve the entries first");
+
+	ccOrderEntry *entries = sort->entries;
+
+	unsigned int i = 1;
+	while( i < count && !Less(&entries[i], &entries[i-1]) )
+		i++;
+
+	if( i >= count )
+		return 0;
+
+	// Few entries, or few entries out of place. An interrupted insertion sort leaves the entries in a
+	// valid order for the radix sort, equal entries are never swapped.
+	if( InsertionSort(entries, i, count, ccOrderSortInsertionMoves(count)) )
+		return 1;
+
+	long minZ = entries[0].zOrder, maxZ = entries[0].zOrder;
+	unsigned long minArrival = entries[0].orderOfArrival, maxArrival = entries[0].orderOfArrival;
+	for( i = 1; i < count; i++ ) {
+		if( entries[i].zOrder < minZ ) minZ = entries[i].zOrder;
+		if( entries[i].zOrder > maxZ ) maxZ = entries[i].zOrder;
+		if( entries[i].orderOfArrival < minArrival ) minArrival = entries[i].orderOfArrival;
+		if( entries[i].orderOfArrival > maxArrival ) maxArrival = entries[i].orderOfArrival;
+	}
+
+	// the differences are computed unsigned, so they can't overflow
+	unsigned int zBits = BitCount((unsigned long)maxZ - (unsigned long)minZ);
+	unsigned int arrivalBits = BitCount(maxArrival - minArrival);
+
+	if( zBits + arrivalBits > 64 ) {
+		MergeSort(sort, count);
+		return 1;
+	}
+
+	SortKey *keys = sort->keys;
+	for( i = 0; i < count; i++ ) {
+		unsigned long long z = (unsigned long)entries[i].zOrder - (unsigned long)minZ;
+		unsigned long long arrival = entries[i].orderOfArrival - minArrival;
+
+		keys[i].key = zBits ? (z << arrivalBits) | arrival : arrival;
+		keys[i].index = i;
+	}
+
+	RadixSort(sort, count, (zBits + arrivalBits + 7)/8);
+	return 1;
+}
+
+// Copies an element. Quads are copied in 16 byte blocks so memcpy is inlined.
+static inline void CopyElement(char *dst, const char *src, size_t size)
+{
+	if( size == sizeof(void *) )
+		memcpy(dst, src, sizeof(void *));
+	else if( size % 16 == 0 ) {
+		for( size_t k = 0; k < size; k += 16 )
+			memcpy(dst + k, src + k, 16);
+	}
+	else
+		memcpy(dst, src, size);
+}
+
+ccOrderPermutation* ccOrderPermutationNew(void)
+{
+	ccOrderPermutation *perm = calloc(1, sizeof(ccOrderPermutation));
+	assert(perm && "ccOrderSort: out of memory");
+	return perm;
+}
+
+void ccOrderPermutationFree(ccOrderPermutation *perm)
+{
+	if( perm == NULL )
+		return;
+
+	free(perm->from);
+	free(perm->scratch);
+	free(perm);
+}
+
+void ccOrderPermutationReserve(ccOrderPermutation *perm, unsigned int count)
+{
+	if( count <= perm->capacity )
+		return;
+
+	unsigned int capacity = perm->capacity ? perm->capacity : 64;
+	while( capacity < count )
+		capacity *= 2;
+
+	perm->from = ResizeArray(perm->from, capacity, sizeof(unsigned int));
+	perm->capacity = capacity;
+}
+
+// Returns at least size bytes of scratch memory
+static void *Scratch(ccOrderPermutation *perm, size_t size)
+{
+	if( perm->scratchSize < size ) {
+		free(perm->scratch);
+		perm->scratchSize = size;
+		perm->scratch = malloc(size);
+		assert(perm->scratch && "ccOrderSort: out of memory");
+	}
+	return perm->scratch;
+}
+
+int ccOrderPermutationIsValid(ccOrderPermutation *perm, unsigned int count)
+{
+	assert( count <= perm->capacity && "ccOrderSort: reserve the permutation first");
+
+	if( count == 0 )
+		return 1;
+
+	// one flag per index
+	unsigned char *seen = Scratch(perm, count);
+	memset(seen, 0, count);
+
+	const unsigned int *from = perm->from;
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( from[i] >= count || seen[from[i]] )
+			return 0;
+		seen[from[i]] = 1;
+	}
+	return 1;
+}
+
+void ccOrderPermute(ccOrderPermutation *perm, void *array, size_t size, unsigned int count)
+{
+	assert( count <= perm->capacity && "ccOrderSort: reserve the permutation first");
+
+	// only the elements between the first and the last one that move are visited
+	const unsigned int *from = perm->from;
+	unsigned int first = 0, end = count;
+	while( first < end && from[first] == first )
+		first++;
+	while( end > first && from[end-1] == end-1 )
+		end--;
+
+	if( first == end )
+		return;
+
+	// one flag per element and room for one element
+	unsigned char *done = Scratch(perm, (end - first) + size);
+	char *saved = (char *)done + (end - first);
+	memset(done, 0, end - first);
+
+	// Follow each cycle of the permutation, so every element is copied once
+	char *elements = array;
+	for( unsigned int i = first; i < end; i++ ) {
+		if( done[i - first] || from[i] == i )
+			continue;
+
+		CopyElement(saved, elements + i*size, size);
+
+		unsigned int j = i;
+		while( from[j] != i ) {
+			CopyElement(elements + j*size, elements + from[j]*size, size);
+			done[j - first] = 1;
+			j = from[j];
+		}
+
+		CopyElement(elements + j*size, saved, size);
+		done[j - first] = 1;
+	}
+}
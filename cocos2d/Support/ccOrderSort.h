@@ -0,0 +1,130 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+/** @file ccOrderSort.h
+ Stable sort of nodes by zOrder and orderOfArrival, used to reorder the children of a node.
+
+ Short or nearly sorted arrays are insertion sorted. Otherwise both orders are packed into a
+ 64 bit key, relative to their minimum values, and the entries are sorted with an LSD radix sort
+ that skips the bytes that are the same in every key. If the key needs more than 64 bits a
+ merge sort is used. All of them keep the order of equal entries.
+
+ ccOrderPermute() moves the elements of an array to new indexes in one pass, CCSpriteBatchNode
+ uses it to reorder its descendants and quads after the sort instead of swapping them one by one.
+
+ This file is plain C and doesn't depend on Objective-C or OpenGL.
+ */
+
+#ifndef __CC_ORDER_SORT_H
+#define __CC_ORDER_SORT_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Arrays with up to this many entries are always insertion sorted. */
+#define CC_ORDER_SORT_INSERTION_MAX		32
+
+/** Longer arrays are insertion sorted until this many moves per entry, then radix sorted. */
+#define CC_ORDER_SORT_INSERTION_MOVES	2
+
+/** A node to sort. */
+typedef struct _ccOrderEntry
+{
+	long zOrder;
+	unsigned long orderOfArrival;
+	void *object;
+} ccOrderEntry;
+
+typedef struct _ccOrderSort
+{
+	// the entries to sort, filled by the caller
+	ccOrderEntry *entries;
+	unsigned int capacity;
+
+	// scratch memory
+	ccOrderEntry *tmpEntries;
+	void *keys, *tmpKeys;
+} ccOrderSort;
+
+/** New indexes for the elements of an array. */
+typedef struct _ccOrderPermutation
+{
+	// element i takes the place of the old element from[i], filled by the caller
+	unsigned int *from;
+	unsigned int capacity;
+
+	// scratch memory
+	void *scratch;
+	size_t scratchSize;
+} ccOrderPermutation;
+
+/** Returns the number of moves after which an insertion sort of count entries should give up,
+ the same budget as ccOrderSortEntries(). Callers that insertion sort their own arrays use it to decide
+ when the array is too far from sorted and ccOrderSortEntries() is cheaper.
+ */
+static inline unsigned long ccOrderSortInsertionMoves(unsigned int count)
+{
+	return count <= CC_ORDER_SORT_INSERTION_MAX ? (unsigned long)-1 : (unsigned long)CC_ORDER_SORT_INSERTION_MOVES*count;
+}
+
+/** Allocates a sorter. */
+ccOrderSort* ccOrderSortNew(void);
+
+/** Frees a sorter. Silently ignores NULL. */
+void ccOrderSortFree(ccOrderSort *sort);
+
+/** Makes room for count entries. Their content is lost. */
+void ccOrderSortReserve(ccOrderSort *sort, unsigned int count);
+
+/** Sorts the first count entries by zOrder, then by orderOfArrival. Equal entries keep their order.
+ Returns 0 if the entries were sorted already.
+ */
+int ccOrderSortEntries(ccOrderSort *sort, unsigned int count);
+
+/** Allocates a permutation. */
+ccOrderPermutation* ccOrderPermutationNew(void);
+
+/** Frees a permutation. Silently ignores NULL. */
+void ccOrderPermutationFree(ccOrderPermutation *perm);
+
+/** Makes room for count indexes in from. Their content is lost. */
+void ccOrderPermutationReserve(ccOrderPermutation *perm, unsigned int count);
+
+/** Returns 1 if the first count indexes in from are a permutation of [0, count), 0 otherwise. */
+int ccOrderPermutationIsValid(ccOrderPermutation *perm, unsigned int count);
+
+/** Reorders the first count elements of array, each one size bytes long:
+ element i is replaced by the old element from[i]. from must be a permutation of [0, count).
+ */
+void ccOrderPermute(ccOrderPermutation *perm, void *array, size_t size, unsigned int count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CC_ORDER_SORT_H
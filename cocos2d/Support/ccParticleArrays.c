@@ -0,0 +1,612 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <assert.h>
+
+#include "ccParticleArrays.h"
+
+#if CC_PARTICLE_ARRAYS_SIMD && (defined(__SSE2__) || defined(_M_X64))
+#define CC_PARTICLE_ARRAYS_SSE2
+#include <emmintrin.h>
+#elif CC_PARTICLE_ARRAYS_SIMD
+#define CC_PARTICLE_ARRAYS_NEON
+#include <arm_neon.h>
+#endif
+
+// Number of float arrays in ccParticleArrays
+#define ARRAYS	21
+
+// same as CC_DEGREES_TO_RADIANS
+#define DEGREES_TO_RADIANS	0.01745329252f
+
+static void SetArrays(ccParticleArrays *particles)
+{
+	float **arrays[ARRAYS] = {
+		&particles->timeToLive,
+		&particles->posX, &particles->posY,
+		&particles->colorR, &particles->colorG, &particles->colorB, &particles->colorA,
+		&particles->size,
+		&particles->rotation,
+		&particles->mode.A.dirX, &particles->mode.A.dirY, &particles->mode.A.radialAccel, &particles->mode.A.tangentialAccel,
+		&particles->startPosX, &particles->startPosY,
+		&particles->deltaColorR, &particles->deltaColorG, &particles->deltaColorB, &particles->deltaColorA,
+		&particles->deltaSize,
+		&particles->deltaRotation,
+	};
+
+	for( int i = 0; i < ARRAYS; i++ )
+		*arrays[i] = particles->block + i*particles->stride;
+}
+
+ccParticleArrays* ccParticleArraysNew(unsigned int capacity)
+{
+	ccParticleArrays *particles = calloc(1, sizeof(ccParticleArrays));
+	assert(particles && "ccParticleArrays: out of memory");
+
+	ccParticleArraysResize(particles, capacity);
+
+	return particles;
+}
+
+void ccParticleArraysFree(ccParticleArrays *particles)
+{
+	if( particles == NULL )
+		return;
+
+	free(particles->block);
+	free(particles);
+}
+
+void ccParticleArraysResize(ccParticleArrays *particles, unsigned int capacity)
+{
+	// every array starts on a 16 byte boundary
+	unsigned int stride = (capacity + 3) & ~3u;
+	float *block = calloc((size_t)ARRAYS*(stride ? stride : 4), sizeof(float));
+	assert(block && "ccParticleArrays: out of memory");
+
+	if( particles->count > capacity )
+		particles->count = capacity;
+
+	if( particles->block )
+		for( int i = 0; i < ARRAYS; i++ )
+			memcpy(block + i*stride, particles->block + i*particles->stride, particles->count*sizeof(float));
+
+	free(particles->block);
+	particles->block = block;
+	particles->stride = stride;
+	particles->capacity = capacity;
+	SetArrays(particles);
+}
+
+// Moves amount particles to a lower index.
+static inline void MoveParticles(ccParticleArrays *particles, unsigned int from, unsigned int to, unsigned int amount)
+{
+	float *block = particles->block;
+	unsigned int stride = particles->stride;
+
+	for( int i = 0; i < ARRAYS; i++ )
+		memmove(block + i*stride + to, block + i*stride + from, amount*sizeof(float));
+}
+
+// Same math as the loop of -[CCParticleSystem update:]. Returns 0 if the particle died.
+static inline int UpdateOne(ccParticleArrays *p, unsigned int i, float dt, int radiusMode, float gravityX, float gravityY)
+{
+	p->timeToLive[i] -= dt;
+	if( ! (p->timeToLive[i] > 0) )
+		return 0;
+
+	if( ! radiusMode ) {
+		float x = p->posX[i], y = p->posY[i];
+		float radialX = 0, radialY = 0;
+
+		// radial acceleration
+		if( x || y ) {
+			float invLength = 1.0f/sqrtf(x*x + y*y);
+			radialX = x*invLength;
+			radialY = y*invLength;
+		}
+
+		// tangential acceleration
+		float tangentialX = -radialY*p->mode.A.tangentialAccel[i];
+		float tangentialY = radialX*p->mode.A.tangentialAccel[i];
+		radialX *= p->mode.A.radialAccel[i];
+		radialY *= p->mode.A.radialAccel[i];
+
+		// (gravity + radial + tangential) * dt
+		p->mode.A.dirX[i] += (radialX + tangentialX + gravityX)*dt;
+		p->mode.A.dirY[i] += (radialY + tangentialY + gravityY)*dt;
+		p->posX[i] = x + p->mode.A.dirX[i]*dt;
+		p->posY[i] = y + p->mode.A.dirY[i]*dt;
+	} else {
+		p->mode.B.angle[i] += p->mode.B.degreesPerSecond[i]*dt;
+		p->mode.B.radius[i] += p->mode.B.deltaRadius[i]*dt;
+
+		p->posX[i] = -cosf(p->mode.B.angle[i])*p->mode.B.radius[i];
+		p->posY[i] = -sinf(p->mode.B.angle[i])*p->mode.B.radius[i];
+	}
+
+	p->colorR[i] += p->deltaColorR[i]*dt;
+	p->colorG[i] += p->deltaColorG[i]*dt;
+	p->colorB[i] += p->deltaColorB[i]*dt;
+	p->colorA[i] += p->deltaColorA[i]*dt;
+
+	float size = p->size[i] + p->deltaSize[i]*dt;
+	p->size[i] = ( 0 > size ? 0 : size );
+
+	p->rotation[i] += p->deltaRotation[i]*dt;
+
+	return 1;
+}
+
+#if defined(CC_PARTICLE_ARRAYS_SSE2)
+
+typedef __m128 FloatW;
+typedef __m128 MaskW;
+#define LoadW(p) _mm_loadu_ps(p)
+#define StoreW(p, v) _mm_storeu_ps(p, v)
+#define SetW(f) _mm_set1_ps(f)
+#define AddW(a, b) _mm_add_ps(a, b)
+#define SubW(a, b) _mm_sub_ps(a, b)
+#define MulW(a, b) _mm_mul_ps(a, b)
+#define MaxW(a, b) _mm_max_ps(a, b)
+#define MinW(a, b) _mm_min_ps(a, b)
+#define NegW(a) _mm_xor_ps(a, _mm_set1_ps(-0.0f))
+#define InvSqrtW(a) _mm_div_ps(_mm_set1_ps(1.0f), _mm_sqrt_ps(a))
+#define GreaterW(a, b) _mm_cmpgt_ps(a, b)
+#define NotEqualW(a, b) _mm_cmpneq_ps(a, b)
+#define OrM(a, b) _mm_or_ps(a, b)
+#define AndW(m, a) _mm_and_ps(m, a)
+#define BitsM(m) _mm_movemask_ps(m)
+
+// Cephes sinf() and cosf(): the argument is reduced to [-pi/4, pi/4] and the octant picks the polynomial and the sign
+static inline void SinCosW(__m128 x, __m128 *s, __m128 *c)
+{
+	__m128 signBit = _mm_set1_ps(-0.0f);
+	__m128 ax = _mm_andnot_ps(signBit, x);
+
+	__m128i j = _mm_cvttps_epi32(_mm_mul_ps(ax, _mm_set1_ps(1.27323954473516f)));
+	j = _mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(1)), _mm_set1_epi32(~1));
+	__m128 y = _mm_cvtepi32_ps(j);
+
+	__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(j, _mm_set1_epi32(2)), _mm_set1_epi32(2)));
+	__m128 sinSign = _mm_xor_ps(_mm_and_ps(x, signBit), _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(j, _mm_set1_epi32(4)), 29)));
+	__m128 cosSign = _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(j, _mm_set1_epi32(2)), _mm_set1_epi32(4)), 29));
+
+	ax = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(0.78515625f)));
+	ax = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(2.4187564849853515625e-4f)));
+	ax = _mm_sub_ps(ax, _mm_mul_ps(y, _mm_set1_ps(3.77489497744594108e-8f)));
+	__m128 z = _mm_mul_ps(ax, ax);
+
+	__m128 pc = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(2.443315711809948e-5f), z), _mm_set1_ps(-1.388731625493765e-3f));
+	pc = _mm_add_ps(_mm_mul_ps(pc, z), _mm_set1_ps(4.166664568298827e-2f));
+	pc = _mm_mul_ps(_mm_mul_ps(pc, z), z);
+	pc = _mm_add_ps(_mm_sub_ps(pc, _mm_mul_ps(z, _mm_set1_ps(0.5f))), _mm_set1_ps(1.0f));
+
+	__m128 ps = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(-1.9515295891e-4f), z), _mm_set1_ps(8.3321608736e-3f));
+	ps = _mm_add_ps(_mm_mul_ps(ps, z), _mm_set1_ps(-1.6666654611e-1f));
+	ps = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(ps, z), ax), ax);
+
+	*s = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, pc), _mm_andnot_ps(swap, ps)), sinSign);
+	*c = _mm_xor_ps(_mm_or_ps(_mm_and_ps(swap, ps), _mm_andnot_ps(swap, pc)), cosSign);
+}
+
+// Writes the corners a, b, c and d (v[0] to v[7], see UpdateQuad()) and the colors of 4 quads.
+// The colors are in [0, 255] and are packed into the bytes of ccColor4B.
+static inline void WriteQuads4(float *quads, const __m128 *v, __m128 r, __m128 g, __m128 b, __m128 a)
+{
+	__m128 zero = _mm_setzero_ps(), max = _mm_set1_ps(255.0f);
+	__m128i ri = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(r, zero), max));
+	__m128i gi = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(g, zero), max));
+	__m128i bi = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(b, zero), max));
+	__m128i ai = _mm_cvttps_epi32(_mm_min_ps(_mm_max_ps(a, zero), max));
+	__m128 colors = _mm_castsi128_ps(_mm_or_si128(_mm_or_si128(ri, _mm_slli_epi32(gi, 8)),
+												  _mm_or_si128(_mm_slli_epi32(bi, 16), _mm_slli_epi32(ai, 24))));
+
+	// bl, br, tr and tl
+	static const int vertex[4] = {6, 18, 12, 0};
+	for( int k = 0; k < 4; k++ ) {
+		__m128 xy01 = _mm_unpacklo_ps(v[2*k], v[2*k + 1]);
+		__m128 xy23 = _mm_unpackhi_ps(v[2*k], v[2*k + 1]);
+		float *position = quads + vertex[k];
+		_mm_storel_pi((__m64 *)position, xy01);
+		_mm_storeh_pi((__m64 *)(position + CC_PARTICLE_QUAD_FLOATS), xy01);
+		_mm_storel_pi((__m64 *)(position + 2*CC_PARTICLE_QUAD_FLOATS), xy23);
+		_mm_storeh_pi((__m64 *)(position + 3*CC_PARTICLE_QUAD_FLOATS), xy23);
+	}
+
+	for( int k = 0; k < 4; k++ ) {
+		float *quad = quads + k*CC_PARTICLE_QUAD_FLOATS;
+		_mm_store_ss(quad + 3, colors);
+		_mm_store_ss(quad + 9, colors);
+		_mm_store_ss(quad + 15, colors);
+		_mm_store_ss(quad + 21, colors);
+		colors = _mm_shuffle_ps(colors, colors, _MM_SHUFFLE(0, 3, 2, 1));
+	}
+}
+
+#elif defined(CC_PARTICLE_ARRAYS_NEON)
+
+typedef float32x4_t FloatW;
+typedef uint32x4_t MaskW;
+#define LoadW(p) vld1q_f32(p)
+#define StoreW(p, v) vst1q_f32(p, v)
+#define SetW(f) vdupq_n_f32(f)
+#define AddW(a, b) vaddq_f32(a, b)
+#define SubW(a, b) vsubq_f32(a, b)
+#define MulW(a, b) vmulq_f32(a, b)
+#define MaxW(a, b) vmaxq_f32(a, b)
+#define MinW(a, b) vminq_f32(a, b)
+#define NegW(a) vnegq_f32(a)
+#define InvSqrtW(a) InvSqrtNeon(a)
+#define GreaterW(a, b) vcgtq_f32(a, b)
+#define NotEqualW(a, b) vmvnq_u32(vceqq_f32(a, b))
+#define OrM(a, b) vorrq_u32(a, b)
+#define AndW(m, a) vreinterpretq_f32_u32(vandq_u32(m, vreinterpretq_u32_f32(a)))
+#define BitsM(m) BitsNeon(m)
+
+// estimate refined by two Newton-Raphson steps
+static inline float32x4_t InvSqrtNeon(float32x4_t a)
+{
+	float32x4_t e = vrsqrteq_f32(a);
+	e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a, e), e));
+	e = vmulq_f32(e, vrsqrtsq_f32(vmulq_f32(a, e), e));
+	return e;
+}
+
+static inline int BitsNeon(uint32x4_t m)
+{
+	uint32x4_t b = vshrq_n_u32(m, 31);
+	return (int)(vgetq_lane_u32(b, 0) | (vgetq_lane_u32(b, 1) << 1) | (vgetq_lane_u32(b, 2) << 2) | (vgetq_lane_u32(b, 3) << 3));
+}
+
+// Cephes sinf() and cosf(): the argument is reduced to [-pi/4, pi/4] and the octant picks the polynomial and the sign
+static inline void SinCosW(float32x4_t x, float32x4_t *s, float32x4_t *c)
+{
+	float32x4_t ax = vabsq_f32(x);
+
+	uint32x4_t j = vcvtq_u32_f32(vmulq_n_f32(ax, 1.27323954473516f));
+	j = vandq_u32(vaddq_u32(j, vdupq_n_u32(1)), vdupq_n_u32(~1u));
+	float32x4_t y = vcvtq_f32_u32(j);
+
+	uint32x4_t swap = vtstq_u32(j, vdupq_n_u32(2));
+	uint32x4_t sinSign = veorq_u32(vandq_u32(vreinterpretq_u32_f32(x), vdupq_n_u32(0x80000000u)), vshlq_n_u32(vandq_u32(j, vdupq_n_u32(4)), 29));
+	uint32x4_t cosSign = vshlq_n_u32(vandq_u32(vaddq_u32(j, vdupq_n_u32(2)), vdupq_n_u32(4)), 29);
+
+	ax = vsubq_f32(ax, vmulq_n_f32(y, 0.78515625f));
+	ax = vsubq_f32(ax, vmulq_n_f32(y, 2.4187564849853515625e-4f));
+	ax = vsubq_f32(ax, vmulq_n_f32(y, 3.77489497744594108e-8f));
+	float32x4_t z = vmulq_f32(ax, ax);
+
+	float32x4_t pc = vaddq_f32(vmulq_n_f32(z, 2.443315711809948e-5f), vdupq_n_f32(-1.388731625493765e-3f));
+	pc = vaddq_f32(vmulq_f32(pc, z), vdupq_n_f32(4.166664568298827e-2f));
+	pc = vmulq_f32(vmulq_f32(pc, z), z);
+	pc = vaddq_f32(vsubq_f32(pc, vmulq_n_f32(z, 0.5f)), vdupq_n_f32(1.0f));
+
+	float32x4_t ps = vaddq_f32(vmulq_n_f32(z, -1.9515295891e-4f), vdupq_n_f32(8.3321608736e-3f));
+	ps = vaddq_f32(vmulq_f32(ps, z), vdupq_n_f32(-1.6666654611e-1f));
+	ps = vaddq_f32(vmulq_f32(vmulq_f32(ps, z), ax), ax);
+
+	*s = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, pc, ps)), sinSign));
+	*c = vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(vbslq_f32(swap, ps, pc)), cosSign));
+}
+
+// Writes the corners a, b, c and d (v[0] to v[7], see UpdateQuad()) and the colors of 4 quads.
+// The colors are in [0, 255] and are packed into the bytes of ccColor4B.
+static inline void WriteQuads4(float *quads, const float32x4_t *v, float32x4_t r, float32x4_t g, float32x4_t b, float32x4_t a)
+{
+	float32x4_t zero = vdupq_n_f32(0.0f), max = vdupq_n_f32(255.0f);
+	uint32x4_t ri = vcvtq_u32_f32(vminq_f32(vmaxq_f32(r, zero), max));
+	uint32x4_t gi = vcvtq_u32_f32(vminq_f32(vmaxq_f32(g, zero), max));
+	uint32x4_t bi = vcvtq_u32_f32(vminq_f32(vmaxq_f32(b, zero), max));
+	uint32x4_t ai = vcvtq_u32_f32(vminq_f32(vmaxq_f32(a, zero), max));
+	uint32x4_t colors = vorrq_u32(vorrq_u32(ri, vshlq_n_u32(gi, 8)), vorrq_u32(vshlq_n_u32(bi, 16), vshlq_n_u32(ai, 24)));
+
+	// bl, br, tr and tl
+	static const int vertex[4] = {6, 18, 12, 0};
+	for( int k = 0; k < 4; k++ ) {
+		float32x4x2_t xy = vzipq_f32(v[2*k], v[2*k + 1]);
+		float *position = quads + vertex[k];
+		vst1_f32(position, vget_low_f32(xy.val[0]));
+		vst1_f32(position + CC_PARTICLE_QUAD_FLOATS, vget_high_f32(xy.val[0]));
+		vst1_f32(position + 2*CC_PARTICLE_QUAD_FLOATS, vget_low_f32(xy.val[1]));
+		vst1_f32(position + 3*CC_PARTICLE_QUAD_FLOATS, vget_high_f32(xy.val[1]));
+	}
+
+	for( int k = 3; k < CC_PARTICLE_QUAD_FLOATS; k += 6 ) {
+		vst1q_lane_u32((uint32_t *)(quads + k), colors, 0);
+		vst1q_lane_u32((uint32_t *)(quads + CC_PARTICLE_QUAD_FLOATS + k), colors, 1);
+		vst1q_lane_u32((uint32_t *)(quads + 2*CC_PARTICLE_QUAD_FLOATS + k), colors, 2);
+		vst1q_lane_u32((uint32_t *)(quads + 3*CC_PARTICLE_QUAD_FLOATS + k), colors, 3);
+	}
+}
+
+#endif
+
+#if defined(CC_PARTICLE_ARRAYS_SSE2) || defined(CC_PARTICLE_ARRAYS_NEON)
+
+// Updates the color, size and rotation of 4 particles and writes them, with their life, at index to.
+// The values that don't change are copied if to isn't i.
+static inline void UpdateCommon4(ccParticleArrays *p, unsigned int i, unsigned int to, FloatW dt, FloatW timeToLive)
+{
+	StoreW(p->timeToLive + to, timeToLive);
+
+	StoreW(p->colorR + to, AddW(LoadW(p->colorR + i), MulW(LoadW(p->deltaColorR + i), dt)));
+	StoreW(p->colorG + to, AddW(LoadW(p->colorG + i), MulW(LoadW(p->deltaColorG + i), dt)));
+	StoreW(p->colorB + to, AddW(LoadW(p->colorB + i), MulW(LoadW(p->deltaColorB + i), dt)));
+	StoreW(p->colorA + to, AddW(LoadW(p->colorA + i), MulW(LoadW(p->deltaColorA + i), dt)));
+
+	FloatW size = AddW(LoadW(p->size + i), MulW(LoadW(p->deltaSize + i), dt));
+	StoreW(p->size + to, MaxW(size, SetW(0.0f)));
+
+	StoreW(p->rotation + to, AddW(LoadW(p->rotation + i), MulW(LoadW(p->deltaRotation + i), dt)));
+
+	if( to != i ) {
+		float *constants[] = {
+			p->startPosX, p->startPosY,
+			p->deltaColorR, p->deltaColorG, p->deltaColorB, p->deltaColorA,
+			p->deltaSize, p->deltaRotation,
+		};
+		for( int k = 0; k < 8; k++ )
+			StoreW(constants[k] + to, LoadW(constants[k] + i));
+	}
+}
+
+// See UpdateOne(). The dead particles are updated too, they are removed afterwards.
+static inline void UpdateGravity4(ccParticleArrays *p, unsigned int i, unsigned int to, FloatW dt, FloatW timeToLive,
+								  FloatW gravityX, FloatW gravityY)
+{
+	FloatW x = LoadW(p->posX + i), y = LoadW(p->posY + i);
+
+	FloatW zero = SetW(0.0f);
+	MaskW nonZero = OrM(NotEqualW(x, zero), NotEqualW(y, zero));
+	FloatW invLength = InvSqrtW(AddW(MulW(x, x), MulW(y, y)));
+	FloatW radialX = AndW(nonZero, MulW(x, invLength));
+	FloatW radialY = AndW(nonZero, MulW(y, invLength));
+
+	FloatW tangentialAccel = LoadW(p->mode.A.tangentialAccel + i);
+	FloatW tangentialX = MulW(NegW(radialY), tangentialAccel);
+	FloatW tangentialY = MulW(radialX, tangentialAccel);
+	FloatW radialAccel = LoadW(p->mode.A.radialAccel + i);
+	radialX = MulW(radialX, radialAccel);
+	radialY = MulW(radialY, radialAccel);
+
+	FloatW dirX = AddW(LoadW(p->mode.A.dirX + i), MulW(AddW(AddW(radialX, tangentialX), gravityX), dt));
+	FloatW dirY = AddW(LoadW(p->mode.A.dirY + i), MulW(AddW(AddW(radialY, tangentialY), gravityY), dt));
+	StoreW(p->mode.A.dirX + to, dirX);
+	StoreW(p->mode.A.dirY + to, dirY);
+	StoreW(p->posX + to, AddW(x, MulW(dirX, dt)));
+	StoreW(p->posY + to, AddW(y, MulW(dirY, dt)));
+
+	if( to != i ) {
+		StoreW(p->mode.A.radialAccel + to, radialAccel);
+		StoreW(p->mode.A.tangentialAccel + to, tangentialAccel);
+	}
+
+	UpdateCommon4(p, i, to, dt, timeToLive);
+}
+
+static inline void UpdateRadius4(ccParticleArrays *p, unsigned int i, unsigned int to, FloatW dt, FloatW timeToLive)
+{
+	FloatW degreesPerSecond = LoadW(p->mode.B.degreesPerSecond + i);
+	FloatW deltaRadius = LoadW(p->mode.B.deltaRadius + i);
+	FloatW angle = AddW(LoadW(p->mode.B.angle + i), MulW(degreesPerSecond, dt));
+	FloatW radius = AddW(LoadW(p->mode.B.radius + i), MulW(deltaRadius, dt));
+	StoreW(p->mode.B.angle + to, angle);
+	StoreW(p->mode.B.radius + to, radius);
+
+	FloatW s, c;
+	SinCosW(angle, &s, &c);
+	StoreW(p->posX + to, MulW(NegW(c), radius));
+	StoreW(p->posY + to, MulW(NegW(s), radius));
+
+	if( to != i ) {
+		StoreW(p->mode.B.degreesPerSecond + to, degreesPerSecond);
+		StoreW(p->mode.B.deltaRadius + to, deltaRadius);
+	}
+
+	UpdateCommon4(p, i, to, dt, timeToLive);
+}
+
+#endif
+
+// Updates every particle and moves the live ones to the front, w is where the next live one goes.
+static unsigned int Update(ccParticleArrays *p, float dt, int radiusMode, float gravityX, float gravityY)
+{
+	unsigned int count = p->count;
+	unsigned int i = 0, w = 0;
+
+#if defined(CC_PARTICLE_ARRAYS_SSE2) || defined(CC_PARTICLE_ARRAYS_NEON)
+	FloatW dtW = SetW(dt), gravityXW = SetW(gravityX), gravityYW = SetW(gravityY);
+
+	for( ; i + 4 <= count; i += 4 ) {
+		FloatW timeToLive = SubW(LoadW(p->timeToLive + i), dtW);
+		int alive = BitsM(GreaterW(timeToLive, SetW(0.0f)));
+
+		// 4 live particles are written where they go, otherwise they are updated in place and moved one by one
+		unsigned int to = ( alive == 0xf ? w : i );
+		if( radiusMode )
+			UpdateRadius4(p, i, to, dtW, timeToLive);
+		else
+			UpdateGravity4(p, i, to, dtW, timeToLive, gravityXW, gravityYW);
+
+		if( alive == 0xf )
+			w += 4;
+		else {
+			for( unsigned int k = 0; k < 4; k++ ) {
+				if( alive & (1 << k) ) {
+					if( w != i + k )
+						MoveParticles(p, i + k, w, 1);
+					w++;
+				}
+			}
+		}
+	}
+#endif
+
+	for( ; i < count; i++ ) {
+		if( UpdateOne(p, i, dt, radiusMode, gravityX, gravityY) ) {
+			if( w != i )
+				MoveParticles(p, i, w, 1);
+			w++;
+		}
+	}
+
+	p->count = w;
+	return w;
+}
+
+unsigned int ccParticleArraysUpdateGravity(ccParticleArrays *particles, float dt, float gravityX, float gravityY)
+{
+	return Update(particles, dt, 0, gravityX, gravityY);
+}
+
+unsigned int ccParticleArraysUpdateRadius(ccParticleArrays *particles, float dt)
+{
+	return Update(particles, dt, 1, 0, 0);
+}
+
+// The vertices are tl, bl, tr and br. The color goes in the 4th float of each vertex.
+static inline void WriteQuad(float *quad, const unsigned char *color,
+							 float ax, float ay, float bx, float by, float cx, float cy, float dx, float dy)
+{
+	quad[0] = dx;  quad[1] = dy;  memcpy(quad + 3, color, 4);
+	quad[6] = ax;  quad[7] = ay;  memcpy(quad + 9, color, 4);
+	quad[12] = cx; quad[13] = cy; memcpy(quad + 15, color, 4);
+	quad[18] = bx; quad[19] = by; memcpy(quad + 21, color, 4);
+}
+
+// Same as the float to GLubyte conversion of CCParticleSystemQuad, but clamped
+static inline unsigned char ColorByte(float f)
+{
+	return ( f > 0 ? ( f < 255 ? (unsigned char)f : 255 ) : 0 );
+}
+
+// Same math as -[CCParticleSystemQuad updateQuadWithParticle:newPosition:]: a is the bottom left corner,
+// b the bottom right, c the top right and d the top left.
+static inline void UpdateQuad(const ccParticleArrays *p, unsigned int i, float *quad, float x, float y, int opacityModifyRGB)
+{
+	float r = p->colorR[i], g = p->colorG[i], b = p->colorB[i], a = p->colorA[i];
+	unsigned char color[4];
+	if( opacityModifyRGB ) {
+		color[0] = ColorByte(r*a*255); color[1] = ColorByte(g*a*255); color[2] = ColorByte(b*a*255);
+	} else {
+		color[0] = ColorByte(r*255); color[1] = ColorByte(g*255); color[2] = ColorByte(b*255);
+	}
+	color[3] = ColorByte(a*255);
+
+	float size_2 = p->size[i]/2;
+	if( p->rotation[i] ) {
+		float x1 = -size_2, y1 = -size_2;
+		float x2 = size_2, y2 = size_2;
+
+		float rad = -(p->rotation[i]*DEGREES_TO_RADIANS);
+		float cr = cosf(rad), sr = sinf(rad);
+
+		WriteQuad(quad, color,
+				  x1*cr - y1*sr + x, x1*sr + y1*cr + y,
+				  x2*cr - y1*sr + x, x2*sr + y1*cr + y,
+				  x2*cr - y2*sr + x, x2*sr + y2*cr + y,
+				  x1*cr - y2*sr + x, x1*sr + y2*cr + y);
+	} else {
+		WriteQuad(quad, color,
+				  x - size_2, y - size_2,
+				  x + size_2, y - size_2,
+				  x + size_2, y + size_2,
+				  x - size_2, y + size_2);
+	}
+}
+
+void ccParticleArraysUpdateQuads(const ccParticleArrays *p, float *quads, float currentX, float currentY,
+								 int startPositions, float offsetX, float offsetY, int opacityModifyRGB)
+{
+	unsigned int count = p->count;
+	unsigned int i = 0;
+
+#if defined(CC_PARTICLE_ARRAYS_SSE2) || defined(CC_PARTICLE_ARRAYS_NEON)
+	FloatW currentXW = SetW(currentX), currentYW = SetW(currentY);
+	FloatW offsetXW = SetW(offsetX), offsetYW = SetW(offsetY);
+	FloatW zero = SetW(0.0f), half = SetW(0.5f), byteMax = SetW(255.0f);
+
+	for( ; i + 4 <= count; i += 4 ) {
+		FloatW x = LoadW(p->posX + i), y = LoadW(p->posY + i);
+		if( startPositions ) {
+			x = SubW(x, SubW(currentXW, LoadW(p->startPosX + i)));
+			y = SubW(y, SubW(currentYW, LoadW(p->startPosY + i)));
+		}
+		x = AddW(x, offsetXW);
+		y = AddW(y, offsetYW);
+
+		FloatW r = LoadW(p->colorR + i), g = LoadW(p->colorG + i), b = LoadW(p->colorB + i), a = LoadW(p->colorA + i);
+		if( opacityModifyRGB ) {
+			r = MulW(r, a);
+			g = MulW(g, a);
+			b = MulW(b, a);
+		}
+
+		FloatW size_2 = MulW(LoadW(p->size + i), half);
+		FloatW rotation = LoadW(p->rotation + i);
+		FloatW v[8];
+
+		if( BitsM(NotEqualW(rotation, zero)) ) {
+			FloatW x1 = NegW(size_2), y1 = x1;
+			FloatW x2 = size_2, y2 = size_2;
+
+			FloatW sr, cr;
+			SinCosW(NegW(MulW(rotation, SetW(DEGREES_TO_RADIANS))), &sr, &cr);
+			FloatW x1cr = MulW(x1, cr), x2cr = MulW(x2, cr), y1sr = MulW(y1, sr), y2sr = MulW(y2, sr);
+			FloatW x1sr = MulW(x1, sr), x2sr = MulW(x2, sr), y1cr = MulW(y1, cr), y2cr = MulW(y2, cr);
+
+			v[0] = AddW(SubW(x1cr, y1sr), x); v[1] = AddW(AddW(x1sr, y1cr), y);
+			v[2] = AddW(SubW(x2cr, y1sr), x); v[3] = AddW(AddW(x2sr, y1cr), y);
+			v[4] = AddW(SubW(x2cr, y2sr), x); v[5] = AddW(AddW(x2sr, y2cr), y);
+			v[6] = AddW(SubW(x1cr, y2sr), x); v[7] = AddW(AddW(x1sr, y2cr), y);
+		} else {
+			FloatW left = SubW(x, size_2), right = AddW(x, size_2);
+			FloatW bottom = SubW(y, size_2), top = AddW(y, size_2);
+
+			v[0] = left; v[1] = bottom;
+			v[2] = right; v[3] = bottom;
+			v[4] = right; v[5] = top;
+			v[6] = left; v[7] = top;
+		}
+
+		WriteQuads4(quads + CC_PARTICLE_QUAD_FLOATS*i, v, MulW(r, byteMax), MulW(g, byteMax), MulW(b, byteMax), MulW(a, byteMax));
+	}
+#endif
+
+	for( ; i < count; i++ ) {
+		float x = p->posX[i], y = p->posY[i];
+		if( startPositions ) {
+			x -= currentX - p->startPosX[i];
+			y -= currentY - p->startPosY[i];
+		}
+
+		UpdateQuad(p, i, quads + CC_PARTICLE_QUAD_FLOATS*i, x + offsetX, y + offsetY, opacityModifyRGB);
+	}
+}
@@ -0,0 +1,136 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+/** @file ccParticleArrays.h
+ Particles of a CCParticleSystem kept in a structure of arrays.
+
+ Each value of tCCParticle lives in its own float array, so the particles can be updated four at
+ a time with SSE2 or NEON when the compiler targets them. Define CC_NO_SIMD to force the scalar code.
+ The update integrates the particles of a mode, like -[CCParticleSystem update:], and moves the live
+ ones to the front of the arrays in the same pass, keeping their order. Then the vertices and colors
+ of their quads are written like -[CCParticleSystemQuad updateQuadWithParticle:newPosition:].
+
+ The SIMD code uses a polynomial sine and cosine, within a few ulps of sinf() and cosf(), for the
+ rotation of the quads and for the positions of radius mode.
+
+ This file is plain C and doesn't depend on Objective-C or OpenGL.
+ */
+
+#ifndef __CC_PARTICLE_ARRAYS_H
+#define __CC_PARTICLE_ARRAYS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of floats in a ccV3F_C4B_T2F_Quad. The vertices are tl, bl, tr and br, 6 floats each:
+ the position (3 floats), the color (4 bytes) and the texture coordinates.
+ */
+#define CC_PARTICLE_QUAD_FLOATS	24
+
+/** 1 if the particles are updated with SSE2 or NEON, 0 if they are updated one by one.
+ The scalar code is slower than the loop of -[CCParticleSystem update:].
+ */
+#if !defined(CC_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define CC_PARTICLE_ARRAYS_SIMD	1
+#else
+#define CC_PARTICLE_ARRAYS_SIMD	0
+#endif
+
+typedef struct _ccParticleArrays
+{
+	// live particles, they are the first count values of every array
+	unsigned int count;
+	// particles that fit in the arrays
+	unsigned int capacity;
+
+	// the values of tCCParticle
+	float *timeToLive;
+	float *posX, *posY;
+	float *colorR, *colorG, *colorB, *colorA;
+	float *size;
+	float *rotation;
+
+	union {
+		// Mode A: gravity, direction, radial accel, tangential accel
+		struct {
+			float *dirX, *dirY;
+			float *radialAccel;
+			float *tangentialAccel;
+		} A;
+
+		// Mode B: radius mode
+		struct {
+			float *angle;
+			float *degreesPerSecond;
+			float *radius;
+			float *deltaRadius;
+		} B;
+	} mode;
+
+	float *startPosX, *startPosY;
+	float *deltaColorR, *deltaColorG, *deltaColorB, *deltaColorA;
+	float *deltaSize;
+	float *deltaRotation;
+
+	// all the arrays, stride floats apart
+	float *block;
+	unsigned int stride;
+} ccParticleArrays;
+
+/** Allocates the arrays for capacity particles. */
+ccParticleArrays* ccParticleArraysNew(unsigned int capacity);
+
+/** Frees the arrays. Silently ignores NULL. */
+void ccParticleArraysFree(ccParticleArrays *particles);
+
+/** Changes the capacity. The live particles that fit are kept. */
+void ccParticleArraysResize(ccParticleArrays *particles, unsigned int capacity);
+
+/** Updates the particles in gravity mode (mode A) and removes the dead ones.
+ Returns the number of live particles.
+ */
+unsigned int ccParticleArraysUpdateGravity(ccParticleArrays *particles, float dt, float gravityX, float gravityY);
+
+/** Updates the particles in radius mode (mode B) and removes the dead ones.
+ Returns the number of live particles.
+ */
+unsigned int ccParticleArraysUpdateRadius(ccParticleArrays *particles, float dt);
+
+/** Writes the vertices and colors of the quads of the live particles, the texture coordinates are
+ not modified. quads points to the ccV3F_C4B_T2F_Quad of the first particle.
+ If startPositions is not 0 the particles are moved by their start position minus (currentX, currentY),
+ like kCCPositionTypeFree and kCCPositionTypeRelative. Then they are moved by (offsetX, offsetY).
+ If opacityModifyRGB is not 0 the colors are premultiplied by their alpha.
+ */
+void ccParticleArraysUpdateQuads(const ccParticleArrays *particles, float *quads, float currentX, float currentY,
+								 int startPositions, float offsetX, float offsetY, int opacityModifyRGB);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CC_PARTICLE_ARRAYS_H
@@ -0,0 +1,374 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+
+#include "ccTransformCache.h"
+
+static const float identity[16] = {
+	1, 0, 0, 0,
+	0, 1, 0, 0,
+	0, 0, 1, 0,
+	0, 0, 0, 1,
+};
+
+static void *ResizeArray(void *arr, unsigned int count, size_t size)
+{
+	void *ret = realloc(arr, count * size);
+	assert(ret && "ccTransformCache: out of memory");
+	return ret;
+}
+
+static void ResizeAffineArrays(ccAffineArrays *arrays, unsigned int count)
+{
+	arrays->a = ResizeArray(arrays->a, count, sizeof(float));
+	arrays->b = ResizeArray(arrays->b, count, sizeof(float));
+	arrays->c = ResizeArray(arrays->c, count, sizeof(float));
+	arrays->d = ResizeArray(arrays->d, count, sizeof(float));
+	arrays->tx = ResizeArray(arrays->tx, count, sizeof(float));
+	arrays->ty = ResizeArray(arrays->ty, count, sizeof(float));
+	arrays->z = ResizeArray(arrays->z, count, sizeof(float));
+}
+
+static void FreeAffineArrays(ccAffineArrays *arrays)
+{
+	free(arrays->a);
+	free(arrays->b);
+	free(arrays->c);
+	free(arrays->d);
+	free(arrays->tx);
+	free(arrays->ty);
+	free(arrays->z);
+}
+
+ccTransformCache* ccTransformCacheNew(void)
+{
+	ccTransformCache *cache = calloc(1, sizeof(ccTransformCache));
+	memcpy(cache->base, identity, sizeof(identity));
+	return cache;
+}
+
+void ccTransformCacheFree(ccTransformCache *cache)
+{
+	if( cache == NULL )
+		return;
+
+	free(cache->parent);
+	free(cache->subtreeEnd);
+	free(cache->dirty);
+	free(cache->queued);
+	free(cache->userData);
+	FreeAffineArrays(&cache->local);
+	FreeAffineArrays(&cache->world);
+	free(cache->modelview);
+	free(cache->queue);
+	free(cache);
+}
+
+void ccTransformCacheClear(ccTransformCache *cache)
+{
+	cache->count = 0;
+	cache->queueCount = 0;
+	cache->invalid = 0;
+	cache->insertNext = cache->insertEnd = 0;
+	cache->removedSlots = 0;
+}
+
+static void EnsureCapacity(ccTransformCache *cache, unsigned int capacity)
+{
+	if( capacity <= cache->capacity )
+		return;
+
+	unsigned int newCapacity = cache->capacity ? cache->capacity : 64;
+	while( newCapacity < capacity )
+		newCapacity *= 2;
+
+	cache->parent = ResizeArray(cache->parent, newCapacity, sizeof(int));
+	cache->subtreeEnd = ResizeArray(cache->subtreeEnd, newCapacity, sizeof(unsigned int));
+	cache->dirty = ResizeArray(cache->dirty, newCapacity, sizeof(unsigned char));
+	cache->queued = ResizeArray(cache->queued, newCapacity, sizeof(unsigned char));
+	cache->userData = ResizeArray(cache->userData, newCapacity, sizeof(void *));
+	ResizeAffineArrays(&cache->local, newCapacity);
+	ResizeAffineArrays(&cache->world, newCapacity);
+	cache->modelview = ResizeArray(cache->modelview, newCapacity, 16*sizeof(float));
+
+	cache->capacity = newCapacity;
+}
+
+unsigned int ccTransformCacheAdd(ccTransformCache *cache, int parent, void *userData)
+{
+	unsigned int slot;
+	if( cache->insertNext < cache->insertEnd ) {
+		slot = cache->insertNext++;
+		assert( parent < (int)slot && "ccTransformCache: the parent must be added first");
+
+		// The ancestors that were in the cache already were extended by ccTransformCacheInsert()
+		cache->subtreeEnd[slot] = slot + 1;
+		for( int p = parent; p >= 0 && cache->subtreeEnd[p] <= slot; p = cache->parent[p] )
+			cache->subtreeEnd[p] = slot + 1;
+	} else {
+		assert( parent < (int)cache->count && "ccTransformCache: the parent must be added first");
+
+		EnsureCapacity(cache, cache->count + 1);
+		slot = cache->count++;
+		cache->needsSubtreeEnds = 1;
+	}
+
+	cache->parent[slot] = parent;
+	cache->dirty[slot] = 1;
+	cache->queued[slot] = 0;
+	cache->userData[slot] = userData;
+
+	cache->local.a[slot] = 1.0f; cache->local.c[slot] = 0.0f; cache->local.tx[slot] = 0.0f;
+	cache->local.b[slot] = 0.0f; cache->local.d[slot] = 1.0f; cache->local.ty[slot] = 0.0f;
+	cache->local.z[slot] = 0.0f;
+
+	return slot;
+}
+
+static void UpdateSubtreeEnds(ccTransformCache *cache);
+
+// The slots are appended: the ranges of the ancestors are extended to the end of the cache,
+// so they can hold slots of other subtrees as well. UpdateRange() doesn't mind.
+unsigned int ccTransformCacheInsert(ccTransformCache *cache, int parent, unsigned int count)
+{
+	assert( !cache->invalid && "ccTransformCache: rebuild the cache instead");
+	assert( parent >= 0 && parent < (int)cache->count && "ccTransformCache: invalid parent");
+	assert( cache->insertNext == cache->insertEnd && "ccTransformCache: the previous insertion is not filled");
+
+	if( cache->needsSubtreeEnds )
+		UpdateSubtreeEnds(cache);
+
+	unsigned int slot = cache->count;
+	EnsureCapacity(cache, slot + count);
+	cache->count += count;
+
+	for( int p = parent; p >= 0; p = cache->parent[p] )
+		cache->subtreeEnd[p] = cache->count;
+
+	cache->insertNext = slot;
+	cache->insertEnd = slot + count;
+	return slot;
+}
+
+// The removed slots are left in place, with NULL user data, until the cache is rebuilt
+void ccTransformCacheRemove(ccTransformCache *cache, unsigned int slot)
+{
+	assert( !cache->invalid && "ccTransformCache: rebuild the cache instead");
+	assert( slot < cache->count && cache->userData[slot] && "ccTransformCache: invalid slot");
+
+	if( cache->needsSubtreeEnds )
+		UpdateSubtreeEnds(cache);
+
+	int *parent = cache->parent;
+	void **userData = cache->userData;
+	unsigned int end = cache->subtreeEnd[slot];
+	unsigned int removed = 1;
+
+	userData[slot] = NULL;
+	cache->queued[slot] = 0;
+
+	// The range can hold other subtrees, a slot is removed if its parent was
+	for( unsigned int i = slot + 1; i < end; i++ ) {
+		int p = parent[i];
+		if( p >= (int)slot && userData[p] == NULL && userData[i] ) {
+			userData[i] = NULL;
+			cache->queued[i] = 0;
+			removed++;
+		}
+	}
+
+	// Rebuilding it is cheaper than updating the removed slots
+	cache->removedSlots += removed;
+	if( 2*cache->removedSlots > cache->count )
+		cache->invalid = 1;
+}
+
+void ccTransformCacheSetLocal(ccTransformCache *cache, unsigned int slot, float a, float b, float c, float d, float tx, float ty, float z)
+{
+	assert( slot < cache->count && "ccTransformCache: invalid slot");
+
+	ccAffineArrays *local = &cache->local;
+	local->a[slot] = a; local->c[slot] = c; local->tx[slot] = tx;
+	local->b[slot] = b; local->d[slot] = d; local->ty[slot] = ty;
+	local->z[slot] = z;
+
+	cache->dirty[slot] = 1;
+	cache->queued[slot] = 0;
+}
+
+void ccTransformCacheQueue(ccTransformCache *cache, unsigned int slot)
+{
+	if( slot >= cache->count || cache->queued[slot] )
+		return;
+
+	if( cache->queueCount == cache->queueCapacity ) {
+		cache->queueCapacity = cache->queueCapacity ? 2*cache->queueCapacity : 64;
+		cache->queue = ResizeArray(cache->queue, cache->queueCapacity, sizeof(unsigned int));
+	}
+
+	cache->queued[slot] = 1;
+	cache->queue[cache->queueCount++] = slot;
+}
+
+void ccTransformCacheFlush(ccTransformCache *cache, ccTransformCacheLocalFunc func)
+{
+	assert( !cache->invalid && "ccTransformCache: rebuild the cache before flushing it");
+	assert( cache->insertNext == cache->insertEnd && "ccTransformCache: the inserted slots are not filled");
+
+	// A slot can be in the queue twice if it was updated by ccTransformCacheUpdateSubtree()
+	// and queued again, so only the ones that are still marked are read.
+	for( unsigned int i = 0; i < cache->queueCount; i++ ) {
+		unsigned int slot = cache->queue[i];
+		if( cache->queued[slot] ) {
+			func(cache, slot, cache->userData[slot]);
+			cache->queued[slot] = 0;
+		}
+	}
+
+	cache->queueCount = 0;
+}
+
+void ccTransformCacheInvalidate(ccTransformCache *cache)
+{
+	cache->invalid = 1;
+}
+
+void ccTransformCacheSetBase(ccTransformCache *cache, const float *base)
+{
+	if( memcmp(cache->base, base, sizeof(cache->base)) != 0 ) {
+		memcpy(cache->base, base, sizeof(cache->base));
+		cache->needsFullUpdate = 1;
+	}
+}
+
+// The slots of a subtree are contiguous, so a reverse pass finds where each one ends.
+static void UpdateSubtreeEnds(ccTransformCache *cache)
+{
+	unsigned int count = cache->count;
+	int *parent = cache->parent;
+	unsigned int *subtreeEnd = cache->subtreeEnd;
+
+	for( unsigned int i = 0; i < count; i++ )
+		subtreeEnd[i] = i + 1;
+
+	for( unsigned int i = count; i-- > 0; ) {
+		int p = parent[i];
+		if( p >= 0 && subtreeEnd[i] > subtreeEnd[p] )
+			subtreeEnd[p] = subtreeEnd[i];
+	}
+
+	cache->needsSubtreeEnds = 0;
+}
+
+// Updates the slots [begin, end). The parents of all of them are either in the range
+// or are up to date already.
+static void UpdateRange(ccTransformCache *cache, unsigned int begin, unsigned int end)
+{
+	const int *parent = cache->parent;
+	const ccAffineArrays l = cache->local;
+	const ccAffineArrays w = cache->world;
+	const float *base = cache->base;
+
+	for( unsigned int i = begin; i < end; i++ ) {
+		int p = parent[i];
+
+		float a, b, c, d, tx, ty, z;
+		if( p < 0 ) {
+			a = l.a[i]; b = l.b[i];
+			c = l.c[i]; d = l.d[i];
+			tx = l.tx[i]; ty = l.ty[i];
+			z = l.z[i];
+		} else {
+			// CGAffineTransformConcat(local, parentWorld), Z is a plain translation
+			float pa = w.a[p], pb = w.b[p], pc = w.c[p], pd = w.d[p];
+			a = l.a[i]*pa + l.b[i]*pc;
+			b = l.a[i]*pb + l.b[i]*pd;
+			c = l.c[i]*pa + l.d[i]*pc;
+			d = l.c[i]*pb + l.d[i]*pd;
+			tx = l.tx[i]*pa + l.ty[i]*pc + w.tx[p];
+			ty = l.tx[i]*pb + l.ty[i]*pd + w.ty[p];
+			z = l.z[i] + w.z[p];
+		}
+
+		w.a[i] = a; w.b[i] = b;
+		w.c[i] = c; w.d[i] = d;
+		w.tx[i] = tx; w.ty[i] = ty;
+		w.z[i] = z;
+
+		// base * world, see CGAffineToGL() for the layout of the world matrix
+		float *m = cache->modelview + 16*i;
+		for( int k = 0; k < 4; k++ ) {
+			float b0 = base[k], b1 = base[4+k], b2 = base[8+k];
+			m[k] = a*b0 + b*b1;
+			m[4+k] = c*b0 + d*b1;
+			m[8+k] = b2;
+			m[12+k] = tx*b0 + ty*b1 + z*b2 + base[12+k];
+		}
+	}
+}
+
+void ccTransformCacheUpdate(ccTransformCache *cache)
+{
+	unsigned int count = cache->count;
+	unsigned char *dirty = cache->dirty;
+
+	if( cache->needsSubtreeEnds )
+		UpdateSubtreeEnds(cache);
+
+	if( cache->needsFullUpdate ) {
+		UpdateRange(cache, 0, count);
+		memset(dirty, 0, count);
+		cache->needsFullUpdate = 0;
+		return;
+	}
+
+	// Clean slots are skipped with memchr(), a dirty slot updates its whole subtree.
+	unsigned int i = 0;
+	while( i < count ) {
+		unsigned char *next = memchr(dirty + i, 1, count - i);
+		if( next == NULL )
+			break;
+
+		i = (unsigned int)(next - dirty);
+		unsigned int end = cache->subtreeEnd[i];
+		UpdateRange(cache, i, end);
+		memset(dirty + i, 0, end - i);
+		i = end;
+	}
+}
+
+void ccTransformCacheUpdateSubtree(ccTransformCache *cache, unsigned int slot)
+{
+	assert( slot < cache->count && "ccTransformCache: invalid slot");
+
+	if( cache->needsSubtreeEnds )
+		UpdateSubtreeEnds(cache);
+
+	unsigned int end = cache->subtreeEnd[slot];
+	UpdateRange(cache, slot, end);
+	memset(cache->dirty + slot, 0, end - slot);
+}
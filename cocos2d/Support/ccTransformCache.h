@@ -0,0 +1,168 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+/** @file ccTransformCache.h
+ Flattened world transforms of a node tree.
+
+ The nodes are stored in slots, in depth first order, so the slots of a subtree
+ are contiguous and a parent always comes before its children.
+ Subtrees inserted after the cache was built are appended: the range of a subtree
+ can then hold slots of other subtrees as well, until the cache is rebuilt.
+ The transforms are kept as structure of arrays: one array per component of the
+ local and world affine transforms. The world transforms are updated in one linear
+ pass that only touches the subtrees whose local transforms changed.
+
+ For each slot the cache also keeps the modelview matrix of the node: the base matrix
+ (the modelview matrix of the parent of the root) multiplied by the world transform.
+ It has the layout of a kmMat4 and can be loaded with kmGLLoadMatrix().
+
+ This file is plain C and doesn't depend on Objective-C or OpenGL.
+ */
+
+#ifndef __CC_TRANSFORM_CACHE_H
+#define __CC_TRANSFORM_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** An affine transform with a Z translation, one array per component.
+ The components are the ones of CGAffineTransform: x' = a*x + c*y + tx, y' = b*x + d*y + ty.
+ */
+typedef struct _ccAffineArrays
+{
+	float *a, *b, *c, *d, *tx, *ty, *z;
+} ccAffineArrays;
+
+typedef struct _ccTransformCache ccTransformCache;
+
+/** Called by ccTransformCacheFlush() for each queued slot. It should call ccTransformCacheSetLocal(). */
+typedef void (*ccTransformCacheLocalFunc)(ccTransformCache *cache, unsigned int slot, void *userData);
+
+struct _ccTransformCache
+{
+	unsigned int count;
+	unsigned int capacity;
+
+	// parent slot, -1 for roots
+	int *parent;
+	// one past the last slot of the subtree
+	unsigned int *subtreeEnd;
+	// the local transform changed, the subtree needs an update
+	unsigned char *dirty;
+	// the local transform must be read again, see ccTransformCacheQueue()
+	unsigned char *queued;
+	void **userData;
+
+	ccAffineArrays local;
+	ccAffineArrays world;
+
+	// 16 floats per slot
+	float *modelview;
+	float base[16];
+
+	unsigned int *queue;
+	unsigned int queueCount, queueCapacity;
+
+	// the slots no longer match the node tree, see ccTransformCacheInvalidate()
+	int invalid;
+
+	// the slots opened by ccTransformCacheInsert() that ccTransformCacheAdd() fills next
+	unsigned int insertNext, insertEnd;
+	// slots removed by ccTransformCacheRemove(), their user data is NULL
+	unsigned int removedSlots;
+
+	int needsSubtreeEnds;
+	int needsFullUpdate;
+};
+
+/** Allocates an empty cache. */
+ccTransformCache* ccTransformCacheNew(void);
+
+/** Frees a cache. Silently ignores NULL. */
+void ccTransformCacheFree(ccTransformCache *cache);
+
+/** Removes all the slots before the tree is added again. Also clears the queue and the invalid flag. */
+void ccTransformCacheClear(ccTransformCache *cache);
+
+/** Appends a slot and returns it. Slots must be added in depth first order:
+ the parent must be the slot of an ancestor that is still open, or -1 for a root.
+ The local transform is the identity until ccTransformCacheSetLocal() is called.
+ After ccTransformCacheInsert() the slots it opened are filled first.
+ */
+unsigned int ccTransformCacheAdd(ccTransformCache *cache, int parent, void *userData);
+
+/** Opens count slots for a subtree added to parent after the cache was built, and returns the first one.
+ They must be filled with ccTransformCacheAdd(), in depth first order, before the cache is used again.
+ The other slots don't move.
+ */
+unsigned int ccTransformCacheInsert(ccTransformCache *cache, int parent, unsigned int count);
+
+/** Removes the subtree of a slot, for a subtree removed from the node tree. The other slots don't move.
+ The cache is invalidated once half of its slots were removed.
+ */
+void ccTransformCacheRemove(ccTransformCache *cache, unsigned int slot);
+
+/** Sets the local transform of a slot and marks its subtree for the next update. */
+void ccTransformCacheSetLocal(ccTransformCache *cache, unsigned int slot, float a, float b, float c, float d, float tx, float ty, float z);
+
+/** Queues a slot whose local transform changed. ccTransformCacheFlush() reads it again later.
+ Queuing a slot more than once is cheap.
+ */
+void ccTransformCacheQueue(ccTransformCache *cache, unsigned int slot);
+
+/** Calls func for each queued slot and empties the queue. Must not be called on an invalid cache. */
+void ccTransformCacheFlush(ccTransformCache *cache, ccTransformCacheLocalFunc func);
+
+/** Marks the cache as invalid after the node tree changed. The owner should rebuild it
+ with ccTransformCacheClear() and ccTransformCacheAdd() before the next update.
+ */
+void ccTransformCacheInvalidate(ccTransformCache *cache);
+
+/** Sets the base matrix (16 floats, kmMat4 layout). All the modelview matrices are updated if it changed. */
+void ccTransformCacheSetBase(ccTransformCache *cache, const float *base);
+
+/** Updates the world transforms and modelview matrices of the dirty subtrees. */
+void ccTransformCacheUpdate(ccTransformCache *cache);
+
+/** Updates the subtree of a slot right away, for a local transform that changed after ccTransformCacheUpdate(). */
+void ccTransformCacheUpdateSubtree(ccTransformCache *cache, unsigned int slot);
+
+/** Returns YES if the slot is queued. */
+static inline int ccTransformCacheIsQueued(const ccTransformCache *cache, unsigned int slot)
+{
+	return cache->queued[slot];
+}
+
+/** Returns the modelview matrix of a slot (16 floats, kmMat4 layout). */
+static inline const float* ccTransformCacheGetModelview(const ccTransformCache *cache, unsigned int slot)
+{
+	return cache->modelview + 16*slot;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __CC_TRANSFORM_CACHE_H
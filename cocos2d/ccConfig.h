@@ -151,6 +151,22 @@ mac相关线程
 #define CC_NODE_RENDER_SUBPIXEL 1
 #endif
 
+/** @def CC_NODE_TRANSFORM_CACHE
+ If enabled, CCScene keeps the world transforms of its nodes in a flattened cache (see ccTransformCache.h).
+ Only the subtrees whose transforms changed are updated each frame, and CCNode#visit loads the
+ modelview matrix from the cache instead of pushing and multiplying the matrix stack for every node.
+ Nodes with a grid or a camera, and their children, still use the matrix stack.
+
+ nodeToParentTransform is only called again after a setter of CCNode changed the transform.
+ Subclasses that compute it from other values, like the PhysicsSprite of the Box2d and Chipmunk
+ templates, must call CCNode#markTransformDirty when those values change or they are drawn where they were.
+
+ To enable set it to 1. Disabled by default.
+ */
+#ifndef CC_NODE_TRANSFORM_CACHE
+#define CC_NODE_TRANSFORM_CACHE 0
+#endif
+
 /** @def CC_SPRITEBATCHNODE_RENDER_SUBPIXEL
  If enabled, the CCSprite objects rendered with CCSpriteBatchNode will be able to render in subpixels.
  If disabled, integer pixels will be used.
@@ -184,6 +200,36 @@ mac相关线程
 #define CC_TEXTURE_ATLAS_USE_VAO 1
 #endif
 
+/** @def CC_TEXTURE_ATLAS_VBO_COUNT
+ Number of vertex buffers used by each CCTextureAtlas.
+ With 2 or 3, the modified quads are uploaded into the buffer that was drawn the least recently,
+ so the upload doesn't have to wait for the GPU to finish drawing the previous frame.
+ Each buffer uses as much memory as the quads of the atlas.
+
+ To use double or triple buffering set it to 2 or 3. 1 by default.
+ */
+#ifndef CC_TEXTURE_ATLAS_VBO_COUNT
+#define CC_TEXTURE_ATLAS_VBO_COUNT 1
+#endif
+
+/** @def CC_PARTICLE_SYSTEM_ARRAYS
+ If enabled, CCParticleSystemQuad keeps its particles in a structure of arrays (see ccParticleArrays.h)
+ instead of an array of tCCParticle. They are updated, and their quads are written, four at a time
+ with SSE2 or NEON.
+ The results are not exactly the same: the dead particles are removed without changing the order of
+ the others, so the particles are drawn in a different order. The rotation and the positions of
+ radius mode (mode B) use an approximated sine and cosine, so in radius mode the particles follow
+ slightly different trajectories too. The particles array is NULL, so subclasses that read it must
+ not enable it.
+ Subclasses that override update: or updateQuadWithParticle:newPosition: still use the array of tCCParticle.
+ It has no effect when the compiler targets neither SSE2 nor NEON: the scalar update is slower.
+
+ To enable set it to 1. Disabled by default.
+ */
+#ifndef CC_PARTICLE_SYSTEM_ARRAYS
+#define CC_PARTICLE_SYSTEM_ARRAYS 0
+#endif
+
 
 /** @def CC_USE_LA88_LABELS
  If enabled, it will use LA88 (Luminance Alpha 16-bit textures) for CCLabelTTF objects.
@@ -0,0 +1,229 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// Steps the Testbed scenes without rendering and reports the b2Profile
+// timings of every scene as JSON on stdout, together with a checksum of
+// the final body state. With -trace the steps are also recorded with a
+// b2Profiler and written to a Chrome trace file.
+//
+// Usage: Box2DBenchmark [-steps N] [-scene NAME] [-threads N] [-wide] [-trace FILE]
+
+#include "../Testbed/Framework/Test.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+using namespace std;
+
+namespace
+{
+	struct ProfileField
+	{
+		const char* name;
+		float32 b2Profile::* member;
+	};
+
+	const ProfileField profileFields[] =
+	{
+		{"step", &b2Profile::step},
+		{"collide", &b2Profile::collide},
+		{"solve", &b2Profile::solve},
+		{"solveInit", &b2Profile::solveInit},
+		{"solveVelocity", &b2Profile::solveVelocity},
+		{"solvePosition", &b2Profile::solvePosition},
+		{"broadphase", &b2Profile::broadphase},
+		{"solveTOI", &b2Profile::solveTOI},
+	};
+
+	const int32 profileFieldCount = sizeof(profileFields) / sizeof(profileFields[0]);
+
+	// FNV-1a over the bytes of the body state.
+	struct Checksum
+	{
+		Checksum() : hash(2166136261u) {}
+
+		void Add(const void* data, size_t size)
+		{
+			const unsigned char* bytes = static_cast<const unsigned char*>(data);
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= bytes[i];
+				hash *= 16777619u;
+			}
+		}
+
+		void Add(float32 x)
+		{
+			Add(&x, sizeof(x));
+		}
+
+		uint32 hash;
+	};
+
+	uint32 ComputeChecksum(b2World* world)
+	{
+		Checksum checksum;
+		for (b2Body* body = world->GetBodyList(); body; body = body->GetNext())
+		{
+			const b2Transform& xf = body->GetTransform();
+			checksum.Add(xf.p.x);
+			checksum.Add(xf.p.y);
+			checksum.Add(xf.q.s);
+			checksum.Add(xf.q.c);
+			checksum.Add(body->GetLinearVelocity().x);
+			checksum.Add(body->GetLinearVelocity().y);
+			checksum.Add(body->GetAngularVelocity());
+		}
+		return checksum.hash;
+	}
+
+	// Nearest rank percentile of sorted samples.
+	float32 Percentile(const vector<float32>& samples, float32 fraction)
+	{
+		if (samples.empty())
+		{
+			return 0.0f;
+		}
+
+		int32 rank = int32(fraction * samples.size() + 0.5f);
+		rank = b2Clamp(rank, 1, int32(samples.size()));
+		return samples[rank - 1];
+	}
+
+	void RunScene(const TestEntry* entry, int32 stepCount, int32 threadCount, bool wide, b2Profiler* profiler, bool first)
+	{
+		// Scenes use rand, seed it so every run builds the same scene.
+		srand(0);
+
+		Settings settings;
+		settings.drawShapes = 0;
+		settings.drawJoints = 0;
+
+		Test* test = entry->createFcn();
+		b2World* world = test->GetWorld();
+		world->SetThreadCount(threadCount);
+		world->SetWideContactSolver(wide);
+		world->SetProfiler(profiler);
+
+		vector<float32> samples[profileFieldCount];
+		for (int32 i = 0; i < profileFieldCount; ++i)
+		{
+			samples[i].reserve(stepCount);
+		}
+
+		for (int32 i = 0; i < stepCount; ++i)
+		{
+			test->Step(&settings);
+
+			const b2Profile& profile = world->GetProfile();
+			for (int32 j = 0; j < profileFieldCount; ++j)
+			{
+				samples[j].push_back(profile.*profileFields[j].member);
+			}
+		}
+
+		uint32 checksum = ComputeChecksum(world);
+		int32 bodyCount = world->GetBodyCount();
+		int32 contactCount = world->GetContactCount();
+		delete test;
+
+		printf("%s\n\t\t{\n", first ? "" : ",");
+		printf("\t\t\t\"name\": \"%s\",\n", entry->name);
+		printf("\t\t\t\"bodies\": %d,\n", bodyCount);
+		printf("\t\t\t\"contacts\": %d,\n", contactCount);
+		printf("\t\t\t\"checksum\": \"%08x\",\n", checksum);
+		printf("\t\t\t\"profile\":\n\t\t\t{\n");
+		for (int32 i = 0; i < profileFieldCount; ++i)
+		{
+			vector<float32>& s = samples[i];
+			sort(s.begin(), s.end());
+			printf("\t\t\t\t\"%s\": {\"median\": %.4f, \"p95\": %.4f, \"max\": %.4f}%s\n",
+				profileFields[i].name, Percentile(s, 0.5f), Percentile(s, 0.95f),
+				s.empty() ? 0.0f : s.back(), i + 1 < profileFieldCount ? "," : "");
+		}
+		printf("\t\t\t}\n\t\t}");
+	}
+}
+
+int main(int argc, char** argv)
+{
+	int32 stepCount = 600;
+	int32 threadCount = 1;
+	bool wide = false;
+	const char* sceneName = NULL;
+	const char* traceName = NULL;
+
+	for (int32 i = 1; i < argc; ++i)
+	{
+		if (strcmp(argv[i], "-steps") == 0 && i + 1 < argc)
+		{
+			stepCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-scene") == 0 && i + 1 < argc)
+		{
+			sceneName = argv[++i];
+		}
+		else if (strcmp(argv[i], "-threads") == 0 && i + 1 < argc)
+		{
+			threadCount = atoi(argv[++i]);
+		}
+		else if (strcmp(argv[i], "-wide") == 0)
+		{
+			wide = true;
+		}
+		else if (strcmp(argv[i], "-trace") == 0 && i + 1 < argc)
+		{
+			traceName = argv[++i];
+		}
+		else
+		{
+			fprintf(stderr, "usage: %s [-steps N] [-scene NAME] [-threads N] [-wide] [-trace FILE]\n", argv[0]);
+			return 1;
+		}
+	}
+
+	printf("{\n\t\"steps\": %d,\n\t\"threads\": %d,\n\t\"wide\": %s,\n\t\"scenes\":\n\t[", stepCount, threadCount, wide ? "true" : "false");
+
+	b2Profiler profiler;
+	profiler.SetEnabled(traceName != NULL);
+
+	bool first = true;
+	for (const TestEntry* entry = g_testEntries; entry->createFcn; ++entry)
+	{
+		if (sceneName && strcmp(sceneName, entry->name) != 0)
+		{
+			continue;
+		}
+
+		RunScene(entry, stepCount, threadCount, wide, traceName ? &profiler : NULL, first);
+		first = false;
+	}
+
+	printf("\n\t]\n}\n");
+
+	if (traceName && profiler.WriteChromeTrace(traceName) == false)
+	{
+		fprintf(stderr, "cannot write %s\n", traceName);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,220 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+// Compares b2DynamicTree with b2WideTree for query, ray-cast and
+// MoveProxy throughput at several proxy counts, then reports the quality
+// of the dynamic tree before and after rotations and a SAH rebuild.
+
+#include <Box2D/Box2D.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+using namespace std;
+
+namespace
+{
+	uint32 seed = 12345;
+
+	// A small deterministic generator, so all runs use the same scene.
+	float32 RandomFloat(float32 lo, float32 hi)
+	{
+		seed = 1664525 * seed + 1013904223;
+		float32 r = float32(seed >> 8) / float32(1 << 24);
+		return lo + r * (hi - lo);
+	}
+
+	b2AABB RandomBox(float32 extent, float32 size)
+	{
+		b2Vec2 p(RandomFloat(-extent, extent), RandomFloat(-extent, extent));
+		b2Vec2 h(RandomFloat(0.1f, size), RandomFloat(0.1f, size));
+		b2AABB aabb;
+		aabb.lowerBound = p - h;
+		aabb.upperBound = p + h;
+		return aabb;
+	}
+
+	struct QueryCounter
+	{
+		bool QueryCallback(int32 proxyId)
+		{
+			B2_NOT_USED(proxyId);
+			++count;
+			return true;
+		}
+
+		int32 count;
+	};
+
+	struct RayCastCounter
+	{
+		float32 RayCastCallback(const b2RayCastInput& input, int32 proxyId)
+		{
+			B2_NOT_USED(proxyId);
+			++count;
+			return input.maxFraction;
+		}
+
+		int32 count;
+	};
+
+	template <typename T>
+	int32 RunQueries(const T& tree, const vector<b2AABB>& boxes)
+	{
+		QueryCounter counter;
+		counter.count = 0;
+		for (size_t i = 0; i < boxes.size(); ++i)
+		{
+			tree.Query(&counter, boxes[i]);
+		}
+		return counter.count;
+	}
+
+	template <typename T>
+	int32 RunRayCasts(const T& tree, const vector<b2RayCastInput>& rays)
+	{
+		RayCastCounter counter;
+		counter.count = 0;
+		for (size_t i = 0; i < rays.size(); ++i)
+		{
+			tree.RayCast(&counter, rays[i]);
+		}
+		return counter.count;
+	}
+
+	template <typename T>
+	int32 RunMoves(T& tree, const vector<int32>& proxies, const vector<b2AABB>& boxes, const vector<b2Vec2>& displacements)
+	{
+		int32 count = 0;
+		for (size_t i = 0; i < proxies.size(); ++i)
+		{
+			b2AABB aabb = boxes[i];
+			aabb.lowerBound += displacements[i];
+			aabb.upperBound += displacements[i];
+			count += tree.MoveProxy(proxies[i], aabb, displacements[i]) ? 1 : 0;
+		}
+		return count;
+	}
+
+	void Report(const char* name, int32 proxyCount, int32 operations, float32 ms1, float32 ms2, int32 result1, int32 result2)
+	{
+		printf("%-8s %7d %8d %10.3f %10.3f %7.2fx %s\n", name, proxyCount, operations, ms1, ms2,
+			ms2 > 0.0f ? ms1 / ms2 : 0.0f, result1 == result2 ? "" : "MISMATCH");
+	}
+
+	void Run(int32 proxyCount)
+	{
+		// Keep the proxy density constant.
+		float32 extent = 2.0f * b2Sqrt(float32(proxyCount));
+
+		b2DynamicTree tree;
+		vector<int32> proxies(proxyCount);
+		vector<b2AABB> boxes(proxyCount);
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			boxes[i] = RandomBox(extent, 0.5f);
+			proxies[i] = tree.CreateProxy(boxes[i], NULL);
+		}
+
+		b2Timer timer;
+		b2WideTree wideTree;
+		wideTree.Build(tree);
+		float32 buildTime = timer.GetMilliseconds();
+		printf("%-8s %7d %8d %10s %10.3f\n", "build", proxyCount, proxyCount, "", buildTime);
+
+		const int32 queryCount = 10000;
+		vector<b2AABB> queries(queryCount);
+		for (int32 i = 0; i < queryCount; ++i)
+		{
+			queries[i] = RandomBox(extent, 2.0f);
+		}
+
+		timer.Reset();
+		int32 hits1 = RunQueries(tree, queries);
+		float32 ms1 = timer.GetMilliseconds();
+		timer.Reset();
+		int32 hits2 = RunQueries(wideTree, queries);
+		float32 ms2 = timer.GetMilliseconds();
+		Report("query", proxyCount, queryCount, ms1, ms2, hits1, hits2);
+
+		const int32 rayCount = 10000;
+		vector<b2RayCastInput> rays(rayCount);
+		for (int32 i = 0; i < rayCount; ++i)
+		{
+			rays[i].p1.Set(RandomFloat(-extent, extent), RandomFloat(-extent, extent));
+			rays[i].p2 = rays[i].p1 + b2Vec2(RandomFloat(-20.0f, 20.0f), RandomFloat(-20.0f, 20.0f));
+			rays[i].maxFraction = 1.0f;
+		}
+
+		timer.Reset();
+		hits1 = RunRayCasts(tree, rays);
+		ms1 = timer.GetMilliseconds();
+		timer.Reset();
+		hits2 = RunRayCasts(wideTree, rays);
+		ms2 = timer.GetMilliseconds();
+		Report("raycast", proxyCount, rayCount, ms1, ms2, hits1, hits2);
+
+		// Move every proxy by a small amount, like a frame of falling bodies.
+		vector<b2Vec2> displacements(proxyCount);
+		for (int32 i = 0; i < proxyCount; ++i)
+		{
+			displacements[i].Set(RandomFloat(-0.2f, 0.2f), RandomFloat(-0.2f, 0.2f));
+		}
+
+		timer.Reset();
+		int32 moved1 = RunMoves(tree, proxies, boxes, displacements);
+		ms1 = timer.GetMilliseconds();
+		timer.Reset();
+		int32 moved2 = RunMoves(wideTree, proxies, boxes, displacements);
+		ms2 = timer.GetMilliseconds();
+		Report("move", proxyCount, proxyCount, ms1, ms2, moved1, moved2);
+
+		// Tree quality after insertion, rotations and a full rebuild.
+		printf("%-8s %7d %8s %10s %10s   ratio %.2f cost %.2f\n", "inserted", proxyCount, "", "", "",
+			tree.GetAreaRatio(), tree.GetQueryCost());
+
+		timer.Reset();
+		int32 rotations = tree.Rotate(2.0f);
+		ms1 = timer.GetMilliseconds();
+		printf("%-8s %7d %8d %10.3f %10s   ratio %.2f cost %.2f\n", "rotate", proxyCount, rotations, ms1, "",
+			tree.GetAreaRatio(), tree.GetQueryCost());
+
+		timer.Reset();
+		tree.RebuildTopDown();
+		ms1 = timer.GetMilliseconds();
+		printf("%-8s %7d %8d %10.3f %10s   ratio %.2f cost %.2f\n", "rebuild", proxyCount, proxyCount, ms1, "",
+			tree.GetAreaRatio(), tree.GetQueryCost());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	printf("%-8s %7s %8s %10s %10s %8s\n", "test", "proxies", "ops", "binary ms", "wide ms", "speedup");
+
+	if (argc > 1)
+	{
+		Run(atoi(argv[1]));
+		return 0;
+	}
+
+	Run(1000);
+	Run(10000);
+	Run(100000);
+	return 0;
+}
@@ -17,9 +17,13 @@
 */
 
 #include <Box2D/Collision/b2BroadPhase.h>
+#include <Box2D/Common/b2Snapshot.h>
 #include <cstring>
 using namespace std;
 
+// The parallel pair search hands out the move buffer in slices of this size.
+#define b2_moveSliceSize	64
+
 b2BroadPhase::b2BroadPhase()
 {
 	m_proxyCount = 0;
@@ -31,10 +35,21 @@ b2BroadPhase::b2BroadPhase()
 	m_moveCapacity = 16;
 	m_moveCount = 0;
 	m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+
+	m_threadPool = NULL;
+	memset(m_threadPairs, 0, sizeof(m_threadPairs));
 }
 
 b2BroadPhase::~b2BroadPhase()
 {
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		if (m_threadPairs[i].pairs)
+		{
+			b2Free(m_threadPairs[i].pairs);
+		}
+	}
+
 	b2Free(m_moveBuffer);
 	b2Free(m_pairBuffer);
 }
@@ -95,6 +110,33 @@ void b2BroadPhase::UnBufferMove(int32 proxyId)
 	}
 }
 
+void b2BroadPhase::Save(b2Snapshot* snapshot) const
+{
+	m_tree.Save(snapshot);
+	snapshot->Write(m_proxyCount);
+	snapshot->Write(m_moveCount);
+	snapshot->Write(m_moveBuffer, m_moveCount * sizeof(int32));
+}
+
+void b2BroadPhase::Restore(b2Snapshot* snapshot)
+{
+	m_tree.Restore(snapshot);
+	snapshot->Read(&m_proxyCount);
+	snapshot->Read(&m_moveCount);
+
+	if (m_moveCount > m_moveCapacity)
+	{
+		b2Free(m_moveBuffer);
+		while (m_moveCapacity < m_moveCount)
+		{
+			m_moveCapacity *= 2;
+		}
+		m_moveBuffer = (int32*)b2Alloc(m_moveCapacity * sizeof(int32));
+	}
+
+	snapshot->Read(m_moveBuffer, m_moveCount * sizeof(int32));
+}
+
 // This is called from b2DynamicTree::Query when we are gathering pairs.
 bool b2BroadPhase::QueryCallback(int32 proxyId)
 {
@@ -120,3 +162,160 @@ bool b2BroadPhase::QueryCallback(int32 proxyId)
 
 	return true;
 }
+
+// Collects the pairs of one query into a thread's pair buffer.
+struct b2PairQuery
+{
+	bool QueryCallback(int32 proxyId)
+	{
+		// A proxy cannot form a pair with itself.
+		if (proxyId == queryProxyId)
+		{
+			return true;
+		}
+
+		// Grow the pair buffer as needed.
+		if (buffer->count == buffer->capacity)
+		{
+			b2Pair* oldPairs = buffer->pairs;
+			buffer->capacity = b2Max(16, 2 * buffer->capacity);
+			buffer->pairs = (b2Pair*)b2Alloc(buffer->capacity * sizeof(b2Pair));
+			if (oldPairs)
+			{
+				memcpy(buffer->pairs, oldPairs, buffer->count * sizeof(b2Pair));
+				b2Free(oldPairs);
+			}
+		}
+
+		buffer->pairs[buffer->count].proxyIdA = b2Min(proxyId, queryProxyId);
+		buffer->pairs[buffer->count].proxyIdB = b2Max(proxyId, queryProxyId);
+		++buffer->count;
+
+		return true;
+	}
+
+	b2PairBuffer* buffer;
+	int32 queryProxyId;
+};
+
+// Queries the tree for a slice of the move buffer. The tree is only read.
+class b2PairSearchTask : public b2Task
+{
+public:
+	void Execute(int32 index, int32 threadIndex)
+	{
+		int32 begin = index * b2_moveSliceSize;
+		int32 end = b2Min(begin + b2_moveSliceSize, broadPhase->m_moveCount);
+
+		b2PairQuery query;
+		query.buffer = broadPhase->m_threadPairs + threadIndex;
+
+		for (int32 i = begin; i < end; ++i)
+		{
+			query.queryProxyId = broadPhase->m_moveBuffer[i];
+			if (query.queryProxyId == b2BroadPhase::e_nullProxy)
+			{
+				continue;
+			}
+
+			const b2AABB& fatAABB = broadPhase->m_tree.GetFatAABB(query.queryProxyId);
+			broadPhase->m_tree.Query(&query, fatAABB);
+		}
+	}
+
+	b2BroadPhase* broadPhase;
+};
+
+inline bool b2PairEqual(const b2Pair& pair1, const b2Pair& pair2)
+{
+	return pair1.proxyIdA == pair2.proxyIdA && pair1.proxyIdB == pair2.proxyIdB;
+}
+
+// Sorts a thread's pair buffer and removes its duplicates.
+class b2PairSortTask : public b2Task
+{
+public:
+	void Execute(int32 index, int32 threadIndex)
+	{
+		B2_NOT_USED(threadIndex);
+
+		b2PairBuffer* buffer = buffers + index;
+		std::sort(buffer->pairs, buffer->pairs + buffer->count, b2PairLessThan);
+		buffer->count = int32(std::unique(buffer->pairs, buffer->pairs + buffer->count, b2PairEqual) - buffer->pairs);
+	}
+
+	b2PairBuffer* buffers;
+};
+
+bool b2BroadPhase::ShouldFindPairsParallel() const
+{
+	return m_threadPool != NULL && m_threadPool->GetThreadCount() > 1 && m_moveCount > b2_moveSliceSize;
+}
+
+void b2BroadPhase::FindPairsParallel()
+{
+	int32 threadCount = m_threadPool->GetThreadCount();
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		m_threadPairs[i].count = 0;
+	}
+
+	b2PairSearchTask searchTask;
+	searchTask.broadPhase = this;
+	m_threadPool->Run(&searchTask, (m_moveCount + b2_moveSliceSize - 1) / b2_moveSliceSize);
+
+	b2PairSortTask sortTask;
+	sortTask.buffers = m_threadPairs;
+	m_threadPool->Run(&sortTask, threadCount);
+
+	// Make room for all pairs.
+	int32 pairCount = 0;
+	for (int32 i = 0; i < threadCount; ++i)
+	{
+		pairCount += m_threadPairs[i].count;
+	}
+
+	if (pairCount > m_pairCapacity)
+	{
+		b2Free(m_pairBuffer);
+		while (m_pairCapacity < pairCount)
+		{
+			m_pairCapacity *= 2;
+		}
+		m_pairBuffer = (b2Pair*)b2Alloc(m_pairCapacity * sizeof(b2Pair));
+	}
+
+	// Merge the sorted buffers. Which thread found a pair does not matter,
+	// the result only depends on the set of pairs.
+	int32 heads[b2_maxThreads];
+	memset(heads, 0, sizeof(heads));
+
+	m_pairCount = 0;
+	for (;;)
+	{
+		const b2Pair* next = NULL;
+		int32 nextThread = -1;
+		for (int32 i = 0; i < threadCount; ++i)
+		{
+			const b2PairBuffer* buffer = m_threadPairs + i;
+			if (heads[i] < buffer->count && (next == NULL || b2PairLessThan(buffer->pairs[heads[i]], *next)))
+			{
+				next = buffer->pairs + heads[i];
+				nextThread = i;
+			}
+		}
+
+		if (next == NULL)
+		{
+			break;
+		}
+
+		++heads[nextThread];
+
+		// The same pair may have been found by several threads.
+		if (m_pairCount == 0 || b2PairEqual(m_pairBuffer[m_pairCount - 1], *next) == false)
+		{
+			m_pairBuffer[m_pairCount++] = *next;
+		}
+	}
+}
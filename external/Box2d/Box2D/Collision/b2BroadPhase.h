@@ -22,6 +22,7 @@
 #include <Box2D/Common/b2Settings.h>
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2ThreadPool.h>
 #include <algorithm>
 
 struct b2Pair
@@ -31,6 +32,14 @@ struct b2Pair
 	int32 next;
 };
 
+/// A pair buffer owned by one thread of a parallel pair search.
+struct b2PairBuffer
+{
+	b2Pair* pairs;
+	int32 count;
+	int32 capacity;
+};
+
 /// The broad-phase is used for computing pairs and performing volume queries and ray casts.
 /// This broad-phase does not persist pairs. Instead, this reports potentially new pairs.
 /// It is up to the client to consume the new pairs and to track subsequent overlap.
@@ -97,12 +106,39 @@ public:
 	/// Get the balance of the embedded tree.
 	int32 GetTreeBalance() const;
 
-	/// Get the quality metric of the embedded tree.
+	/// Get the quality metric of the embedded tree. This is the ratio of the
+	/// summed node perimeters to the root perimeter. The minimum is 1.
 	float32 GetTreeQuality() const;
 
+	/// Get the expected number of tree nodes tested by a proxy query.
+	float32 GetTreeQueryCost() const;
+
+	/// Rebuild the embedded tree with the surface area heuristic.
+	void RebuildTree();
+
+	/// Improve the embedded tree with rotations for at most the given number of
+	/// milliseconds. Returns the number of rotations.
+	int32 RotateTree(float32 timeBudget);
+
+	/// Write the tree and the move buffer to a snapshot.
+	void Save(b2Snapshot* snapshot) const;
+
+	/// Read the tree and the move buffer from a snapshot written by Save.
+	void Restore(b2Snapshot* snapshot);
+
+	/// Search for new pairs on the threads of a pool. Each thread collects
+	/// pairs into its own buffer, the buffers are sorted in parallel and
+	/// merged, so pairs are reported in the same order as without a pool.
+	/// The pool is not owned. Pass NULL to search on the calling thread.
+	void SetThreadPool(b2ThreadPool* pool) { m_threadPool = pool; }
+
 private:
 
 	friend class b2DynamicTree;
+	friend class b2PairSearchTask;
+
+	bool ShouldFindPairsParallel() const;
+	void FindPairsParallel();
 
 	void BufferMove(int32 proxyId);
 	void UnBufferMove(int32 proxyId);
@@ -122,6 +158,9 @@ private:
 	int32 m_pairCount;
 
 	int32 m_queryProxyId;
+
+	b2ThreadPool* m_threadPool;
+	b2PairBuffer m_threadPairs[b2_maxThreads];
 };
 
 /// This is used to sort pairs.
@@ -177,35 +216,58 @@ inline float32 b2BroadPhase::GetTreeQuality() const
 	return m_tree.GetAreaRatio();
 }
 
+inline float32 b2BroadPhase::GetTreeQueryCost() const
+{
+	return m_tree.GetQueryCost();
+}
+
+inline void b2BroadPhase::RebuildTree()
+{
+	m_tree.RebuildTopDown();
+}
+
+inline int32 b2BroadPhase::RotateTree(float32 timeBudget)
+{
+	return m_tree.Rotate(timeBudget);
+}
+
 template <typename T>
 void b2BroadPhase::UpdatePairs(T* callback)
 {
 	// Reset pair buffer
 	m_pairCount = 0;
 
-	// Perform tree queries for all moving proxies.
-	for (int32 i = 0; i < m_moveCount; ++i)
+	if (ShouldFindPairsParallel())
+	{
+		// This leaves the pair buffer sorted and without duplicates.
+		FindPairsParallel();
+	}
+	else
 	{
-		m_queryProxyId = m_moveBuffer[i];
-		if (m_queryProxyId == e_nullProxy)
+		// Perform tree queries for all moving proxies.
+		for (int32 i = 0; i < m_moveCount; ++i)
 		{
-			continue;
-		}
+			m_queryProxyId = m_moveBuffer[i];
+			if (m_queryProxyId == e_nullProxy)
+			{
+				continue;
+			}
 
-		// We have to query the tree with the fat AABB so that
-		// we don't fail to create a pair that may touch later.
-		const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
+			// We have to query the tree with the fat AABB so that
+			// we don't fail to create a pair that may touch later.
+			const b2AABB& fatAABB = m_tree.GetFatAABB(m_queryProxyId);
 
-		// Query tree, create pairs and add them pair buffer.
-		m_tree.Query(this, fatAABB);
+			// Query tree, create pairs and add them pair buffer.
+			m_tree.Query(this, fatAABB);
+		}
+
+		// Sort the pair buffer to expose duplicates.
+		std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
 	}
 
 	// Reset move buffer
 	m_moveCount = 0;
 
-	// Sort the pair buffer to expose duplicates.
-	std::sort(m_pairBuffer, m_pairBuffer + m_pairCount, b2PairLessThan);
-
 	// Send the pairs back to the client.
 	int32 i = 0;
 	while (i < m_pairCount)
@@ -17,10 +17,34 @@
 */
 
 #include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Snapshot.h>
 #include <cstring>
 #include <cfloat>
+#include <algorithm>
 using namespace std;
 
+// The number of bins used to find a split in RebuildTopDown.
+#define b2_sahBinCount	16
+
+// Orders leaves by the center of their AABB along one axis.
+struct b2CenterLessThan
+{
+	bool operator()(int32 a, int32 b) const
+	{
+		const b2AABB& aabbA = nodes[a].aabb;
+		const b2AABB& aabbB = nodes[b].aabb;
+		if (axis == 0)
+		{
+			return aabbA.lowerBound.x + aabbA.upperBound.x < aabbB.lowerBound.x + aabbB.upperBound.x;
+		}
+		return aabbA.lowerBound.y + aabbA.upperBound.y < aabbB.lowerBound.y + aabbB.upperBound.y;
+	}
+
+	const b2TreeNode* nodes;
+	int32 axis;
+};
+
 
 b2DynamicTree::b2DynamicTree()
 {
@@ -42,6 +66,7 @@ b2DynamicTree::b2DynamicTree()
 	m_freeList = 0;
 
 	m_path = 0;
+	m_rotationIndex = 0;
 
 	m_insertionCount = 0;
 }
@@ -557,6 +582,45 @@ float32 b2DynamicTree::GetAreaRatio() const
 	return totalArea / rootArea;
 }
 
+float32 b2DynamicTree::GetQueryCost() const
+{
+	if (m_root == b2_nullNode)
+	{
+		return 0.0f;
+	}
+
+	float32 totalArea = 0.0f;
+	float32 leafArea = 0.0f;
+	int32 nodeCount = 0;
+	int32 leafCount = 0;
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		const b2TreeNode* node = m_nodes + i;
+		if (node->height < 0)
+		{
+			// Free node in pool
+			continue;
+		}
+
+		float32 area = node->aabb.GetPerimeter();
+		totalArea += area;
+		++nodeCount;
+
+		if (node->IsLeaf())
+		{
+			leafArea += area;
+			++leafCount;
+		}
+	}
+
+	// A query box overlaps a node if its center lies in the node box grown by
+	// the query box. The probability for a query inside the root follows from
+	// the ratio of the grown perimeters.
+	float32 queryArea = leafArea / leafCount;
+	float32 rootArea = m_nodes[m_root].aabb.GetPerimeter() + queryArea;
+	return (totalArea + nodeCount * queryArea) / rootArea;
+}
+
 // Compute the height of a sub-tree.
 int32 b2DynamicTree::ComputeHeight(int32 nodeId) const
 {
@@ -769,3 +833,410 @@ void b2DynamicTree::RebuildBottomUp()
 
 	Validate();
 }
+
+void b2DynamicTree::RebuildTopDown()
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	int32* leaves = (int32*)b2Alloc(m_nodeCount * sizeof(int32));
+	int32 count = 0;
+
+	// Build array of leaves. Free the rest.
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		if (m_nodes[i].height < 0)
+		{
+			// free node in pool
+			continue;
+		}
+
+		if (m_nodes[i].IsLeaf())
+		{
+			m_nodes[i].parent = b2_nullNode;
+			leaves[count] = i;
+			++count;
+		}
+		else
+		{
+			FreeNode(i);
+		}
+	}
+
+	// The freed nodes are enough for the new internal nodes, so the
+	// node pool does not move while building.
+	m_root = BuildTopDown(leaves, count);
+	m_nodes[m_root].parent = b2_nullNode;
+
+	b2Free(leaves);
+}
+
+// Build a sub-tree over the given leaves and return its root. The leaves
+// are sorted into bins along the longest axis of their centers and split
+// where the summed perimeters of both sides, weighted by their leaf counts,
+// are smallest. A split that leaves too few leaves on one side is replaced
+// by a median split, so the recursion depth stays O(log N).
+int32 b2DynamicTree::BuildTopDown(int32* leaves, int32 count)
+{
+	if (count == 1)
+	{
+		return leaves[0];
+	}
+
+	b2Vec2 lower = m_nodes[leaves[0]].aabb.GetCenter();
+	b2Vec2 upper = lower;
+	for (int32 i = 1; i < count; ++i)
+	{
+		b2Vec2 c = m_nodes[leaves[i]].aabb.GetCenter();
+		lower = b2Min(lower, c);
+		upper = b2Max(upper, c);
+	}
+
+	int32 axis = upper.x - lower.x > upper.y - lower.y ? 0 : 1;
+	float32 origin = axis == 0 ? lower.x : lower.y;
+	float32 width = axis == 0 ? upper.x - lower.x : upper.y - lower.y;
+
+	// Without extent all leaves share the same center, any split will do.
+	int32 split = count / 2;
+
+	if (width > 0.0f)
+	{
+		float32 scale = b2_sahBinCount / width;
+
+		b2AABB binAABBs[b2_sahBinCount];
+		int32 binCounts[b2_sahBinCount];
+		for (int32 i = 0; i < b2_sahBinCount; ++i)
+		{
+			binCounts[i] = 0;
+		}
+
+		for (int32 i = 0; i < count; ++i)
+		{
+			const b2AABB& aabb = m_nodes[leaves[i]].aabb;
+			b2Vec2 c = aabb.GetCenter();
+			int32 bin = b2Min(int32(((axis == 0 ? c.x : c.y) - origin) * scale), b2_sahBinCount - 1);
+			if (binCounts[bin] == 0)
+			{
+				binAABBs[bin] = aabb;
+			}
+			else
+			{
+				binAABBs[bin].Combine(aabb);
+			}
+			++binCounts[bin];
+		}
+
+		// Sweep from the right to get the cost of the right side of each split.
+		float32 rightCosts[b2_sahBinCount];
+		b2AABB rightAABB;
+		rightAABB.lowerBound.SetZero();
+		rightAABB.upperBound.SetZero();
+		int32 rightCount = 0;
+		for (int32 i = b2_sahBinCount - 1; i > 0; --i)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (rightCount == 0)
+				{
+					rightAABB = binAABBs[i];
+				}
+				else
+				{
+					rightAABB.Combine(binAABBs[i]);
+				}
+				rightCount += binCounts[i];
+			}
+
+			rightCosts[i] = rightCount > 0 ? rightCount * rightAABB.GetPerimeter() : 0.0f;
+		}
+
+		// Sweep from the left. Bins [0, bestBin] go to the left child.
+		float32 bestCost = b2_maxFloat;
+		int32 bestBin = -1;
+		b2AABB leftAABB;
+		leftAABB.lowerBound.SetZero();
+		leftAABB.upperBound.SetZero();
+		int32 leftCount = 0;
+		for (int32 i = 0; i < b2_sahBinCount - 1; ++i)
+		{
+			if (binCounts[i] > 0)
+			{
+				if (leftCount == 0)
+				{
+					leftAABB = binAABBs[i];
+				}
+				else
+				{
+					leftAABB.Combine(binAABBs[i]);
+				}
+				leftCount += binCounts[i];
+			}
+
+			if (leftCount == 0 || leftCount == count)
+			{
+				continue;
+			}
+
+			float32 cost = leftCount * leftAABB.GetPerimeter() + rightCosts[i + 1];
+			if (cost < bestCost)
+			{
+				bestCost = cost;
+				bestBin = i;
+			}
+		}
+
+		// Partition the leaves. If the costs overflowed there is no best bin
+		// and all the leaves end up on the right side.
+		int32 i = 0;
+		int32 j = count - 1;
+		while (i <= j)
+		{
+			b2Vec2 c = m_nodes[leaves[i]].aabb.GetCenter();
+			int32 bin = b2Min(int32(((axis == 0 ? c.x : c.y) - origin) * scale), b2_sahBinCount - 1);
+			if (bin <= bestBin)
+			{
+				++i;
+			}
+			else
+			{
+				b2Swap(leaves[i], leaves[j]);
+				--j;
+			}
+		}
+
+		split = i;
+
+		if (split == 0 || b2Min(split, count - split) < count / b2_sahBinCount)
+		{
+			b2CenterLessThan lessThan;
+			lessThan.nodes = m_nodes;
+			lessThan.axis = axis;
+
+			split = count / 2;
+			std::nth_element(leaves, leaves + split, leaves + count, lessThan);
+		}
+	}
+
+	int32 index1 = BuildTopDown(leaves, split);
+	int32 index2 = BuildTopDown(leaves + split, count - split);
+
+	int32 parentIndex = AllocateNode();
+	b2TreeNode* child1 = m_nodes + index1;
+	b2TreeNode* child2 = m_nodes + index2;
+	b2TreeNode* parent = m_nodes + parentIndex;
+	parent->child1 = index1;
+	parent->child2 = index2;
+	parent->height = 1 + b2Max(child1->height, child2->height);
+	parent->aabb.Combine(child1->aabb, child2->aabb);
+	parent->parent = b2_nullNode;
+
+	child1->parent = parentIndex;
+	child2->parent = parentIndex;
+
+	return parentIndex;
+}
+
+int32 b2DynamicTree::Rotate(float32 timeBudget)
+{
+	if (m_root == b2_nullNode)
+	{
+		return 0;
+	}
+
+	b2Timer timer;
+	int32 rotationCount = 0;
+
+	for (int32 i = 0; i < m_nodeCapacity; ++i)
+	{
+		// Checking the timer is not free.
+		if ((i & 31) == 0 && timer.GetMilliseconds() >= timeBudget)
+		{
+			break;
+		}
+
+		if (m_rotationIndex >= m_nodeCapacity)
+		{
+			m_rotationIndex = 0;
+		}
+
+		int32 index = m_rotationIndex++;
+
+		// Free nodes and leaves have no grand children to rotate.
+		if (m_nodes[index].height < 2)
+		{
+			continue;
+		}
+
+		if (RotateNode(index))
+		{
+			++rotationCount;
+		}
+	}
+
+	return rotationCount;
+}
+
+// Try to swap a child of node A with a grand child below the other child
+// of A. The bounds of A do not change, so the best rotation is the one
+// that shrinks the perimeter of the other child the most.
+bool b2DynamicTree::RotateNode(int32 iA)
+{
+	b2TreeNode* A = m_nodes + iA;
+	int32 iB = A->child1;
+	int32 iC = A->child2;
+	const b2TreeNode* B = m_nodes + iB;
+	const b2TreeNode* C = m_nodes + iC;
+
+	float32 bestGain = 0.0f;
+	int32 bestChild = b2_nullNode;
+	int32 bestParent = b2_nullNode;
+	int32 bestGrandChild = b2_nullNode;
+
+	if (C->IsLeaf() == false)
+	{
+		// Swap B with a child of C.
+		const b2TreeNode* F = m_nodes + C->child1;
+		const b2TreeNode* G = m_nodes + C->child2;
+		float32 area = C->aabb.GetPerimeter();
+
+		b2AABB aabb;
+		aabb.Combine(B->aabb, G->aabb);
+		float32 gain = area - aabb.GetPerimeter();
+		if (gain > bestGain)
+		{
+			bestGain = gain;
+			bestChild = iB;
+			bestParent = iC;
+			bestGrandChild = C->child1;
+		}
+
+		aabb.Combine(B->aabb, F->aabb);
+		gain = area - aabb.GetPerimeter();
+		if (gain > bestGain)
+		{
+			bestGain = gain;
+			bestChild = iB;
+			bestParent = iC;
+			bestGrandChild = C->child2;
+		}
+	}
+
+	if (B->IsLeaf() == false)
+	{
+		// Swap C with a child of B.
+		const b2TreeNode* D = m_nodes + B->child1;
+		const b2TreeNode* E = m_nodes + B->child2;
+		float32 area = B->aabb.GetPerimeter();
+
+		b2AABB aabb;
+		aabb.Combine(C->aabb, E->aabb);
+		float32 gain = area - aabb.GetPerimeter();
+		if (gain > bestGain)
+		{
+			bestGain = gain;
+			bestChild = iC;
+			bestParent = iB;
+			bestGrandChild = B->child1;
+		}
+
+		aabb.Combine(C->aabb, D->aabb);
+		gain = area - aabb.GetPerimeter();
+		if (gain > bestGain)
+		{
+			bestGain = gain;
+			bestChild = iC;
+			bestParent = iB;
+			bestGrandChild = B->child2;
+		}
+	}
+
+	if (bestChild == b2_nullNode)
+	{
+		return false;
+	}
+
+	SwapNodes(iA, bestChild, bestParent, bestGrandChild);
+	return true;
+}
+
+// Swap B, a child of A, with F, a child of C, where C is the other child of A.
+void b2DynamicTree::SwapNodes(int32 iA, int32 iB, int32 iC, int32 iF)
+{
+	b2TreeNode* A = m_nodes + iA;
+	b2TreeNode* C = m_nodes + iC;
+
+	if (A->child1 == iB)
+	{
+		A->child1 = iF;
+	}
+	else
+	{
+		A->child2 = iF;
+	}
+	m_nodes[iF].parent = iA;
+
+	if (C->child1 == iF)
+	{
+		C->child1 = iB;
+	}
+	else
+	{
+		C->child2 = iB;
+	}
+	m_nodes[iB].parent = iC;
+
+	C->aabb.Combine(m_nodes[C->child1].aabb, m_nodes[C->child2].aabb);
+	C->height = 1 + b2Max(m_nodes[C->child1].height, m_nodes[C->child2].height);
+
+	// Walk back up the tree fixing heights.
+	int32 index = iA;
+	while (index != b2_nullNode)
+	{
+		b2TreeNode* node = m_nodes + index;
+		int32 height = 1 + b2Max(m_nodes[node->child1].height, m_nodes[node->child2].height);
+		if (height == node->height)
+		{
+			break;
+		}
+
+		node->height = height;
+		index = node->parent;
+	}
+}
+
+void b2DynamicTree::Save(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_root);
+	snapshot->Write(m_nodeCount);
+	snapshot->Write(m_nodeCapacity);
+	snapshot->Write(m_freeList);
+	snapshot->Write(m_path);
+	snapshot->Write(m_rotationIndex);
+	snapshot->Write(m_insertionCount);
+	snapshot->Write(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+}
+
+void b2DynamicTree::Restore(b2Snapshot* snapshot)
+{
+	int32 nodeCapacity;
+	snapshot->Read(&m_root);
+	snapshot->Read(&m_nodeCount);
+	snapshot->Read(&nodeCapacity);
+	snapshot->Read(&m_freeList);
+	snapshot->Read(&m_path);
+	snapshot->Read(&m_rotationIndex);
+	snapshot->Read(&m_insertionCount);
+
+	// The pool grows by doubling its capacity, so the capacity has to match
+	// for the pool to grow the same way later.
+	if (nodeCapacity != m_nodeCapacity)
+	{
+		b2Free(m_nodes);
+		m_nodeCapacity = nodeCapacity;
+		m_nodes = (b2TreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2TreeNode));
+	}
+
+	snapshot->Read(m_nodes, m_nodeCapacity * sizeof(b2TreeNode));
+}
@@ -22,6 +22,8 @@
 #include <Box2D/Collision/b2Collision.h>
 #include <Box2D/Common/b2GrowableStack.h>
 
+class b2Snapshot;
+
 #define b2_nullNode (-1)
 
 /// A node in the dynamic tree. The client does not interact with this directly.
@@ -115,11 +117,35 @@ public:
 	/// Get the ratio of the sum of the node areas to the root area.
 	float32 GetAreaRatio() const;
 
+	/// Get the expected number of nodes tested by a query with the size of
+	/// an average proxy, following the surface area heuristic.
+	float32 GetQueryCost() const;
+
 	/// Build an optimal tree. Very expensive. For testing.
 	void RebuildBottomUp();
 
+	/// Build a new tree top down, splitting the leaves with a binned surface
+	/// area heuristic. This takes O(N log N) time.
+	void RebuildTopDown();
+
+	/// Improve the tree with local rotations that reduce the surface area of
+	/// the nodes. Nodes are visited incrementally across calls until the time
+	/// budget runs out.
+	/// @param timeBudget the time budget in milliseconds.
+	/// @return the number of rotations.
+	int32 Rotate(float32 timeBudget);
+
+	/// Write the node pool to a snapshot. This includes the free list, so
+	/// the proxy ids handed out after a restore are the same.
+	void Save(b2Snapshot* snapshot) const;
+
+	/// Read the node pool from a snapshot written by Save.
+	void Restore(b2Snapshot* snapshot);
+
 private:
 
+	friend class b2WideTree;
+
 	int32 AllocateNode();
 	void FreeNode(int32 node);
 
@@ -128,6 +154,10 @@ private:
 
 	int32 Balance(int32 index);
 
+	int32 BuildTopDown(int32* leaves, int32 count);
+	bool RotateNode(int32 index);
+	void SwapNodes(int32 iA, int32 iB, int32 iC, int32 iF);
+
 	int32 ComputeHeight() const;
 	int32 ComputeHeight(int32 nodeId) const;
 
@@ -145,6 +175,9 @@ private:
 	/// This is used to incrementally traverse the tree for re-balancing.
 	uint32 m_path;
 
+	/// This is used to incrementally traverse the node pool for rotations.
+	int32 m_rotationIndex;
+
 	int32 m_insertionCount;
 };
 
@@ -0,0 +1,288 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <Box2D/Collision/b2WideTree.h>
+#include <cstring>
+using namespace std;
+
+b2WideTree::b2WideTree()
+{
+	m_root = b2_nullNode;
+
+	m_nodes = NULL;
+	m_parentSlots = NULL;
+	m_nodeCount = 0;
+	m_nodeCapacity = 0;
+
+	m_fatAABBs = NULL;
+	m_userData = NULL;
+	m_leafSlots = NULL;
+	m_proxyCapacity = 0;
+}
+
+b2WideTree::~b2WideTree()
+{
+	if (m_nodes)
+	{
+		b2Free(m_nodes);
+		b2Free(m_parentSlots);
+	}
+
+	if (m_fatAABBs)
+	{
+		b2Free(m_fatAABBs);
+		b2Free(m_userData);
+		b2Free(m_leafSlots);
+	}
+}
+
+void b2WideTree::Build(const b2DynamicTree& tree)
+{
+	m_root = b2_nullNode;
+	m_nodeCount = 0;
+
+	// Proxies keep the ids of the dynamic tree.
+	if (tree.m_nodeCapacity > m_proxyCapacity)
+	{
+		if (m_fatAABBs)
+		{
+			b2Free(m_fatAABBs);
+			b2Free(m_userData);
+			b2Free(m_leafSlots);
+		}
+
+		m_proxyCapacity = tree.m_nodeCapacity;
+		m_fatAABBs = (b2AABB*)b2Alloc(m_proxyCapacity * sizeof(b2AABB));
+		m_userData = (void**)b2Alloc(m_proxyCapacity * sizeof(void*));
+		m_leafSlots = (int32*)b2Alloc(m_proxyCapacity * sizeof(int32));
+	}
+
+	for (int32 i = 0; i < m_proxyCapacity; ++i)
+	{
+		m_leafSlots[i] = b2_nullNode;
+		m_userData[i] = NULL;
+	}
+
+	if (tree.m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	// Every wide node has at least two children, except for a single leaf root.
+	if (tree.m_nodeCount > m_nodeCapacity)
+	{
+		if (m_nodes)
+		{
+			b2Free(m_nodes);
+			b2Free(m_parentSlots);
+		}
+
+		m_nodeCapacity = tree.m_nodeCount;
+		m_nodes = (b2WideTreeNode*)b2Alloc(m_nodeCapacity * sizeof(b2WideTreeNode));
+		m_parentSlots = (int32*)b2Alloc(m_nodeCapacity * sizeof(int32));
+	}
+
+	m_root = BuildNode(tree, tree.m_root, b2_nullNode);
+}
+
+// Collapse the binary subtree below index into a wide node. The largest
+// internal node is opened until there are four children. Nodes are
+// allocated depth first.
+int32 b2WideTree::BuildNode(const b2DynamicTree& tree, int32 index, int32 parentSlot)
+{
+	b2Assert(m_nodeCount < m_nodeCapacity);
+	int32 nodeId = m_nodeCount++;
+	m_parentSlots[nodeId] = parentSlot;
+
+	int32 children[b2_simdWidth];
+	int32 childCount = 0;
+
+	const b2TreeNode* root = tree.m_nodes + index;
+	if (root->IsLeaf())
+	{
+		children[childCount++] = index;
+	}
+	else
+	{
+		children[childCount++] = root->child1;
+		children[childCount++] = root->child2;
+	}
+
+	while (childCount < b2_simdWidth)
+	{
+		int32 largest = -1;
+		float32 largestPerimeter = -1.0f;
+		for (int32 i = 0; i < childCount; ++i)
+		{
+			const b2TreeNode* child = tree.m_nodes + children[i];
+			if (child->IsLeaf() == false && child->aabb.GetPerimeter() > largestPerimeter)
+			{
+				largest = i;
+				largestPerimeter = child->aabb.GetPerimeter();
+			}
+		}
+
+		if (largest == -1)
+		{
+			break;
+		}
+
+		const b2TreeNode* child = tree.m_nodes + children[largest];
+		children[largest] = child->child1;
+		children[childCount++] = child->child2;
+	}
+
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		b2WideTreeNode* node = m_nodes + nodeId;
+		if (lane >= childCount)
+		{
+			// Empty lanes never overlap anything.
+			node->lowerX[lane] = b2_maxFloat;
+			node->lowerY[lane] = b2_maxFloat;
+			node->upperX[lane] = -b2_maxFloat;
+			node->upperY[lane] = -b2_maxFloat;
+			node->children[lane] = b2_nullNode;
+			continue;
+		}
+
+		const b2TreeNode* child = tree.m_nodes + children[lane];
+		node->lowerX[lane] = child->aabb.lowerBound.x;
+		node->lowerY[lane] = child->aabb.lowerBound.y;
+		node->upperX[lane] = child->aabb.upperBound.x;
+		node->upperY[lane] = child->aabb.upperBound.y;
+
+		if (child->IsLeaf())
+		{
+			int32 proxyId = children[lane];
+			m_fatAABBs[proxyId] = child->aabb;
+			m_userData[proxyId] = child->userData;
+			m_leafSlots[proxyId] = nodeId * b2_simdWidth + lane;
+			node->children[lane] = EncodeLeaf(proxyId);
+		}
+		else
+		{
+			int32 childId = BuildNode(tree, children[lane], nodeId * b2_simdWidth + lane);
+			m_nodes[nodeId].children[lane] = childId;
+		}
+	}
+
+	return nodeId;
+}
+
+bool b2WideTree::MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement)
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	b2Assert(m_leafSlots[proxyId] != b2_nullNode);
+
+	if (m_fatAABBs[proxyId].Contains(aabb))
+	{
+		return false;
+	}
+
+	// Extend AABB.
+	b2AABB b = aabb;
+	b2Vec2 r(b2_aabbExtension, b2_aabbExtension);
+	b.lowerBound = b.lowerBound - r;
+	b.upperBound = b.upperBound + r;
+
+	// Predict AABB displacement.
+	b2Vec2 d = b2_aabbMultiplier * displacement;
+
+	if (d.x < 0.0f)
+	{
+		b.lowerBound.x += d.x;
+	}
+	else
+	{
+		b.upperBound.x += d.x;
+	}
+
+	if (d.y < 0.0f)
+	{
+		b.lowerBound.y += d.y;
+	}
+	else
+	{
+		b.upperBound.y += d.y;
+	}
+
+	m_fatAABBs[proxyId] = b;
+
+	// The leaf gets the new box, the ancestors are enlarged until one already contains it.
+	int32 slot = m_leafSlots[proxyId];
+	bool leaf = true;
+	while (slot != b2_nullNode)
+	{
+		b2WideTreeNode* node = m_nodes + slot / b2_simdWidth;
+		int32 lane = slot % b2_simdWidth;
+
+		b2AABB box;
+		box.lowerBound.Set(node->lowerX[lane], node->lowerY[lane]);
+		box.upperBound.Set(node->upperX[lane], node->upperY[lane]);
+
+		if (leaf)
+		{
+			box = b;
+			leaf = false;
+		}
+		else if (box.Contains(b))
+		{
+			break;
+		}
+		else
+		{
+			box.Combine(b);
+		}
+
+		node->lowerX[lane] = box.lowerBound.x;
+		node->lowerY[lane] = box.lowerBound.y;
+		node->upperX[lane] = box.upperBound.x;
+		node->upperY[lane] = box.upperBound.y;
+
+		slot = m_parentSlots[slot / b2_simdWidth];
+	}
+
+	return true;
+}
+
+int32 b2WideTree::ComputeHeight(int32 nodeId) const
+{
+	const b2WideTreeNode* node = m_nodes + nodeId;
+	int32 height = 0;
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		if (node->children[lane] >= 0)
+		{
+			height = b2Max(height, ComputeHeight(node->children[lane]));
+		}
+	}
+
+	return 1 + height;
+}
+
+int32 b2WideTree::GetHeight() const
+{
+	if (m_root == b2_nullNode)
+	{
+		return 0;
+	}
+
+	return ComputeHeight(m_root);
+}
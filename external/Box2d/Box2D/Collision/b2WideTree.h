@@ -0,0 +1,280 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B2_WIDE_TREE_H
+#define B2_WIDE_TREE_H
+
+#include <Box2D/Collision/b2DynamicTree.h>
+#include <Box2D/Common/b2Simd.h>
+
+/// The maximum traversal stack size of a wide tree query.
+#define b2_wideTreeStackSize	256
+
+/// A node in the wide tree. The bounding boxes of the children are stored
+/// by coordinate so that all of them are tested at once.
+struct b2WideTreeNode
+{
+	float32 lowerX[b2_simdWidth];
+	float32 lowerY[b2_simdWidth];
+	float32 upperX[b2_simdWidth];
+	float32 upperY[b2_simdWidth];
+
+	/// A node index, an encoded proxy id for leaves or b2_nullNode.
+	int32 children[b2_simdWidth];
+};
+
+/// A read mostly companion to b2DynamicTree with four children per node.
+/// The tree is built from a dynamic tree by collapsing its binary nodes and
+/// keeps the proxy ids of that tree. Node bounding boxes are tested four at
+/// a time with SIMD and the traversal uses a fixed size stack. User data and
+/// the fat AABBs of the proxies are kept apart from the nodes.
+///
+/// Moving a proxy only enlarges the boxes of its ancestors, so the tree
+/// should be rebuilt from time to time when proxies move a lot.
+class b2WideTree
+{
+public:
+	/// Constructing the tree creates an empty tree.
+	b2WideTree();
+
+	/// Destroy the tree, freeing the nodes.
+	~b2WideTree();
+
+	/// Rebuild this tree from the current state of a dynamic tree.
+	void Build(const b2DynamicTree& tree);
+
+	/// Move a proxy with a swepted AABB. If the proxy has moved outside of its fattened AABB,
+	/// then the fattened AABB and the boxes of its ancestors are enlarged.
+	/// @return true if the fattened AABB was changed.
+	bool MoveProxy(int32 proxyId, const b2AABB& aabb, const b2Vec2& displacement);
+
+	/// Get proxy user data.
+	void* GetUserData(int32 proxyId) const;
+
+	/// Get the fat AABB for a proxy.
+	const b2AABB& GetFatAABB(int32 proxyId) const;
+
+	/// Query an AABB for overlapping proxies. The callback class
+	/// is called for each proxy that overlaps the supplied AABB.
+	template <typename T>
+	void Query(T* callback, const b2AABB& aabb) const;
+
+	/// Ray-cast against the proxies in the tree. See b2DynamicTree::RayCast.
+	template <typename T>
+	void RayCast(T* callback, const b2RayCastInput& input) const;
+
+	/// Get the number of nodes.
+	int32 GetNodeCount() const { return m_nodeCount; }
+
+	/// Compute the height of the tree in O(N) time.
+	int32 GetHeight() const;
+
+private:
+
+	int32 BuildNode(const b2DynamicTree& tree, int32 index, int32 parentSlot);
+	int32 ComputeHeight(int32 nodeId) const;
+
+	static int32 EncodeLeaf(int32 proxyId) { return -2 - proxyId; }
+	static int32 DecodeLeaf(int32 child) { return -2 - child; }
+
+	int32 m_root;
+
+	b2WideTreeNode* m_nodes;
+	int32* m_parentSlots;
+	int32 m_nodeCount;
+	int32 m_nodeCapacity;
+
+	b2AABB* m_fatAABBs;
+	void** m_userData;
+	int32* m_leafSlots;
+	int32 m_proxyCapacity;
+};
+
+inline void* b2WideTree::GetUserData(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_userData[proxyId];
+}
+
+inline const b2AABB& b2WideTree::GetFatAABB(int32 proxyId) const
+{
+	b2Assert(0 <= proxyId && proxyId < m_proxyCapacity);
+	return m_fatAABBs[proxyId];
+}
+
+template <typename T>
+inline void b2WideTree::Query(T* callback, const b2AABB& aabb) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2FloatW lowerX = b2SplatW(aabb.lowerBound.x);
+	b2FloatW lowerY = b2SplatW(aabb.lowerBound.y);
+	b2FloatW upperX = b2SplatW(aabb.upperBound.x);
+	b2FloatW upperY = b2SplatW(aabb.upperBound.y);
+
+	int32 stack[b2_wideTreeStackSize];
+	int32 count = 0;
+	stack[count++] = m_root;
+
+	while (count > 0)
+	{
+		const b2WideTreeNode* node = m_nodes + stack[--count];
+
+		b2FloatW overlapX = b2AndW(b2GreaterEqualW(b2LoadW(node->upperX), lowerX), b2GreaterEqualW(upperX, b2LoadW(node->lowerX)));
+		b2FloatW overlapY = b2AndW(b2GreaterEqualW(b2LoadW(node->upperY), lowerY), b2GreaterEqualW(upperY, b2LoadW(node->lowerY)));
+		int32 mask = b2MoveMaskW(b2AndW(overlapX, overlapY));
+
+		for (int32 lane = 0; mask != 0; ++lane, mask >>= 1)
+		{
+			if ((mask & 1) == 0)
+			{
+				continue;
+			}
+
+			int32 child = node->children[lane];
+			if (child >= 0)
+			{
+				b2Assert(count < b2_wideTreeStackSize);
+				stack[count++] = child;
+			}
+			else
+			{
+				bool proceed = callback->QueryCallback(DecodeLeaf(child));
+				if (proceed == false)
+				{
+					return;
+				}
+			}
+		}
+	}
+}
+
+template <typename T>
+inline void b2WideTree::RayCast(T* callback, const b2RayCastInput& input) const
+{
+	if (m_root == b2_nullNode)
+	{
+		return;
+	}
+
+	b2Vec2 p1 = input.p1;
+	b2Vec2 p2 = input.p2;
+	b2Vec2 r = p2 - p1;
+	b2Assert(r.LengthSquared() > 0.0f);
+	r.Normalize();
+
+	// v is perpendicular to the segment.
+	b2Vec2 v = b2Cross(1.0f, r);
+	b2Vec2 abs_v = b2Abs(v);
+
+	b2FloatW p1X = b2SplatW(p1.x);
+	b2FloatW p1Y = b2SplatW(p1.y);
+	b2FloatW vX = b2SplatW(v.x);
+	b2FloatW vY = b2SplatW(v.y);
+	b2FloatW absVX = b2SplatW(abs_v.x);
+	b2FloatW absVY = b2SplatW(abs_v.y);
+	b2FloatW half = b2SplatW(0.5f);
+	b2FloatW zero = b2ZeroW();
+
+	float32 maxFraction = input.maxFraction;
+
+	// Build a bounding box for the segment.
+	b2FloatW segmentLowerX, segmentLowerY, segmentUpperX, segmentUpperY;
+	{
+		b2Vec2 t = p1 + maxFraction * (p2 - p1);
+		segmentLowerX = b2SplatW(b2Min(p1.x, t.x));
+		segmentLowerY = b2SplatW(b2Min(p1.y, t.y));
+		segmentUpperX = b2SplatW(b2Max(p1.x, t.x));
+		segmentUpperY = b2SplatW(b2Max(p1.y, t.y));
+	}
+
+	int32 stack[b2_wideTreeStackSize];
+	int32 count = 0;
+	stack[count++] = m_root;
+
+	while (count > 0)
+	{
+		const b2WideTreeNode* node = m_nodes + stack[--count];
+
+		b2FloatW lowerX = b2LoadW(node->lowerX);
+		b2FloatW lowerY = b2LoadW(node->lowerY);
+		b2FloatW upperX = b2LoadW(node->upperX);
+		b2FloatW upperY = b2LoadW(node->upperY);
+
+		b2FloatW overlapX = b2AndW(b2GreaterEqualW(upperX, segmentLowerX), b2GreaterEqualW(segmentUpperX, lowerX));
+		b2FloatW overlapY = b2AndW(b2GreaterEqualW(upperY, segmentLowerY), b2GreaterEqualW(segmentUpperY, lowerY));
+
+		// Separating axis for segment (Gino, p80).
+		// |dot(v, p1 - c)| > dot(|v|, h)
+		b2FloatW cX = b2MulW(half, b2AddW(lowerX, upperX));
+		b2FloatW cY = b2MulW(half, b2AddW(lowerY, upperY));
+		b2FloatW hX = b2MulW(half, b2SubW(upperX, lowerX));
+		b2FloatW hY = b2MulW(half, b2SubW(upperY, lowerY));
+		b2FloatW separation = b2AbsW(b2AddW(b2MulW(vX, b2SubW(p1X, cX)), b2MulW(vY, b2SubW(p1Y, cY))));
+		separation = b2SubW(separation, b2AddW(b2MulW(absVX, hX), b2MulW(absVY, hY)));
+
+		b2FloatW hit = b2AndW(b2AndW(overlapX, overlapY), b2GreaterEqualW(zero, separation));
+		int32 mask = b2MoveMaskW(hit);
+
+		for (int32 lane = 0; mask != 0; ++lane, mask >>= 1)
+		{
+			if ((mask & 1) == 0)
+			{
+				continue;
+			}
+
+			int32 child = node->children[lane];
+			if (child >= 0)
+			{
+				b2Assert(count < b2_wideTreeStackSize);
+				stack[count++] = child;
+				continue;
+			}
+
+			b2RayCastInput subInput;
+			subInput.p1 = input.p1;
+			subInput.p2 = input.p2;
+			subInput.maxFraction = maxFraction;
+
+			float32 value = callback->RayCastCallback(subInput, DecodeLeaf(child));
+
+			if (value == 0.0f)
+			{
+				// The client has terminated the ray cast.
+				return;
+			}
+
+			if (value > 0.0f)
+			{
+				// Update segment bounding box.
+				maxFraction = value;
+				b2Vec2 t = p1 + maxFraction * (p2 - p1);
+				segmentLowerX = b2SplatW(b2Min(p1.x, t.x));
+				segmentLowerY = b2SplatW(b2Min(p1.y, t.y));
+				segmentUpperX = b2SplatW(b2Max(p1.x, t.x));
+				segmentUpperY = b2SplatW(b2Max(p1.y, t.y));
+			}
+		}
+	}
+}
+
+#endif
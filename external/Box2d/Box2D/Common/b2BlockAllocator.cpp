@@ -17,10 +17,12 @@
 */
 
 #include <Box2D/Common/b2BlockAllocator.h>
+#include <Box2D/Common/b2Math.h>
 #include <cstdlib>
 #include <climits>
 #include <cstring>
 #include <memory>
+#include <algorithm>
 using namespace std;
 
 int32 b2BlockAllocator::s_blockSizes[b2_blockSizes] =
@@ -65,6 +67,11 @@ b2BlockAllocator::b2BlockAllocator()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 	memset(m_freeLists, 0, sizeof(m_freeLists));
 
+	memset(m_blocksInUse, 0, sizeof(m_blocksInUse));
+	m_bytesInUse = 0;
+	m_maxBytesInUse = 0;
+	m_mallocCount = 0;
+
 	if (s_blockSizeLookupInitialized == false)
 	{
 		int32 j = 0;
@@ -105,12 +112,19 @@ void* b2BlockAllocator::Allocate(int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
+		++m_mallocCount;
+		m_bytesInUse += size;
+		m_maxBytesInUse = b2Max(m_maxBytesInUse, m_bytesInUse);
 		return b2Alloc(size);
 	}
 
 	int32 index = s_blockSizeLookup[size];
 	b2Assert(0 <= index && index < b2_blockSizes);
 
+	++m_blocksInUse[index];
+	m_bytesInUse += s_blockSizes[index];
+	m_maxBytesInUse = b2Max(m_maxBytesInUse, m_bytesInUse);
+
 	if (m_freeLists[index])
 	{
 		b2Block* block = m_freeLists[index];
@@ -165,6 +179,7 @@ void b2BlockAllocator::Free(void* p, int32 size)
 
 	if (size > b2_maxBlockSize)
 	{
+		m_bytesInUse -= size;
 		b2Free(p);
 		return;
 	}
@@ -172,6 +187,10 @@ void b2BlockAllocator::Free(void* p, int32 size)
 	int32 index = s_blockSizeLookup[size];
 	b2Assert(0 <= index && index < b2_blockSizes);
 
+	b2Assert(m_blocksInUse[index] > 0);
+	--m_blocksInUse[index];
+	m_bytesInUse -= s_blockSizes[index];
+
 #ifdef _DEBUG
 	// Verify the memory address and size is valid.
 	int32 blockSize = s_blockSizes[index];
@@ -214,4 +233,125 @@ void b2BlockAllocator::Clear()
 	memset(m_chunks, 0, m_chunkSpace * sizeof(b2Chunk));
 
 	memset(m_freeLists, 0, sizeof(m_freeLists));
+
+	// Large allocations are still alive.
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		m_bytesInUse -= m_blocksInUse[i] * s_blockSizes[i];
+		m_blocksInUse[i] = 0;
+	}
+}
+
+static bool b2ChunkLessThan(const b2Chunk& chunk1, const b2Chunk& chunk2)
+{
+	return chunk1.blocks < chunk2.blocks;
+}
+
+// Find the chunk that holds a block. The chunks are sorted by address.
+static int32 b2FindChunk(const b2Chunk* chunks, int32 count, const b2Block* block)
+{
+	int32 low = 0;
+	int32 high = count - 1;
+	while (low < high)
+	{
+		int32 mid = (low + high + 1) / 2;
+		if ((const int8*)chunks[mid].blocks <= (const int8*)block)
+		{
+			low = mid;
+		}
+		else
+		{
+			high = mid - 1;
+		}
+	}
+
+	b2Assert((const int8*)chunks[low].blocks <= (const int8*)block);
+	b2Assert((const int8*)block < (const int8*)chunks[low].blocks + b2_chunkSize);
+	return low;
+}
+
+int32 b2BlockAllocator::Trim()
+{
+	if (m_chunkCount == 0)
+	{
+		return 0;
+	}
+
+	// Count the free blocks of every chunk.
+	std::sort(m_chunks, m_chunks + m_chunkCount, b2ChunkLessThan);
+
+	int32* freeCounts = (int32*)b2Alloc(m_chunkCount * sizeof(int32));
+	memset(freeCounts, 0, m_chunkCount * sizeof(int32));
+
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		for (b2Block* block = m_freeLists[i]; block; block = block->next)
+		{
+			++freeCounts[b2FindChunk(m_chunks, m_chunkCount, block)];
+		}
+	}
+
+	// Unlink the blocks of the empty chunks from the free lists, keeping
+	// the order of the other blocks.
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		int32 blockCount = b2_chunkSize / s_blockSizes[i];
+		b2Block** link = m_freeLists + i;
+		while (*link)
+		{
+			int32 chunkIndex = b2FindChunk(m_chunks, m_chunkCount, *link);
+			if (freeCounts[chunkIndex] == blockCount)
+			{
+				*link = (*link)->next;
+			}
+			else
+			{
+				link = &(*link)->next;
+			}
+		}
+	}
+
+	int32 released = 0;
+	int32 chunkCount = 0;
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		b2Chunk* chunk = m_chunks + i;
+		if (freeCounts[i] == b2_chunkSize / chunk->blockSize)
+		{
+			b2Free(chunk->blocks);
+			released += b2_chunkSize;
+		}
+		else
+		{
+			m_chunks[chunkCount++] = *chunk;
+		}
+	}
+
+	memset(m_chunks + chunkCount, 0, (m_chunkCount - chunkCount) * sizeof(b2Chunk));
+	m_chunkCount = chunkCount;
+
+	b2Free(freeCounts);
+
+	return released;
+}
+
+void b2BlockAllocator::GetStats(b2BlockAllocatorStats* stats) const
+{
+	stats->bytesInUse = m_bytesInUse;
+	stats->maxBytesInUse = m_maxBytesInUse;
+	stats->chunkBytes = m_chunkCount * b2_chunkSize;
+	stats->mallocCount = m_mallocCount;
+
+	for (int32 i = 0; i < b2_blockSizes; ++i)
+	{
+		stats->blockSizes[i] = s_blockSizes[i];
+		stats->blocksInUse[i] = m_blocksInUse[i];
+		stats->blockCapacity[i] = 0;
+	}
+
+	for (int32 i = 0; i < m_chunkCount; ++i)
+	{
+		int32 index = s_blockSizeLookup[m_chunks[i].blockSize];
+		stats->blockCapacity[index] += b2_chunkSize / m_chunks[i].blockSize;
+	}
 }
@@ -29,6 +29,31 @@ const int32 b2_chunkArrayIncrement = 128;
 struct b2Block;
 struct b2Chunk;
 
+/// Memory statistics of a block allocator.
+struct b2BlockAllocatorStats
+{
+	/// The number of bytes handed out right now, counting whole blocks.
+	int32 bytesInUse;
+
+	/// The largest value of bytesInUse so far.
+	int32 maxBytesInUse;
+
+	/// The number of bytes held in chunks.
+	int32 chunkBytes;
+
+	/// The number of allocations larger than b2_maxBlockSize, which use b2Alloc.
+	int32 mallocCount;
+
+	/// The size of the blocks of each size class.
+	int32 blockSizes[b2_blockSizes];
+
+	/// The number of blocks of each size class in use.
+	int32 blocksInUse[b2_blockSizes];
+
+	/// The number of blocks of each size class in the chunks.
+	int32 blockCapacity[b2_blockSizes];
+};
+
 /// This is a small object allocator used for allocating small
 /// objects that persist for more than one time step.
 /// See: http://www.codeproject.com/useritems/Small_Block_Allocator.asp
@@ -46,6 +71,12 @@ public:
 
 	void Clear();
 
+	/// Return the chunks that have no block in use to b2Free.
+	/// @return the number of bytes released.
+	int32 Trim();
+
+	void GetStats(b2BlockAllocatorStats* stats) const;
+
 private:
 
 	b2Chunk* m_chunks;
@@ -54,6 +85,11 @@ private:
 
 	b2Block* m_freeLists[b2_blockSizes];
 
+	int32 m_blocksInUse[b2_blockSizes];
+	int32 m_bytesInUse;
+	int32 m_maxBytesInUse;
+	int32 m_mallocCount;
+
 	static int32 s_blockSizes[b2_blockSizes];
 	static uint8 s_blockSizeLookup[b2_maxBlockSize + 1];
 	static bool s_blockSizeLookupInitialized;
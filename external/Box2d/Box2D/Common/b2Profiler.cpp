@@ -0,0 +1,154 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <Box2D/Common/b2Profiler.h>
+#include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Math.h>
+#include <cstdio>
+#include <cstring>
+using namespace std;
+
+b2Profiler::b2Profiler()
+{
+	memset(m_threads, 0, sizeof(m_threads));
+	m_origin = b2Timer::GetTimestamp();
+	m_enabled = true;
+}
+
+b2Profiler::~b2Profiler()
+{
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		if (m_threads[i].events)
+		{
+			b2Free(m_threads[i].events);
+		}
+	}
+}
+
+void b2Profiler::Clear()
+{
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		b2Assert(m_threads[i].depth == 0);
+		m_threads[i].count = 0;
+	}
+
+	m_origin = b2Timer::GetTimestamp();
+}
+
+b2ProfileEvent* b2Profiler::Push(int32 threadIndex)
+{
+	b2Assert(0 <= threadIndex && threadIndex < b2_maxThreads);
+	b2ProfileThread* thread = m_threads + threadIndex;
+
+	if (thread->count == thread->capacity)
+	{
+		b2ProfileEvent* oldEvents = thread->events;
+		thread->capacity = b2Max(2 * thread->capacity, 256);
+		thread->events = (b2ProfileEvent*)b2Alloc(thread->capacity * sizeof(b2ProfileEvent));
+		if (oldEvents)
+		{
+			memcpy(thread->events, oldEvents, thread->count * sizeof(b2ProfileEvent));
+			b2Free(oldEvents);
+		}
+	}
+
+	return thread->events + thread->count++;
+}
+
+void b2Profiler::Begin(const char* name, int32 threadIndex)
+{
+	b2ProfileThread* thread = m_threads + threadIndex;
+	b2Assert(thread->depth < b2_maxProfileDepth);
+
+	b2ProfileEvent* event = Push(threadIndex);
+	event->name = name;
+	event->count = 1;
+	event->depth = thread->depth;
+	event->end = 0;
+
+	thread->stack[thread->depth++] = thread->count - 1;
+
+	// Read the clock last, so the bookkeeping is not part of the span.
+	event->begin = b2Timer::GetTimestamp() - m_origin;
+}
+
+void b2Profiler::End(int32 threadIndex)
+{
+	int64 now = b2Timer::GetTimestamp() - m_origin;
+
+	b2ProfileThread* thread = m_threads + threadIndex;
+	b2Assert(thread->depth > 0);
+
+	int32 index = thread->stack[--thread->depth];
+	thread->events[index].end = now;
+}
+
+void b2Profiler::AddEvent(const char* name, int64 begin, int64 end, int32 count, int32 threadIndex)
+{
+	b2ProfileEvent* event = Push(threadIndex);
+	event->name = name;
+	event->begin = begin - m_origin;
+	event->end = end - m_origin;
+	event->count = count;
+	event->depth = m_threads[threadIndex].depth;
+}
+
+int32 b2Profiler::GetEventCount(int32 threadIndex) const
+{
+	b2Assert(0 <= threadIndex && threadIndex < b2_maxThreads);
+	return m_threads[threadIndex].count;
+}
+
+const b2ProfileEvent* b2Profiler::GetEvents(int32 threadIndex) const
+{
+	b2Assert(0 <= threadIndex && threadIndex < b2_maxThreads);
+	return m_threads[threadIndex].events;
+}
+
+bool b2Profiler::WriteChromeTrace(const char* fileName) const
+{
+	FILE* file = fopen(fileName, "w");
+	if (file == NULL)
+	{
+		return false;
+	}
+
+	// Complete events ("X") nest by their time stamps, which are in microseconds.
+	fprintf(file, "{\"traceEvents\":[\n");
+	bool first = true;
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		const b2ProfileThread* thread = m_threads + i;
+		for (int32 j = 0; j < thread->count; ++j)
+		{
+			const b2ProfileEvent* event = thread->events + j;
+			fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":0,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"count\":%d}}",
+				first ? "" : ",\n", event->name, i,
+				float64(event->begin) * 1.0e-3, float64(event->end - event->begin) * 1.0e-3, event->count);
+			first = false;
+		}
+	}
+	fprintf(file, "\n]}\n");
+
+	bool ok = ferror(file) == 0;
+	fclose(file);
+	return ok;
+}
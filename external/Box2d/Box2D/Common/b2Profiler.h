@@ -0,0 +1,127 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B2_PROFILER_H
+#define B2_PROFILER_H
+
+#include <Box2D/Common/b2Settings.h>
+#include <Box2D/Common/b2ThreadPool.h>
+
+/// The deepest nesting of profiler scopes.
+#define b2_maxProfileDepth	32
+
+/// A timed span recorded by b2Profiler. Times are in nanoseconds since
+/// the profiler was cleared.
+struct b2ProfileEvent
+{
+	/// The name must outlive the profiler, typically a string literal.
+	const char* name;
+	int64 begin;
+	int64 end;
+
+	/// The number of calls summed up in this event. Scopes have one call.
+	int32 count;
+
+	int32 depth;
+};
+
+/// Records nested time spans for each thread of a world and writes them
+/// as Chrome trace events, which can be viewed in chrome://tracing or
+/// Perfetto. Threads only touch their own records, so recording needs
+/// no locking. Attach a profiler with b2World::SetProfiler.
+class b2Profiler
+{
+public:
+	b2Profiler();
+	~b2Profiler();
+
+	/// A disabled profiler records nothing. Profilers start enabled.
+	void SetEnabled(bool flag) { m_enabled = flag; }
+	bool IsEnabled() const { return m_enabled; }
+
+	/// Remove all events and restart the clock. The memory is kept.
+	/// This must not be called inside a scope.
+	void Clear();
+
+	/// Open a span on the given thread. Spans of a thread must nest.
+	void Begin(const char* name, int32 threadIndex = 0);
+
+	/// Close the innermost open span of the given thread.
+	void End(int32 threadIndex = 0);
+
+	/// Add a span with explicit time stamps from b2Timer::GetTimestamp,
+	/// nested in the innermost open span of the thread. This is meant for
+	/// totals of many short calls.
+	void AddEvent(const char* name, int64 begin, int64 end, int32 count, int32 threadIndex = 0);
+
+	/// Get the recorded events of a thread, in the order they began.
+	int32 GetEventCount(int32 threadIndex = 0) const;
+	const b2ProfileEvent* GetEvents(int32 threadIndex = 0) const;
+
+	/// Write all events as Chrome trace event JSON.
+	/// @return false if the file could not be written.
+	bool WriteChromeTrace(const char* fileName) const;
+
+private:
+
+	struct b2ProfileThread
+	{
+		b2ProfileEvent* events;
+		int32 count;
+		int32 capacity;
+		int32 stack[b2_maxProfileDepth];
+		int32 depth;
+	};
+
+	b2ProfileEvent* Push(int32 threadIndex);
+
+	b2ProfileThread m_threads[b2_maxThreads];
+	int64 m_origin;
+	bool m_enabled;
+};
+
+/// Times the enclosing block. Does nothing if the profiler is NULL or disabled.
+class b2ProfileScope
+{
+public:
+	b2ProfileScope(b2Profiler* profiler, const char* name, int32 threadIndex = 0)
+	{
+		m_profiler = profiler && profiler->IsEnabled() ? profiler : NULL;
+		m_threadIndex = threadIndex;
+		if (m_profiler)
+		{
+			m_profiler->Begin(name, threadIndex);
+		}
+	}
+
+	~b2ProfileScope()
+	{
+		if (m_profiler)
+		{
+			m_profiler->End(m_threadIndex);
+		}
+	}
+
+private:
+
+	b2Profiler* m_profiler;
+	int32 m_threadIndex;
+};
+
+#endif
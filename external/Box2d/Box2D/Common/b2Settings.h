@@ -31,6 +31,8 @@ typedef signed int int32;
 typedef unsigned char uint8;
 typedef unsigned short uint16;
 typedef unsigned int uint32;
+typedef signed long long int64;
+typedef unsigned long long uint64;
 typedef float float32;
 typedef double float64;
 
@@ -0,0 +1,242 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_SIMD_H
+#define B2_SIMD_H
+
+#include <Box2D/Common/b2Math.h>
+
+/// Four wide float math used by the batched solvers. SSE2 and NEON are used
+/// when the compiler targets them, otherwise a portable fallback is used.
+/// Define B2_NO_SIMD to force the fallback.
+/// Comparisons return lane masks that are meant for b2AndW and b2SelectW.
+
+#define b2_simdWidth	4
+
+#if !defined(B2_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define B2_SIMD_SSE2
+#include <emmintrin.h>
+#elif !defined(B2_NO_SIMD) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+#define B2_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(B2_SIMD_SSE2)
+
+typedef __m128 b2FloatW;
+
+inline b2FloatW b2ZeroW() { return _mm_setzero_ps(); }
+inline b2FloatW b2SplatW(float32 x) { return _mm_set1_ps(x); }
+inline b2FloatW b2MakeW(float32 x, float32 y, float32 z, float32 w) { return _mm_setr_ps(x, y, z, w); }
+inline b2FloatW b2LoadW(const float32* in) { return _mm_loadu_ps(in); }
+inline void b2StoreW(float32* out, b2FloatW a) { _mm_storeu_ps(out, a); }
+
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return _mm_add_ps(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return _mm_sub_ps(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return _mm_mul_ps(a, b); }
+inline b2FloatW b2DivW(b2FloatW a, b2FloatW b) { return _mm_div_ps(a, b); }
+inline b2FloatW b2SqrtW(b2FloatW a) { return _mm_sqrt_ps(a); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return _mm_min_ps(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return _mm_max_ps(a, b); }
+
+inline b2FloatW b2GreaterW(b2FloatW a, b2FloatW b) { return _mm_cmpgt_ps(a, b); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return _mm_cmpge_ps(a, b); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b) { return _mm_and_ps(a, b); }
+inline b2FloatW b2OrW(b2FloatW a, b2FloatW b) { return _mm_or_ps(a, b); }
+
+/// Per lane: mask ? b : a
+inline b2FloatW b2SelectW(b2FloatW a, b2FloatW b, b2FloatW mask)
+{
+	return _mm_or_ps(_mm_and_ps(mask, b), _mm_andnot_ps(mask, a));
+}
+
+/// Bit i is set if lane i of the mask is set.
+inline int32 b2MoveMaskW(b2FloatW mask) { return _mm_movemask_ps(mask); }
+
+#elif defined(B2_SIMD_NEON)
+
+typedef float32x4_t b2FloatW;
+
+inline b2FloatW b2ZeroW() { return vdupq_n_f32(0.0f); }
+inline b2FloatW b2SplatW(float32 x) { return vdupq_n_f32(x); }
+inline b2FloatW b2MakeW(float32 x, float32 y, float32 z, float32 w)
+{
+	float32 v[4] = {x, y, z, w};
+	return vld1q_f32(v);
+}
+inline b2FloatW b2LoadW(const float32* in) { return vld1q_f32(in); }
+inline void b2StoreW(float32* out, b2FloatW a) { vst1q_f32(out, a); }
+
+inline b2FloatW b2AddW(b2FloatW a, b2FloatW b) { return vaddq_f32(a, b); }
+inline b2FloatW b2SubW(b2FloatW a, b2FloatW b) { return vsubq_f32(a, b); }
+inline b2FloatW b2MulW(b2FloatW a, b2FloatW b) { return vmulq_f32(a, b); }
+inline b2FloatW b2MinW(b2FloatW a, b2FloatW b) { return vminq_f32(a, b); }
+inline b2FloatW b2MaxW(b2FloatW a, b2FloatW b) { return vmaxq_f32(a, b); }
+
+#if defined(__aarch64__)
+inline b2FloatW b2DivW(b2FloatW a, b2FloatW b) { return vdivq_f32(a, b); }
+inline b2FloatW b2SqrtW(b2FloatW a) { return vsqrtq_f32(a); }
+#else
+// ARMv7 has no vector divide or square root. Refine the estimates with
+// two Newton-Raphson steps, which is close to full single precision.
+inline b2FloatW b2DivW(b2FloatW a, b2FloatW b)
+{
+	float32x4_t r = vrecpeq_f32(b);
+	r = vmulq_f32(r, vrecpsq_f32(b, r));
+	r = vmulq_f32(r, vrecpsq_f32(b, r));
+	return vmulq_f32(a, r);
+}
+
+inline b2FloatW b2SqrtW(b2FloatW a)
+{
+	float32x4_t r = vrsqrteq_f32(a);
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a, r), r));
+	r = vmulq_f32(r, vrsqrtsq_f32(vmulq_f32(a, r), r));
+	uint32x4_t zero = vceqq_f32(a, vdupq_n_f32(0.0f));
+	return vbslq_f32(zero, vdupq_n_f32(0.0f), vmulq_f32(a, r));
+}
+#endif
+
+inline b2FloatW b2GreaterW(b2FloatW a, b2FloatW b) { return vreinterpretq_f32_u32(vcgtq_f32(a, b)); }
+inline b2FloatW b2GreaterEqualW(b2FloatW a, b2FloatW b) { return vreinterpretq_f32_u32(vcgeq_f32(a, b)); }
+inline b2FloatW b2AndW(b2FloatW a, b2FloatW b)
+{
+	return vreinterpretq_f32_u32(vandq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+inline b2FloatW b2OrW(b2FloatW a, b2FloatW b)
+{
+	return vreinterpretq_f32_u32(vorrq_u32(vreinterpretq_u32_f32(a), vreinterpretq_u32_f32(b)));
+}
+
+/// Per lane: mask ? b : a
+inline b2FloatW b2SelectW(b2FloatW a, b2FloatW b, b2FloatW mask)
+{
+	return vbslq_f32(vreinterpretq_u32_f32(mask), b, a);
+}
+
+/// Bit i is set if lane i of the mask is set.
+inline int32 b2MoveMaskW(b2FloatW mask)
+{
+	static const uint32 bits[4] = {1, 2, 4, 8};
+	uint32x4_t m = vandq_u32(vreinterpretq_u32_f32(mask), vld1q_u32(bits));
+	uint32x2_t s = vadd_u32(vget_low_u32(m), vget_high_u32(m));
+	return int32(vget_lane_u32(vpadd_u32(s, s), 0));
+}
+
+#else
+
+/// Portable fallback. Masks hold 1.0f for true and 0.0f for false.
+struct b2FloatW
+{
+	float32 x[b2_simdWidth];
+};
+
+inline b2FloatW b2SplatW(float32 s)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = s;
+	return r;
+}
+
+inline b2FloatW b2ZeroW() { return b2SplatW(0.0f); }
+
+inline b2FloatW b2MakeW(float32 x, float32 y, float32 z, float32 w)
+{
+	b2FloatW r;
+	r.x[0] = x; r.x[1] = y; r.x[2] = z; r.x[3] = w;
+	return r;
+}
+
+inline b2FloatW b2LoadW(const float32* in)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = in[i];
+	return r;
+}
+
+inline void b2StoreW(float32* out, b2FloatW a)
+{
+	for (int32 i = 0; i < b2_simdWidth; ++i) out[i] = a.x[i];
+}
+
+#define B2_SIMD_FALLBACK_OP(name, expr) \
+	inline b2FloatW name(b2FloatW a, b2FloatW b) \
+	{ \
+		b2FloatW r; \
+		for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = (expr); \
+		return r; \
+	}
+
+B2_SIMD_FALLBACK_OP(b2AddW, a.x[i] + b.x[i])
+B2_SIMD_FALLBACK_OP(b2SubW, a.x[i] - b.x[i])
+B2_SIMD_FALLBACK_OP(b2MulW, a.x[i] * b.x[i])
+B2_SIMD_FALLBACK_OP(b2DivW, a.x[i] / b.x[i])
+B2_SIMD_FALLBACK_OP(b2MinW, a.x[i] < b.x[i] ? a.x[i] : b.x[i])
+B2_SIMD_FALLBACK_OP(b2MaxW, a.x[i] > b.x[i] ? a.x[i] : b.x[i])
+B2_SIMD_FALLBACK_OP(b2GreaterW, a.x[i] > b.x[i] ? 1.0f : 0.0f)
+B2_SIMD_FALLBACK_OP(b2GreaterEqualW, a.x[i] >= b.x[i] ? 1.0f : 0.0f)
+B2_SIMD_FALLBACK_OP(b2AndW, (a.x[i] != 0.0f && b.x[i] != 0.0f) ? 1.0f : 0.0f)
+B2_SIMD_FALLBACK_OP(b2OrW, (a.x[i] != 0.0f || b.x[i] != 0.0f) ? 1.0f : 0.0f)
+
+#undef B2_SIMD_FALLBACK_OP
+
+inline b2FloatW b2SqrtW(b2FloatW a)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = b2Sqrt(a.x[i]);
+	return r;
+}
+
+/// Per lane: mask ? b : a
+inline b2FloatW b2SelectW(b2FloatW a, b2FloatW b, b2FloatW mask)
+{
+	b2FloatW r;
+	for (int32 i = 0; i < b2_simdWidth; ++i) r.x[i] = mask.x[i] != 0.0f ? b.x[i] : a.x[i];
+	return r;
+}
+
+/// Bit i is set if lane i of the mask is set.
+inline int32 b2MoveMaskW(b2FloatW mask)
+{
+	int32 bits = 0;
+	for (int32 i = 0; i < b2_simdWidth; ++i) bits |= mask.x[i] != 0.0f ? (1 << i) : 0;
+	return bits;
+}
+
+#endif
+
+/// Access a single lane. This is meant for packing and unpacking, not for
+/// use inside the solver loops.
+inline float32& b2LaneW(b2FloatW& a, int32 lane)
+{
+	return ((float32*)&a)[lane];
+}
+
+/// Per lane: |a|
+inline b2FloatW b2AbsW(b2FloatW a)
+{
+	return b2MaxW(a, b2SubW(b2ZeroW(), a));
+}
+
+/// Per lane: lower <= a <= upper
+inline b2FloatW b2ClampW(b2FloatW a, b2FloatW lower, b2FloatW upper)
+{
+	return b2MaxW(lower, b2MinW(a, upper));
+}
+
+#endif
@@ -0,0 +1,87 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#include <Box2D/Common/b2Snapshot.h>
+#include <Box2D/Common/b2Math.h>
+#include <string.h>
+
+b2Snapshot::b2Snapshot()
+{
+	m_data = NULL;
+	m_size = 0;
+	m_capacity = 0;
+	m_position = 0;
+}
+
+b2Snapshot::~b2Snapshot()
+{
+	b2Free(m_data);
+}
+
+void b2Snapshot::Clear()
+{
+	m_size = 0;
+	m_position = 0;
+}
+
+void b2Snapshot::Reserve(int32 capacity)
+{
+	if (capacity <= m_capacity)
+	{
+		return;
+	}
+
+	int32 newCapacity = b2Max(2 * m_capacity, 1024);
+	while (newCapacity < capacity)
+	{
+		newCapacity *= 2;
+	}
+
+	char* newData = (char*)b2Alloc(newCapacity);
+	if (m_size > 0)
+	{
+		memcpy(newData, m_data, m_size);
+	}
+	b2Free(m_data);
+
+	m_data = newData;
+	m_capacity = newCapacity;
+}
+
+void b2Snapshot::SetData(const void* data, int32 size)
+{
+	b2Assert(size >= 0);
+	m_size = 0;
+	m_position = 0;
+	Write(data, size);
+}
+
+void b2Snapshot::Write(const void* data, int32 size)
+{
+	Reserve(m_size + size);
+	memcpy(m_data + m_size, data, size);
+	m_size += size;
+}
+
+void b2Snapshot::Read(void* data, int32 size)
+{
+	b2Assert(m_position + size <= m_size);
+	memcpy(data, m_data + m_position, size);
+	m_position += size;
+}
@@ -0,0 +1,82 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+
+#ifndef B2_SNAPSHOT_H
+#define B2_SNAPSHOT_H
+
+#include <Box2D/Common/b2Settings.h>
+
+/// A growable binary buffer that holds a simulation snapshot. The memory is
+/// kept between uses, so saving into the same snapshot every frame does not
+/// allocate once the buffer is large enough.
+/// The data is in native byte order and holds raw pointers, so it can only be
+/// restored in the process that created it.
+class b2Snapshot
+{
+public:
+	b2Snapshot();
+	~b2Snapshot();
+
+	/// Remove the data and keep the memory.
+	void Clear();
+
+	/// Get the data, for example to keep a copy of it.
+	const void* GetData() const { return m_data; }
+
+	/// Get the size of the data in bytes.
+	int32 GetSize() const { return m_size; }
+
+	/// Replace the data with a copy of the given bytes.
+	void SetData(const void* data, int32 size);
+
+	/// Append bytes.
+	void Write(const void* data, int32 size);
+
+	template <typename T>
+	void Write(const T& value)
+	{
+		Write(&value, sizeof(T));
+	}
+
+	/// Restart reading at the beginning of the data.
+	void Rewind() { m_position = 0; }
+
+	/// Get the number of bytes that have not been read yet.
+	int32 GetRemaining() const { return m_size - m_position; }
+
+	/// Read the next bytes. Reading past the end is an error.
+	void Read(void* data, int32 size);
+
+	template <typename T>
+	void Read(T* value)
+	{
+		Read(value, sizeof(T));
+	}
+
+private:
+
+	void Reserve(int32 capacity);
+
+	char* m_data;
+	int32 m_size;
+	int32 m_capacity;
+	int32 m_position;
+};
+
+#endif
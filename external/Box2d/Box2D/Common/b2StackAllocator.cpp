@@ -21,9 +21,13 @@
 
 b2StackAllocator::b2StackAllocator()
 {
+	m_size = b2_stackSize;
+	m_data = (char*)b2Alloc(m_size);
 	m_index = 0;
+	m_growable = false;
 	m_allocation = 0;
 	m_maxAllocation = 0;
+	m_mallocCount = 0;
 	m_entryCount = 0;
 }
 
@@ -31,6 +35,7 @@ b2StackAllocator::~b2StackAllocator()
 {
 	b2Assert(m_index == 0);
 	b2Assert(m_entryCount == 0);
+	b2Free(m_data);
 }
 
 void* b2StackAllocator::Allocate(int32 size)
@@ -39,10 +44,11 @@ void* b2StackAllocator::Allocate(int32 size)
 
 	b2StackEntry* entry = m_entries + m_entryCount;
 	entry->size = size;
-	if (m_index + size > b2_stackSize)
+	if (m_index + size > m_size)
 	{
 		entry->data = (char*)b2Alloc(size);
 		entry->usedMalloc = true;
+		++m_mallocCount;
 	}
 	else
 	{
@@ -74,6 +80,12 @@ void b2StackAllocator::Free(void* p)
 	m_allocation -= entry->size;
 	--m_entryCount;
 
+	// Nothing points into the buffer when the stack is empty.
+	if (m_growable && m_entryCount == 0 && m_maxAllocation > m_size)
+	{
+		SetSize(m_maxAllocation);
+	}
+
 	p = NULL;
 }
 
@@ -81,3 +93,40 @@ int32 b2StackAllocator::GetMaxAllocation() const
 {
 	return m_maxAllocation;
 }
+
+void b2StackAllocator::SetSize(int32 size)
+{
+	b2Assert(m_entryCount == 0);
+	b2Assert(size >= 0);
+	if (size == m_size)
+	{
+		return;
+	}
+
+	b2Free(m_data);
+	m_size = size;
+	m_data = (char*)b2Alloc(m_size);
+}
+
+int32 b2StackAllocator::GetSize() const
+{
+	return m_size;
+}
+
+void b2StackAllocator::SetGrowable(bool flag)
+{
+	m_growable = flag;
+}
+
+bool b2StackAllocator::IsGrowable() const
+{
+	return m_growable;
+}
+
+void b2StackAllocator::GetStats(b2StackAllocatorStats* stats) const
+{
+	stats->size = m_size;
+	stats->bytesInUse = m_allocation;
+	stats->maxBytesInUse = m_maxAllocation;
+	stats->mallocCount = m_mallocCount;
+}
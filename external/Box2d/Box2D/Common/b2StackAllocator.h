@@ -21,7 +21,7 @@
 
 #include <Box2D/Common/b2Settings.h>
 
-const int32 b2_stackSize = 100 * 1024;	// 100k
+const int32 b2_stackSize = 100 * 1024;	// 100k, the default
 const int32 b2_maxStackEntries = 32;
 
 struct b2StackEntry
@@ -31,6 +31,22 @@ struct b2StackEntry
 	bool usedMalloc;
 };
 
+/// Memory statistics of a stack allocator.
+struct b2StackAllocatorStats
+{
+	/// The size of the stack buffer in bytes.
+	int32 size;
+
+	/// The number of bytes allocated right now.
+	int32 bytesInUse;
+
+	/// The largest number of bytes that were allocated at once.
+	int32 maxBytesInUse;
+
+	/// The number of allocations that did not fit and used b2Alloc.
+	int32 mallocCount;
+};
+
 // This is a stack allocator used for fast per step allocations.
 // You must nest allocate/free pairs. The code will assert
 // if you try to interleave multiple allocate/free pairs.
@@ -45,13 +61,29 @@ public:
 
 	int32 GetMaxAllocation() const;
 
+	/// Set the size of the stack buffer. Allocations that do not fit
+	/// fall back to b2Alloc. This must not be called while memory is allocated.
+	void SetSize(int32 size);
+	int32 GetSize() const;
+
+	/// A growable stack enlarges its buffer to the largest allocation seen
+	/// so far whenever it becomes empty, so repeated allocation patterns
+	/// stop falling back to b2Alloc.
+	void SetGrowable(bool flag);
+	bool IsGrowable() const;
+
+	void GetStats(b2StackAllocatorStats* stats) const;
+
 private:
 
-	char m_data[b2_stackSize];
+	char* m_data;
+	int32 m_size;
 	int32 m_index;
+	bool m_growable;
 
 	int32 m_allocation;
 	int32 m_maxAllocation;
+	int32 m_mallocCount;
 
 	b2StackEntry m_entries[b2_maxStackEntries];
 	int32 m_entryCount;
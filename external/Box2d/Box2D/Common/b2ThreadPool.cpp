@@ -0,0 +1,199 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#include <Box2D/Common/b2ThreadPool.h>
+#include <Box2D/Common/b2Math.h>
+
+#if defined(B2_USE_PTHREADS)
+
+b2ThreadPool::b2ThreadPool()
+{
+	m_threadCount = 1;
+	m_task = NULL;
+	m_count = 0;
+	m_next = 0;
+	m_busy = 0;
+	m_generation = 0;
+	m_quit = false;
+
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_workCondition, NULL);
+	pthread_cond_init(&m_doneCondition, NULL);
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+	SetThreadCount(1);
+
+	pthread_cond_destroy(&m_doneCondition);
+	pthread_cond_destroy(&m_workCondition);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+void b2ThreadPool::SetThreadCount(int32 count)
+{
+	count = b2Clamp(count, 1, b2_maxThreads);
+	if (count == m_threadCount)
+	{
+		return;
+	}
+
+	// Stop the current workers.
+	pthread_mutex_lock(&m_mutex);
+	m_quit = true;
+	pthread_cond_broadcast(&m_workCondition);
+	pthread_mutex_unlock(&m_mutex);
+
+	for (int32 i = 1; i < m_threadCount; ++i)
+	{
+		pthread_join(m_workers[i].thread, NULL);
+	}
+
+	m_quit = false;
+	m_threadCount = 1;
+
+	// Thread 0 is the calling thread.
+	for (int32 i = 1; i < count; ++i)
+	{
+		b2Worker* worker = m_workers + i;
+		worker->pool = this;
+		worker->threadIndex = i;
+
+		// A worker may start after the next run was issued, so it must not
+		// read the current generation itself.
+		worker->generation = m_generation;
+		if (pthread_create(&worker->thread, NULL, WorkerMain, worker) != 0)
+		{
+			break;
+		}
+
+		++m_threadCount;
+	}
+}
+
+void b2ThreadPool::Run(b2Task* task, int32 count)
+{
+	if (m_threadCount == 1 || count <= 1)
+	{
+		for (int32 i = 0; i < count; ++i)
+		{
+			task->Execute(i, 0);
+		}
+		return;
+	}
+
+	pthread_mutex_lock(&m_mutex);
+	m_task = task;
+	m_count = count;
+	m_next = 0;
+	m_busy = m_threadCount - 1;
+	++m_generation;
+	pthread_cond_broadcast(&m_workCondition);
+	pthread_mutex_unlock(&m_mutex);
+
+	Work(0);
+
+	pthread_mutex_lock(&m_mutex);
+	while (m_busy > 0)
+	{
+		pthread_cond_wait(&m_doneCondition, &m_mutex);
+	}
+	m_task = NULL;
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void b2ThreadPool::Work(int32 threadIndex)
+{
+	for (;;)
+	{
+		int32 index = __sync_fetch_and_add(&m_next, 1);
+		if (index >= m_count)
+		{
+			break;
+		}
+
+		m_task->Execute(index, threadIndex);
+	}
+}
+
+void* b2ThreadPool::WorkerMain(void* data)
+{
+	b2Worker* worker = (b2Worker*)data;
+	b2ThreadPool* pool = worker->pool;
+
+	int32 generation = worker->generation;
+
+	pthread_mutex_lock(&pool->m_mutex);
+	for (;;)
+	{
+		while (pool->m_generation == generation && pool->m_quit == false)
+		{
+			pthread_cond_wait(&pool->m_workCondition, &pool->m_mutex);
+		}
+
+		if (pool->m_quit)
+		{
+			break;
+		}
+
+		generation = pool->m_generation;
+		pthread_mutex_unlock(&pool->m_mutex);
+
+		pool->Work(worker->threadIndex);
+
+		pthread_mutex_lock(&pool->m_mutex);
+		if (--pool->m_busy == 0)
+		{
+			pthread_cond_signal(&pool->m_doneCondition);
+		}
+	}
+	pthread_mutex_unlock(&pool->m_mutex);
+
+	return NULL;
+}
+
+#else
+
+b2ThreadPool::b2ThreadPool()
+{
+	m_threadCount = 1;
+}
+
+b2ThreadPool::~b2ThreadPool()
+{
+}
+
+void b2ThreadPool::SetThreadCount(int32 count)
+{
+	B2_NOT_USED(count);
+}
+
+void b2ThreadPool::Run(b2Task* task, int32 count)
+{
+	for (int32 i = 0; i < count; ++i)
+	{
+		task->Execute(i, 0);
+	}
+}
+
+void b2ThreadPool::Work(int32 threadIndex)
+{
+	B2_NOT_USED(threadIndex);
+}
+
+#endif
@@ -0,0 +1,99 @@
+/*
+* Copyright (c) 2012 cocos2d-iphone.org
+*
+* This software is provided 'as-is', without any express or implied
+* warranty.  In no event will the authors be held liable for any damages
+* arising from the use of this software.
+* Permission is granted to anyone to use this software for any purpose,
+* including commercial applications, and to alter it and redistribute it
+* freely, subject to the following restrictions:
+* 1. The origin of this software must not be misrepresented; you must not
+* claim that you wrote the original software. If you use this software
+* in a product, an acknowledgment in the product documentation would be
+* appreciated but is not required.
+* 2. Altered source versions must be plainly marked as such, and must not be
+* misrepresented as being the original software.
+* 3. This notice may not be removed or altered from any source distribution.
+*/
+
+#ifndef B2_THREAD_POOL_H
+#define B2_THREAD_POOL_H
+
+#include <Box2D/Common/b2Settings.h>
+
+#if defined(__linux__) || defined (__APPLE__)
+#define B2_USE_PTHREADS
+#include <pthread.h>
+#endif
+
+/// The maximum number of threads a thread pool may use, including
+/// the calling thread.
+#define b2_maxThreads	16
+
+/// A unit of parallel work. The thread pool calls Execute once for
+/// every index of a run, from any of its threads.
+class b2Task
+{
+public:
+	virtual ~b2Task() {}
+
+	/// @param index the work item, in [0, count).
+	/// @param threadIndex the executing thread, in [0, thread count). The
+	/// calling thread is always thread 0.
+	virtual void Execute(int32 index, int32 threadIndex) = 0;
+};
+
+/// A small pool of persistent worker threads. Work items are handed out
+/// dynamically, so a task must not depend on which thread runs an item.
+/// On platforms without thread support all work runs on the calling thread.
+class b2ThreadPool
+{
+public:
+	b2ThreadPool();
+	~b2ThreadPool();
+
+	/// Set the number of threads, including the calling thread. One
+	/// (the default) runs everything on the calling thread without
+	/// creating any workers.
+	void SetThreadCount(int32 count);
+
+	/// Get the number of threads, including the calling thread.
+	int32 GetThreadCount() const { return m_threadCount; }
+
+	/// Execute task items [0, count) and return once all of them completed.
+	/// This must not be called recursively from a task.
+	void Run(b2Task* task, int32 count);
+
+private:
+
+	void Work(int32 threadIndex);
+
+	int32 m_threadCount;
+
+#if defined(B2_USE_PTHREADS)
+	static void* WorkerMain(void* data);
+
+	struct b2Worker
+	{
+		b2ThreadPool* pool;
+		int32 threadIndex;
+		int32 generation;
+		pthread_t thread;
+	};
+
+	b2Worker m_workers[b2_maxThreads];
+
+	pthread_mutex_t m_mutex;
+	pthread_cond_t m_workCondition;
+	pthread_cond_t m_doneCondition;
+
+	b2Task* m_task;
+	int32 m_count;
+	volatile int32 m_next;
+	int32 m_busy;
+	int32 m_generation;
+	bool m_quit;
+#endif
+};
+
+#endif
@@ -20,81 +20,78 @@
 
 #if defined(_WIN32)
 
-float64 b2Timer::s_invFrequency = 0.0f;
-
 #include <windows.h>
 
-b2Timer::b2Timer()
+int64 b2Timer::GetTimestamp()
 {
-	LARGE_INTEGER largeInteger;
-
-	if (s_invFrequency == 0.0f)
+	static LARGE_INTEGER s_frequency;
+	if (s_frequency.QuadPart == 0)
 	{
-		QueryPerformanceFrequency(&largeInteger);
-		s_invFrequency = float64(largeInteger.QuadPart);
-		if (s_invFrequency > 0.0f)
-		{
-			s_invFrequency = 1000.0f / s_invFrequency;
-		}
+		QueryPerformanceFrequency(&s_frequency);
 	}
 
-	QueryPerformanceCounter(&largeInteger);
-	m_start = float64(largeInteger.QuadPart);
-}
+	LARGE_INTEGER counter;
+	QueryPerformanceCounter(&counter);
 
-void b2Timer::Reset()
-{
-	LARGE_INTEGER largeInteger;
-	QueryPerformanceCounter(&largeInteger);
-	m_start = float64(largeInteger.QuadPart);
+	// Split the conversion so that it does not overflow.
+	int64 seconds = counter.QuadPart / s_frequency.QuadPart;
+	int64 remainder = counter.QuadPart % s_frequency.QuadPart;
+	return seconds * 1000000000 + remainder * 1000000000 / s_frequency.QuadPart;
 }
 
-float32 b2Timer::GetMilliseconds() const
+#elif defined(__APPLE__)
+
+#include <mach/mach_time.h>
+
+int64 b2Timer::GetTimestamp()
 {
-	LARGE_INTEGER largeInteger;
-	QueryPerformanceCounter(&largeInteger);
-	float64 count = float64(largeInteger.QuadPart);
-	float32 ms = float32(s_invFrequency * (count - m_start));
-	return ms;
+	static mach_timebase_info_data_t s_timebase;
+	if (s_timebase.denom == 0)
+	{
+		mach_timebase_info(&s_timebase);
+	}
+
+	uint64 ticks = mach_absolute_time();
+	return int64(ticks / s_timebase.denom * s_timebase.numer +
+		ticks % s_timebase.denom * s_timebase.numer / s_timebase.denom);
 }
 
-#elif defined(__linux__) || defined (__APPLE__)
+#elif defined(__linux__)
 
-#include <sys/time.h>
+#include <time.h>
 
-b2Timer::b2Timer()
+int64 b2Timer::GetTimestamp()
 {
-    Reset();
+	timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return int64(t.tv_sec) * 1000000000 + t.tv_nsec;
 }
 
-void b2Timer::Reset()
-{
-    timeval t;
-    gettimeofday(&t, 0);
-    m_start_sec = t.tv_sec;
-    m_start_msec = t.tv_usec * 0.001f;
-}
+#else
 
-float32 b2Timer::GetMilliseconds() const
+int64 b2Timer::GetTimestamp()
 {
-    timeval t;
-    gettimeofday(&t, 0);
-    return (t.tv_sec - m_start_sec) * 1000 + t.tv_usec * 0.001f - m_start_msec;
+	return 0;
 }
 
-#else
+#endif
 
 b2Timer::b2Timer()
 {
+	Reset();
 }
 
 void b2Timer::Reset()
 {
+	m_start = GetTimestamp();
 }
 
 float32 b2Timer::GetMilliseconds() const
 {
-	return 0.0f;
+	return float32(float64(GetTimestamp() - m_start) * 1.0e-6);
 }
 
-#endif
+int64 b2Timer::GetNanoseconds() const
+{
+	return GetTimestamp() - m_start;
+}
@@ -18,8 +18,9 @@
 
 #include <Box2D/Common/b2Settings.h>
 
-/// Timer for profiling. This has platform specific code and may
-/// not work on every platform.
+/// Timer for profiling. This uses a monotonic clock with nanosecond
+/// resolution where the platform has one. This has platform specific
+/// code and may not work on every platform.
 class b2Timer
 {
 public:
@@ -33,13 +34,14 @@ public:
 	/// Get the time since construction or the last reset.
 	float32 GetMilliseconds() const;
 
+	/// Get the time since construction or the last reset in nanoseconds.
+	int64 GetNanoseconds() const;
+
+	/// Get the current time of the monotonic clock in nanoseconds. The
+	/// origin is arbitrary.
+	static int64 GetTimestamp();
+
 private:
 
-#if defined(_WIN32)
-	float64 m_start;
-	static float64 s_invFrequency;
-#elif defined(__linux__) || defined (__APPLE__)
-	unsigned long m_start_sec;
-	unsigned long m_start_msec;
-#endif
+	int64 m_start;
 };
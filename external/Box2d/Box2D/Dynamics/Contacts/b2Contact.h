@@ -144,6 +144,7 @@ protected:
 	friend class b2ContactSolver;
 	friend class b2Body;
 	friend class b2Fixture;
+	friend class b2CollideTask;
 
 	// Flags stored in m_flags
 	enum
@@ -183,6 +184,12 @@ protected:
 
 	void Update(b2ContactListener* listener);
 
+	// The two halves of Update. UpdateManifold only writes to this contact, so
+	// contacts can be updated in parallel. ReportUpdate wakes the bodies and
+	// calls the listener.
+	void UpdateManifold(b2Manifold* oldManifold);
+	void ReportUpdate(const b2Manifold& oldManifold, bool wasTouching, b2ContactListener* listener);
+
 	static b2ContactRegister s_registers[b2Shape::e_typeCount][b2Shape::e_typeCount];
 	static bool s_initialized;
 
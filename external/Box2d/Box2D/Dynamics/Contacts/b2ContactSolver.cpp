@@ -23,9 +23,16 @@
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2World.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Common/b2Simd.h>
 
 #define B2_DEBUG_SOLVER 0
 
+// Smaller islands are not worth batching.
+#define b2_minBatchedContacts	(4 * b2_simdWidth)
+
+// The number of graph colors used to form batches.
+#define b2_maxContactColors		16
+
 struct b2ContactPositionConstraint
 {
 	b2Vec2 localPoints[b2_maxManifoldPoints];
@@ -41,6 +48,51 @@ struct b2ContactPositionConstraint
 	int32 pointCount;
 };
 
+// Contact constraints in structure of arrays form, one constraint per lane.
+// Unused lanes have zero mass and a body index of -1.
+struct b2VelocityConstraintPointWide
+{
+	b2FloatW rAX, rAY;
+	b2FloatW rBX, rBY;
+	b2FloatW normalImpulse;
+	b2FloatW tangentImpulse;
+	b2FloatW normalMass;
+	b2FloatW tangentMass;
+	b2FloatW velocityBias;
+};
+
+struct b2ContactVelocityConstraintWide
+{
+	b2VelocityConstraintPointWide points[b2_maxManifoldPoints];
+	b2FloatW normalX, normalY;
+	b2FloatW k11, k12, k22;
+	b2FloatW normalMass11, normalMass12, normalMass21, normalMass22;
+	b2FloatW invMassA, invMassB;
+	b2FloatW invIA, invIB;
+	b2FloatW friction;
+	b2FloatW blockMask;
+	int32 indexA[b2_simdWidth];
+	int32 indexB[b2_simdWidth];
+};
+
+struct b2ContactPositionConstraintWide
+{
+	b2FloatW localPointsX[b2_maxManifoldPoints];
+	b2FloatW localPointsY[b2_maxManifoldPoints];
+	b2FloatW pointMask[b2_maxManifoldPoints];
+	b2FloatW localNormalX, localNormalY;
+	b2FloatW localPointX, localPointY;
+	b2FloatW localCenterAX, localCenterAY;
+	b2FloatW localCenterBX, localCenterBY;
+	b2FloatW invMassA, invMassB;
+	b2FloatW invIA, invIB;
+	b2FloatW radius;
+	b2FloatW circlesMask;
+	b2FloatW faceBMask;
+	int32 indexA[b2_simdWidth];
+	int32 indexB[b2_simdWidth];
+};
+
 b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 {
 	m_step = def->step;
@@ -125,10 +177,27 @@ b2ContactSolver::b2ContactSolver(b2ContactSolverDef* def)
 			pc->localPoints[j] = cp->localPoint;
 		}
 	}
+
+	m_wideBuffer = NULL;
+	m_velocityBatches = NULL;
+	m_positionBatches = NULL;
+	m_batchIndices = NULL;
+	m_batchCount = 0;
+	m_overflowIndices = NULL;
+	m_overflowCount = 0;
+
+	if (def->wide && m_count >= b2_minBatchedContacts)
+	{
+		BuildBatches();
+	}
 }
 
 b2ContactSolver::~b2ContactSolver()
 {
+	if (m_wideBuffer)
+	{
+		m_allocator->Free(m_wideBuffer);
+	}
 	m_allocator->Free(m_velocityConstraints);
 	m_allocator->Free(m_positionConstraints);
 }
@@ -243,6 +312,11 @@ void b2ContactSolver::InitializeVelocityConstraints()
 			}
 		}
 	}
+
+	if (m_velocityBatches)
+	{
+		PackVelocityConstraints();
+	}
 }
 
 void b2ContactSolver::WarmStart()
@@ -278,17 +352,35 @@ void b2ContactSolver::WarmStart()
 			vB += mB * P;
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		if (mA != 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+		if (mB != 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
 void b2ContactSolver::SolveVelocityConstraints()
 {
-	for (int32 i = 0; i < m_count; ++i)
+	int32 count = m_count;
+	const int32* indices = NULL;
+	if (m_velocityBatches)
 	{
+		SolveVelocityConstraintsWide();
+
+		// Solve the constraints that did not fit into a batch.
+		count = m_overflowCount;
+		indices = m_overflowIndices;
+	}
+
+	for (int32 k = 0; k < count; ++k)
+	{
+		int32 i = indices ? indices[k] : k;
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
 
 		int32 indexA = vc->indexA;
@@ -588,15 +680,26 @@ void b2ContactSolver::SolveVelocityConstraints()
 			}
 		}
 
-		m_velocities[indexA].v = vA;
-		m_velocities[indexA].w = wA;
-		m_velocities[indexB].v = vB;
-		m_velocities[indexB].w = wB;
+		if (mA != 0.0f)
+		{
+			m_velocities[indexA].v = vA;
+			m_velocities[indexA].w = wA;
+		}
+		if (mB != 0.0f)
+		{
+			m_velocities[indexB].v = vB;
+			m_velocities[indexB].w = wB;
+		}
 	}
 }
 
 void b2ContactSolver::StoreImpulses()
 {
+	if (m_velocityBatches)
+	{
+		UnpackVelocityConstraints();
+	}
+
 	for (int32 i = 0; i < m_count; ++i)
 	{
 		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
@@ -666,8 +769,20 @@ bool b2ContactSolver::SolvePositionConstraints()
 {
 	float32 minSeparation = 0.0f;
 
-	for (int32 i = 0; i < m_count; ++i)
+	int32 count = m_count;
+	const int32* indices = NULL;
+	if (m_positionBatches)
 	{
+		minSeparation = SolvePositionConstraintsWide();
+
+		// Solve the constraints that did not fit into a batch.
+		count = m_overflowCount;
+		indices = m_overflowIndices;
+	}
+
+	for (int32 k = 0; k < count; ++k)
+	{
+		int32 i = indices ? indices[k] : k;
 		b2ContactPositionConstraint* pc = m_positionConstraints + i;
 
 		int32 indexA = pc->indexA;
@@ -728,11 +843,17 @@ bool b2ContactSolver::SolvePositionConstraints()
 			aB += iB * b2Cross(rB, P);
 		}
 
-		m_positions[indexA].c = cA;
-		m_positions[indexA].a = aA;
+		if (mA != 0.0f)
+		{
+			m_positions[indexA].c = cA;
+			m_positions[indexA].a = aA;
+		}
 
-		m_positions[indexB].c = cB;
-		m_positions[indexB].a = aB;
+		if (mB != 0.0f)
+		{
+			m_positions[indexB].c = cB;
+			m_positions[indexB].a = aB;
+		}
 	}
 
 	// We can't expect minSpeparation >= -b2_linearSlop because we don't
@@ -830,3 +951,660 @@ bool b2ContactSolver::SolveTOIPositionConstraints(int32 toiIndexA, int32 toiInde
 	// push the separation above -b2_linearSlop.
 	return minSeparation >= -1.5f * b2_linearSlop;
 }
+
+// Graph color the constraints and lay them out in batches of b2_simdWidth.
+// Bodies without mass are never modified by the solver, so any number of
+// constraints in a batch may share them.
+void b2ContactSolver::BuildBatches()
+{
+	int32 batchCapacity = (m_count + b2_simdWidth - 1) / b2_simdWidth + b2_maxContactColors;
+
+	int32 size = 16;
+	size += batchCapacity * sizeof(b2ContactVelocityConstraintWide);
+	size += batchCapacity * sizeof(b2ContactPositionConstraintWide);
+	size += batchCapacity * b2_simdWidth * sizeof(int32);
+	size += m_count * sizeof(int32);
+
+	m_wideBuffer = m_allocator->Allocate(size);
+
+	// Wide values must be 16 byte aligned.
+	char* buffer = (char*)m_wideBuffer + (16 - ((size_t)m_wideBuffer & 15)) % 16;
+	m_velocityBatches = (b2ContactVelocityConstraintWide*)buffer;
+	buffer += batchCapacity * sizeof(b2ContactVelocityConstraintWide);
+	m_positionBatches = (b2ContactPositionConstraintWide*)buffer;
+	buffer += batchCapacity * sizeof(b2ContactPositionConstraintWide);
+	m_batchIndices = (int32*)buffer;
+	buffer += batchCapacity * b2_simdWidth * sizeof(int32);
+	m_overflowIndices = (int32*)buffer;
+
+	// Find the range of body indices with finite mass.
+	int32 lower = 0x7fffffff, upper = -1;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		if (vc->invMassA > 0.0f || vc->invIA > 0.0f)
+		{
+			lower = b2Min(lower, vc->indexA);
+			upper = b2Max(upper, vc->indexA);
+		}
+		if (vc->invMassB > 0.0f || vc->invIB > 0.0f)
+		{
+			lower = b2Min(lower, vc->indexB);
+			upper = b2Max(upper, vc->indexB);
+		}
+	}
+
+	int32 bodyCount = upper >= lower ? upper - lower + 1 : 0;
+	int32* colors = (int32*)m_allocator->Allocate(m_count * sizeof(int32));
+	uint32* bodyColors = (uint32*)m_allocator->Allocate(bodyCount * sizeof(uint32));
+	memset(bodyColors, 0, bodyCount * sizeof(uint32));
+
+	int32 colorCounts[b2_maxContactColors];
+	memset(colorCounts, 0, sizeof(colorCounts));
+
+	// Greedy coloring in constraint order.
+	m_overflowCount = 0;
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+		uint32* colorsA = NULL;
+		uint32* colorsB = NULL;
+		uint32 used = 0;
+		if (vc->invMassA > 0.0f || vc->invIA > 0.0f)
+		{
+			colorsA = bodyColors + vc->indexA - lower;
+			used |= *colorsA;
+		}
+		if (vc->invMassB > 0.0f || vc->invIB > 0.0f)
+		{
+			colorsB = bodyColors + vc->indexB - lower;
+			used |= *colorsB;
+		}
+
+		int32 color = 0;
+		while (color < b2_maxContactColors && (used & (1 << color)))
+		{
+			++color;
+		}
+
+		if (color == b2_maxContactColors)
+		{
+			colors[i] = -1;
+			m_overflowIndices[m_overflowCount++] = i;
+			continue;
+		}
+
+		colors[i] = color;
+		++colorCounts[color];
+		if (colorsA)
+		{
+			*colorsA |= 1 << color;
+		}
+		if (colorsB)
+		{
+			*colorsB |= 1 << color;
+		}
+	}
+
+	// Assign the batches of each color, keeping the constraint order within a color.
+	int32 colorBatch[b2_maxContactColors];
+	int32 colorLane[b2_maxContactColors];
+	m_batchCount = 0;
+	for (int32 c = 0; c < b2_maxContactColors; ++c)
+	{
+		colorBatch[c] = m_batchCount;
+		colorLane[c] = 0;
+		m_batchCount += (colorCounts[c] + b2_simdWidth - 1) / b2_simdWidth;
+	}
+	b2Assert(m_batchCount <= batchCapacity);
+
+	for (int32 i = 0; i < m_batchCount * b2_simdWidth; ++i)
+	{
+		m_batchIndices[i] = -1;
+	}
+
+	for (int32 i = 0; i < m_count; ++i)
+	{
+		int32 c = colors[i];
+		if (c < 0)
+		{
+			continue;
+		}
+
+		m_batchIndices[colorBatch[c] * b2_simdWidth + colorLane[c]] = i;
+		if (++colorLane[c] == b2_simdWidth)
+		{
+			++colorBatch[c];
+			colorLane[c] = 0;
+		}
+	}
+
+	m_allocator->Free(bodyColors);
+	m_allocator->Free(colors);
+
+	// The position constraints do not depend on the solver state, pack them now.
+	for (int32 b = 0; b < m_batchCount; ++b)
+	{
+		b2ContactPositionConstraintWide* pw = m_positionBatches + b;
+		memset(pw, 0, sizeof(b2ContactPositionConstraintWide));
+
+		b2FloatW pointCount = b2ZeroW();
+		b2FloatW type = b2ZeroW();
+
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			int32 i = m_batchIndices[b * b2_simdWidth + lane];
+			if (i < 0)
+			{
+				pw->indexA[lane] = -1;
+				pw->indexB[lane] = -1;
+				continue;
+			}
+
+			b2ContactPositionConstraint* pc = m_positionConstraints + i;
+			pw->indexA[lane] = pc->indexA;
+			pw->indexB[lane] = pc->indexB;
+
+			for (int32 j = 0; j < pc->pointCount; ++j)
+			{
+				b2LaneW(pw->localPointsX[j], lane) = pc->localPoints[j].x;
+				b2LaneW(pw->localPointsY[j], lane) = pc->localPoints[j].y;
+			}
+
+			b2LaneW(pw->localNormalX, lane) = pc->localNormal.x;
+			b2LaneW(pw->localNormalY, lane) = pc->localNormal.y;
+			b2LaneW(pw->localPointX, lane) = pc->localPoint.x;
+			b2LaneW(pw->localPointY, lane) = pc->localPoint.y;
+			b2LaneW(pw->localCenterAX, lane) = pc->localCenterA.x;
+			b2LaneW(pw->localCenterAY, lane) = pc->localCenterA.y;
+			b2LaneW(pw->localCenterBX, lane) = pc->localCenterB.x;
+			b2LaneW(pw->localCenterBY, lane) = pc->localCenterB.y;
+			b2LaneW(pw->invMassA, lane) = pc->invMassA;
+			b2LaneW(pw->invMassB, lane) = pc->invMassB;
+			b2LaneW(pw->invIA, lane) = pc->invIA;
+			b2LaneW(pw->invIB, lane) = pc->invIB;
+			b2LaneW(pw->radius, lane) = pc->radiusA + pc->radiusB;
+			b2LaneW(pointCount, lane) = float32(pc->pointCount);
+			b2LaneW(type, lane) = float32(pc->type + 1);
+		}
+
+		pw->pointMask[0] = b2GreaterW(pointCount, b2SplatW(0.5f));
+		pw->pointMask[1] = b2GreaterW(pointCount, b2SplatW(1.5f));
+
+		b2FloatW circles = b2SplatW(float32(b2Manifold::e_circles + 1));
+		b2FloatW faceB = b2SplatW(float32(b2Manifold::e_faceB + 1));
+		pw->circlesMask = b2AndW(b2GreaterEqualW(type, circles), b2GreaterEqualW(circles, type));
+		pw->faceBMask = b2AndW(b2GreaterEqualW(type, faceB), b2GreaterEqualW(faceB, type));
+	}
+}
+
+void b2ContactSolver::PackVelocityConstraints()
+{
+	for (int32 b = 0; b < m_batchCount; ++b)
+	{
+		b2ContactVelocityConstraintWide* vw = m_velocityBatches + b;
+		memset(vw, 0, sizeof(b2ContactVelocityConstraintWide));
+
+		b2FloatW pointCount = b2ZeroW();
+
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			int32 i = m_batchIndices[b * b2_simdWidth + lane];
+			if (i < 0)
+			{
+				vw->indexA[lane] = -1;
+				vw->indexB[lane] = -1;
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+			vw->indexA[lane] = vc->indexA;
+			vw->indexB[lane] = vc->indexB;
+
+			for (int32 j = 0; j < vc->pointCount; ++j)
+			{
+				b2VelocityConstraintPoint* vcp = vc->points + j;
+				b2VelocityConstraintPointWide* wcp = vw->points + j;
+				b2LaneW(wcp->rAX, lane) = vcp->rA.x;
+				b2LaneW(wcp->rAY, lane) = vcp->rA.y;
+				b2LaneW(wcp->rBX, lane) = vcp->rB.x;
+				b2LaneW(wcp->rBY, lane) = vcp->rB.y;
+				b2LaneW(wcp->normalImpulse, lane) = vcp->normalImpulse;
+				b2LaneW(wcp->tangentImpulse, lane) = vcp->tangentImpulse;
+				b2LaneW(wcp->normalMass, lane) = vcp->normalMass;
+				b2LaneW(wcp->tangentMass, lane) = vcp->tangentMass;
+				b2LaneW(wcp->velocityBias, lane) = vcp->velocityBias;
+			}
+
+			if (vc->pointCount == 2)
+			{
+				b2LaneW(vw->k11, lane) = vc->K.ex.x;
+				b2LaneW(vw->k12, lane) = vc->K.ex.y;
+				b2LaneW(vw->k22, lane) = vc->K.ey.y;
+				b2LaneW(vw->normalMass11, lane) = vc->normalMass.ex.x;
+				b2LaneW(vw->normalMass21, lane) = vc->normalMass.ex.y;
+				b2LaneW(vw->normalMass12, lane) = vc->normalMass.ey.x;
+				b2LaneW(vw->normalMass22, lane) = vc->normalMass.ey.y;
+			}
+
+			b2LaneW(vw->normalX, lane) = vc->normal.x;
+			b2LaneW(vw->normalY, lane) = vc->normal.y;
+			b2LaneW(vw->invMassA, lane) = vc->invMassA;
+			b2LaneW(vw->invMassB, lane) = vc->invMassB;
+			b2LaneW(vw->invIA, lane) = vc->invIA;
+			b2LaneW(vw->invIB, lane) = vc->invIB;
+			b2LaneW(vw->friction, lane) = vc->friction;
+			b2LaneW(pointCount, lane) = float32(vc->pointCount);
+		}
+
+		vw->blockMask = b2GreaterW(pointCount, b2SplatW(1.5f));
+	}
+}
+
+void b2ContactSolver::UnpackVelocityConstraints()
+{
+	for (int32 b = 0; b < m_batchCount; ++b)
+	{
+		b2ContactVelocityConstraintWide* vw = m_velocityBatches + b;
+
+		for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+		{
+			int32 i = m_batchIndices[b * b2_simdWidth + lane];
+			if (i < 0)
+			{
+				continue;
+			}
+
+			b2ContactVelocityConstraint* vc = m_velocityConstraints + i;
+			for (int32 j = 0; j < vc->pointCount; ++j)
+			{
+				vc->points[j].normalImpulse = b2LaneW(vw->points[j].normalImpulse, lane);
+				vc->points[j].tangentImpulse = b2LaneW(vw->points[j].tangentImpulse, lane);
+			}
+		}
+	}
+}
+
+static inline void b2GatherVelocities(const b2Velocity* velocities, const int32* indices,
+									  b2FloatW* vx, b2FloatW* vy, b2FloatW* w)
+{
+	float32 x[b2_simdWidth], y[b2_simdWidth], a[b2_simdWidth];
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		int32 index = indices[lane];
+		if (index < 0)
+		{
+			x[lane] = y[lane] = a[lane] = 0.0f;
+			continue;
+		}
+
+		x[lane] = velocities[index].v.x;
+		y[lane] = velocities[index].v.y;
+		a[lane] = velocities[index].w;
+	}
+
+	*vx = b2MakeW(x[0], x[1], x[2], x[3]);
+	*vy = b2MakeW(y[0], y[1], y[2], y[3]);
+	*w = b2MakeW(a[0], a[1], a[2], a[3]);
+}
+
+// Bodies without mass are not written back, see b2SolverData.
+static inline void b2ScatterVelocities(b2Velocity* velocities, const int32* indices, b2FloatW invMass,
+									   b2FloatW vx, b2FloatW vy, b2FloatW w)
+{
+	float32 m[b2_simdWidth], x[b2_simdWidth], y[b2_simdWidth], a[b2_simdWidth];
+	b2StoreW(m, invMass);
+	b2StoreW(x, vx);
+	b2StoreW(y, vy);
+	b2StoreW(a, w);
+
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		int32 index = indices[lane];
+		if (index < 0 || m[lane] == 0.0f)
+		{
+			continue;
+		}
+
+		velocities[index].v.Set(x[lane], y[lane]);
+		velocities[index].w = a[lane];
+	}
+}
+
+// Batched version of the sequential velocity solver, including the block
+// solver for two point manifolds. All four cases are evaluated and the
+// first valid one is selected per lane.
+void b2ContactSolver::SolveVelocityConstraintsWide()
+{
+	const b2FloatW zero = b2ZeroW();
+
+	for (int32 b = 0; b < m_batchCount; ++b)
+	{
+		b2ContactVelocityConstraintWide* vw = m_velocityBatches + b;
+
+		b2FloatW vAX, vAY, wA, vBX, vBY, wB;
+		b2GatherVelocities(m_velocities, vw->indexA, &vAX, &vAY, &wA);
+		b2GatherVelocities(m_velocities, vw->indexB, &vBX, &vBY, &wB);
+
+		b2FloatW mA = vw->invMassA;
+		b2FloatW mB = vw->invMassB;
+		b2FloatW iA = vw->invIA;
+		b2FloatW iB = vw->invIB;
+
+		b2FloatW normalX = vw->normalX;
+		b2FloatW normalY = vw->normalY;
+		b2FloatW tangentX = normalY;
+		b2FloatW tangentY = b2SubW(zero, normalX);
+
+		// Solve tangent constraints first because non-penetration is more important
+		// than friction. Unused points have zero mass and impulse.
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2VelocityConstraintPointWide* wcp = vw->points + j;
+
+			// Relative velocity at contact
+			b2FloatW dvX = b2SubW(b2SubW(vBX, b2MulW(wB, wcp->rBY)), b2SubW(vAX, b2MulW(wA, wcp->rAY)));
+			b2FloatW dvY = b2SubW(b2AddW(vBY, b2MulW(wB, wcp->rBX)), b2AddW(vAY, b2MulW(wA, wcp->rAX)));
+
+			// Compute tangent force
+			b2FloatW vt = b2AddW(b2MulW(dvX, tangentX), b2MulW(dvY, tangentY));
+			b2FloatW lambda = b2SubW(zero, b2MulW(wcp->tangentMass, vt));
+
+			// Clamp the accumulated force
+			b2FloatW maxFriction = b2MulW(vw->friction, wcp->normalImpulse);
+			b2FloatW newImpulse = b2ClampW(b2AddW(wcp->tangentImpulse, lambda), b2SubW(zero, maxFriction), maxFriction);
+			lambda = b2SubW(newImpulse, wcp->tangentImpulse);
+			wcp->tangentImpulse = newImpulse;
+
+			// Apply contact impulse
+			b2FloatW PX = b2MulW(lambda, tangentX);
+			b2FloatW PY = b2MulW(lambda, tangentY);
+
+			vAX = b2SubW(vAX, b2MulW(mA, PX));
+			vAY = b2SubW(vAY, b2MulW(mA, PY));
+			wA = b2SubW(wA, b2MulW(iA, b2SubW(b2MulW(wcp->rAX, PY), b2MulW(wcp->rAY, PX))));
+
+			vBX = b2AddW(vBX, b2MulW(mB, PX));
+			vBY = b2AddW(vBY, b2MulW(mB, PY));
+			wB = b2AddW(wB, b2MulW(iB, b2SubW(b2MulW(wcp->rBX, PY), b2MulW(wcp->rBY, PX))));
+		}
+
+		// Solve normal constraints
+		b2VelocityConstraintPointWide* cp1 = vw->points + 0;
+		b2VelocityConstraintPointWide* cp2 = vw->points + 1;
+
+		b2FloatW ax = cp1->normalImpulse;
+		b2FloatW ay = cp2->normalImpulse;
+
+		// Relative normal velocity at both contact points
+		b2FloatW dv1X = b2SubW(b2SubW(vBX, b2MulW(wB, cp1->rBY)), b2SubW(vAX, b2MulW(wA, cp1->rAY)));
+		b2FloatW dv1Y = b2SubW(b2AddW(vBY, b2MulW(wB, cp1->rBX)), b2AddW(vAY, b2MulW(wA, cp1->rAX)));
+		b2FloatW dv2X = b2SubW(b2SubW(vBX, b2MulW(wB, cp2->rBY)), b2SubW(vAX, b2MulW(wA, cp2->rAY)));
+		b2FloatW dv2Y = b2SubW(b2AddW(vBY, b2MulW(wB, cp2->rBX)), b2AddW(vAY, b2MulW(wA, cp2->rAX)));
+		b2FloatW vn1 = b2AddW(b2MulW(dv1X, normalX), b2MulW(dv1Y, normalY));
+		b2FloatW vn2 = b2AddW(b2MulW(dv2X, normalX), b2MulW(dv2Y, normalY));
+
+		// Single point: clamp the accumulated impulse.
+		b2FloatW single = b2SubW(zero, b2MulW(cp1->normalMass, b2SubW(vn1, cp1->velocityBias)));
+		single = b2MaxW(b2AddW(ax, single), zero);
+
+		// Two points: b' = vn - velocityBias - K * a
+		b2FloatW bx = b2SubW(b2SubW(vn1, cp1->velocityBias), b2AddW(b2MulW(vw->k11, ax), b2MulW(vw->k12, ay)));
+		b2FloatW by = b2SubW(b2SubW(vn2, cp2->velocityBias), b2AddW(b2MulW(vw->k12, ax), b2MulW(vw->k22, ay)));
+
+		// Without a valid case the impulse does not change.
+		b2FloatW xx = ax;
+		b2FloatW xy = ay;
+
+		// Case 4: x1 = 0 and x2 = 0
+		b2FloatW valid = b2AndW(b2GreaterEqualW(bx, zero), b2GreaterEqualW(by, zero));
+		xx = b2SelectW(xx, zero, valid);
+		xy = b2SelectW(xy, zero, valid);
+
+		// Case 3: vn2 = 0 and x1 = 0
+		b2FloatW x2 = b2SubW(zero, b2MulW(cp2->normalMass, by));
+		b2FloatW vn = b2AddW(b2MulW(vw->k12, x2), bx);
+		valid = b2AndW(b2GreaterEqualW(x2, zero), b2GreaterEqualW(vn, zero));
+		xx = b2SelectW(xx, zero, valid);
+		xy = b2SelectW(xy, x2, valid);
+
+		// Case 2: vn1 = 0 and x2 = 0
+		b2FloatW x1 = b2SubW(zero, b2MulW(cp1->normalMass, bx));
+		vn = b2AddW(b2MulW(vw->k12, x1), by);
+		valid = b2AndW(b2GreaterEqualW(x1, zero), b2GreaterEqualW(vn, zero));
+		xx = b2SelectW(xx, x1, valid);
+		xy = b2SelectW(xy, zero, valid);
+
+		// Case 1: vn = 0
+		x1 = b2SubW(zero, b2AddW(b2MulW(vw->normalMass11, bx), b2MulW(vw->normalMass12, by)));
+		x2 = b2SubW(zero, b2AddW(b2MulW(vw->normalMass21, bx), b2MulW(vw->normalMass22, by)));
+		valid = b2AndW(b2GreaterEqualW(x1, zero), b2GreaterEqualW(x2, zero));
+		xx = b2SelectW(xx, x1, valid);
+		xy = b2SelectW(xy, x2, valid);
+
+		xx = b2SelectW(single, xx, vw->blockMask);
+		xy = b2SelectW(zero, xy, vw->blockMask);
+
+		// Apply the incremental impulse
+		b2FloatW dx = b2SubW(xx, ax);
+		b2FloatW dy = b2SubW(xy, ay);
+		b2FloatW P1X = b2MulW(dx, normalX);
+		b2FloatW P1Y = b2MulW(dx, normalY);
+		b2FloatW P2X = b2MulW(dy, normalX);
+		b2FloatW P2Y = b2MulW(dy, normalY);
+		b2FloatW PX = b2AddW(P1X, P2X);
+		b2FloatW PY = b2AddW(P1Y, P2Y);
+
+		vAX = b2SubW(vAX, b2MulW(mA, PX));
+		vAY = b2SubW(vAY, b2MulW(mA, PY));
+		wA = b2SubW(wA, b2MulW(iA, b2AddW(
+			b2SubW(b2MulW(cp1->rAX, P1Y), b2MulW(cp1->rAY, P1X)),
+			b2SubW(b2MulW(cp2->rAX, P2Y), b2MulW(cp2->rAY, P2X)))));
+
+		vBX = b2AddW(vBX, b2MulW(mB, PX));
+		vBY = b2AddW(vBY, b2MulW(mB, PY));
+		wB = b2AddW(wB, b2MulW(iB, b2AddW(
+			b2SubW(b2MulW(cp1->rBX, P1Y), b2MulW(cp1->rBY, P1X)),
+			b2SubW(b2MulW(cp2->rBX, P2Y), b2MulW(cp2->rBY, P2X)))));
+
+		// Accumulate
+		cp1->normalImpulse = xx;
+		cp2->normalImpulse = xy;
+
+		b2ScatterVelocities(m_velocities, vw->indexA, vw->invMassA, vAX, vAY, wA);
+		b2ScatterVelocities(m_velocities, vw->indexB, vw->invMassB, vBX, vBY, wB);
+	}
+}
+
+static inline void b2GatherPositions(const b2Position* positions, const int32* indices,
+									 b2FloatW* cx, b2FloatW* cy, b2FloatW* a)
+{
+	float32 x[b2_simdWidth], y[b2_simdWidth], angle[b2_simdWidth];
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		int32 index = indices[lane];
+		if (index < 0)
+		{
+			x[lane] = y[lane] = angle[lane] = 0.0f;
+			continue;
+		}
+
+		x[lane] = positions[index].c.x;
+		y[lane] = positions[index].c.y;
+		angle[lane] = positions[index].a;
+	}
+
+	*cx = b2MakeW(x[0], x[1], x[2], x[3]);
+	*cy = b2MakeW(y[0], y[1], y[2], y[3]);
+	*a = b2MakeW(angle[0], angle[1], angle[2], angle[3]);
+}
+
+static inline void b2ScatterPositions(b2Position* positions, const int32* indices, b2FloatW invMass,
+									  b2FloatW cx, b2FloatW cy, b2FloatW a)
+{
+	float32 m[b2_simdWidth], x[b2_simdWidth], y[b2_simdWidth], angle[b2_simdWidth];
+	b2StoreW(m, invMass);
+	b2StoreW(x, cx);
+	b2StoreW(y, cy);
+	b2StoreW(angle, a);
+
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		int32 index = indices[lane];
+		if (index < 0 || m[lane] == 0.0f)
+		{
+			continue;
+		}
+
+		positions[index].c.Set(x[lane], y[lane]);
+		positions[index].a = angle[lane];
+	}
+}
+
+// The sine and cosine are evaluated per lane, like b2Rot::Set.
+static inline void b2RotationW(b2FloatW angle, b2FloatW* s, b2FloatW* c)
+{
+	float32 a[b2_simdWidth], sines[b2_simdWidth], cosines[b2_simdWidth];
+	b2StoreW(a, angle);
+	for (int32 lane = 0; lane < b2_simdWidth; ++lane)
+	{
+		b2Rot q(a[lane]);
+		sines[lane] = q.s;
+		cosines[lane] = q.c;
+	}
+
+	*s = b2MakeW(sines[0], sines[1], sines[2], sines[3]);
+	*c = b2MakeW(cosines[0], cosines[1], cosines[2], cosines[3]);
+}
+
+// Batched version of the sequential position solver. Returns the minimum separation.
+float32 b2ContactSolver::SolvePositionConstraintsWide()
+{
+	const b2FloatW zero = b2ZeroW();
+	const b2FloatW half = b2SplatW(0.5f);
+	const b2FloatW epsilon = b2SplatW(b2_epsilon);
+	b2FloatW minSeparation = zero;
+
+	for (int32 b = 0; b < m_batchCount; ++b)
+	{
+		b2ContactPositionConstraintWide* pw = m_positionBatches + b;
+
+		b2FloatW cAX, cAY, aA, cBX, cBY, aB;
+		b2GatherPositions(m_positions, pw->indexA, &cAX, &cAY, &aA);
+		b2GatherPositions(m_positions, pw->indexB, &cBX, &cBY, &aB);
+
+		b2FloatW mA = pw->invMassA;
+		b2FloatW mB = pw->invMassB;
+		b2FloatW iA = pw->invIA;
+		b2FloatW iB = pw->invIB;
+
+		// Solve normal constraints
+		for (int32 j = 0; j < b2_maxManifoldPoints; ++j)
+		{
+			b2FloatW sA, qcA, sB, qcB;
+			b2RotationW(aA, &sA, &qcA);
+			b2RotationW(aB, &sB, &qcB);
+
+			// xf.p = c - b2Mul(xf.q, localCenter)
+			b2FloatW pAX = b2SubW(cAX, b2SubW(b2MulW(qcA, pw->localCenterAX), b2MulW(sA, pw->localCenterAY)));
+			b2FloatW pAY = b2SubW(cAY, b2AddW(b2MulW(sA, pw->localCenterAX), b2MulW(qcA, pw->localCenterAY)));
+			b2FloatW pBX = b2SubW(cBX, b2SubW(b2MulW(qcB, pw->localCenterBX), b2MulW(sB, pw->localCenterBY)));
+			b2FloatW pBY = b2SubW(cBY, b2AddW(b2MulW(sB, pw->localCenterBX), b2MulW(qcB, pw->localCenterBY)));
+
+			// Face manifolds: the reference face belongs to A, or to B for e_faceB.
+			b2FloatW faceB = pw->faceBMask;
+			b2FloatW sRef = b2SelectW(sA, sB, faceB);
+			b2FloatW cRef = b2SelectW(qcA, qcB, faceB);
+			b2FloatW pRefX = b2SelectW(pAX, pBX, faceB);
+			b2FloatW pRefY = b2SelectW(pAY, pBY, faceB);
+			b2FloatW sInc = b2SelectW(sB, sA, faceB);
+			b2FloatW cInc = b2SelectW(qcB, qcA, faceB);
+			b2FloatW pIncX = b2SelectW(pBX, pAX, faceB);
+			b2FloatW pIncY = b2SelectW(pBY, pAY, faceB);
+
+			b2FloatW refNormalX = b2SubW(b2MulW(cRef, pw->localNormalX), b2MulW(sRef, pw->localNormalY));
+			b2FloatW refNormalY = b2AddW(b2MulW(sRef, pw->localNormalX), b2MulW(cRef, pw->localNormalY));
+			b2FloatW planeX = b2AddW(b2SubW(b2MulW(cRef, pw->localPointX), b2MulW(sRef, pw->localPointY)), pRefX);
+			b2FloatW planeY = b2AddW(b2AddW(b2MulW(sRef, pw->localPointX), b2MulW(cRef, pw->localPointY)), pRefY);
+			b2FloatW clipX = b2AddW(b2SubW(b2MulW(cInc, pw->localPointsX[j]), b2MulW(sInc, pw->localPointsY[j])), pIncX);
+			b2FloatW clipY = b2AddW(b2AddW(b2MulW(sInc, pw->localPointsX[j]), b2MulW(cInc, pw->localPointsY[j])), pIncY);
+
+			b2FloatW separation = b2AddW(b2MulW(b2SubW(clipX, planeX), refNormalX), b2MulW(b2SubW(clipY, planeY), refNormalY));
+
+			// Ensure normal points from A to B
+			b2FloatW normalX = b2SelectW(refNormalX, b2SubW(zero, refNormalX), faceB);
+			b2FloatW normalY = b2SelectW(refNormalY, b2SubW(zero, refNormalY), faceB);
+			b2FloatW pointX = clipX;
+			b2FloatW pointY = clipY;
+
+			// Circle manifolds have a single point.
+			b2FloatW circles = pw->circlesMask;
+			b2FloatW pointAX = b2AddW(b2SubW(b2MulW(qcA, pw->localPointX), b2MulW(sA, pw->localPointY)), pAX);
+			b2FloatW pointAY = b2AddW(b2AddW(b2MulW(sA, pw->localPointX), b2MulW(qcA, pw->localPointY)), pAY);
+			b2FloatW pointBX = b2AddW(b2SubW(b2MulW(qcB, pw->localPointsX[0]), b2MulW(sB, pw->localPointsY[0])), pBX);
+			b2FloatW pointBY = b2AddW(b2AddW(b2MulW(sB, pw->localPointsX[0]), b2MulW(qcB, pw->localPointsY[0])), pBY);
+			b2FloatW dX = b2SubW(pointBX, pointAX);
+			b2FloatW dY = b2SubW(pointBY, pointAY);
+			b2FloatW length = b2SqrtW(b2AddW(b2MulW(dX, dX), b2MulW(dY, dY)));
+
+			// Like b2Vec2::Normalize, short vectors are left alone.
+			b2FloatW normalize = b2GreaterEqualW(length, epsilon);
+			b2FloatW invLength = b2DivW(b2SplatW(1.0f), b2SelectW(b2SplatW(1.0f), length, normalize));
+			b2FloatW circleNormalX = b2SelectW(dX, b2MulW(dX, invLength), normalize);
+			b2FloatW circleNormalY = b2SelectW(dY, b2MulW(dY, invLength), normalize);
+
+			normalX = b2SelectW(normalX, circleNormalX, circles);
+			normalY = b2SelectW(normalY, circleNormalY, circles);
+			pointX = b2SelectW(pointX, b2MulW(half, b2AddW(pointAX, pointBX)), circles);
+			pointY = b2SelectW(pointY, b2MulW(half, b2AddW(pointAY, pointBY)), circles);
+			separation = b2SelectW(separation, b2AddW(b2MulW(dX, circleNormalX), b2MulW(dY, circleNormalY)), circles);
+			separation = b2SubW(separation, pw->radius);
+
+			b2FloatW rAX = b2SubW(pointX, cAX);
+			b2FloatW rAY = b2SubW(pointY, cAY);
+			b2FloatW rBX = b2SubW(pointX, cBX);
+			b2FloatW rBY = b2SubW(pointY, cBY);
+
+			// Track max constraint error.
+			b2FloatW active = pw->pointMask[j];
+			minSeparation = b2MinW(minSeparation, b2SelectW(zero, separation, active));
+
+			// Prevent large corrections and allow slop.
+			b2FloatW C = b2MulW(b2SplatW(b2_baumgarte), b2AddW(separation, b2SplatW(b2_linearSlop)));
+			C = b2ClampW(C, b2SplatW(-b2_maxLinearCorrection), zero);
+
+			// Compute the effective mass.
+			b2FloatW rnA = b2SubW(b2MulW(rAX, normalY), b2MulW(rAY, normalX));
+			b2FloatW rnB = b2SubW(b2MulW(rBX, normalY), b2MulW(rBY, normalX));
+			b2FloatW K = b2AddW(b2AddW(mA, mB), b2AddW(b2MulW(iA, b2MulW(rnA, rnA)), b2MulW(iB, b2MulW(rnB, rnB))));
+
+			// Compute normal impulse
+			b2FloatW solvable = b2AndW(b2GreaterW(K, zero), active);
+			b2FloatW impulse = b2DivW(b2SubW(zero, C), b2SelectW(b2SplatW(1.0f), K, solvable));
+			impulse = b2SelectW(zero, impulse, solvable);
+
+			b2FloatW PX = b2MulW(impulse, normalX);
+			b2FloatW PY = b2MulW(impulse, normalY);
+
+			cAX = b2SubW(cAX, b2MulW(mA, PX));
+			cAY = b2SubW(cAY, b2MulW(mA, PY));
+			aA = b2SubW(aA, b2MulW(iA, b2SubW(b2MulW(rAX, PY), b2MulW(rAY, PX))));
+
+			cBX = b2AddW(cBX, b2MulW(mB, PX));
+			cBY = b2AddW(cBY, b2MulW(mB, PY));
+			aB = b2AddW(aB, b2MulW(iB, b2SubW(b2MulW(rBX, PY), b2MulW(rBY, PX))));
+		}
+
+		b2ScatterPositions(m_positions, pw->indexA, pw->invMassA, cAX, cAY, aA);
+		b2ScatterPositions(m_positions, pw->indexB, pw->invMassB, cBX, cBY, aB);
+	}
+
+	float32 separations[b2_simdWidth];
+	b2StoreW(separations, minSeparation);
+	float32 result = separations[0];
+	for (int32 lane = 1; lane < b2_simdWidth; ++lane)
+	{
+		result = b2Min(result, separations[lane]);
+	}
+	return result;
+}
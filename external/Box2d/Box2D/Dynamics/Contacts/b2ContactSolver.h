@@ -27,6 +27,8 @@ class b2Contact;
 class b2Body;
 class b2StackAllocator;
 struct b2ContactPositionConstraint;
+struct b2ContactVelocityConstraintWide;
+struct b2ContactPositionConstraintWide;
 
 struct b2VelocityConstraintPoint
 {
@@ -63,6 +65,7 @@ struct b2ContactSolverDef
 	b2Position* positions;
 	b2Velocity* velocities;
 	b2StackAllocator* allocator;
+	bool wide;
 };
 
 class b2ContactSolver
@@ -88,6 +91,23 @@ public:
 	b2ContactVelocityConstraint* m_velocityConstraints;
 	b2Contact** m_contacts;
 	int m_count;
+
+	// Optional batched solver. The constraints are graph colored so that no
+	// two constraints in a batch share a body with finite mass. Constraints
+	// that do not fit into a color are solved one at a time afterwards.
+	void BuildBatches();
+	void PackVelocityConstraints();
+	void UnpackVelocityConstraints();
+	void SolveVelocityConstraintsWide();
+	float32 SolvePositionConstraintsWide();
+
+	void* m_wideBuffer;
+	b2ContactVelocityConstraintWide* m_velocityBatches;
+	b2ContactPositionConstraintWide* m_positionBatches;
+	int32* m_batchIndices;
+	int32 m_batchCount;
+	int32* m_overflowIndices;
+	int32 m_overflowCount;
 };
 
 #endif
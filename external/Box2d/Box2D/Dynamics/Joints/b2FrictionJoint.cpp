@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/Joints/b2FrictionJoint.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Snapshot.h>
 
 // Point-to-point constraint
 // Cdot = v2 - v1
@@ -122,10 +123,16 @@ void b2FrictionJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_angularImpulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -179,10 +186,16 @@ void b2FrictionJoint::SolveVelocityConstraints(const b2SolverData& data)
 		wB += iB * b2Cross(m_rB, impulse);
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2FrictionJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -234,6 +247,22 @@ float32 b2FrictionJoint::GetMaxTorque() const
 	return m_maxTorque;
 }
 
+void b2FrictionJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_linearImpulse);
+	snapshot->Write(m_angularImpulse);
+	snapshot->Write(m_maxForce);
+	snapshot->Write(m_maxTorque);
+}
+
+void b2FrictionJoint::RestoreState(b2Snapshot* snapshot)
+{
+	snapshot->Read(&m_linearImpulse);
+	snapshot->Read(&m_angularImpulse);
+	snapshot->Read(&m_maxForce);
+	snapshot->Read(&m_maxTorque);
+}
+
 void b2FrictionJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -21,6 +21,7 @@
 #include <Box2D/Dynamics/Joints/b2PrismaticJoint.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Snapshot.h>
 
 // Gear Joint:
 // C0 = (coordinate1 + ratio * coordinate2)_initial
@@ -226,14 +227,26 @@ void b2GearJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_impulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
-	data.velocities[m_indexC].v = vC;
-	data.velocities[m_indexC].w = wC;
-	data.velocities[m_indexD].v = vD;
-	data.velocities[m_indexD].w = wD;
+	if (m_mA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_mB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
+	if (m_mC != 0.0f)
+	{
+		data.velocities[m_indexC].v = vC;
+		data.velocities[m_indexC].w = wC;
+	}
+	if (m_mD != 0.0f)
+	{
+		data.velocities[m_indexD].v = vD;
+		data.velocities[m_indexD].w = wD;
+	}
 }
 
 void b2GearJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -262,14 +275,26 @@ void b2GearJoint::SolveVelocityConstraints(const b2SolverData& data)
 	vD -= (m_mD * impulse) * m_JvBD;
 	wD -= m_iD * impulse * m_JwD;
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
-	data.velocities[m_indexC].v = vC;
-	data.velocities[m_indexC].w = wC;
-	data.velocities[m_indexD].v = vD;
-	data.velocities[m_indexD].w = wD;
+	if (m_mA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_mB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
+	if (m_mC != 0.0f)
+	{
+		data.velocities[m_indexC].v = vC;
+		data.velocities[m_indexC].w = wC;
+	}
+	if (m_mD != 0.0f)
+	{
+		data.velocities[m_indexD].v = vD;
+		data.velocities[m_indexD].w = wD;
+	}
 }
 
 bool b2GearJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -358,14 +383,26 @@ bool b2GearJoint::SolvePositionConstraints(const b2SolverData& data)
 	cD -= m_mD * impulse * JvBD;
 	aD -= m_iD * impulse * JwD;
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
-	data.positions[m_indexC].c = cC;
-	data.positions[m_indexC].a = aC;
-	data.positions[m_indexD].c = cD;
-	data.positions[m_indexD].a = aD;
+	if (m_mA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_mB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
+	if (m_mC != 0.0f)
+	{
+		data.positions[m_indexC].c = cC;
+		data.positions[m_indexC].a = aC;
+	}
+	if (m_mD != 0.0f)
+	{
+		data.positions[m_indexD].c = cD;
+		data.positions[m_indexD].a = aD;
+	}
 
 	// TODO_ERIN not implemented
 	return linearError < b2_linearSlop;
@@ -404,6 +441,18 @@ float32 b2GearJoint::GetRatio() const
 	return m_ratio;
 }
 
+void b2GearJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_ratio);
+	snapshot->Write(m_impulse);
+}
+
+void b2GearJoint::RestoreState(b2Snapshot* snapshot)
+{
+	snapshot->Read(&m_ratio);
+	snapshot->Read(&m_impulse);
+}
+
 void b2GearJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -25,6 +25,7 @@ class b2Body;
 class b2Joint;
 struct b2SolverData;
 class b2BlockAllocator;
+class b2Snapshot;
 
 enum b2JointType
 {
@@ -163,6 +164,12 @@ protected:
 	// This returns true if the position errors are within tolerance.
 	virtual bool SolvePositionConstraints(const b2SolverData& data) = 0;
 
+	// Writes and reads back the values that a step or a setter can change,
+	// for b2World::SaveSnapshot. The solver temporaries are computed again
+	// by InitVelocityConstraints.
+	virtual void SaveState(b2Snapshot* snapshot) const = 0;
+	virtual void RestoreState(b2Snapshot* snapshot) = 0;
+
 	b2JointType m_type;
 	b2Joint* m_prev;
 	b2Joint* m_next;
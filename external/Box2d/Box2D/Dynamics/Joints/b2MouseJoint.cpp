@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/Joints/b2MouseJoint.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Snapshot.h>
 
 // p = attached point, m = mouse point
 // C = p - m
@@ -161,8 +162,11 @@ void b2MouseJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_impulse.SetZero();
 	}
 
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -186,8 +190,11 @@ void b2MouseJoint::SolveVelocityConstraints(const b2SolverData& data)
 	vB += m_invMassB * impulse;
 	wB += m_invIB * b2Cross(m_rB, impulse);
 
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2MouseJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -215,3 +222,21 @@ float32 b2MouseJoint::GetReactionTorque(float32 inv_dt) const
 {
 	return inv_dt * 0.0f;
 }
+
+void b2MouseJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_targetA);
+	snapshot->Write(m_frequencyHz);
+	snapshot->Write(m_dampingRatio);
+	snapshot->Write(m_maxForce);
+	snapshot->Write(m_impulse);
+}
+
+void b2MouseJoint::RestoreState(b2Snapshot* snapshot)
+{
+	snapshot->Read(&m_targetA);
+	snapshot->Read(&m_frequencyHz);
+	snapshot->Read(&m_dampingRatio);
+	snapshot->Read(&m_maxForce);
+	snapshot->Read(&m_impulse);
+}
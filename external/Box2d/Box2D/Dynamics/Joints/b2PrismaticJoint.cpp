@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/Joints/b2PrismaticJoint.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Snapshot.h>
 
 // Linear constraint (point-to-line)
 // d = p2 - p1 = x2 + r2 - x1 - r1
@@ -254,10 +255,16 @@ void b2PrismaticJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_motorImpulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2PrismaticJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -362,10 +369,16 @@ void b2PrismaticJoint::SolveVelocityConstraints(const b2SolverData& data)
 		}
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2PrismaticJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -484,10 +497,16 @@ bool b2PrismaticJoint::SolvePositionConstraints(const b2SolverData& data)
 	cB += mB * P;
 	aB += iB * LB;
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
+	if (m_invMassA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
 
 	return linearError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -614,6 +633,32 @@ float32 b2PrismaticJoint::GetMotorForce(float32 inv_dt) const
 	return inv_dt * m_motorImpulse;
 }
 
+void b2PrismaticJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_motorImpulse);
+	snapshot->Write(m_lowerTranslation);
+	snapshot->Write(m_upperTranslation);
+	snapshot->Write(m_maxMotorForce);
+	snapshot->Write(m_motorSpeed);
+	snapshot->Write(m_enableLimit);
+	snapshot->Write(m_enableMotor);
+	snapshot->Write(m_limitState);
+}
+
+void b2PrismaticJoint::RestoreState(b2Snapshot* snapshot)
+{
+	snapshot->Read(&m_impulse);
+	snapshot->Read(&m_motorImpulse);
+	snapshot->Read(&m_lowerTranslation);
+	snapshot->Read(&m_upperTranslation);
+	snapshot->Read(&m_maxMotorForce);
+	snapshot->Read(&m_motorSpeed);
+	snapshot->Read(&m_enableLimit);
+	snapshot->Read(&m_enableMotor);
+	snapshot->Read(&m_limitState);
+}
+
 void b2PrismaticJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/Joints/b2RevoluteJoint.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Snapshot.h>
 
 // Point-to-point constraint
 // C = p2 - p1
@@ -176,10 +177,16 @@ void b2RevoluteJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_motorImpulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -284,10 +291,16 @@ void b2RevoluteJoint::SolveVelocityConstraints(const b2SolverData& data)
 		wB += iB * b2Cross(m_rB, impulse);
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2RevoluteJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -368,10 +381,16 @@ bool b2RevoluteJoint::SolvePositionConstraints(const b2SolverData& data)
 		aB += iB * b2Cross(rB, impulse);
 	}
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
+	if (m_invMassA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
 
 	return positionError <= b2_linearSlop && angularError <= b2_angularSlop;
 }
@@ -482,6 +501,32 @@ void b2RevoluteJoint::SetLimits(float32 lower, float32 upper)
 	}
 }
 
+void b2RevoluteJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_motorImpulse);
+	snapshot->Write(m_enableMotor);
+	snapshot->Write(m_maxMotorTorque);
+	snapshot->Write(m_motorSpeed);
+	snapshot->Write(m_enableLimit);
+	snapshot->Write(m_lowerAngle);
+	snapshot->Write(m_upperAngle);
+	snapshot->Write(m_limitState);
+}
+
+void b2RevoluteJoint::RestoreState(b2Snapshot* snapshot)
+{
+	snapshot->Read(&m_impulse);
+	snapshot->Read(&m_motorImpulse);
+	snapshot->Read(&m_enableMotor);
+	snapshot->Read(&m_maxMotorTorque);
+	snapshot->Read(&m_motorSpeed);
+	snapshot->Read(&m_enableLimit);
+	snapshot->Read(&m_lowerAngle);
+	snapshot->Read(&m_upperAngle);
+	snapshot->Read(&m_limitState);
+}
+
 void b2RevoluteJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
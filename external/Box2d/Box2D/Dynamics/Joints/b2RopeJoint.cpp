@@ -19,6 +19,7 @@
 #include <Box2D/Dynamics/Joints/b2RopeJoint.h>
 #include <Box2D/Dynamics/b2Body.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
+#include <Box2D/Common/b2Snapshot.h>
 
 
 // Limit:
@@ -117,10 +118,16 @@ void b2RopeJoint::InitVelocityConstraints(const b2SolverData& data)
 		m_impulse = 0.0f;
 	}
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 void b2RopeJoint::SolveVelocityConstraints(const b2SolverData& data)
@@ -153,10 +160,16 @@ void b2RopeJoint::SolveVelocityConstraints(const b2SolverData& data)
 	vB += m_invMassB * P;
 	wB += m_invIB * b2Cross(m_rB, P);
 
-	data.velocities[m_indexA].v = vA;
-	data.velocities[m_indexA].w = wA;
-	data.velocities[m_indexB].v = vB;
-	data.velocities[m_indexB].w = wB;
+	if (m_invMassA != 0.0f)
+	{
+		data.velocities[m_indexA].v = vA;
+		data.velocities[m_indexA].w = wA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.velocities[m_indexB].v = vB;
+		data.velocities[m_indexB].w = wB;
+	}
 }
 
 bool b2RopeJoint::SolvePositionConstraints(const b2SolverData& data)
@@ -185,10 +198,16 @@ bool b2RopeJoint::SolvePositionConstraints(const b2SolverData& data)
 	cB += m_invMassB * P;
 	aB += m_invIB * b2Cross(rB, P);
 
-	data.positions[m_indexA].c = cA;
-	data.positions[m_indexA].a = aA;
-	data.positions[m_indexB].c = cB;
-	data.positions[m_indexB].a = aB;
+	if (m_invMassA != 0.0f)
+	{
+		data.positions[m_indexA].c = cA;
+		data.positions[m_indexA].a = aA;
+	}
+	if (m_invMassB != 0.0f)
+	{
+		data.positions[m_indexB].c = cB;
+		data.positions[m_indexB].a = aB;
+	}
 
 	return length - m_maxLength < b2_linearSlop;
 }
@@ -225,6 +244,22 @@ b2LimitState b2RopeJoint::GetLimitState() const
 	return m_state;
 }
 
+void b2RopeJoint::SaveState(b2Snapshot* snapshot) const
+{
+	snapshot->Write(m_maxLength);
+	snapshot->Write(m_length);
+	snapshot->Write(m_impulse);
+	snapshot->Write(m_state);
+}
+
+void b2RopeJoint::RestoreState(b2Snapshot* snapshot)
+{
+	snapshot->Read(&m_maxLength);
+	snapshot->Read(&m_length);
+	snapshot->Read(&m_impulse);
+	snapshot->Read(&m_state);
+}
+
 void b2RopeJoint::Dump()
 {
 	int32 indexA = m_bodyA->m_islandIndex;
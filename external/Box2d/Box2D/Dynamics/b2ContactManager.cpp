@@ -21,6 +21,10 @@
 #include <Box2D/Dynamics/b2Fixture.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/Contacts/b2Contact.h>
+#include <Box2D/Common/b2Profiler.h>
+#include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2ThreadPool.h>
+#include <cstring>
 
 b2ContactFilter b2_defaultFilter;
 b2ContactListener b2_defaultListener;
@@ -32,6 +36,16 @@ b2ContactManager::b2ContactManager()
 	m_contactFilter = &b2_defaultFilter;
 	m_contactListener = &b2_defaultListener;
 	m_allocator = NULL;
+	m_profiler = NULL;
+	m_threadPool = NULL;
+
+	m_updates = NULL;
+	m_updateCapacity = 0;
+}
+
+b2ContactManager::~b2ContactManager()
+{
+	b2Free(m_updates);
 }
 
 void b2ContactManager::Destroy(b2Contact* c)
@@ -102,70 +116,282 @@ void b2ContactManager::Destroy(b2Contact* c)
 // This is the top level collision call for the time step. Here
 // all the narrow phase collision is processed for the world
 // contact list.
+// The collide functions used by each primary contact type, for the profiler.
+static const char* s_collideNames[b2Shape::e_typeCount][b2Shape::e_typeCount] =
+{
+	{"b2CollideCircles", NULL, NULL, NULL},
+	{"b2CollideEdgeAndCircle", NULL, "b2CollideEdgeAndPolygon", NULL},
+	{"b2CollidePolygonAndCircle", NULL, "b2CollidePolygons", NULL},
+	{"b2CollideEdgeAndCircle (chain)", NULL, "b2CollideEdgeAndPolygon (chain)", NULL}
+};
+
+// Narrow-phase time per contact type, for the profiler.
+struct b2CollideTimes
+{
+	int64 times[b2Shape::e_typeCount][b2Shape::e_typeCount];
+	int32 counts[b2Shape::e_typeCount][b2Shape::e_typeCount];
+};
+
+// The totals are laid out back to back from the start of the narrow-phase.
+static void b2ReportCollideTimes(b2Profiler* profiler, const b2CollideTimes& times, int64 begin, int32 threadIndex)
+{
+	for (int32 i = 0; i < b2Shape::e_typeCount; ++i)
+	{
+		for (int32 j = 0; j < b2Shape::e_typeCount; ++j)
+		{
+			if (times.counts[i][j] > 0)
+			{
+				b2Assert(s_collideNames[i][j] != NULL);
+				profiler->AddEvent(s_collideNames[i][j], begin, begin + times.times[i][j], times.counts[i][j], threadIndex);
+				begin += times.times[i][j];
+			}
+		}
+	}
+}
+
+// What the narrow-phase does with a contact.
+enum b2CollideAction
+{
+	e_collideSkip,
+	e_collideDestroy,
+	e_collideUpdate
+};
+
+// A contact of the parallel narrow-phase.
+struct b2ContactUpdate
+{
+	b2Contact* contact;
+	b2Manifold oldManifold;
+	int32 action;
+	bool wasTouching;
+};
+
+// The parallel narrow-phase hands out contacts in batches of this size.
+#define b2_collideBatchSize	64
+
+// Use the parallel narrow-phase from this many contacts on.
+#define b2_minParallelContacts	256
+
+// Updates the manifolds of a batch of contacts per item.
+class b2CollideTask : public b2Task
+{
+public:
+	void Execute(int32 index, int32 threadIndex)
+	{
+		int32 begin = index * b2_collideBatchSize;
+		int32 end = b2Min(begin + b2_collideBatchSize, count);
+		for (int32 i = begin; i < end; ++i)
+		{
+			b2ContactUpdate* u = updates + i;
+			if (u->action != e_collideUpdate)
+			{
+				continue;
+			}
+
+			b2Contact* c = u->contact;
+			u->wasTouching = c->IsTouching();
+
+			if (times)
+			{
+				int64 start = b2Timer::GetTimestamp();
+				c->UpdateManifold(&u->oldManifold);
+				int32 typeA = c->GetFixtureA()->GetType();
+				int32 typeB = c->GetFixtureB()->GetType();
+				times[threadIndex].times[typeA][typeB] += b2Timer::GetTimestamp() - start;
+				++times[threadIndex].counts[typeA][typeB];
+			}
+			else
+			{
+				c->UpdateManifold(&u->oldManifold);
+			}
+		}
+	}
+
+	b2ContactUpdate* updates;
+	int32 count;
+	b2CollideTimes* times;
+};
+
+// Filter a contact and decide if it is destroyed, skipped or updated.
+int32 b2ContactManager::ClassifyContact(b2Contact* c)
+{
+	b2Fixture* fixtureA = c->GetFixtureA();
+	b2Fixture* fixtureB = c->GetFixtureB();
+	int32 indexA = c->GetChildIndexA();
+	int32 indexB = c->GetChildIndexB();
+	b2Body* bodyA = fixtureA->GetBody();
+	b2Body* bodyB = fixtureB->GetBody();
+
+	// Is this contact flagged for filtering?
+	if (c->m_flags & b2Contact::e_filterFlag)
+	{
+		// Should these bodies collide?
+		if (bodyB->ShouldCollide(bodyA) == false)
+		{
+			return e_collideDestroy;
+		}
+
+		// Check user filtering.
+		if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+		{
+			return e_collideDestroy;
+		}
+
+		// Clear the filtering flag.
+		c->m_flags &= ~b2Contact::e_filterFlag;
+	}
+
+	bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
+	bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+
+	// At least one body must be awake and it must be dynamic or kinematic.
+	if (activeA == false && activeB == false)
+	{
+		return e_collideSkip;
+	}
+
+	int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
+	int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
+	bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+
+	// Here we destroy contacts that cease to overlap in the broad-phase.
+	if (overlap == false)
+	{
+		return e_collideDestroy;
+	}
+
+	// The contact persists.
+	return e_collideUpdate;
+}
+
 void b2ContactManager::Collide()
 {
+	if (m_threadPool && m_threadPool->GetThreadCount() > 1 && m_contactCount >= b2_minParallelContacts)
+	{
+		CollideParallel();
+		return;
+	}
+
+	// With a profiler the narrow-phase time is summed up per contact type.
+	b2Profiler* profiler = m_profiler && m_profiler->IsEnabled() ? m_profiler : NULL;
+	int64 collideBegin = 0;
+	b2CollideTimes times;
+	if (profiler)
+	{
+		collideBegin = b2Timer::GetTimestamp();
+		memset(&times, 0, sizeof(times));
+	}
+
 	// Update awake contacts.
 	b2Contact* c = m_contactList;
 	while (c)
 	{
-		b2Fixture* fixtureA = c->GetFixtureA();
-		b2Fixture* fixtureB = c->GetFixtureB();
-		int32 indexA = c->GetChildIndexA();
-		int32 indexB = c->GetChildIndexB();
-		b2Body* bodyA = fixtureA->GetBody();
-		b2Body* bodyB = fixtureB->GetBody();
+		b2Contact* next = c->GetNext();
 
-		// Is this contact flagged for filtering?
-		if (c->m_flags & b2Contact::e_filterFlag)
+		int32 action = ClassifyContact(c);
+		if (action == e_collideDestroy)
+		{
+			Destroy(c);
+		}
+		else if (action == e_collideUpdate)
 		{
-			// Should these bodies collide?
-			if (bodyB->ShouldCollide(bodyA) == false)
+			if (profiler)
 			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
+				int64 begin = b2Timer::GetTimestamp();
+				c->Update(m_contactListener);
+				int32 typeA = c->GetFixtureA()->GetType();
+				int32 typeB = c->GetFixtureB()->GetType();
+				times.times[typeA][typeB] += b2Timer::GetTimestamp() - begin;
+				++times.counts[typeA][typeB];
 			}
-
-			// Check user filtering.
-			if (m_contactFilter && m_contactFilter->ShouldCollide(fixtureA, fixtureB) == false)
+			else
 			{
-				b2Contact* cNuke = c;
-				c = cNuke->GetNext();
-				Destroy(cNuke);
-				continue;
+				c->Update(m_contactListener);
 			}
-
-			// Clear the filtering flag.
-			c->m_flags &= ~b2Contact::e_filterFlag;
 		}
 
-		bool activeA = bodyA->IsAwake() && bodyA->m_type != b2_staticBody;
-		bool activeB = bodyB->IsAwake() && bodyB->m_type != b2_staticBody;
+		c = next;
+	}
+
+	if (profiler)
+	{
+		b2ReportCollideTimes(profiler, times, collideBegin, 0);
+	}
+}
+
+// The manifolds are computed on the thread pool. Everything else happens on
+// the calling thread in list order, like in the serial narrow-phase: contacts
+// are destroyed, bodies woken and the listener called in the same order. A
+// contact between sleeping bodies is checked again when its turn comes,
+// because a contact before it may have woken one of the bodies.
+// Filtering is done up front, so when a listener flags contacts for
+// filtering, the filter runs on the next step.
+void b2ContactManager::CollideParallel()
+{
+	b2Profiler* profiler = m_profiler && m_profiler->IsEnabled() ? m_profiler : NULL;
+	int64 collideBegin = profiler ? b2Timer::GetTimestamp() : 0;
+
+	if (m_updateCapacity < m_contactCount)
+	{
+		b2Free(m_updates);
+		m_updateCapacity = b2Max(2 * m_updateCapacity, m_contactCount);
+		m_updates = (b2ContactUpdate*)b2Alloc(m_updateCapacity * sizeof(b2ContactUpdate));
+	}
+
+	int32 count = 0;
+	for (b2Contact* c = m_contactList; c; c = c->GetNext())
+	{
+		b2ContactUpdate* u = m_updates + count++;
+		u->contact = c;
+		u->action = ClassifyContact(c);
+	}
+	b2Assert(count == m_contactCount);
+
+	b2CollideTimes times[b2_maxThreads];
+	if (profiler)
+	{
+		memset(times, 0, sizeof(times));
+	}
+
+	b2CollideTask task;
+	task.updates = m_updates;
+	task.count = count;
+	task.times = profiler ? times : NULL;
+	m_threadPool->Run(&task, (count + b2_collideBatchSize - 1) / b2_collideBatchSize);
 
-		// At least one body must be awake and it must be dynamic or kinematic.
-		if (activeA == false && activeB == false)
+	if (profiler)
+	{
+		for (int32 i = 0; i < m_threadPool->GetThreadCount(); ++i)
 		{
-			c = c->GetNext();
-			continue;
+			b2ReportCollideTimes(profiler, times[i], collideBegin, i);
 		}
+	}
 
-		int32 proxyIdA = fixtureA->m_proxies[indexA].proxyId;
-		int32 proxyIdB = fixtureB->m_proxies[indexB].proxyId;
-		bool overlap = m_broadPhase.TestOverlap(proxyIdA, proxyIdB);
+	for (int32 i = 0; i < count; ++i)
+	{
+		b2ContactUpdate* u = m_updates + i;
+		b2Contact* c = u->contact;
 
-		// Here we destroy contacts that cease to overlap in the broad-phase.
-		if (overlap == false)
+		if (u->action == e_collideUpdate)
 		{
-			b2Contact* cNuke = c;
-			c = cNuke->GetNext();
-			Destroy(cNuke);
+			c->ReportUpdate(u->oldManifold, u->wasTouching, m_contactListener);
 			continue;
 		}
 
-		// The contact persists.
-		c->Update(m_contactListener);
-		c = c->GetNext();
+		int32 action = u->action;
+		if (action == e_collideSkip)
+		{
+			action = ClassifyContact(c);
+		}
+
+		if (action == e_collideDestroy)
+		{
+			Destroy(c);
+		}
+		else if (action == e_collideUpdate)
+		{
+			c->Update(m_contactListener);
+		}
 	}
 }
 
@@ -25,12 +25,16 @@ class b2Contact;
 class b2ContactFilter;
 class b2ContactListener;
 class b2BlockAllocator;
+class b2Profiler;
+class b2ThreadPool;
+struct b2ContactUpdate;
 
 // Delegate of b2World.
 class b2ContactManager
 {
 public:
 	b2ContactManager();
+	~b2ContactManager();
 
 	// Broad-phase callback.
 	void AddPair(void* proxyUserDataA, void* proxyUserDataB);
@@ -39,6 +43,8 @@ public:
 
 	void Destroy(b2Contact* c);
 
+	// Update the contacts with the narrow-phase. With a thread pool of more
+	// than one thread, the manifolds of big worlds are computed in parallel.
 	void Collide();
 
 	b2BroadPhase m_broadPhase;
@@ -47,6 +53,16 @@ public:
 	b2ContactFilter* m_contactFilter;
 	b2ContactListener* m_contactListener;
 	b2BlockAllocator* m_allocator;
+	b2Profiler* m_profiler;
+	b2ThreadPool* m_threadPool;
+
+private:
+
+	int32 ClassifyContact(b2Contact* c);
+	void CollideParallel();
+
+	b2ContactUpdate* m_updates;
+	int32 m_updateCapacity;
 };
 
 #endif
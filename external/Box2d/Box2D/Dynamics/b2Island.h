@@ -28,6 +28,7 @@ class b2Joint;
 class b2StackAllocator;
 class b2ContactListener;
 struct b2ContactVelocityConstraint;
+struct b2ContactImpulse;
 struct b2Profile;
 
 /// This is an internal class.
@@ -36,6 +37,17 @@ class b2Island
 public:
 	b2Island(int32 bodyCapacity, int32 contactCapacity, int32 jointCapacity,
 			b2StackAllocator* allocator, b2ContactListener* listener);
+
+	/// Construct an island over arrays owned by the caller. The island bodies
+	/// occupy the solver state at [bodyOffset, bodyOffset + bodyCount). If impulses
+	/// is not NULL the contact impulses are stored there instead of being reported
+	/// to a listener.
+	b2Island(b2Body** bodies, int32 bodyCount,
+			b2Contact** contacts, int32 contactCount,
+			b2Joint** joints, int32 jointCount,
+			b2Position* positions, b2Velocity* velocities, int32 bodyOffset,
+			b2StackAllocator* allocator, b2ContactImpulse* impulses);
+
 	~b2Island();
 
 	void Clear()
@@ -73,6 +85,7 @@ public:
 
 	b2StackAllocator* m_allocator;
 	b2ContactListener* m_listener;
+	b2ContactImpulse* m_impulses;
 
 	b2Body** m_bodies;
 	b2Contact** m_contacts;
@@ -80,6 +93,7 @@ public:
 
 	b2Position* m_positions;
 	b2Velocity* m_velocities;
+	int32 m_bodyOffset;
 
 	int32 m_bodyCount;
 	int32 m_jointCount;
@@ -88,6 +102,8 @@ public:
 	int32 m_bodyCapacity;
 	int32 m_contactCapacity;
 	int32 m_jointCapacity;
+
+	bool m_ownsArrays;
 };
 
 #endif
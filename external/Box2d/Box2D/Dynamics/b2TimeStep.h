@@ -43,6 +43,7 @@ struct b2TimeStep
 	int32 velocityIterations;
 	int32 positionIterations;
 	bool warmStarting;
+	bool wideContactSolver;
 };
 
 /// This is an internal structure.
@@ -60,6 +61,8 @@ struct b2Velocity
 };
 
 /// Solver Data
+/// Constraints never write back the state of a body without mass. Islands
+/// solved in parallel share the slots of static bodies and rely on this.
 struct b2SolverData
 {
 	b2TimeStep step;
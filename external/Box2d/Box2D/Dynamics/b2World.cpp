@@ -32,6 +32,8 @@
 #include <Box2D/Collision/b2TimeOfImpact.h>
 #include <Box2D/Common/b2Draw.h>
 #include <Box2D/Common/b2Timer.h>
+#include <Box2D/Common/b2Profiler.h>
+#include <Box2D/Common/b2Snapshot.h>
 #include <new>
 
 b2World::b2World(const b2Vec2& gravity)
@@ -46,6 +48,8 @@ b2World::b2World(const b2Vec2& gravity)
 	m_jointCount = 0;
 
 	m_warmStarting = true;
+	m_wideContactSolver = false;
+	m_treeRotationBudget = 0.0f;
 	m_continuousPhysics = true;
 	m_subStepping = false;
 
@@ -59,8 +63,19 @@ b2World::b2World(const b2Vec2& gravity)
 	m_inv_dt0 = 0.0f;
 
 	m_contactManager.m_allocator = &m_blockAllocator;
+	m_contactManager.m_broadPhase.SetThreadPool(&m_threadPool);
+	m_contactManager.m_threadPool = &m_threadPool;
+
+	m_threadAllocators[0] = &m_stackAllocator;
+	for (int32 i = 1; i < b2_maxThreads; ++i)
+	{
+		m_threadAllocators[i] = NULL;
+	}
+	m_stackSize = b2_stackSize;
+	m_stackGrowable = false;
 
 	memset(&m_profile, 0, sizeof(b2Profile));
+	m_profiler = NULL;
 }
 
 b2World::~b2World()
@@ -82,6 +97,74 @@ b2World::~b2World()
 
 		b = bNext;
 	}
+
+	// Stop the workers and release their stack allocators.
+	SetThreadCount(1);
+}
+
+void b2World::SetStackSize(int32 size)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_stackSize = size;
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		if (m_threadAllocators[i])
+		{
+			m_threadAllocators[i]->SetSize(size);
+		}
+	}
+}
+
+void b2World::SetStackGrowable(bool flag)
+{
+	m_stackGrowable = flag;
+	for (int32 i = 0; i < b2_maxThreads; ++i)
+	{
+		if (m_threadAllocators[i])
+		{
+			m_threadAllocators[i]->SetGrowable(flag);
+		}
+	}
+}
+
+int32 b2World::TrimMemory()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return 0;
+	}
+
+	return m_blockAllocator.Trim();
+}
+
+void b2World::GetBlockAllocatorStats(b2BlockAllocatorStats* stats) const
+{
+	m_blockAllocator.GetStats(stats);
+}
+
+void b2World::GetStackAllocatorStats(int32 threadIndex, b2StackAllocatorStats* stats) const
+{
+	b2Assert(0 <= threadIndex && threadIndex < b2_maxThreads);
+	if (m_threadAllocators[threadIndex])
+	{
+		m_threadAllocators[threadIndex]->GetStats(stats);
+	}
+	else
+	{
+		memset(stats, 0, sizeof(b2StackAllocatorStats));
+	}
+}
+
+void b2World::SetProfiler(b2Profiler* profiler)
+{
+	m_profiler = profiler;
+	m_contactManager.m_profiler = profiler;
 }
 
 void b2World::SetDestructionListener(b2DestructionListener* listener)
@@ -104,6 +187,36 @@ void b2World::SetDebugDraw(b2Draw* debugDraw)
 	m_debugDraw = debugDraw;
 }
 
+void b2World::SetThreadCount(int32 count)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_threadPool.SetThreadCount(count);
+
+	// Each worker solves islands with its own stack allocator.
+	int32 threadCount = m_threadPool.GetThreadCount();
+	for (int32 i = 1; i < b2_maxThreads; ++i)
+	{
+		if (i < threadCount && m_threadAllocators[i] == NULL)
+		{
+			void* mem = b2Alloc(sizeof(b2StackAllocator));
+			m_threadAllocators[i] = new (mem) b2StackAllocator;
+			m_threadAllocators[i]->SetSize(m_stackSize);
+			m_threadAllocators[i]->SetGrowable(m_stackGrowable);
+		}
+		else if (i >= threadCount && m_threadAllocators[i] != NULL)
+		{
+			m_threadAllocators[i]->~b2StackAllocator();
+			b2Free(m_threadAllocators[i]);
+			m_threadAllocators[i] = NULL;
+		}
+	}
+}
+
 b2Body* b2World::CreateBody(const b2BodyDef* def)
 {
 	b2Assert(IsLocked() == false);
@@ -389,13 +502,6 @@ void b2World::Solve(const b2TimeStep& step)
 	m_profile.solveVelocity = 0.0f;
 	m_profile.solvePosition = 0.0f;
 
-	// Size the island for the worst case.
-	b2Island island(m_bodyCount,
-					m_contactManager.m_contactCount,
-					m_jointCount,
-					&m_stackAllocator,
-					m_contactManager.m_contactListener);
-
 	// Clear all the island flags.
 	for (b2Body* b = m_bodyList; b; b = b->m_next)
 	{
@@ -410,6 +516,52 @@ void b2World::Solve(const b2TimeStep& step)
 		j->m_islandFlag = false;
 	}
 
+	if (m_threadPool.GetThreadCount() > 1)
+	{
+		SolveIslandsParallel(step);
+	}
+	else
+	{
+		SolveIslands(step);
+	}
+
+	{
+		b2ProfileScope scope(m_profiler, "Broadphase");
+		b2Timer timer;
+		// Synchronize fixtures, check for out of range bodies.
+		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		{
+			// If a body was not in an island then it did not move.
+			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			{
+				continue;
+			}
+
+			if (b->GetType() == b2_staticBody)
+			{
+				continue;
+			}
+
+			// Update fixtures (for broad-phase).
+			b->SynchronizeFixtures();
+		}
+
+		// Look for new contacts.
+		m_contactManager.FindNewContacts();
+		m_profile.broadphase = timer.GetMilliseconds();
+	}
+}
+
+// Build and simulate all awake islands one at a time.
+void b2World::SolveIslands(const b2TimeStep& step)
+{
+	// Size the island for the worst case.
+	b2Island island(m_bodyCount,
+					m_contactManager.m_contactCount,
+					m_jointCount,
+					&m_stackAllocator,
+					m_contactManager.m_contactListener);
+
 	// Build and simulate all awake islands.
 	int32 stackSize = m_bodyCount;
 	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(stackSize * sizeof(b2Body*));
@@ -431,6 +583,12 @@ void b2World::Solve(const b2TimeStep& step)
 			continue;
 		}
 
+		b2Profiler* profiler = m_profiler && m_profiler->IsEnabled() ? m_profiler : NULL;
+		if (profiler)
+		{
+			profiler->Begin("Island build");
+		}
+
 		// Reset island and stack.
 		island.Clear();
 		int32 stackCount = 0;
@@ -527,8 +685,20 @@ void b2World::Solve(const b2TimeStep& step)
 			}
 		}
 
+		if (profiler)
+		{
+			profiler->End();
+			profiler->Begin("Island solve");
+		}
+
 		b2Profile profile;
 		island.Solve(&profile, step, m_gravity, m_allowSleep);
+
+		if (profiler)
+		{
+			profiler->End();
+		}
+
 		m_profile.solveInit += profile.solveInit;
 		m_profile.solveVelocity += profile.solveVelocity;
 		m_profile.solvePosition += profile.solvePosition;
@@ -546,31 +716,313 @@ void b2World::Solve(const b2TimeStep& step)
 	}
 
 	m_stackAllocator.Free(stack);
+}
+
+// An island found by the parallel solver. The ranges index the flat
+// arrays shared by all islands.
+struct b2SolverIsland
+{
+	int32 bodyStart, bodyCount;
+	int32 staticStart, staticCount;
+	int32 contactStart, contactCount;
+	int32 jointStart, jointCount;
+	b2Profile profile;
+	bool sleeping;
+};
 
+// Solves one island per item on the world thread pool.
+class b2IslandSolveTask : public b2Task
+{
+public:
+	void Execute(int32 index, int32 threadIndex)
 	{
-		b2Timer timer;
-		// Synchronize fixtures, check for out of range bodies.
-		for (b2Body* b = m_bodyList; b; b = b->GetNext())
+		b2SolverIsland* si = islands + index;
+		b2ProfileScope scope(profiler, "Island solve", threadIndex);
+
+		b2Island island(bodies + si->bodyStart, si->bodyCount,
+						contacts + si->contactStart, si->contactCount,
+						joints + si->jointStart, si->jointCount,
+						positions, velocities, si->bodyStart,
+						allocators[threadIndex],
+						impulses ? impulses + si->contactStart : NULL);
+
+		island.Solve(&si->profile, *step, gravity, allowSleep);
+
+		// The island either went to sleep as a whole or it is still awake.
+		si->sleeping = bodies[si->bodyStart]->IsAwake() == false;
+	}
+
+	b2SolverIsland* islands;
+	b2Body** bodies;
+	b2Contact** contacts;
+	b2Joint** joints;
+	b2Position* positions;
+	b2Velocity* velocities;
+	b2ContactImpulse* impulses;
+	b2StackAllocator** allocators;
+	const b2TimeStep* step;
+	b2Vec2 gravity;
+	bool allowSleep;
+	b2Profiler* profiler;
+};
+
+// Find all awake islands first, then solve them concurrently. Every non-static
+// body belongs to a single island, so the islands write disjoint state. Static
+// bodies may touch many islands. They are kept out of the island body lists
+// and get one solver slot that all islands read. The constraints skip the
+// write-back for bodies without mass (see b2SolverData), so no island writes
+// that slot. Anything the serial solver does to shared state is applied
+// afterwards in island order, which keeps the results identical to SolveIslands.
+void b2World::SolveIslandsParallel(const b2TimeStep& step)
+{
+	int32 bodyCapacity = m_bodyCount;
+	int32 contactCapacity = m_contactManager.m_contactCount;
+	int32 jointCapacity = m_jointCount;
+
+	// A static body is added once per contact or joint edge at most.
+	int32 staticCapacity = contactCapacity + jointCapacity;
+
+	b2ContactListener* listener = m_contactManager.m_contactListener;
+
+	b2SolverIsland* islands = (b2SolverIsland*)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2SolverIsland));
+	b2Body** bodies = (b2Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Body*));
+	b2Body** statics = (b2Body**)m_stackAllocator.Allocate(staticCapacity * sizeof(b2Body*));
+	b2Contact** contacts = (b2Contact**)m_stackAllocator.Allocate(contactCapacity * sizeof(b2Contact*));
+	b2Joint** joints = (b2Joint**)m_stackAllocator.Allocate(jointCapacity * sizeof(b2Joint*));
+	b2Position* positions = (b2Position*)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Position));
+	b2Velocity* velocities = (b2Velocity*)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Velocity));
+	b2ContactImpulse* impulses = NULL;
+	if (listener)
+	{
+		impulses = (b2ContactImpulse*)m_stackAllocator.Allocate(contactCapacity * sizeof(b2ContactImpulse));
+	}
+	b2Body** stack = (b2Body**)m_stackAllocator.Allocate(bodyCapacity * sizeof(b2Body*));
+
+	// Island bodies take solver slots from the front, static bodies from the back.
+	// The static slots are filled here and only read by the island tasks.
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		if (b->GetType() == b2_staticBody)
 		{
-			// If a body was not in an island then it did not move.
-			if ((b->m_flags & b2Body::e_islandFlag) == 0)
+			b->m_islandIndex = -1;
+		}
+	}
+
+	b2Profiler* profiler = m_profiler && m_profiler->IsEnabled() ? m_profiler : NULL;
+	if (profiler)
+	{
+		profiler->Begin("Island build");
+	}
+
+	int32 islandCount = 0;
+	int32 bodyCount = 0;
+	int32 staticCount = 0;
+	int32 contactCount = 0;
+	int32 jointCount = 0;
+	int32 staticSlot = bodyCapacity;
+
+	for (b2Body* seed = m_bodyList; seed; seed = seed->m_next)
+	{
+		if (seed->m_flags & b2Body::e_islandFlag)
+		{
+			continue;
+		}
+
+		if (seed->IsAwake() == false || seed->IsActive() == false)
+		{
+			continue;
+		}
+
+		// The seed can be dynamic or kinematic.
+		if (seed->GetType() == b2_staticBody)
+		{
+			continue;
+		}
+
+		b2SolverIsland* si = islands + islandCount++;
+		si->bodyStart = bodyCount;
+		si->staticStart = staticCount;
+		si->contactStart = contactCount;
+		si->jointStart = jointCount;
+
+		int32 stackCount = 0;
+		stack[stackCount++] = seed;
+		seed->m_flags |= b2Body::e_islandFlag;
+
+		// Perform a depth first search (DFS) on the constraint graph.
+		while (stackCount > 0)
+		{
+			b2Body* b = stack[--stackCount];
+			b2Assert(b->IsActive() == true);
+
+			// Make sure the body is awake.
+			b->SetAwake(true);
+
+			// To keep islands as small as possible, we don't
+			// propagate islands across static bodies.
+			if (b->GetType() == b2_staticBody)
 			{
+				b2Assert(staticCount < staticCapacity);
+				statics[staticCount++] = b;
+
+				if (b->m_islandIndex == -1)
+				{
+					b->m_islandIndex = --staticSlot;
+					positions[staticSlot].c = b->m_sweep.c;
+					positions[staticSlot].a = b->m_sweep.a;
+					velocities[staticSlot].v = b->m_linearVelocity;
+					velocities[staticSlot].w = b->m_angularVelocity;
+				}
 				continue;
 			}
 
-			if (b->GetType() == b2_staticBody)
+			b2Assert(bodyCount < staticSlot);
+			b->m_islandIndex = bodyCount;
+			bodies[bodyCount++] = b;
+
+			// Search all contacts connected to this body.
+			for (b2ContactEdge* ce = b->m_contactList; ce; ce = ce->next)
 			{
-				continue;
+				b2Contact* contact = ce->contact;
+
+				// Has this contact already been added to an island?
+				if (contact->m_flags & b2Contact::e_islandFlag)
+				{
+					continue;
+				}
+
+				// Is this contact solid and touching?
+				if (contact->IsEnabled() == false ||
+					contact->IsTouching() == false)
+				{
+					continue;
+				}
+
+				// Skip sensors.
+				bool sensorA = contact->m_fixtureA->m_isSensor;
+				bool sensorB = contact->m_fixtureB->m_isSensor;
+				if (sensorA || sensorB)
+				{
+					continue;
+				}
+
+				b2Assert(contactCount < contactCapacity);
+				contacts[contactCount++] = contact;
+				contact->m_flags |= b2Contact::e_islandFlag;
+
+				b2Body* other = ce->other;
+
+				// Was the other body already added to this island?
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCapacity);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
 			}
 
-			// Update fixtures (for broad-phase).
-			b->SynchronizeFixtures();
+			// Search all joints connect to this body.
+			for (b2JointEdge* je = b->m_jointList; je; je = je->next)
+			{
+				if (je->joint->m_islandFlag == true)
+				{
+					continue;
+				}
+
+				b2Body* other = je->other;
+
+				// Don't simulate joints connected to inactive bodies.
+				if (other->IsActive() == false)
+				{
+					continue;
+				}
+
+				b2Assert(jointCount < jointCapacity);
+				joints[jointCount++] = je->joint;
+				je->joint->m_islandFlag = true;
+
+				if (other->m_flags & b2Body::e_islandFlag)
+				{
+					continue;
+				}
+
+				b2Assert(stackCount < bodyCapacity);
+				stack[stackCount++] = other;
+				other->m_flags |= b2Body::e_islandFlag;
+			}
 		}
 
-		// Look for new contacts.
-		m_contactManager.FindNewContacts();
-		m_profile.broadphase = timer.GetMilliseconds();
+		si->bodyCount = bodyCount - si->bodyStart;
+		si->staticCount = staticCount - si->staticStart;
+		si->contactCount = contactCount - si->contactStart;
+		si->jointCount = jointCount - si->jointStart;
+
+		// Allow static bodies to participate in other islands.
+		for (int32 i = si->staticStart; i < staticCount; ++i)
+		{
+			statics[i]->m_flags &= ~b2Body::e_islandFlag;
+		}
+	}
+
+	if (profiler)
+	{
+		profiler->End();
 	}
+
+	b2IslandSolveTask task;
+	task.islands = islands;
+	task.bodies = bodies;
+	task.contacts = contacts;
+	task.joints = joints;
+	task.positions = positions;
+	task.velocities = velocities;
+	task.impulses = impulses;
+	task.allocators = m_threadAllocators;
+	task.step = &step;
+	task.gravity = m_gravity;
+	task.allowSleep = m_allowSleep;
+	task.profiler = profiler;
+
+	m_threadPool.Run(&task, islandCount);
+
+	// Merge the results in island order.
+	for (int32 i = 0; i < islandCount; ++i)
+	{
+		b2SolverIsland* si = islands + i;
+
+		m_profile.solveInit += si->profile.solveInit;
+		m_profile.solveVelocity += si->profile.solveVelocity;
+		m_profile.solvePosition += si->profile.solvePosition;
+
+		if (impulses)
+		{
+			for (int32 j = si->contactStart; j < si->contactStart + si->contactCount; ++j)
+			{
+				listener->PostSolve(contacts[j], impulses + j);
+			}
+		}
+
+		// A sleeping island also puts its static bodies to sleep.
+		for (int32 j = si->staticStart; j < si->staticStart + si->staticCount; ++j)
+		{
+			statics[j]->SetAwake(si->sleeping == false);
+		}
+	}
+
+	m_stackAllocator.Free(stack);
+	if (impulses)
+	{
+		m_stackAllocator.Free(impulses);
+	}
+	m_stackAllocator.Free(velocities);
+	m_stackAllocator.Free(positions);
+	m_stackAllocator.Free(joints);
+	m_stackAllocator.Free(contacts);
+	m_stackAllocator.Free(statics);
+	m_stackAllocator.Free(bodies);
+	m_stackAllocator.Free(islands);
 }
 
 // Find TOI contacts and solve them.
@@ -860,6 +1312,7 @@ void b2World::SolveTOI(const b2TimeStep& step)
 		subStep.positionIterations = 20;
 		subStep.velocityIterations = step.velocityIterations;
 		subStep.warmStarting = false;
+		subStep.wideContactSolver = false;
 		island.SolveTOI(subStep, bA->m_islandIndex, bB->m_islandIndex);
 
 		// Reset island flags and synchronize broad-phase proxies.
@@ -897,10 +1350,12 @@ void b2World::SolveTOI(const b2TimeStep& step)
 void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIterations)
 {
 	b2Timer stepTimer;
+	b2ProfileScope stepScope(m_profiler, "Step");
 
 	// If new fixtures were added, we need to find the new contacts.
 	if (m_flags & e_newFixture)
 	{
+		b2ProfileScope scope(m_profiler, "Broadphase");
 		m_contactManager.FindNewContacts();
 		m_flags &= ~e_newFixture;
 	}
@@ -923,9 +1378,11 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	step.dtRatio = m_inv_dt0 * dt;
 
 	step.warmStarting = m_warmStarting;
+	step.wideContactSolver = m_wideContactSolver;
 
 	// Update contacts. This is where some contacts are destroyed.
 	{
+		b2ProfileScope scope(m_profiler, "Collide");
 		b2Timer timer;
 		m_contactManager.Collide();
 		m_profile.collide = timer.GetMilliseconds();
@@ -934,6 +1391,7 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	// Integrate velocities, solve velocity constraints, and integrate positions.
 	if (m_stepComplete && step.dt > 0.0f)
 	{
+		b2ProfileScope scope(m_profiler, "Solve");
 		b2Timer timer;
 		Solve(step);
 		m_profile.solve = timer.GetMilliseconds();
@@ -942,11 +1400,21 @@ void b2World::Step(float32 dt, int32 velocityIterations, int32 positionIteration
 	// Handle TOI events.
 	if (m_continuousPhysics && step.dt > 0.0f)
 	{
+		b2ProfileScope scope(m_profiler, "SolveTOI");
 		b2Timer timer;
 		SolveTOI(step);
 		m_profile.solveTOI = timer.GetMilliseconds();
 	}
 
+	// Incrementally improve the broad-phase tree.
+	if (m_treeRotationBudget > 0.0f)
+	{
+		b2ProfileScope scope(m_profiler, "Tree rotation");
+		b2Timer timer;
+		m_contactManager.m_broadPhase.RotateTree(m_treeRotationBudget);
+		m_profile.broadphase += timer.GetMilliseconds();
+	}
+
 	if (step.dt > 0.0f)
 	{
 		m_inv_dt0 = step.inv_dt;
@@ -1256,6 +1724,306 @@ float32 b2World::GetTreeQuality() const
 	return m_contactManager.m_broadPhase.GetTreeQuality();
 }
 
+float32 b2World::GetTreeQueryCost() const
+{
+	return m_contactManager.m_broadPhase.GetTreeQueryCost();
+}
+
+void b2World::RebuildTree()
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return;
+	}
+
+	m_contactManager.m_broadPhase.RebuildTree();
+}
+
+// Snapshots start with this header. The topology hash covers the objects
+// that are referenced by the snapshot.
+#define b2_snapshotMagic	0x53533262
+#define b2_snapshotVersion	2
+
+struct b2SnapshotHeader
+{
+	uint32 magic;
+	int32 version;
+	uint32 topology;
+	int32 bodyCount;
+	int32 jointCount;
+	int32 contactCount;
+};
+
+inline uint32 b2HashBytes(uint32 hash, const void* data, int32 size)
+{
+	// FNV-1a
+	const uint8* bytes = (const uint8*)data;
+	for (int32 i = 0; i < size; ++i)
+	{
+		hash = (hash ^ bytes[i]) * 16777619u;
+	}
+	return hash;
+}
+
+uint32 b2World::ComputeTopologyHash() const
+{
+	uint32 hash = 2166136261u;
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		hash = b2HashBytes(hash, &b, sizeof(b));
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			hash = b2HashBytes(hash, &f, sizeof(f));
+		}
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		hash = b2HashBytes(hash, &j, sizeof(j));
+		hash = b2HashBytes(hash, &j->m_type, sizeof(j->m_type));
+	}
+
+	return hash;
+}
+
+void b2World::SaveSnapshot(b2Snapshot* snapshot) const
+{
+	b2Assert(IsLocked() == false);
+
+	snapshot->Clear();
+
+	b2SnapshotHeader header;
+	header.magic = b2_snapshotMagic;
+	header.version = b2_snapshotVersion;
+	header.topology = ComputeTopologyHash();
+	header.bodyCount = m_bodyCount;
+	header.jointCount = m_jointCount;
+	header.contactCount = m_contactManager.m_contactCount;
+	snapshot->Write(header);
+
+	snapshot->Write(m_flags & e_newFixture);
+	snapshot->Write(m_gravity);
+	snapshot->Write(m_inv_dt0);
+	snapshot->Write(m_stepComplete);
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		snapshot->Write(b->m_type);
+		snapshot->Write(b->m_flags);
+		snapshot->Write(b->m_islandIndex);
+		snapshot->Write(b->m_xf);
+		snapshot->Write(b->m_sweep);
+		snapshot->Write(b->m_linearVelocity);
+		snapshot->Write(b->m_angularVelocity);
+		snapshot->Write(b->m_force);
+		snapshot->Write(b->m_torque);
+		snapshot->Write(b->m_mass);
+		snapshot->Write(b->m_invMass);
+		snapshot->Write(b->m_I);
+		snapshot->Write(b->m_invI);
+		snapshot->Write(b->m_linearDamping);
+		snapshot->Write(b->m_angularDamping);
+		snapshot->Write(b->m_gravityScale);
+		snapshot->Write(b->m_sleepTime);
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			snapshot->Write(f->m_density);
+			snapshot->Write(f->m_friction);
+			snapshot->Write(f->m_restitution);
+			snapshot->Write(f->m_filter);
+			snapshot->Write(f->m_isSensor);
+			snapshot->Write(f->m_proxyCount);
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				snapshot->Write(f->m_proxies[i].aabb);
+				snapshot->Write(f->m_proxies[i].proxyId);
+			}
+		}
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->SaveState(snapshot);
+	}
+
+	m_contactManager.m_broadPhase.Save(snapshot);
+
+	// Contacts are only ever added to the front of the world and body contact
+	// lists, so the order of both is restored by adding the contacts back
+	// oldest first.
+	b2Contact* last = m_contactManager.m_contactList;
+	while (last && last->m_next)
+	{
+		last = last->m_next;
+	}
+
+	for (b2Contact* c = last; c; c = c->m_prev)
+	{
+		snapshot->Write(c->m_fixtureA->m_proxies[c->m_indexA].proxyId);
+		snapshot->Write(c->m_fixtureB->m_proxies[c->m_indexB].proxyId);
+		snapshot->Write(c->m_flags);
+		snapshot->Write(c->m_manifold);
+		snapshot->Write(c->m_toiCount);
+		snapshot->Write(c->m_toi);
+		snapshot->Write(c->m_friction);
+		snapshot->Write(c->m_restitution);
+	}
+}
+
+bool b2World::RestoreSnapshot(b2Snapshot* snapshot)
+{
+	b2Assert(IsLocked() == false);
+	if (IsLocked())
+	{
+		return false;
+	}
+
+	snapshot->Rewind();
+	if (snapshot->GetRemaining() < int32(sizeof(b2SnapshotHeader)))
+	{
+		return false;
+	}
+
+	b2SnapshotHeader header;
+	snapshot->Read(&header);
+	if (header.magic != b2_snapshotMagic || header.version != b2_snapshotVersion ||
+		header.bodyCount != m_bodyCount || header.jointCount != m_jointCount ||
+		header.topology != ComputeTopologyHash())
+	{
+		return false;
+	}
+
+	// Return the current contacts to the block allocator. The listener is
+	// not told, the contacts of the snapshot take their place.
+	b2Contact* c = m_contactManager.m_contactList;
+	while (c)
+	{
+		b2Contact* next = c->m_next;
+		b2Contact::Destroy(c, &m_blockAllocator);
+		c = next;
+	}
+	m_contactManager.m_contactList = NULL;
+	m_contactManager.m_contactCount = 0;
+
+	int32 newFixture;
+	snapshot->Read(&newFixture);
+	m_flags = (m_flags & ~e_newFixture) | newFixture;
+	snapshot->Read(&m_gravity);
+	snapshot->Read(&m_inv_dt0);
+	snapshot->Read(&m_stepComplete);
+
+	for (b2Body* b = m_bodyList; b; b = b->m_next)
+	{
+		snapshot->Read(&b->m_type);
+		snapshot->Read(&b->m_flags);
+		snapshot->Read(&b->m_islandIndex);
+		snapshot->Read(&b->m_xf);
+		snapshot->Read(&b->m_sweep);
+		snapshot->Read(&b->m_linearVelocity);
+		snapshot->Read(&b->m_angularVelocity);
+		snapshot->Read(&b->m_force);
+		snapshot->Read(&b->m_torque);
+		snapshot->Read(&b->m_mass);
+		snapshot->Read(&b->m_invMass);
+		snapshot->Read(&b->m_I);
+		snapshot->Read(&b->m_invI);
+		snapshot->Read(&b->m_linearDamping);
+		snapshot->Read(&b->m_angularDamping);
+		snapshot->Read(&b->m_gravityScale);
+		snapshot->Read(&b->m_sleepTime);
+		b->m_contactList = NULL;
+
+		for (b2Fixture* f = b->m_fixtureList; f; f = f->m_next)
+		{
+			snapshot->Read(&f->m_density);
+			snapshot->Read(&f->m_friction);
+			snapshot->Read(&f->m_restitution);
+			snapshot->Read(&f->m_filter);
+			snapshot->Read(&f->m_isSensor);
+			snapshot->Read(&f->m_proxyCount);
+			for (int32 i = 0; i < f->m_proxyCount; ++i)
+			{
+				snapshot->Read(&f->m_proxies[i].aabb);
+				snapshot->Read(&f->m_proxies[i].proxyId);
+			}
+		}
+	}
+
+	for (b2Joint* j = m_jointList; j; j = j->m_next)
+	{
+		j->RestoreState(snapshot);
+	}
+
+	b2BroadPhase* broadPhase = &m_contactManager.m_broadPhase;
+	broadPhase->Restore(snapshot);
+
+	for (int32 i = 0; i < header.contactCount; ++i)
+	{
+		int32 proxyIdA, proxyIdB;
+		snapshot->Read(&proxyIdA);
+		snapshot->Read(&proxyIdB);
+
+		b2FixtureProxy* proxyA = (b2FixtureProxy*)broadPhase->GetUserData(proxyIdA);
+		b2FixtureProxy* proxyB = (b2FixtureProxy*)broadPhase->GetUserData(proxyIdB);
+
+		// The snapshot has the fixtures in the order of the contact type, so
+		// Create does not swap them.
+		c = b2Contact::Create(proxyA->fixture, proxyA->childIndex, proxyB->fixture, proxyB->childIndex, &m_blockAllocator);
+		b2Assert(c->m_fixtureA == proxyA->fixture);
+
+		snapshot->Read(&c->m_flags);
+		snapshot->Read(&c->m_manifold);
+		snapshot->Read(&c->m_toiCount);
+		snapshot->Read(&c->m_toi);
+		snapshot->Read(&c->m_friction);
+		snapshot->Read(&c->m_restitution);
+
+		b2Body* bodyA = proxyA->fixture->m_body;
+		b2Body* bodyB = proxyB->fixture->m_body;
+
+		// Insert into the world.
+		c->m_prev = NULL;
+		c->m_next = m_contactManager.m_contactList;
+		if (m_contactManager.m_contactList != NULL)
+		{
+			m_contactManager.m_contactList->m_prev = c;
+		}
+		m_contactManager.m_contactList = c;
+
+		// Connect to body A
+		c->m_nodeA.contact = c;
+		c->m_nodeA.other = bodyB;
+
+		c->m_nodeA.prev = NULL;
+		c->m_nodeA.next = bodyA->m_contactList;
+		if (bodyA->m_contactList != NULL)
+		{
+			bodyA->m_contactList->prev = &c->m_nodeA;
+		}
+		bodyA->m_contactList = &c->m_nodeA;
+
+		// Connect to body B
+		c->m_nodeB.contact = c;
+		c->m_nodeB.other = bodyA;
+
+		c->m_nodeB.prev = NULL;
+		c->m_nodeB.next = bodyB->m_contactList;
+		if (bodyB->m_contactList != NULL)
+		{
+			bodyB->m_contactList->prev = &c->m_nodeB;
+		}
+		bodyB->m_contactList = &c->m_nodeB;
+
+		++m_contactManager.m_contactCount;
+	}
+
+	b2Assert(snapshot->GetRemaining() == 0);
+
+	return true;
+}
+
 void b2World::Dump()
 {
 	if ((m_flags & e_locked) == e_locked)
@@ -22,6 +22,7 @@
 #include <Box2D/Common/b2Math.h>
 #include <Box2D/Common/b2BlockAllocator.h>
 #include <Box2D/Common/b2StackAllocator.h>
+#include <Box2D/Common/b2ThreadPool.h>
 #include <Box2D/Dynamics/b2ContactManager.h>
 #include <Box2D/Dynamics/b2WorldCallbacks.h>
 #include <Box2D/Dynamics/b2TimeStep.h>
@@ -34,6 +35,8 @@ class b2Body;
 class b2Draw;
 class b2Fixture;
 class b2Joint;
+class b2Profiler;
+class b2Snapshot;
 
 /// The world class manages all physics entities, dynamic simulation,
 /// and asynchronous queries. The world also contains efficient memory
@@ -157,6 +160,51 @@ public:
 	void SetSubStepping(bool flag) { m_subStepping = flag; }
 	bool GetSubStepping() const { return m_subStepping; }
 
+	/// Enable/disable the batched contact solver. Contacts are grouped into
+	/// batches without shared dynamic bodies and solved with SIMD instructions
+	/// (SSE2 or NEON) where available. The solution order differs from the
+	/// default solver, so results are not bit-identical to it. Islands with
+	/// few contacts and time of impact sub-steps always use the default solver.
+	void SetWideContactSolver(bool flag) { m_wideContactSolver = flag; }
+	bool GetWideContactSolver() const { return m_wideContactSolver; }
+
+	/// Set the number of threads used to solve islands, including the thread
+	/// calling Step. Independent islands are then solved concurrently and the
+	/// results are identical to the single threaded solver. Contact listener
+	/// PostSolve events are reported after all islands have been solved, in
+	/// the same order. The broad-phase also searches for new pairs on all
+	/// threads and creates contacts in the same order as with one thread.
+	/// The default is one (no worker threads).
+	/// @warning This function is locked during callbacks.
+	void SetThreadCount(int32 count);
+	int32 GetThreadCount() const { return m_threadPool.GetThreadCount(); }
+
+	/// Set the size of the stack buffer each thread uses for the temporaries
+	/// of a step. Temporaries that do not fit fall back to b2Alloc. The
+	/// default is b2_stackSize.
+	/// @warning This function is locked during callbacks.
+	void SetStackSize(int32 size);
+	int32 GetStackSize() const { return m_stackSize; }
+
+	/// Let the stack buffers grow to the largest step seen so far, so that
+	/// big worlds stop falling back to b2Alloc after a few steps.
+	void SetStackGrowable(bool flag);
+	bool GetStackGrowable() const { return m_stackGrowable; }
+
+	/// Release the memory the world keeps for reuse after bodies, fixtures,
+	/// joints and contacts are destroyed.
+	/// @return the number of bytes released.
+	/// @warning This function is locked during callbacks.
+	int32 TrimMemory();
+
+	/// Get the statistics of the allocator that holds the bodies, fixtures,
+	/// shapes, joints and contacts.
+	void GetBlockAllocatorStats(b2BlockAllocatorStats* stats) const;
+
+	/// Get the statistics of the step stack of a thread. Thread 0 is the
+	/// calling thread.
+	void GetStackAllocatorStats(int32 threadIndex, b2StackAllocatorStats* stats) const;
+
 	/// Get the number of broad-phase proxies.
 	int32 GetProxyCount() const;
 
@@ -179,6 +227,24 @@ public:
 	/// The minimum is 1.
 	float32 GetTreeQuality() const;
 
+	/// Get the expected number of dynamic tree nodes tested by a query the size
+	/// of an average proxy. The smaller the better. Compare this to the value
+	/// after RebuildTree to decide when a rebuild is worthwhile.
+	float32 GetTreeQueryCost() const;
+
+	/// Rebuild the dynamic tree from scratch with the surface area heuristic.
+	/// The tree quality may degrade over long sessions where proxies are
+	/// created and destroyed a lot.
+	/// @warning This function is locked during callbacks.
+	void RebuildTree();
+
+	/// Improve the dynamic tree with local rotations at the end of every step,
+	/// for at most the given number of milliseconds. Zero (the default)
+	/// disables the rotations. The order of query and ray-cast callbacks
+	/// depends on the shape of the tree.
+	void SetTreeRotationBudget(float32 milliseconds) { m_treeRotationBudget = milliseconds; }
+	float32 GetTreeRotationBudget() const { return m_treeRotationBudget; }
+
 	/// Change the global gravity vector.
 	void SetGravity(const b2Vec2& gravity);
 
@@ -200,10 +266,33 @@ public:
 	/// Get the current profile.
 	const b2Profile& GetProfile() const;
 
+	/// Record the phases of every step with a profiler: the broad-phase,
+	/// the narrow-phase per contact type, island building, island solving
+	/// and TOI. Pass NULL (the default) to stop profiling. The world does
+	/// not own the profiler.
+	void SetProfiler(b2Profiler* profiler);
+	b2Profiler* GetProfiler() const { return m_profiler; }
+
 	/// Dump the world into the log file.
 	/// @warning this should be called outside of a time step.
 	void Dump();
 
+	/// Save the simulation state to a snapshot. This covers the bodies,
+	/// fixtures, joints, contacts with their warm starting impulses and the
+	/// broad-phase, so a step after RestoreSnapshot gives exactly the same
+	/// result as a step after SaveSnapshot.
+	/// @warning This function is locked during callbacks.
+	void SaveSnapshot(b2Snapshot* snapshot) const;
+
+	/// Restore the simulation state from a snapshot of this world. The world
+	/// must have the bodies, fixtures and joints it had when the snapshot was
+	/// saved. Contacts are recreated without calling the contact listener.
+	/// User data is not restored.
+	/// @return false if the snapshot does not match the world, which is then
+	/// left unchanged.
+	/// @warning This function is locked during callbacks.
+	bool RestoreSnapshot(b2Snapshot* snapshot);
+
 private:
 
 	// m_flags
@@ -220,14 +309,25 @@ private:
 	friend class b2Controller;
 
 	void Solve(const b2TimeStep& step);
+	void SolveIslands(const b2TimeStep& step);
+	void SolveIslandsParallel(const b2TimeStep& step);
 	void SolveTOI(const b2TimeStep& step);
 
+	uint32 ComputeTopologyHash() const;
+
 	void DrawJoint(b2Joint* joint);
 	void DrawShape(b2Fixture* shape, const b2Transform& xf, const b2Color& color);
 
 	b2BlockAllocator m_blockAllocator;
 	b2StackAllocator m_stackAllocator;
 
+	// Worker threads and their stack allocators. The calling thread
+	// uses m_stackAllocator.
+	b2ThreadPool m_threadPool;
+	b2StackAllocator* m_threadAllocators[b2_maxThreads];
+	int32 m_stackSize;
+	bool m_stackGrowable;
+
 	int32 m_flags;
 
 	b2ContactManager m_contactManager;
@@ -252,10 +352,14 @@ private:
 	bool m_warmStarting;
 	bool m_continuousPhysics;
 	bool m_subStepping;
+	bool m_wideContactSolver;
+
+	float32 m_treeRotationBudget;
 
 	bool m_stepComplete;
 
 	b2Profile m_profile;
+	b2Profiler* m_profiler;
 };
 
 inline b2Body* b2World::GetBodyList()
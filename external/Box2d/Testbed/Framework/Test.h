@@ -149,6 +149,9 @@ public:
 	void SpawnBomb(const b2Vec2& worldPt);
 	void CompleteBombSpawn(const b2Vec2& p);
 
+	// The world of the test, for tools that step tests without the UI.
+	b2World* GetWorld() { return m_world; }
+
 	// Let derived tests know that a joint was destroyed.
 	virtual void JointDestroyed(b2Joint* joint) { B2_NOT_USED(joint); }
 
@@ -0,0 +1,155 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Times the polygon collision functions on random overlapping pairs and
+// prints a checksum of all the contacts. CollisionBenchmarkScalar runs the
+// same pairs with CP_NO_SIMD, so the two checksums must match. Configure
+// with -DCHIPMUNK_BENCHMARK_FLOATS=ON to check the CP_USE_DOUBLES=0 kernels.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chipmunk_private.h"
+
+#define SHAPE_COUNT 256
+#define MAX_VERTS 12
+
+static unsigned int seed = 12345;
+
+// A small deterministic generator, so all runs use the same pairs.
+static cpFloat
+RandomFloat(cpFloat lo, cpFloat hi)
+{
+	seed = 1664525*seed + 1013904223;
+	cpFloat r = (cpFloat)(seed >> 8)/(cpFloat)(1 << 24);
+	return lo + r*(hi - lo);
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+static cpShape *
+MakePoly(cpBody *body)
+{
+	cpVect verts[MAX_VERTS], hull[MAX_VERTS];
+	int count = 3 + (int)RandomFloat(0.0f, MAX_VERTS - 3 + 0.999f);
+	cpFloat radius = RandomFloat(1.0f, 3.0f);
+	for(int i=0; i<count; i++) verts[i] = cpvmult(cpvforangle(RandomFloat(0.0f, 2.0f*(cpFloat)M_PI)), radius);
+	
+	int hullCount = cpConvexHull(count, verts, hull, NULL, 0.0f);
+	if(hullCount < 3) return cpBoxShapeNew(body, radius, radius);
+	
+	return cpPolyShapeNew(body, hullCount, hull, cpvzero);
+}
+
+static unsigned long long checksum = 14695981039346656037ULL;
+
+static void
+HashBytes(const void *data, size_t size)
+{
+	const unsigned char *bytes = (const unsigned char *)data;
+	for(size_t i=0; i<size; i++){
+		checksum ^= bytes[i];
+		checksum *= 1099511628211ULL;
+	}
+}
+
+static void
+HashContacts(const cpContact *contacts, int count)
+{
+	HashBytes(&count, sizeof(count));
+	for(int i=0; i<count; i++){
+		// Adding zero turns -0 into 0, min() may return either for equal values.
+		cpFloat values[5] = {contacts[i].p.x, contacts[i].p.y, contacts[i].n.x, contacts[i].n.y, contacts[i].dist + 0.0f};
+		HashBytes(values, sizeof(values));
+		HashBytes(&contacts[i].hash, sizeof(contacts[i].hash));
+	}
+}
+
+static void
+Place(cpShape *shape, cpFloat spread)
+{
+	cpShapeUpdate(shape, cpv(RandomFloat(-spread, spread), RandomFloat(-spread, spread)), cpvforangle(RandomFloat(0.0f, 2.0f*(cpFloat)M_PI)));
+}
+
+static void
+Run(const char *name, cpShape **a, cpShape **b, int pairs)
+{
+	cpContact contacts[CP_MAX_CONTACTS_PER_ARBITER];
+	int touching = 0, total = 0;
+	double time = 0.0;
+	
+	for(int i=0; i<pairs; i++){
+		cpShape *shape1 = a[i%SHAPE_COUNT];
+		cpShape *shape2 = b[(i*7 + 3)%SHAPE_COUNT];
+		Place(shape1, 2.0f);
+		Place(shape2, 2.0f);
+		
+		double start = Now();
+		int count = cpCollideShapes(shape1, shape2, contacts);
+		time += Now() - start;
+		
+		touching += (count > 0);
+		total += count;
+		HashContacts(contacts, count);
+	}
+	
+	printf("%-12s %8d %8d %8d %10.3f\n", name, pairs, touching, total, time);
+}
+
+int
+main(int argc, char **argv)
+{
+	int pairs = (argc > 1 ? atoi(argv[1]) : 1000000);
+	
+	cpBody *body = cpBodyNew(1.0f, 1.0f);
+	cpShape *polys[SHAPE_COUNT], *circles[SHAPE_COUNT], *segments[SHAPE_COUNT];
+	for(int i=0; i<SHAPE_COUNT; i++){
+		polys[i] = MakePoly(body);
+		circles[i] = cpCircleShapeNew(body, RandomFloat(0.5f, 2.0f), cpvzero);
+		segments[i] = cpSegmentShapeNew(body, cpv(-2.0f, 0.0f), cpv(2.0f, 0.0f), RandomFloat(0.0f, 0.5f));
+	}
+	
+	printf("%s, CP_USE_DOUBLES %d\n", (CP_POLY_SOA ? "four wide" : "scalar"), CP_USE_DOUBLES);
+	printf("%-12s %8s %8s %8s %10s\n", "pair", "tests", "touching", "contacts", "ms");
+	
+	Run("poly2poly", polys, polys, pairs);
+	Run("circle2poly", circles, polys, pairs);
+	Run("seg2poly", segments, polys, pairs);
+	
+	printf("checksum %016llx\n", checksum);
+	
+	for(int i=0; i<SHAPE_COUNT; i++){
+		cpShapeFree(polys[i]);
+		cpShapeFree(circles[i]);
+		cpShapeFree(segments[i]);
+	}
+	cpBodyFree(body);
+	
+	return 0;
+}
@@ -0,0 +1,183 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Times cpHashSet with the access pattern of space->cachedArbiters: arbiters are
+// keyed by a shape pair, found once per candidate pair each step and the stale
+// ones are filtered out. HashSetBenchmarkFlat runs the same work with
+// CP_USE_FLAT_HASH_SET, both print the same checksum.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "chipmunk_private.h"
+
+// Stands in for a cpArbiter, the set only looks at the two shape pointers.
+typedef struct Arbiter {
+	void *a, *b;
+	int stamp;
+} Arbiter;
+
+typedef struct Shape {
+	cpHashValue hashid;
+} Shape;
+
+static unsigned int seed = 12345;
+
+static unsigned int
+RandomInt(unsigned int n)
+{
+	seed = 1664525*seed + 1013904223;
+	return (seed >> 8)%n;
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+// Same as arbiterSetEql() in cpSpace.c.
+static cpBool
+ArbiterSetEql(Shape **shapes, Arbiter *arb)
+{
+	Shape *a = shapes[0];
+	Shape *b = shapes[1];
+	
+	return ((a == arb->a && b == arb->b) || (b == arb->a && a == arb->b));
+}
+
+static Arbiter *arbiters;
+static int arbiterCount;
+
+static void *
+ArbiterSetTrans(Shape **shapes, void *unused)
+{
+	(void)unused;
+	
+	Arbiter *arb = arbiters + (arbiterCount++);
+	arb->a = shapes[0];
+	arb->b = shapes[1];
+	arb->stamp = 0;
+	
+	return arb;
+}
+
+typedef struct FilterContext {
+	int stamp;
+	unsigned long long sum;
+} FilterContext;
+
+static cpBool
+ArbiterFilter(Arbiter *arb, FilterContext *context)
+{
+	context->sum += (unsigned long long)arb->stamp;
+	return (arb->stamp == context->stamp);
+}
+
+static inline cpHashValue
+PairHash(Shape **pair)
+{
+	return CP_HASH_PAIR(pair[0]->hashid, pair[1]->hashid);
+}
+
+static void
+Run(int count, int steps)
+{
+	// Shape pairs as a broadphase would produce them, a few pairs per shape.
+	int shapeCount = count/2;
+	Shape *shapes = (Shape *)cpcalloc(shapeCount, sizeof(Shape));
+	for(int i=0; i<shapeCount; i++) shapes[i].hashid = (cpHashValue)i;
+	
+	Shape **pairs = (Shape **)cpcalloc(2*count, sizeof(Shape *));
+	for(int i=0; i<count; i++){
+		int a = i/2;
+		pairs[2*i + 0] = shapes + a;
+		pairs[2*i + 1] = shapes + (a + 1 + (int)RandomInt(8) + 8*(i&1))%shapeCount;
+	}
+	
+	// The extra space is for the pairs that come and go each step.
+	arbiters = (Arbiter *)cpcalloc(count + count/10*steps, sizeof(Arbiter));
+	arbiterCount = 0;
+	
+	cpHashSet *set = cpHashSetNew(0, (cpHashSetEqlFunc)ArbiterSetEql);
+	
+	double start = Now();
+	for(int i=0; i<count; i++) cpHashSetInsert(set, PairHash(pairs + 2*i), pairs + 2*i, NULL, (cpHashSetTransFunc)ArbiterSetTrans);
+	double insertTime = Now() - start;
+	
+	// Each step touches 90% of the pairs, the rest are replaced with new ones and filtered out.
+	double findTime = 0.0, filterTime = 0.0;
+	unsigned long long sum = 0;
+	
+	for(int step=1; step<=steps; step++){
+		for(int i=0; i<count/10; i++){
+			int j = (int)RandomInt(count);
+			pairs[2*j + 1] = shapes + RandomInt(shapeCount);
+		}
+		
+		start = Now();
+		for(int i=0; i<count; i++){
+			Shape **pair = pairs + 2*i;
+			Arbiter *arb = (Arbiter *)cpHashSetInsert(set, PairHash(pair), pair, NULL, (cpHashSetTransFunc)ArbiterSetTrans);
+			arb->stamp = step;
+		}
+		findTime += Now() - start;
+		
+		FilterContext context = {step, 0};
+		start = Now();
+		cpHashSetFilter(set, (cpHashSetFilterFunc)ArbiterFilter, &context);
+		filterTime += Now() - start;
+		
+		sum += context.sum + (unsigned long long)cpHashSetCount(set);
+	}
+	
+	// Misses, like the lookups for pairs that don't have an arbiter yet.
+	start = Now();
+	for(int i=0; i<count; i++){
+		Shape *pair[2] = {shapes + i%shapeCount, shapes + (i*7919 + 13)%shapeCount};
+		sum += (cpHashSetFind(set, PairHash(pair), pair) != NULL);
+	}
+	double missTime = Now() - start;
+	
+	printf("%8d %10.3f %10.3f %10.3f %10.3f %20llu\n", count, insertTime, findTime/steps, filterTime/steps, missTime, sum);
+	
+	cpHashSetFree(set);
+	cpfree(arbiters);
+	cpfree(pairs);
+	cpfree(shapes);
+}
+
+int
+main(int argc, char **argv)
+{
+	int steps = (argc > 1 ? atoi(argv[1]) : 20);
+	
+	printf("%s cpHashSet, times in ms, find and filter per step\n", (CP_USE_FLAT_HASH_SET ? "flat" : "chained"));
+	printf("%8s %10s %10s %10s %10s %20s\n", "count", "insert", "find", "filter", "miss", "checksum");
+	
+	int counts[] = {10000, 50000, 100000, 200000};
+	for(int i=0; i<4; i++) Run(counts[i], steps);
+	
+	return 0;
+}
@@ -0,0 +1,557 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Runs standard scenes with every spatial index and reports steps per second,
+// the time spent in each phase of a step and a hash of the final body states.
+//   pyramid    a pyramid of 820 boxes settling on the ground
+//   logsmash   a wall of logs hit by a heavy ball
+//   tumble     1000 polygons tumbling inside a rotating box
+//   chains     20 chains of 40 links on pivot joints swinging into each other
+//   sleeping   a crowd of boxes that falls asleep and is poked awake again
+// Each scene runs twice. The first run uses cpSpaceStep() for the steps per
+// second and the hash, the second uses ProfiledStep(), a copy of cpSpaceStep()
+// with timers between the phases. The check column compares the two hashes,
+// so a copy that drifted from cpSpaceStep() shows up as a mismatch.
+// Usage: SceneBenchmark [steps] [scene|all] [index|all]
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chipmunk_private.h"
+
+static unsigned int seed;
+
+// A small deterministic generator, so all runs use the same scene.
+static cpFloat
+RandomFloat(cpFloat lo, cpFloat hi)
+{
+	seed = 1664525*seed + 1013904223;
+	cpFloat r = (cpFloat)(seed >> 8)/(cpFloat)(1 << 24);
+	return lo + r*(hi - lo);
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+//MARK: Profiled Step
+
+typedef struct Timings {
+	double integrate;
+	double broadphase;
+	double components;
+	double prestep;
+	double solve;
+} Timings;
+
+// Same as cpSpaceStep() with timers between the phases.
+// The broadphase time includes the narrowphase collision callbacks.
+// The prestep time includes the velocity integration and cached impulses.
+static void
+ProfiledStep(cpSpace *space, cpFloat dt, Timings *timings)
+{
+	if(dt == 0.0f) return;
+	
+	double start = Now();
+	
+	space->stamp++;
+	
+	cpFloat prev_dt = space->curr_dt;
+	space->curr_dt = dt;
+	
+	cpArray *bodies = space->bodies;
+	cpArray *constraints = space->constraints;
+	cpArray *arbiters = space->arbiters;
+	
+	for(int i=0; i<arbiters->num; i++){
+		cpArbiter *arb = (cpArbiter *)arbiters->arr[i];
+		arb->state = cpArbiterStateNormal;
+		
+		if(!cpBodyIsSleeping(arb->body_a) && !cpBodyIsSleeping(arb->body_b)){
+			cpArbiterUnthread(arb);
+		}
+	}
+	arbiters->num = 0;
+	
+	cpSpaceLock(space); {
+		for(int i=0; i<bodies->num; i++){
+			cpBody *body = (cpBody *)bodies->arr[i];
+			body->position_func(body, dt);
+		}
+		
+		double now = Now();
+		timings->integrate += now - start;
+		start = now;
+		
+		cpSpacePushFreshContactBuffer(space);
+		cpSpatialIndexEach(space->activeShapes, (cpSpatialIndexIteratorFunc)cpShapeUpdateFunc, NULL);
+		cpSpatialIndexReindexQuery(space->activeShapes, (cpSpatialIndexQueryFunc)cpSpaceCollideShapes, space);
+	} cpSpaceUnlock(space, cpFalse);
+	
+	double now = Now();
+	timings->broadphase += now - start;
+	start = now;
+	
+	cpSpaceProcessComponents(space, dt);
+	
+	now = Now();
+	timings->components += now - start;
+	start = now;
+	
+	cpSpaceLock(space); {
+		cpHashSetFilter(space->cachedArbiters, (cpHashSetFilterFunc)cpSpaceArbiterSetFilter, space);
+		
+		cpFloat slop = space->collisionSlop;
+		cpFloat biasCoef = 1.0f - cpfpow(space->collisionBias, dt);
+		for(int i=0; i<arbiters->num; i++){
+			cpArbiterPreStep((cpArbiter *)arbiters->arr[i], dt, slop, biasCoef);
+		}
+		
+		for(int i=0; i<constraints->num; i++){
+			cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+			
+			cpConstraintPreSolveFunc preSolve = constraint->preSolve;
+			if(preSolve) preSolve(constraint, space);
+			
+			constraint->klass->preStep(constraint, dt);
+		}
+		
+		cpFloat damping = cpfpow(space->damping, dt);
+		cpVect gravity = space->gravity;
+		for(int i=0; i<bodies->num; i++){
+			cpBody *body = (cpBody *)bodies->arr[i];
+			body->velocity_func(body, gravity, damping, dt);
+		}
+		
+		cpFloat dt_coef = (prev_dt == 0.0f ? 0.0f : dt/prev_dt);
+		for(int i=0; i<arbiters->num; i++){
+			cpArbiterApplyCachedImpulse((cpArbiter *)arbiters->arr[i], dt_coef);
+		}
+		
+		for(int i=0; i<constraints->num; i++){
+			cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+			constraint->klass->applyCachedImpulse(constraint, dt_coef);
+		}
+		
+		now = Now();
+		timings->prestep += now - start;
+		start = now;
+		
+		for(int i=0; i<space->iterations; i++){
+			for(int j=0; j<arbiters->num; j++){
+				cpArbiterApplyImpulse((cpArbiter *)arbiters->arr[j]);
+			}
+			
+			for(int j=0; j<constraints->num; j++){
+				cpConstraint *constraint = (cpConstraint *)constraints->arr[j];
+				constraint->klass->applyImpulse(constraint);
+			}
+		}
+		
+		for(int i=0; i<constraints->num; i++){
+			cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+			
+			cpConstraintPostSolveFunc postSolve = constraint->postSolve;
+			if(postSolve) postSolve(constraint, space);
+		}
+		
+		for(int i=0; i<arbiters->num; i++){
+			cpArbiter *arb = (cpArbiter *) arbiters->arr[i];
+			
+			cpCollisionHandler *handler = arb->handler;
+			handler->postSolve(arb, space, handler->data);
+		}
+	} cpSpaceUnlock(space, cpTrue);
+	
+	timings->solve += Now() - start;
+}
+
+//MARK: Spatial Indexes
+
+typedef cpSpatialIndex *(*IndexNewFunc)(cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
+
+// Must be called before any shapes are added.
+static void
+ReplaceIndexes(cpSpace *space, IndexNewFunc indexNew)
+{
+	cpSpatialIndex *staticShapes = indexNew((cpSpatialIndexBBFunc)cpShapeGetBB, NULL);
+	cpSpatialIndex *activeShapes = indexNew((cpSpatialIndexBBFunc)cpShapeGetBB, staticShapes);
+	
+	cpSpatialIndexFree(space->staticShapes);
+	cpSpatialIndexFree(space->activeShapes);
+	
+	space->staticShapes = staticShapes;
+	space->activeShapes = activeShapes;
+}
+
+static void UseBBTree(cpSpace *space){(void)space; /* the default index */}
+static void UseSpaceHash(cpSpace *space){cpSpaceUseSpatialHash(space, 30.0f, 10000);}
+static void UseSweep1D(cpSpace *space){ReplaceIndexes(space, cpSweep1DNew);}
+static void UseSweep2D(cpSpace *space){ReplaceIndexes(space, cpSweep2DNew);}
+
+// Starts out badly tuned and lets the hash fix it.
+static void
+UseSpaceHashAuto(cpSpace *space)
+{
+	cpSpaceUseSpatialHash(space, 200.0f, 100);
+	cpSpaceHashSetAutoResize(space->staticShapes, cpTrue);
+	cpSpaceHashSetAutoResize(space->activeShapes, cpTrue);
+}
+
+static void UseSpaceGrid(cpSpace *space){cpSpaceUseSpatialGrid(space, cpBBNew(-1000.0f, -500.0f, 1000.0f, 1500.0f), 30.0f);}
+
+typedef struct Index {
+	const char *name;
+	void (*use)(cpSpace *space);
+	// Print the cpSpaceHashStats of the active shapes.
+	cpBool stats;
+} Index;
+
+static Index indexes[] = {
+	{"cpBBTree", UseBBTree, cpFalse},
+	{"cpSpaceHash", UseSpaceHash, cpTrue},
+	{"cpHashAuto", UseSpaceHashAuto, cpTrue},
+	{"cpHashGrid", UseSpaceGrid, cpTrue},
+	{"cpSweep1D", UseSweep1D, cpFalse},
+	{"cpSweep2D", UseSweep2D, cpFalse},
+};
+
+//MARK: Scene Helpers
+
+// Every body of the scene, including sleeping ones, for the state hash.
+static cpArray *sceneBodies;
+
+static cpBody *
+AddBody(cpSpace *space, cpFloat mass, cpFloat moment, cpVect pos)
+{
+	cpBody *body = cpSpaceAddBody(space, cpBodyNew(mass, moment));
+	cpBodySetPos(body, pos);
+	cpArrayPush(sceneBodies, body);
+	
+	return body;
+}
+
+static cpBody *
+AddBox(cpSpace *space, cpFloat mass, cpFloat width, cpFloat height, cpVect pos)
+{
+	cpBody *body = AddBody(space, mass, cpMomentForBox(mass, width, height), pos);
+	
+	cpShape *shape = cpSpaceAddShape(space, cpBoxShapeNew(body, width, height));
+	cpShapeSetFriction(shape, 0.7f);
+	
+	return body;
+}
+
+static void
+AddGround(cpSpace *space, cpFloat width)
+{
+	cpShape *shape = cpSpaceAddShape(space, cpSegmentShapeNew(space->staticBody, cpv(-width, 0.0f), cpv(width, 0.0f), 0.0f));
+	cpShapeSetFriction(shape, 1.0f);
+}
+
+//MARK: Scenes
+
+typedef struct Scene {
+	const char *name;
+	void (*init)(cpSpace *space);
+	// Called before each step, may be NULL.
+	void (*update)(cpSpace *space, int step, cpFloat dt);
+} Scene;
+
+static void
+PyramidInit(cpSpace *space)
+{
+	space->iterations = 20;
+	space->gravity = cpv(0.0f, -100.0f);
+	AddGround(space, 1000.0f);
+	
+	int base = 40;
+	cpFloat size = 10.0f;
+	for(int row=0; row<base; row++){
+		for(int i=0; i<base - row; i++){
+			cpVect pos = cpv((i - (base - row - 1)*0.5f)*(size + 0.5f), (row + 0.5f)*size);
+			AddBox(space, 1.0f, size, size, pos);
+		}
+	}
+}
+
+static cpBody *logSmashBall;
+
+static void
+LogSmashInit(cpSpace *space)
+{
+	space->iterations = 10;
+	space->gravity = cpv(0.0f, -100.0f);
+	AddGround(space, 2000.0f);
+	
+	// A brick wall of logs, with the odd rows offset by half a log.
+	cpFloat length = 60.0f, thickness = 10.0f;
+	for(int row=0; row<40; row++){
+		cpFloat offset = (row&1 ? length*0.5f : 0.0f);
+		for(int i=0; i<8; i++){
+			cpVect pos = cpv((i - 4)*length + offset, (row + 0.5f)*thickness);
+			AddBox(space, 2.0f, length - 1.0f, thickness, pos);
+		}
+	}
+	
+	cpFloat radius = 30.0f;
+	logSmashBall = AddBody(space, 500.0f, cpMomentForCircle(500.0f, 0.0f, radius, cpvzero), cpv(-600.0f, 250.0f));
+	cpShape *shape = cpSpaceAddShape(space, cpCircleShapeNew(logSmashBall, radius, cpvzero));
+	cpShapeSetFriction(shape, 0.7f);
+	cpBodySetVel(logSmashBall, cpv(400.0f, 0.0f));
+}
+
+static cpBody *tumbleBox;
+
+static void
+TumbleInit(cpSpace *space)
+{
+	space->iterations = 10;
+	space->gravity = cpv(0.0f, -600.0f);
+	
+	// A rogue body that rotates the container, it's updated by TumbleUpdate().
+	tumbleBox = cpBodyNew(INFINITY, INFINITY);
+	cpBodySetAngVel(tumbleBox, 0.4f);
+	
+	cpFloat half = 300.0f;
+	cpVect corners[] = {cpv(-half, -half), cpv(-half, half), cpv(half, half), cpv(half, -half)};
+	for(int i=0; i<4; i++){
+		cpShape *shape = cpSpaceAddShape(space, cpSegmentShapeNew(tumbleBox, corners[i], corners[(i + 1)%4], 0.0f));
+		cpShapeSetFriction(shape, 1.0f);
+	}
+	
+	for(int i=0; i<1000; i++){
+		cpVect verts[6];
+		int count = 3 + i%4;
+		cpFloat radius = RandomFloat(6.0f, 10.0f);
+		for(int j=0; j<count; j++) verts[j] = cpvmult(cpvforangle(-2.0f*(cpFloat)M_PI*j/count), radius);
+		
+		cpVect pos = cpv((i%40 - 19.5f)*14.0f, (i/40 - 12.0f)*14.0f);
+		cpBody *body = AddBody(space, 1.0f, cpMomentForPoly(1.0f, count, verts, cpvzero), pos);
+		
+		cpShape *shape = cpSpaceAddShape(space, cpPolyShapeNew(body, count, verts, cpvzero));
+		cpShapeSetFriction(shape, 0.7f);
+	}
+}
+
+static void
+TumbleUpdate(cpSpace *space, int step, cpFloat dt)
+{
+	(void)space; (void)step;
+	cpBodyUpdatePosition(tumbleBox, dt);
+}
+
+static void
+ChainsInit(cpSpace *space)
+{
+	space->iterations = 30;
+	space->gravity = cpv(0.0f, -100.0f);
+	
+	cpFloat linkLength = 8.0f;
+	for(int chain=0; chain<20; chain++){
+		cpVect anchor = cpv((chain - 10)*30.0f, 400.0f);
+		cpBody *prev = space->staticBody;
+		
+		// The chains start out horizontal and swing through their neighbors.
+		for(int link=0; link<40; link++){
+			cpVect pos = cpvadd(anchor, cpv((link + 0.5f)*linkLength, 0.0f));
+			cpBody *body = AddBody(space, 1.0f, cpMomentForBox(1.0f, linkLength, 3.0f), pos);
+			
+			cpShape *shape = cpSpaceAddShape(space, cpBoxShapeNew(body, linkLength, 3.0f));
+			cpShapeSetFriction(shape, 0.5f);
+			cpShapeSetGroup(shape, chain + 1);
+			
+			cpVect pivot = cpvadd(anchor, cpv(link*linkLength, 0.0f));
+			cpSpaceAddConstraint(space, cpPivotJointNew(prev, body, pivot));
+			prev = body;
+		}
+	}
+}
+
+static void
+SleepingInit(cpSpace *space)
+{
+	space->iterations = 10;
+	space->gravity = cpv(0.0f, -100.0f);
+	space->sleepTimeThreshold = 0.5f;
+	AddGround(space, 2000.0f);
+	
+	for(int i=0; i<1500; i++){
+		cpVect pos = cpv((i%60 - 29.5f)*22.0f + RandomFloat(-2.0f, 2.0f), 10.0f + (i/60)*21.0f);
+		AddBox(space, 1.0f, 20.0f, 20.0f, pos);
+	}
+}
+
+// Every second, poke a few bodies so parts of the crowd wake up again.
+static void
+SleepingUpdate(cpSpace *space, int step, cpFloat dt)
+{
+	(void)space; (void)dt;
+	
+	if(step%60 != 59) return;
+	
+	for(int i=0; i<5; i++){
+		cpBody *body = (cpBody *)sceneBodies->arr[(int)RandomFloat(0.0f, (cpFloat)sceneBodies->num - 0.5f)];
+		cpBodyActivate(body);
+		cpBodyApplyImpulse(body, cpv(RandomFloat(-50.0f, 50.0f), 200.0f), cpvzero);
+	}
+}
+
+static Scene scenes[] = {
+	{"pyramid", PyramidInit, NULL},
+	{"logsmash", LogSmashInit, NULL},
+	{"tumble", TumbleInit, TumbleUpdate},
+	{"chains", ChainsInit, NULL},
+	{"sleeping", SleepingInit, SleepingUpdate},
+};
+
+//MARK: Running
+
+static unsigned long long
+HashBodies(void)
+{
+	unsigned long long hash = 14695981039346656037ULL;
+	
+	for(int i=0; i<sceneBodies->num; i++){
+		cpBody *body = (cpBody *)sceneBodies->arr[i];
+		// Adding zero turns -0 into 0.
+		cpFloat values[6] = {body->p.x, body->p.y, body->v.x, body->v.y, body->a + 0.0f, body->w + 0.0f};
+		
+		const unsigned char *bytes = (const unsigned char *)values;
+		for(size_t j=0; j<sizeof(values); j++){
+			hash ^= bytes[j];
+			hash *= 1099511628211ULL;
+		}
+	}
+	
+	return hash;
+}
+
+static void PushObject(void *obj, cpArray *arr){cpArrayPush(arr, obj);}
+
+static void
+FreeScene(cpSpace *space)
+{
+	// cpSpaceFree() wakes up the sleeping bodies, so free the space before its contents.
+	cpArray *shapes = cpArrayNew(0), *constraints = cpArrayNew(0);
+	cpSpaceEachShape(space, (cpSpaceShapeIteratorFunc)PushObject, shapes);
+	cpSpaceEachConstraint(space, (cpSpaceConstraintIteratorFunc)PushObject, constraints);
+	cpSpaceFree(space);
+	
+	cpArrayFreeEach(constraints, (void (*)(void *))cpConstraintFree);
+	cpArrayFreeEach(shapes, (void (*)(void *))cpShapeFree);
+	cpArrayFreeEach(sceneBodies, (void (*)(void *))cpBodyFree);
+	cpArrayFree(constraints);
+	cpArrayFree(shapes);
+	cpArrayFree(sceneBodies);
+	
+	if(tumbleBox){
+		cpBodyFree(tumbleBox);
+		tumbleBox = NULL;
+	}
+}
+
+// Runs a scene and returns the hash of the final state.
+// Uses ProfiledStep() if timings is not NULL and fills in stats if the index has them.
+static unsigned long long
+RunScene(Scene *scene, Index *index, int steps, Timings *timings, double *time, int *bodyCount, cpSpaceHashStats *stats)
+{
+	// Shape hash ids decide the iteration order of the spatial indexes.
+	cpResetShapeIdCounter();
+	seed = 12345;
+	sceneBodies = cpArrayNew(0);
+	
+	cpSpace *space = cpSpaceNew();
+	index->use(space);
+	scene->init(space);
+	(*bodyCount) = sceneBodies->num;
+	
+	cpFloat dt = 1.0f/60.0f;
+	double start = Now();
+	for(int step=0; step<steps; step++){
+		if(scene->update) scene->update(space, step, dt);
+		
+		if(timings){
+			ProfiledStep(space, dt, timings);
+		} else {
+			cpSpaceStep(space, dt);
+		}
+	}
+	(*time) = Now() - start;
+	
+	unsigned long long hash = HashBodies();
+	if(index->stats) cpSpaceHashGetStats(space->activeShapes, stats);
+	FreeScene(space);
+	
+	return hash;
+}
+
+int
+main(int argc, char **argv)
+{
+	int steps = (argc > 1 ? atoi(argv[1]) : 600);
+	const char *sceneName = (argc > 2 && strcmp(argv[2], "all") ? argv[2] : NULL);
+	const char *indexName = (argc > 3 && strcmp(argv[3], "all") ? argv[3] : NULL);
+	
+	printf("CP_USE_DOUBLES %d, %d steps, phase times in ms per step\n", CP_USE_DOUBLES, steps);
+	printf("%-9s %-12s %6s %9s %9s %10s %10s %9s %9s %16s %s\n",
+		"scene", "index", "bodies", "steps/s", "integrate", "broadphase", "components", "prestep", "solve", "hash", "check"
+	);
+	
+	for(size_t i=0; i<sizeof(scenes)/sizeof(*scenes); i++){
+		Scene *scene = scenes + i;
+		if(sceneName && strcmp(sceneName, scene->name)) continue;
+		
+		for(size_t j=0; j<sizeof(indexes)/sizeof(*indexes); j++){
+			Index *index = indexes + j;
+			if(indexName && strcmp(indexName, index->name)) continue;
+			
+			double time, profiledTime;
+			int bodyCount;
+			cpSpaceHashStats stats;
+			unsigned long long hash = RunScene(scene, index, steps, NULL, &time, &bodyCount, &stats);
+			
+			Timings timings = {};
+			unsigned long long profiledHash = RunScene(scene, index, steps, &timings, &profiledTime, &bodyCount, &stats);
+			
+			printf("%-9s %-12s %6d %9.1f %9.3f %10.3f %10.3f %9.3f %9.3f %016llx %s\n",
+				scene->name, index->name, bodyCount, steps/time*1e3,
+				timings.integrate/steps, timings.broadphase/steps, timings.components/steps,
+				timings.prestep/steps, timings.solve/steps,
+				hash, (hash == profiledHash ? "ok" : "MISMATCH")
+			);
+			
+			if(index->stats){
+				printf("%22s cells %d, dim %.1f, occupancy %.2f, longest chain %d, colliding cells %d, resizes %d\n", "",
+					stats.numcells, stats.celldim, stats.averageOccupancy, stats.longestChain, stats.collidingCells, stats.autoResizes
+				);
+			}
+		}
+	}
+	
+	return 0;
+}
@@ -0,0 +1,260 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Compares cpBBTree, cpSpaceHash, cpSweep1D and cpSweep2D on synthetic
+// workloads. Every step moves the objects and runs a reindex query, which
+// is what cpSpaceStep() does with the active shapes.
+//   stacked    tall columns of boxes that jitter in place
+//   scattered  boxes spread over a square, drifting in random directions
+//   streaming  boxes are added at the top, fall and are removed at the bottom
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "chipmunk.h"
+
+typedef struct Object {
+	cpBB bb;
+	cpVect v;
+	cpHashValue hashid;
+	cpBool active;
+} Object;
+
+typedef struct Workload {
+	const char *name;
+	int count;
+	void (*init)(Object *objects, int count);
+	// Returns the number of objects to remove from the end
+	// and the number to add back there, in that order.
+	void (*step)(Object *objects, int count, int *removed, int *added);
+} Workload;
+
+static unsigned int seed = 12345;
+
+// A small deterministic generator, so all runs use the same scene.
+static cpFloat
+RandomFloat(cpFloat lo, cpFloat hi)
+{
+	seed = 1664525*seed + 1013904223;
+	cpFloat r = (cpFloat)(seed >> 8)/(cpFloat)(1 << 24);
+	return lo + r*(hi - lo);
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+static cpBB ObjectBB(Object *obj){return obj->bb;}
+
+static void
+MoveObject(Object *obj, cpVect d)
+{
+	obj->bb = cpBBNew(obj->bb.l + d.x, obj->bb.b + d.y, obj->bb.r + d.x, obj->bb.t + d.y);
+}
+
+//MARK: Workloads
+
+#define STACK_HEIGHT 100
+
+static void
+StackedInit(Object *objects, int count)
+{
+	for(int i=0; i<count; i++){
+		cpFloat x = (i/STACK_HEIGHT)*30.0f, y = (i%STACK_HEIGHT)*10.0f;
+		objects[i].bb = cpBBNew(x - 5.0f, y - 5.0f, x + 5.0f, y + 5.0f);
+	}
+}
+
+static void
+StackedStep(Object *objects, int count, int *removed, int *added)
+{
+	for(int i=0; i<count; i++) MoveObject(objects + i, cpv(RandomFloat(-0.05f, 0.05f), RandomFloat(-0.05f, 0.05f)));
+	*removed = *added = 0;
+}
+
+static void
+ScatteredInit(Object *objects, int count)
+{
+	cpFloat extent = 10.0f*cpfsqrt(count);
+	for(int i=0; i<count; i++){
+		cpVect p = cpv(RandomFloat(-extent, extent), RandomFloat(-extent, extent));
+		cpFloat r = RandomFloat(2.0f, 8.0f);
+		objects[i].bb = cpBBNew(p.x - r, p.y - r, p.x + r, p.y + r);
+		objects[i].v = cpv(RandomFloat(-1.0f, 1.0f), RandomFloat(-1.0f, 1.0f));
+	}
+}
+
+static void
+ScatteredStep(Object *objects, int count, int *removed, int *added)
+{
+	for(int i=0; i<count; i++) MoveObject(objects + i, objects[i].v);
+	*removed = *added = 0;
+}
+
+#define STREAM_TOP 2000.0f
+
+static void
+StreamObject(Object *obj)
+{
+	cpFloat x = RandomFloat(-500.0f, 500.0f), r = RandomFloat(2.0f, 8.0f);
+	obj->bb = cpBBNew(x - r, STREAM_TOP - r, x + r, STREAM_TOP + r);
+	obj->v = cpv(0.0f, -RandomFloat(4.0f, 6.0f));
+}
+
+static void
+StreamingInit(Object *objects, int count)
+{
+	// Start with a full column so the count stays roughly constant.
+	for(int i=0; i<count; i++){
+		StreamObject(objects + i);
+		MoveObject(objects + i, cpv(0.0f, -STREAM_TOP*i/count));
+	}
+}
+
+static void
+StreamingStep(Object *objects, int count, int *removed, int *added)
+{
+	for(int i=0; i<count; i++) MoveObject(objects + i, objects[i].v);
+	
+	// Recycle the objects that fell out at the bottom.
+	int n = 0;
+	for(int i=0; i<count; i++) if(objects[i].bb.t < 0.0f) n++;
+	*removed = *added = n;
+}
+
+static Workload workloads[] = {
+	{"stacked", 2000, StackedInit, StackedStep},
+	{"scattered", 2000, ScatteredInit, ScatteredStep},
+	{"streaming", 2000, StreamingInit, StreamingStep},
+};
+
+//MARK: Indexes
+
+typedef struct IndexType {
+	const char *name;
+	cpSpatialIndex *(*make)(cpSpatialIndex *staticIndex);
+} IndexType;
+
+static cpSpatialIndex *MakeBBTree(cpSpatialIndex *staticIndex){return cpBBTreeNew((cpSpatialIndexBBFunc)ObjectBB, staticIndex);}
+static cpSpatialIndex *MakeSpaceHash(cpSpatialIndex *staticIndex){return cpSpaceHashNew(20.0f, 20000, (cpSpatialIndexBBFunc)ObjectBB, staticIndex);}
+static cpSpatialIndex *MakeSweep1D(cpSpatialIndex *staticIndex){return cpSweep1DNew((cpSpatialIndexBBFunc)ObjectBB, staticIndex);}
+static cpSpatialIndex *MakeSweep2D(cpSpatialIndex *staticIndex){return cpSweep2DNew((cpSpatialIndexBBFunc)ObjectBB, staticIndex);}
+
+static IndexType indexTypes[] = {
+	{"cpBBTree", MakeBBTree},
+	{"cpSpaceHash", MakeSpaceHash},
+	{"cpSweep1D", MakeSweep1D},
+	{"cpSweep2D", MakeSweep2D},
+};
+
+//MARK: Benchmark
+
+// Only count the pairs that really overlap, the indexes may report extra candidates.
+// cpBBTree queries also report the query object itself.
+static void
+CountPair(Object *a, Object *b, int *pairs)
+{
+	if(a != b && cpBBIntersects(a->bb, b->bb)) (*pairs)++;
+}
+
+static void
+Run(Workload *workload, IndexType *type, int steps)
+{
+	int count = workload->count;
+	Object *objects = (Object *)calloc(count, sizeof(Object));
+	
+	seed = 12345;
+	workload->init(objects, count);
+	
+	double start = Now();
+	
+	// Like a cpSpace, the active index collides against an empty static one.
+	cpSpatialIndex *staticIndex = type->make(NULL);
+	cpSpatialIndex *index = type->make(staticIndex);
+	for(int i=0; i<count; i++){
+		objects[i].hashid = (cpHashValue)i;
+		cpSpatialIndexInsert(index, objects + i, objects[i].hashid);
+	}
+	
+	double insert = Now() - start;
+	cpHashValue nextHashid = count;
+	
+	int pairs = 0;
+	double reindex = 0.0, query = 0.0;
+	for(int step=0; step<steps; step++){
+		int removed, added;
+		workload->step(objects, count, &removed, &added);
+		
+		start = Now();
+		
+		// Streamed objects are replaced in place by new ones.
+		if(removed){
+			for(int i=0; i<count; i++){
+				Object *obj = objects + i;
+				if(obj->bb.t >= 0.0f) continue;
+				
+				cpSpatialIndexRemove(index, obj, obj->hashid);
+				StreamObject(obj);
+				obj->hashid = nextHashid++;
+				cpSpatialIndexInsert(index, obj, obj->hashid);
+			}
+		}
+		
+		cpSpatialIndexReindexQuery(index, (cpSpatialIndexQueryFunc)CountPair, &pairs);
+		reindex += Now() - start;
+		
+		// A handful of region queries, like sensors or picking.
+		start = Now();
+		for(int i=0; i<count; i+=20){
+			cpBB bb = objects[i].bb;
+			cpSpatialIndexQuery(index, objects + i, cpBBNew(bb.l - 10.0f, bb.b - 10.0f, bb.r + 10.0f, bb.t + 10.0f), (cpSpatialIndexQueryFunc)CountPair, &pairs);
+		}
+		query += Now() - start;
+	}
+	
+	printf("%-10s %-12s %7d %6d %10.3f %10.3f %10.3f %10d\n", workload->name, type->name, count, steps, insert, reindex, query, pairs);
+	
+	cpSpatialIndexFree(index);
+	cpSpatialIndexFree(staticIndex);
+	free(objects);
+}
+
+int
+main(int argc, char **argv)
+{
+	int steps = (argc > 1 ? atoi(argv[1]) : 200);
+	
+	printf("%-10s %-12s %7s %6s %10s %10s %10s %10s\n", "workload", "index", "objects", "steps", "insert ms", "step ms", "query ms", "pairs");
+	
+	int numWorkloads = sizeof(workloads)/sizeof(*workloads);
+	int numTypes = sizeof(indexTypes)/sizeof(*indexTypes);
+	for(int i=0; i<numWorkloads; i++){
+		for(int j=0; j<numTypes; j++) Run(workloads + i, indexTypes + j, steps);
+	}
+	
+	return 0;
+}
@@ -71,6 +71,12 @@ cpArbiterNext(cpArbiter *node, cpBody *body)
 
 //MARK: cpHashSet
 
+// Define CP_USE_FLAT_HASH_SET to 1 to build cpHashSet as a flat open addressing table (cpHashSetFlat.c)
+// instead of the chained table in cpHashSet.c. Both have the same API, but iterate in a different order.
+#ifndef CP_USE_FLAT_HASH_SET
+	#define CP_USE_FLAT_HASH_SET 0
+#endif
+
 typedef cpBool (*cpHashSetEqlFunc)(void *ptr, void *elt);
 typedef void *(*cpHashSetTransFunc)(void *ptr, void *data);
 
@@ -148,6 +154,21 @@ cpPolyShapeValueOnAxis(const cpPolyShape *poly, const cpVect n, const cpFloat d)
 	return min - d;
 }
 
+// Polygons keep SoA copies of their transformed vertexes and planes (cpPolyShape.tSoA)
+// for the four wide kernels in cpCollision.c. Define CP_NO_SIMD to use the scalar code only.
+#ifndef CP_NO_SIMD
+	#define CP_POLY_SOA 1
+#else
+	#define CP_POLY_SOA 0
+#endif
+
+// Length of each of the SoA arrays of a polygon.
+static inline int
+cpPolyShapeSoACount(const cpPolyShape *poly)
+{
+	return (poly->numVerts + 3)&~3;
+}
+
 static inline cpBool
 cpPolyShapeContainsVert(const cpPolyShape *poly, const cpVect v)
 {
@@ -179,12 +200,22 @@ cpPolyShapeContainsVertPartial(const cpPolyShape *poly, const cpVect v, const cp
 
 cpSpatialIndex *cpSpatialIndexInit(cpSpatialIndex *index, cpSpatialIndexClass *klass, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
 
+// Add the bytes in the node and pair pools of a cpBBTree to live and pooled. Other indexes are ignored.
+void cpBBTreeGetPoolBytes(cpSpatialIndex *index, size_t *live, size_t *pooled);
+// Add the bytes in the handle and bin pools of a cpSpaceHash to live and pooled. Other indexes are ignored.
+void cpSpaceHashGetPoolBytes(cpSpatialIndex *index, size_t *live, size_t *pooled);
+
 //MARK: Space Functions
 
 extern cpCollisionHandler cpDefaultCollisionHandler;
 void cpSpaceProcessComponents(cpSpace *space, cpFloat dt);
 
+void *cpSpaceAllocPooled(cpSpace *space, size_t size);
+void cpSpaceFreePooled(cpSpace *space, void *ptr, size_t size);
+void cpSpaceFreeContactBuffers(cpSpace *space);
+
 void cpSpacePushFreshContactBuffer(cpSpace *space);
+void cpSpaceSortArbiters(cpSpace *space);
 cpContact *cpContactBufferGetArray(cpSpace *space);
 void cpSpacePushContacts(cpSpace *space, int count);
 
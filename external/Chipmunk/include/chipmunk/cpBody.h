@@ -97,6 +97,9 @@ struct cpBody {
 	CP_PRIVATE(cpConstraint *constraintList);
 	
 	CP_PRIVATE(cpComponentNode node);
+	
+	/// Solver colors used by the neighbouring constraints, see cpHastySpace.
+	CP_PRIVATE(uint64_t solverColors);
 };
 
 /// Allocate a cpBody.
@@ -0,0 +1,68 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIPMUNK_HASTY_SPACE_HEADER
+#define CHIPMUNK_HASTY_SPACE_HEADER
+
+/// @defgroup cpHastySpace cpHastySpace
+/// cpHastySpace is a cpSpace that runs its impulse solver on several threads.
+/// Arbiters and constraints are split into colors that share no dynamic bodies,
+/// each color is solved in parallel and the threads meet at a barrier before
+/// the next one. The result does not depend on the number of threads, but the
+/// solver order differs from cpSpaceStep() so the two do not match bit for bit.
+/// The default cpBBTree spatial index also updates and queries its leaves on
+/// the same threads, see cpBBTreeSetParallelFunc(). The batched queries such
+/// as cpSpaceSegmentQueryFirstBatch() use them as well.
+/// Include this header explicitly, it is not part of chipmunk.h.
+/// @{
+
+#include "chipmunk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/// Maximum number of threads a cpHastySpace will use, including the calling thread.
+#define CP_HASTY_MAX_THREADS 16
+
+/// Allocate and initialize a cpHastySpace. Free it with cpHastySpaceFree().
+/// All the regular cpSpace functions may be used on the returned space.
+cpSpace *cpHastySpaceNew(void);
+/// Destroy and free a cpHastySpace.
+void cpHastySpaceFree(cpSpace *space);
+
+/// Set the number of threads, including the calling thread.
+/// Zero uses one thread per processor. Defaults to 1.
+/// Platforms without pthreads always solve on the calling thread.
+void cpHastySpaceSetThreads(cpSpace *space, unsigned long threads);
+/// Get the number of threads, including the calling thread.
+unsigned long cpHastySpaceGetThreads(cpSpace *space);
+
+/// Step the space forward in time by @c dt. Use this instead of cpSpaceStep().
+void cpHastySpaceStep(cpSpace *space, cpFloat dt);
+
+#ifdef __cplusplus
+}
+#endif
+
+/// @}
+
+#endif
@@ -35,6 +35,11 @@ typedef struct cpPolyShape {
 	int numVerts;
 	cpVect *verts, *tVerts;
 	cpSplittingPlane *planes, *tPlanes;
+	
+	// Transformed vertexes and planes in SoA form for the four wide collision
+	// functions: x, y, n.x, n.y and d arrays padded to a multiple of four.
+	// NULL when Chipmunk is compiled with CP_NO_SIMD.
+	cpFloat *tSoA;
 } cpPolyShape;
 
 /// Allocate a polygon shape.
@@ -25,6 +25,11 @@
 typedef struct cpContactBufferHeader cpContactBufferHeader;
 typedef void (*cpSpaceArbiterApplyImpulseFunc)(cpArbiter *arb);
 
+/// Allocation function for the pooled memory of a space, see cpSpaceSetAllocator().
+typedef void *(*cpSpaceAllocFunc)(size_t size, void *data);
+/// Free function for the pooled memory of a space. @c size is the size the block was allocated with.
+typedef void (*cpSpaceFreeFunc)(void *ptr, size_t size, void *data);
+
 /// Basic Unit of Simulation in Chipmunk
 struct cpSpace {
 	/// Number of iterations to use in the impulse solver to solve contacts.
@@ -92,8 +97,12 @@ struct cpSpace {
 	CP_PRIVATE(cpHashSet *cachedArbiters);
 	CP_PRIVATE(cpArray *pooledArbiters);
 	CP_PRIVATE(cpArray *constraints);
+	CP_PRIVATE(cpBool sortArbiters);
 	
 	CP_PRIVATE(cpArray *allocatedBuffers);
+	CP_PRIVATE(cpSpaceAllocFunc allocFunc);
+	CP_PRIVATE(cpSpaceFreeFunc freeFunc);
+	CP_PRIVATE(void *allocData);
 	CP_PRIVATE(int locked);
 	
 	CP_PRIVATE(cpHashSet *collisionHandlers);
@@ -117,6 +126,12 @@ void cpSpaceDestroy(cpSpace *space);
 /// Destroy and free a cpSpace.
 void cpSpaceFree(cpSpace *space);
 
+/// Set the functions used to allocate the pooled memory of a space: the contact buffers,
+/// the arbiters and the contacts saved for sleeping arbiters. The spatial indexes and arrays
+/// still use cpcalloc(). Allocated blocks don't need to be cleared, the space does that itself.
+/// Must be called before the space is first stepped. Passing NULL functions restores cpcalloc() and cpfree().
+void cpSpaceSetAllocator(cpSpace *space, cpSpaceAllocFunc allocFunc, cpSpaceFreeFunc freeFunc, void *data);
+
 #define CP_DefineSpaceStructGetter(type, member, name) \
 static inline type cpSpaceGet##name(const cpSpace *space){return space->member;}
 
@@ -213,6 +228,9 @@ typedef void (*cpSpacePointQueryFunc)(cpShape *shape, void *data);
 void cpSpacePointQuery(cpSpace *space, cpVect point, cpLayers layers, cpGroup group, cpSpacePointQueryFunc func, void *data);
 /// Query the space at a point and return the first shape found. Returns NULL if no shapes were found.
 cpShape *cpSpacePointQueryFirst(cpSpace *space, cpVect point, cpLayers layers, cpGroup group);
+/// Batched version of cpSpacePointQueryFirst(). Stores the result for @c points[i] in @c out[i].
+/// The queries run in packets through the spatial indexes and on several threads when the space has them (see cpHastySpace.h).
+void cpSpacePointQueryFirstBatch(cpSpace *space, int count, const cpVect *points, cpLayers layers, cpGroup group, cpShape **out);
 
 /// Nearest point query callback function type.
 typedef void (*cpSpaceNearestPointQueryFunc)(cpShape *shape, cpFloat distance, cpVect point, void *data);
@@ -220,6 +238,8 @@ typedef void (*cpSpaceNearestPointQueryFunc)(cpShape *shape, cpFloat distance, c
 void cpSpaceNearestPointQuery(cpSpace *space, cpVect point, cpFloat maxDistance, cpLayers layers, cpGroup group, cpSpaceNearestPointQueryFunc func, void *data);
 /// Query the space at a point and return the nearest shape found. Returns NULL if no shapes were found.
 cpShape *cpSpaceNearestPointQueryNearest(cpSpace *space, cpVect point, cpFloat maxDistance, cpLayers layers, cpGroup group, cpNearestPointQueryInfo *out);
+/// Batched version of cpSpaceNearestPointQueryNearest(). Stores the result for @c points[i] in @c out[i].
+void cpSpaceNearestPointQueryNearestBatch(cpSpace *space, int count, const cpVect *points, cpFloat maxDistance, cpLayers layers, cpGroup group, cpNearestPointQueryInfo *out);
 
 /// Segment query callback function type.
 typedef void (*cpSpaceSegmentQueryFunc)(cpShape *shape, cpFloat t, cpVect n, void *data);
@@ -227,12 +247,17 @@ typedef void (*cpSpaceSegmentQueryFunc)(cpShape *shape, cpFloat t, cpVect n, voi
 void cpSpaceSegmentQuery(cpSpace *space, cpVect start, cpVect end, cpLayers layers, cpGroup group, cpSpaceSegmentQueryFunc func, void *data);
 /// Perform a directed line segment query (like a raycast) against the space and return the first shape hit. Returns NULL if no shapes were hit.
 cpShape *cpSpaceSegmentQueryFirst(cpSpace *space, cpVect start, cpVect end, cpLayers layers, cpGroup group, cpSegmentQueryInfo *out);
+/// Batched version of cpSpaceSegmentQueryFirst(). Stores the result for the segment from @c starts[i] to @c ends[i] in @c out[i].
+void cpSpaceSegmentQueryFirstBatch(cpSpace *space, int count, const cpVect *starts, const cpVect *ends, cpLayers layers, cpGroup group, cpSegmentQueryInfo *out);
 
 /// Rectangle Query callback function type.
 typedef void (*cpSpaceBBQueryFunc)(cpShape *shape, void *data);
 /// Perform a fast rectangle query on the space calling @c func for each shape found.
 /// Only the shape's bounding boxes are checked for overlap, not their full shape.
 void cpSpaceBBQuery(cpSpace *space, cpBB bb, cpLayers layers, cpGroup group, cpSpaceBBQueryFunc func, void *data);
+/// Batched version of cpSpaceBBQuery(). The shapes found for @c bbs[i] are stored in @c shapes[i*maxShapes] onwards
+/// and their number in @c counts[i]. A count larger than @c maxShapes means the extra shapes were dropped.
+void cpSpaceBBQueryBatch(cpSpace *space, int count, const cpBB *bbs, cpLayers layers, cpGroup group, cpShape **shapes, int maxShapes, int *counts);
 
 /// Shape query callback function type.
 typedef void (*cpSpaceShapeQueryFunc)(cpShape *shape, cpContactPointSet *points, void *data);
@@ -267,6 +292,30 @@ void cpSpaceReindexShapesForBody(cpSpace *space, cpBody *body);
 
 /// Switch the space to use a spatial has as it's spatial index.
 void cpSpaceUseSpatialHash(cpSpace *space, cpFloat dim, int count);
+/// Switch the space to use a dense grid covering @c bounds as it's spatial index. See cpSpaceHashNewGrid().
+void cpSpaceUseSpatialGrid(cpSpace *space, cpBB bounds, cpFloat dim);
+
+/// Memory used by a space in bytes, see cpSpaceGetMemoryStats().
+/// Live memory is in use or may still be referenced by the collision cache.
+/// Pooled memory is unused and will be reused before more is allocated.
+typedef struct cpSpaceMemoryStats {
+	/// Contact buffers.
+	size_t contactsLive, contactsPooled;
+	/// Arbiters.
+	size_t arbitersLive, arbitersPooled;
+	/// Contacts saved for the arbiters of sleeping bodies.
+	size_t sleepingContacts;
+	/// Nodes, pairs, handles and bins of the spatial indexes.
+	size_t indexLive, indexPooled;
+} cpSpaceMemoryStats;
+
+/// Get the memory used by the pools of a space.
+void cpSpaceGetMemoryStats(cpSpace *space, cpSpaceMemoryStats *stats);
+/// Release the pooled contact buffers and arbiters that are completely unused,
+/// for instance after a spike in the number of collisions.
+/// The pools of the spatial indexes are kept. Snapshots captured before trimming must not be restored.
+/// Must not be called from a callback while the space is locked.
+void cpSpaceTrimMemory(cpSpace *space);
 
 /// Step the space forward in time by @c dt.
 void cpSpaceStep(cpSpace *space, cpFloat dt);
@@ -0,0 +1,75 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef CHIPMUNK_SPACE_SNAPSHOT_HEADER
+#define CHIPMUNK_SPACE_SNAPSHOT_HEADER
+
+/// @defgroup cpSpaceSnapshot cpSpaceSnapshot
+/// A cpSpaceSnapshot captures the simulation state of a space so it can be rolled back later.
+/// It holds the body states, the sleeping components, the constraint state, the cached
+/// arbiters with their contacts and accumulated impulses and the contact graph.
+/// Restoring writes the state back into the existing bodies, constraints and arbiters.
+///
+/// A snapshot refers to the objects by address. It can only be restored into the space it was
+/// captured from and that space must hold the same bodies, shapes and constraints again.
+/// Remove anything added after the capture before restoring. Rogue bodies are not part of the
+/// snapshot and must be restored by the caller.
+///
+/// Capturing a snapshot makes the space sort its arbiters after the collision detection of
+/// each step, so the solver order doesn't depend on the history of the spatial index.
+/// With that, stepping a restored space gives the same results as the original steps.
+/// Include this header explicitly, it is not part of chipmunk.h.
+/// @{
+
+#include "chipmunk.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct cpSpaceSnapshot cpSpaceSnapshot;
+
+/// Allocate an empty snapshot.
+cpSpaceSnapshot *cpSpaceSnapshotNew(void);
+/// Free a snapshot.
+void cpSpaceSnapshotFree(cpSpaceSnapshot *snapshot);
+
+/// Capture the state of @c space, reusing the snapshot's memory.
+/// Must not be called from a callback while the space is locked.
+void cpSpaceSnapshotCapture(cpSpaceSnapshot *snapshot, cpSpace *space);
+/// Restore the state of @c space that was captured in @c snapshot.
+/// Must not be called from a callback while the space is locked.
+void cpSpaceSnapshotRestore(cpSpaceSnapshot *snapshot, cpSpace *space);
+
+/// Size in bytes of the captured data.
+size_t cpSpaceSnapshotGetSize(cpSpaceSnapshot *snapshot);
+/// Captured data. It can be copied elsewhere and loaded again with cpSpaceSnapshotSetData().
+const void *cpSpaceSnapshotGetData(cpSpaceSnapshot *snapshot);
+/// Replace the captured data with a copy of data previously returned by cpSpaceSnapshotGetData().
+void cpSpaceSnapshotSetData(cpSpaceSnapshot *snapshot, const void *data, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
+
+/// @}
+
+#endif
@@ -81,6 +81,40 @@ cpSpatialIndex* cpSpaceHashNew(cpFloat celldim, int cells, cpSpatialIndexBBFunc
 /// Some trial and error is required to find the optimum numbers for efficiency.
 void cpSpaceHashResize(cpSpaceHash *hash, cpFloat celldim, int numcells);
 
+/// Initialize a spatial hash that uses a dense grid of cells covering @c bounds instead of a hash table.
+/// Works best for bounded worlds such as tile maps. Objects outside of the bounds are kept in the border cells.
+cpSpatialIndex* cpSpaceHashInitGrid(cpSpaceHash *hash, cpBB bounds, cpFloat celldim, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
+/// Allocate and initialize a dense grid spatial hash.
+cpSpatialIndex* cpSpaceHashNewGrid(cpBB bounds, cpFloat celldim, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
+
+/// Let the spatial hash tune its cell size and table size.
+/// The sizes of the objects are sampled whenever all of them are rehashed, every step for the active shapes.
+/// The hash resizes itself when the average object size or the number of objects drift too far from the current settings.
+/// Dense grids only change their cell size.
+void cpSpaceHashSetAutoResize(cpSpatialIndex *index, cpBool autoResize);
+
+/// Spatial hash statistics, see cpSpaceHashGetStats().
+typedef struct cpSpaceHashStats {
+	/// Number of cells in the table and the cell size.
+	int numcells;
+	cpFloat celldim;
+	/// Number of objects and the number of cell entries they use.
+	int objects, entries;
+	/// Number of cells holding entries and the average number of entries in them.
+	int usedCells;
+	cpFloat averageOccupancy;
+	/// Number of entries in the longest cell chain.
+	int longestChain;
+	/// Number of table cells shared by different grid cells because of hash collisions. Always 0 for dense grids.
+	int collidingCells;
+	/// Number of times the hash resized itself.
+	int autoResizes;
+} cpSpaceHashStats;
+
+/// Gather the occupancy and collision statistics of a spatial hash.
+/// This walks the whole table and is meant for tuning and debugging.
+void cpSpaceHashGetStats(cpSpatialIndex *index, cpSpaceHashStats *stats);
+
 //MARK: AABB Tree
 
 typedef struct cpBBTree cpBBTree;
@@ -101,6 +135,38 @@ typedef cpVect (*cpBBTreeVelocityFunc)(void *obj);
 /// Set the velocity function for the bounding box tree to enable temporal coherence.
 void cpBBTreeSetVelocityFunc(cpSpatialIndex *index, cpBBTreeVelocityFunc func);
 
+/// Bounding box tree parallel work function, see cpBBTreeParallelFunc.
+typedef void (*cpBBTreeParallelWorkFunc)(void *data, int item);
+/// Bounding box tree parallel callback function type.
+/// It must call @c work(data, item) once for every item in [0, count), possibly on several threads at once,
+/// and return when all of them have finished.
+typedef void (*cpBBTreeParallelFunc)(cpBBTreeParallelWorkFunc work, void *data, int count, void *context);
+/// Set a function to run parts of the reindex query in parallel. Pass NULL to go back to a single thread.
+/// Leaf updates and the pair queries of moved leaves run in parallel. The query callbacks are still called
+/// from the calling thread in the same order as the serial version.
+/// The spatial index bounding box and the velocity functions must be safe to call from any thread.
+void cpBBTreeSetParallelFunc(cpSpatialIndex *index, cpBBTreeParallelFunc func, void *context);
+/// Call @c work(data, item) for every item in [0, count) using the parallel function of the tree.
+/// Runs the items on the calling thread if the tree has no parallel function or @c index is not a tree.
+void cpBBTreeRunParallel(cpSpatialIndex *index, cpBBTreeParallelWorkFunc work, void *data, int count);
+
+/// Maximum number of queries in a packet query.
+#define CP_BBTREE_PACKET_SIZE 32
+
+/// Bounding box tree packet query callback function type. @c item is the index of the query in the packet.
+typedef void (*cpBBTreePacketQueryFunc)(void *obj1, void *obj2, int item, void *data);
+/// Bounding box tree packet segment query callback function type. Returns the new exit time of query @c item.
+typedef cpFloat (*cpBBTreePacketSegmentQueryFunc)(void *obj1, void *obj2, int item, void *data);
+
+/// Query a packet of up to CP_BBTREE_PACKET_SIZE bounding boxes in a single traversal of the tree.
+/// @c func is called for each item in the same order as a cpSpatialIndexQuery() for that item would.
+/// Falls back to one query per item if @c index is not a tree.
+void cpBBTreeQueryPacket(cpSpatialIndex *index, void *obj, int count, const cpBB *bbs, cpBBTreePacketQueryFunc func, void *data);
+/// Query a packet of up to CP_BBTREE_PACKET_SIZE segments in a single traversal of the tree.
+/// @c t_exit holds the exit time of each segment and is updated with the results of @c func.
+/// Falls back to one query per item if @c index is not a tree.
+void cpBBTreeSegmentQueryPacket(cpSpatialIndex *index, void *obj, int count, const cpVect *a, const cpVect *b, cpFloat *t_exit, cpBBTreePacketSegmentQueryFunc func, void *data);
+
 //MARK: Single Axis Sweep
 
 typedef struct cpSweep1D cpSweep1D;
@@ -112,6 +178,19 @@ cpSpatialIndex* cpSweep1DInit(cpSweep1D *sweep, cpSpatialIndexBBFunc bbfunc, cpS
 /// Allocate and initialize a 1D sort and sweep broadphase.
 cpSpatialIndex* cpSweep1DNew(cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
 
+//MARK: Two Axis Sweep
+
+typedef struct cpSweep2D cpSweep2D;
+
+/// Allocate a 2D sweep and prune broadphase.
+/// It keeps both axes sorted between steps and tracks the overlapping pairs incrementally,
+/// so it works best when most objects move a little each step.
+cpSweep2D* cpSweep2DAlloc(void);
+/// Initialize a 2D sweep and prune broadphase.
+cpSpatialIndex* cpSweep2DInit(cpSweep2D *sweep, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
+/// Allocate and initialize a 2D sweep and prune broadphase.
+cpSpatialIndex* cpSweep2DNew(cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex);
+
 //MARK: Spatial Index Implementation
 
 typedef void (*cpSpatialIndexDestroyImpl)(cpSpatialIndex *index);
@@ -21,6 +21,7 @@
 
 #include "stdlib.h"
 #include "stdio.h"
+#include "string.h"
 
 #include "chipmunk_private.h"
 
@@ -28,6 +29,7 @@ static inline cpSpatialIndexClass *Klass();
 
 typedef struct Node Node;
 typedef struct Pair Pair;
+typedef struct MarkBuffer MarkBuffer;
 
 struct cpBBTree {
 	cpSpatialIndex spatialIndex;
@@ -41,6 +43,18 @@ struct cpBBTree {
 	cpArray *allocatedBuffers;
 	
 	cpTimestamp stamp;
+	
+	cpBBTreeParallelFunc parallelFunc;
+	void *parallelContext;
+	
+	// Scratch space for the parallel reindex query.
+	int leafCount, leafCapacity;
+	Node **leafArray;
+	cpBB *leafBBs;
+	cpBool *leafMoved;
+	
+	int bufferCount;
+	MarkBuffer *buffers;
 };
 
 struct Node {
@@ -373,6 +387,86 @@ SubtreeSegmentQuery(Node *subtree, void *obj, cpVect a, cpVect b, cpFloat t_exit
 	}
 }
 
+// Traverse the tree once for a packet of queries.
+// Each level passes down the list of queries that are still active for the subtree.
+
+typedef struct PacketQueryContext {
+	void *obj;
+	const cpBB *bbs;
+	cpBBTreePacketQueryFunc func;
+	void *data;
+} PacketQueryContext;
+
+static void
+SubtreeQueryPacket(Node *subtree, const int *items, int count, PacketQueryContext *context)
+{
+	int hits[CP_BBTREE_PACKET_SIZE];
+	int hitCount = 0;
+	
+	for(int k=0; k<count; k++){
+		if(cpBBIntersects(subtree->bb, context->bbs[items[k]])) hits[hitCount++] = items[k];
+	}
+	
+	if(!hitCount) return;
+	
+	if(NodeIsLeaf(subtree)){
+		for(int k=0; k<hitCount; k++) context->func(context->obj, subtree->obj, hits[k], context->data);
+	} else {
+		SubtreeQueryPacket(subtree->A, hits, hitCount, context);
+		SubtreeQueryPacket(subtree->B, hits, hitCount, context);
+	}
+}
+
+typedef struct PacketSegmentQueryContext {
+	void *obj;
+	const cpVect *a, *b;
+	cpFloat *t_exit;
+	cpBBTreePacketSegmentQueryFunc func;
+	void *data;
+} PacketSegmentQueryContext;
+
+static void
+SubtreeSegmentQueryPacket(Node *subtree, int *items, int count, PacketSegmentQueryContext *context)
+{
+	cpFloat *t_exit = context->t_exit;
+	
+	if(NodeIsLeaf(subtree)){
+		for(int k=0; k<count; k++){
+			int i = items[k];
+			t_exit[i] = cpfmin(t_exit[i], context->func(context->obj, subtree->obj, i, context->data));
+		}
+	} else {
+		int items_a[CP_BBTREE_PACKET_SIZE], items_b[CP_BBTREE_PACKET_SIZE];
+		cpFloat t_a[CP_BBTREE_PACKET_SIZE], t_b[CP_BBTREE_PACKET_SIZE];
+		cpFloat min_a = INFINITY, min_b = INFINITY;
+		int count_a = 0, count_b = 0;
+		
+		for(int k=0; k<count; k++){
+			int i = items[k];
+			cpFloat ta = cpBBSegmentQuery(subtree->A->bb, context->a[i], context->b[i]);
+			cpFloat tb = cpBBSegmentQuery(subtree->B->bb, context->a[i], context->b[i]);
+			
+			if(ta < t_exit[i]){items_a[count_a] = i; t_a[count_a++] = ta; min_a = cpfmin(min_a, ta);}
+			if(tb < t_exit[i]){items_b[count_b] = i; t_b[count_b++] = tb; min_b = cpfmin(min_b, tb);}
+		}
+		
+		// Like SubtreeSegmentQuery(), visit the nearer child first so the exit times shrink sooner.
+		if(min_b < min_a){
+			if(count_b) SubtreeSegmentQueryPacket(subtree->B, items_b, count_b, context);
+			
+			int n = 0;
+			for(int k=0; k<count_a; k++) if(t_a[k] < t_exit[items_a[k]]) items_a[n++] = items_a[k];
+			if(n) SubtreeSegmentQueryPacket(subtree->A, items_a, n, context);
+		} else {
+			if(count_a) SubtreeSegmentQueryPacket(subtree->A, items_a, count_a, context);
+			
+			int n = 0;
+			for(int k=0; k<count_b; k++) if(t_b[k] < t_exit[items_b[k]]) items_b[n++] = items_b[k];
+			if(n) SubtreeSegmentQueryPacket(subtree->B, items_b, n, context);
+		}
+	}
+}
+
 static void
 SubtreeRecycle(cpBBTree *tree, Node *node)
 {
@@ -468,6 +562,222 @@ MarkSubtree(Node *subtree, MarkContext *context)
 	}
 }
 
+//MARK: Parallel Marking Functions
+
+// Number of leaves handled by a single parallel work item.
+// The split doesn't depend on the number of threads, so neither does the result.
+#define PARALLEL_CHUNK 128
+
+// Marking is split in two passes. The workers run the tree queries for the moved leaves
+// and only record what they found. The calling thread then replays the records in the
+// same order as MarkSubtree() so that pairs are threaded and callbacks are called exactly
+// like the serial version. A record with a NULL leaf ends the records of a moved leaf.
+typedef struct MarkRecord {
+	Node *other;
+	cpBool left;
+} MarkRecord;
+
+struct MarkBuffer {
+	int num, max;
+	MarkRecord *arr;
+};
+
+typedef struct ParallelContext {
+	cpBBTree *tree;
+	Node *staticRoot;
+} ParallelContext;
+
+static inline void
+MarkBufferPush(MarkBuffer *buffer, Node *other, cpBool left)
+{
+	if(buffer->num == buffer->max){
+		buffer->max = (buffer->max ? 2*buffer->max : 64);
+		buffer->arr = (MarkRecord *)cprealloc(buffer->arr, buffer->max*sizeof(MarkRecord));
+	}
+	
+	MarkRecord record = {other, left};
+	buffer->arr[buffer->num++] = record;
+}
+
+static void
+RecordLeafQuery(Node *subtree, Node *leaf, cpBool left, MarkBuffer *buffer)
+{
+	if(cpBBIntersects(leaf->bb, subtree->bb)){
+		if(NodeIsLeaf(subtree)){
+			MarkBufferPush(buffer, subtree, left);
+		} else {
+			RecordLeafQuery(subtree->A, leaf, left, buffer);
+			RecordLeafQuery(subtree->B, leaf, left, buffer);
+		}
+	}
+}
+
+static void
+ReplayLeafQuery(Node *leaf, MarkRecord *record, MarkContext *context)
+{
+	for(; record->other; record++){
+		Node *other = record->other;
+		
+		if(record->left){
+			PairInsert(leaf, other, context->tree);
+		} else {
+			if(other->STAMP < leaf->STAMP) PairInsert(other, leaf, context->tree);
+			context->func(leaf->obj, other->obj, context->data);
+		}
+	}
+}
+
+static inline void
+ChunkRange(cpBBTree *tree, int item, int *start, int *end)
+{
+	int first = item*PARALLEL_CHUNK;
+	int last = first + PARALLEL_CHUNK;
+	
+	(*start) = first;
+	(*end) = (last < tree->leafCount ? last : tree->leafCount);
+}
+
+static void
+ParallelLeafUpdate(ParallelContext *context, int item)
+{
+	cpBBTree *tree = context->tree;
+	
+	int start, end;
+	ChunkRange(tree, item, &start, &end);
+	
+	for(int i=start; i<end; i++){
+		Node *leaf = tree->leafArray[i];
+		cpBB bb = tree->spatialIndex.bbfunc(leaf->obj);
+		
+		if(cpBBContainsBB(leaf->bb, bb)){
+			tree->leafMoved[i] = cpFalse;
+		} else {
+			tree->leafBBs[i] = GetBB(tree, leaf->obj);
+			tree->leafMoved[i] = cpTrue;
+		}
+	}
+}
+
+static void
+ParallelMarkLeaves(ParallelContext *context, int item)
+{
+	cpBBTree *tree = context->tree;
+	cpTimestamp stamp = GetStamp(tree);
+	Node *staticRoot = context->staticRoot;
+	
+	MarkBuffer *buffer = tree->buffers + item;
+	buffer->num = 0;
+	
+	int start, end;
+	ChunkRange(tree, item, &start, &end);
+	
+	for(int i=start; i<end; i++){
+		Node *leaf = tree->leafArray[i];
+		if(leaf->STAMP != stamp) continue;
+		
+		if(staticRoot) RecordLeafQuery(staticRoot, leaf, cpFalse, buffer);
+		
+		for(Node *node = leaf; node->parent; node = node->parent){
+			if(node == node->parent->A){
+				RecordLeafQuery(node->parent->B, leaf, cpTrue, buffer);
+			} else {
+				RecordLeafQuery(node->parent->A, leaf, cpFalse, buffer);
+			}
+		}
+		
+		MarkBufferPush(buffer, NULL, cpFalse);
+	}
+}
+
+static void
+GatherLeaf(Node *leaf, cpBBTree *tree)
+{
+	tree->leafArray[tree->leafCount++] = leaf;
+}
+
+static void
+GatherSubtree(Node *subtree, cpBBTree *tree)
+{
+	if(NodeIsLeaf(subtree)){
+		GatherLeaf(subtree, tree);
+	} else {
+		GatherSubtree(subtree->A, tree);
+		GatherSubtree(subtree->B, tree);
+	}
+}
+
+static int
+ParallelReserve(cpBBTree *tree)
+{
+	int count = cpHashSetCount(tree->leaves);
+	if(count > tree->leafCapacity){
+		tree->leafCapacity = count;
+		tree->leafArray = (Node **)cprealloc(tree->leafArray, count*sizeof(Node *));
+		tree->leafBBs = (cpBB *)cprealloc(tree->leafBBs, count*sizeof(cpBB));
+		tree->leafMoved = (cpBool *)cprealloc(tree->leafMoved, count*sizeof(cpBool));
+	}
+	
+	int chunks = (count + PARALLEL_CHUNK - 1)/PARALLEL_CHUNK;
+	if(chunks > tree->bufferCount){
+		tree->buffers = (MarkBuffer *)cprealloc(tree->buffers, chunks*sizeof(MarkBuffer));
+		memset(tree->buffers + tree->bufferCount, 0, (chunks - tree->bufferCount)*sizeof(MarkBuffer));
+		tree->bufferCount = chunks;
+	}
+	
+	return chunks;
+}
+
+static void
+ParallelReindexQuery(cpBBTree *tree, Node *staticRoot, cpSpatialIndexQueryFunc func, void *data)
+{
+	int chunks = ParallelReserve(tree);
+	ParallelContext parallelContext = {tree, staticRoot};
+	
+	// Update the leaf bounding boxes in parallel, then move the leaves that left
+	// their fat bounding box in the same order as the serial LeafUpdate().
+	tree->leafCount = 0;
+	cpHashSetEach(tree->leaves, (cpHashSetIteratorFunc)GatherLeaf, tree);
+	tree->parallelFunc((cpBBTreeParallelWorkFunc)ParallelLeafUpdate, &parallelContext, chunks, tree->parallelContext);
+	
+	cpTimestamp stamp = GetStamp(tree);
+	for(int i=0; i<tree->leafCount; i++){
+		if(!tree->leafMoved[i]) continue;
+		
+		Node *leaf = tree->leafArray[i];
+		leaf->bb = tree->leafBBs[i];
+		
+		tree->root = SubtreeInsert(SubtreeRemove(tree->root, leaf, tree), leaf, tree);
+		
+		PairsClear(leaf, tree);
+		leaf->STAMP = stamp;
+	}
+	
+	// Query the moved leaves in parallel, then thread the pairs in tree order.
+	tree->leafCount = 0;
+	GatherSubtree(tree->root, tree);
+	tree->parallelFunc((cpBBTreeParallelWorkFunc)ParallelMarkLeaves, &parallelContext, chunks, tree->parallelContext);
+	
+	MarkContext context = {tree, staticRoot, func, data};
+	for(int item=0; item<chunks; item++){
+		MarkRecord *record = tree->buffers[item].arr;
+		
+		int start, end;
+		ChunkRange(tree, item, &start, &end);
+		
+		for(int i=start; i<end; i++){
+			Node *leaf = tree->leafArray[i];
+			
+			if(leaf->STAMP == stamp){
+				ReplayLeafQuery(leaf, record, &context);
+				while(record->other) record++;
+				record++;
+			} else {
+				MarkLeaf(leaf, &context);
+			}
+		}
+	}
+}
+
 //MARK: Leaf Functions
 
 static Node *
@@ -551,6 +861,16 @@ cpBBTreeInit(cpBBTree *tree, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *static
 	cpSpatialIndexInit((cpSpatialIndex *)tree, Klass(), bbfunc, staticIndex);
 	
 	tree->velocityFunc = NULL;
+	tree->parallelFunc = NULL;
+	tree->parallelContext = NULL;
+	
+	tree->leafCount = tree->leafCapacity = 0;
+	tree->leafArray = NULL;
+	tree->leafBBs = NULL;
+	tree->leafMoved = NULL;
+	
+	tree->bufferCount = 0;
+	tree->buffers = NULL;
 	
 	tree->leaves = cpHashSetNew(0, (cpHashSetEqlFunc)leafSetEql);
 	tree->root = NULL;
@@ -574,6 +894,45 @@ cpBBTreeSetVelocityFunc(cpSpatialIndex *index, cpBBTreeVelocityFunc func)
 	((cpBBTree *)index)->velocityFunc = func;
 }
 
+void
+cpBBTreeSetParallelFunc(cpSpatialIndex *index, cpBBTreeParallelFunc func, void *context)
+{
+	if(index->klass != Klass()){
+		cpAssertWarn(cpFalse, "Ignoring cpBBTreeSetParallelFunc() call to non-tree spatial index.");
+		return;
+	}
+	
+	cpBBTree *tree = (cpBBTree *)index;
+	tree->parallelFunc = func;
+	tree->parallelContext = context;
+}
+
+void
+cpBBTreeRunParallel(cpSpatialIndex *index, cpBBTreeParallelWorkFunc work, void *data, int count)
+{
+	cpBBTree *tree = GetTree(index);
+	
+	if(tree && tree->parallelFunc && count > 1){
+		tree->parallelFunc(work, data, count, tree->parallelContext);
+	} else {
+		for(int i=0; i<count; i++) work(data, i);
+	}
+}
+
+void
+cpBBTreeGetPoolBytes(cpSpatialIndex *index, size_t *live, size_t *pooled)
+{
+	cpBBTree *tree = GetTree(index);
+	if(!tree) return;
+	
+	size_t bytes = 0;
+	for(Node *node = tree->pooledNodes; node; node = node->parent) bytes += sizeof(Node);
+	for(Pair *pair = tree->pooledPairs; pair; pair = pair->a.next) bytes += sizeof(Pair);
+	
+	*live += tree->allocatedBuffers->num*CP_BUFFER_BYTES - bytes;
+	*pooled += bytes;
+}
+
 cpSpatialIndex *
 cpBBTreeNew(cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex)
 {
@@ -587,6 +946,13 @@ cpBBTreeDestroy(cpBBTree *tree)
 	
 	if(tree->allocatedBuffers) cpArrayFreeEach(tree->allocatedBuffers, cpfree);
 	cpArrayFree(tree->allocatedBuffers);
+	
+	cpfree(tree->leafArray);
+	cpfree(tree->leafBBs);
+	cpfree(tree->leafMoved);
+	
+	for(int i=0; i<tree->bufferCount; i++) cpfree(tree->buffers[i].arr);
+	cpfree(tree->buffers);
 }
 
 //MARK: Insert/Remove
@@ -627,14 +993,18 @@ cpBBTreeReindexQuery(cpBBTree *tree, cpSpatialIndexQueryFunc func, void *data)
 {
 	if(!tree->root) return;
 	
-	// LeafUpdate() may modify tree->root. Don't cache it.
-	cpHashSetEach(tree->leaves, (cpHashSetIteratorFunc)LeafUpdate, tree);
-	
 	cpSpatialIndex *staticIndex = tree->spatialIndex.staticIndex;
 	Node *staticRoot = (staticIndex && staticIndex->klass == Klass() ? ((cpBBTree *)staticIndex)->root : NULL);
 	
-	MarkContext context = {tree, staticRoot, func, data};
-	MarkSubtree(tree->root, &context);
+	if(tree->parallelFunc){
+		ParallelReindexQuery(tree, staticRoot, func, data);
+	} else {
+		// LeafUpdate() may modify tree->root. Don't cache it.
+		cpHashSetEach(tree->leaves, (cpHashSetIteratorFunc)LeafUpdate, tree);
+		
+		MarkContext context = {tree, staticRoot, func, data};
+		MarkSubtree(tree->root, &context);
+	}
 	if(staticIndex && !staticRoot) cpSpatialIndexCollideStatic((cpSpatialIndex *)tree, staticIndex, func, data);
 	
 	IncrementStamp(tree);
@@ -713,6 +1083,75 @@ static cpSpatialIndexClass klass = {
 
 static inline cpSpatialIndexClass *Klass(){return &klass;}
 
+//MARK: Packet Queries
+
+static inline void
+PacketItems(int *items, int count)
+{
+	cpAssertHard(0 <= count && count <= CP_BBTREE_PACKET_SIZE, "Packet queries are limited to CP_BBTREE_PACKET_SIZE items.");
+	for(int i=0; i<count; i++) items[i] = i;
+}
+
+// Used to run the items of a packet one at a time on other spatial indexes.
+typedef struct PacketItem {
+	int item;
+	cpBBTreePacketQueryFunc func;
+	cpBBTreePacketSegmentQueryFunc segmentFunc;
+	cpFloat *t_exit;
+	void *data;
+} PacketItem;
+
+static void
+PacketItemQuery(void *obj1, void *obj2, PacketItem *item)
+{
+	item->func(obj1, obj2, item->item, item->data);
+}
+
+static cpFloat
+PacketItemSegmentQuery(void *obj1, void *obj2, PacketItem *item)
+{
+	cpFloat t = item->segmentFunc(obj1, obj2, item->item, item->data);
+	item->t_exit[item->item] = cpfmin(item->t_exit[item->item], t);
+	
+	return t;
+}
+
+void
+cpBBTreeQueryPacket(cpSpatialIndex *index, void *obj, int count, const cpBB *bbs, cpBBTreePacketQueryFunc func, void *data)
+{
+	int items[CP_BBTREE_PACKET_SIZE];
+	PacketItems(items, count);
+	
+	cpBBTree *tree = GetTree(index);
+	if(tree){
+		PacketQueryContext context = {obj, bbs, func, data};
+		if(tree->root) SubtreeQueryPacket(tree->root, items, count, &context);
+	} else {
+		for(int i=0; i<count; i++){
+			PacketItem item = {i, func, NULL, NULL, data};
+			cpSpatialIndexQuery(index, obj, bbs[i], (cpSpatialIndexQueryFunc)PacketItemQuery, &item);
+		}
+	}
+}
+
+void
+cpBBTreeSegmentQueryPacket(cpSpatialIndex *index, void *obj, int count, const cpVect *a, const cpVect *b, cpFloat *t_exit, cpBBTreePacketSegmentQueryFunc func, void *data)
+{
+	int items[CP_BBTREE_PACKET_SIZE];
+	PacketItems(items, count);
+	
+	cpBBTree *tree = GetTree(index);
+	if(tree){
+		PacketSegmentQueryContext context = {obj, a, b, t_exit, func, data};
+		if(tree->root) SubtreeSegmentQueryPacket(tree->root, items, count, &context);
+	} else {
+		for(int i=0; i<count; i++){
+			PacketItem item = {i, NULL, func, t_exit, data};
+			cpSpatialIndexSegmentQuery(index, obj, a[i], b[i], t_exit[i], (cpSpatialIndexSegmentQueryFunc)PacketItemSegmentQuery, &item);
+		}
+	}
+}
+
 
 //MARK: Tree Optimization
 
@@ -98,16 +98,225 @@ nextContactPoint(cpContact *arr, int *numPtr)
 	}
 }
 
+//MARK: Four Wide Kernels
+
+// The polygon tests below run four vertexes or planes at a time on the SoA
+// copies kept in cpPolyShape.tSoA. Every lane does the same operations in the
+// same order as the scalar code, so the contacts are identical to it.
+
+#if CP_POLY_SOA
+
+#if CP_USE_DOUBLES
+	#if defined(__SSE2__) || defined(_M_X64)
+		#define CP_SIMD_SSE2
+		#include <emmintrin.h>
+	#elif defined(__aarch64__)
+		#define CP_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+#else
+	#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+		#define CP_SIMD_SSE2
+		#include <emmintrin.h>
+	#elif defined(__ARM_NEON__) || defined(__ARM_NEON)
+		#define CP_SIMD_NEON
+		#include <arm_neon.h>
+	#endif
+#endif
+
+#if defined(CP_SIMD_SSE2) && !CP_USE_DOUBLES
+
+typedef __m128 cpFloat4;
+typedef __m128 cpMask4;
+
+static inline cpFloat4 cp4Load(const cpFloat *p){return _mm_loadu_ps(p);}
+static inline void cp4Store(cpFloat *p, cpFloat4 a){_mm_storeu_ps(p, a);}
+static inline cpFloat4 cp4Splat(cpFloat f){return _mm_set1_ps(f);}
+static inline cpFloat4 cp4Add(cpFloat4 a, cpFloat4 b){return _mm_add_ps(a, b);}
+static inline cpFloat4 cp4Sub(cpFloat4 a, cpFloat4 b){return _mm_sub_ps(a, b);}
+static inline cpFloat4 cp4Mul(cpFloat4 a, cpFloat4 b){return _mm_mul_ps(a, b);}
+// Same as cpfmin(), (a < b ? a : b).
+static inline cpFloat4 cp4Min(cpFloat4 a, cpFloat4 b){return _mm_min_ps(a, b);}
+
+static inline cpMask4 cp4Greater(cpFloat4 a, cpFloat4 b){return _mm_cmpgt_ps(a, b);}
+static inline cpMask4 cp4Less(cpFloat4 a, cpFloat4 b){return _mm_cmplt_ps(a, b);}
+static inline cpMask4 cp4AndNot(cpMask4 a, cpMask4 b){return _mm_andnot_ps(b, a);}
+static inline cpBool cp4Any(cpMask4 m){return (_mm_movemask_ps(m) != 0);}
+
+#elif defined(CP_SIMD_SSE2)
+
+typedef struct cpFloat4 {__m128d a, b;} cpFloat4;
+typedef cpFloat4 cpMask4;
+
+#define CP_4_OP(name, op) static inline cpFloat4 name(cpFloat4 x, cpFloat4 y){cpFloat4 r = {op(x.a, y.a), op(x.b, y.b)}; return r;}
+
+static inline cpFloat4 cp4Load(const cpFloat *p){cpFloat4 r = {_mm_loadu_pd(p), _mm_loadu_pd(p + 2)}; return r;}
+static inline void cp4Store(cpFloat *p, cpFloat4 a){_mm_storeu_pd(p, a.a); _mm_storeu_pd(p + 2, a.b);}
+static inline cpFloat4 cp4Splat(cpFloat f){cpFloat4 r = {_mm_set1_pd(f), _mm_set1_pd(f)}; return r;}
+CP_4_OP(cp4Add, _mm_add_pd)
+CP_4_OP(cp4Sub, _mm_sub_pd)
+CP_4_OP(cp4Mul, _mm_mul_pd)
+// Same as cpfmin(), (a < b ? a : b).
+CP_4_OP(cp4Min, _mm_min_pd)
+
+CP_4_OP(cp4Greater, _mm_cmpgt_pd)
+CP_4_OP(cp4Less, _mm_cmplt_pd)
+static inline cpMask4 cp4AndNot(cpMask4 x, cpMask4 y){cpMask4 r = {_mm_andnot_pd(y.a, x.a), _mm_andnot_pd(y.b, x.b)}; return r;}
+static inline cpBool cp4Any(cpMask4 m){return (_mm_movemask_pd(_mm_or_pd(m.a, m.b)) != 0);}
+
+#undef CP_4_OP
+
+#elif defined(CP_SIMD_NEON) && !CP_USE_DOUBLES
+
+typedef float32x4_t cpFloat4;
+typedef uint32x4_t cpMask4;
+
+static inline cpFloat4 cp4Load(const cpFloat *p){return vld1q_f32(p);}
+static inline void cp4Store(cpFloat *p, cpFloat4 a){vst1q_f32(p, a);}
+static inline cpFloat4 cp4Splat(cpFloat f){return vdupq_n_f32(f);}
+static inline cpFloat4 cp4Add(cpFloat4 a, cpFloat4 b){return vaddq_f32(a, b);}
+static inline cpFloat4 cp4Sub(cpFloat4 a, cpFloat4 b){return vsubq_f32(a, b);}
+static inline cpFloat4 cp4Mul(cpFloat4 a, cpFloat4 b){return vmulq_f32(a, b);}
+static inline cpFloat4 cp4Min(cpFloat4 a, cpFloat4 b){return vbslq_f32(vcltq_f32(a, b), a, b);}
+
+static inline cpMask4 cp4Greater(cpFloat4 a, cpFloat4 b){return vcgtq_f32(a, b);}
+static inline cpMask4 cp4Less(cpFloat4 a, cpFloat4 b){return vcltq_f32(a, b);}
+static inline cpMask4 cp4AndNot(cpMask4 a, cpMask4 b){return vbicq_u32(a, b);}
+static inline cpBool cp4Any(cpMask4 m)
+{
+	uint32x2_t t = vorr_u32(vget_low_u32(m), vget_high_u32(m));
+	return (vget_lane_u32(vpmax_u32(t, t), 0) != 0);
+}
+
+#elif defined(CP_SIMD_NEON)
+
+typedef struct cpFloat4 {float64x2_t a, b;} cpFloat4;
+typedef struct cpMask4 {uint64x2_t a, b;} cpMask4;
+
+#define CP_4_OP(type, name, op) static inline type name(cpFloat4 x, cpFloat4 y){type r = {op(x.a, y.a), op(x.b, y.b)}; return r;}
+
+static inline cpFloat4 cp4Load(const cpFloat *p){cpFloat4 r = {vld1q_f64(p), vld1q_f64(p + 2)}; return r;}
+static inline void cp4Store(cpFloat *p, cpFloat4 a){vst1q_f64(p, a.a); vst1q_f64(p + 2, a.b);}
+static inline cpFloat4 cp4Splat(cpFloat f){cpFloat4 r = {vdupq_n_f64(f), vdupq_n_f64(f)}; return r;}
+CP_4_OP(cpFloat4, cp4Add, vaddq_f64)
+CP_4_OP(cpFloat4, cp4Sub, vsubq_f64)
+CP_4_OP(cpFloat4, cp4Mul, vmulq_f64)
+static inline cpFloat4 cp4Min(cpFloat4 x, cpFloat4 y)
+{
+	cpFloat4 r = {vbslq_f64(vcltq_f64(x.a, y.a), x.a, y.a), vbslq_f64(vcltq_f64(x.b, y.b), x.b, y.b)};
+	return r;
+}
+
+CP_4_OP(cpMask4, cp4Greater, vcgtq_f64)
+CP_4_OP(cpMask4, cp4Less, vcltq_f64)
+static inline cpMask4 cp4AndNot(cpMask4 x, cpMask4 y){cpMask4 r = {vbicq_u64(x.a, y.a), vbicq_u64(x.b, y.b)}; return r;}
+static inline cpBool cp4Any(cpMask4 m){return (vmaxvq_u32(vreinterpretq_u32_u64(vorrq_u64(m.a, m.b))) != 0);}
+
+#undef CP_4_OP
+
+#else
+
+// Portable version, the compiler may still vectorize it.
+typedef struct cpFloat4 {cpFloat v[4];} cpFloat4;
+typedef struct cpMask4 {cpBool v[4];} cpMask4;
+
+#define CP_4_OP(type, name, expr) static inline type name(cpFloat4 a, cpFloat4 b){type r; for(int i=0; i<4; i++) r.v[i] = (expr); return r;}
+
+static inline cpFloat4 cp4Load(const cpFloat *p){cpFloat4 r; for(int i=0; i<4; i++) r.v[i] = p[i]; return r;}
+static inline void cp4Store(cpFloat *p, cpFloat4 a){for(int i=0; i<4; i++) p[i] = a.v[i];}
+static inline cpFloat4 cp4Splat(cpFloat f){cpFloat4 r; for(int i=0; i<4; i++) r.v[i] = f; return r;}
+CP_4_OP(cpFloat4, cp4Add, a.v[i] + b.v[i])
+CP_4_OP(cpFloat4, cp4Sub, a.v[i] - b.v[i])
+CP_4_OP(cpFloat4, cp4Mul, a.v[i] * b.v[i])
+CP_4_OP(cpFloat4, cp4Min, cpfmin(a.v[i], b.v[i]))
+
+CP_4_OP(cpMask4, cp4Greater, a.v[i] > b.v[i])
+CP_4_OP(cpMask4, cp4Less, a.v[i] < b.v[i])
+static inline cpMask4 cp4AndNot(cpMask4 a, cpMask4 b){cpMask4 r; for(int i=0; i<4; i++) r.v[i] = a.v[i] && !b.v[i]; return r;}
+static inline cpBool cp4Any(cpMask4 m){return (m.v[0] || m.v[1] || m.v[2] || m.v[3]);}
+
+#undef CP_4_OP
+
+#endif
+
+// n.v for four vertexes or planes in SoA form, computed like cpvdot().
+static inline cpFloat4
+cp4Dot(cpFloat4 x, cpFloat4 y, cpFloat4 nx, cpFloat4 ny)
+{
+	return cp4Add(cp4Mul(x, nx), cp4Mul(y, ny));
+}
+
+// Four wide cpPolyShapeValueOnAxis().
+static inline cpFloat
+PolyValueOnAxis(const cpPolyShape *poly, const cpVect n, const cpFloat d)
+{
+	int count = cpPolyShapeSoACount(poly);
+	const cpFloat *x = poly->tSoA, *y = x + count;
+	
+	cpFloat4 nx = cp4Splat(n.x), ny = cp4Splat(n.y);
+	cpFloat4 min = cp4Dot(cp4Load(x), cp4Load(y), nx, ny);
+	for(int i=4; i<count; i+=4){
+		min = cp4Min(min, cp4Dot(cp4Load(x + i), cp4Load(y + i), nx, ny));
+	}
+	
+	cpFloat lanes[4];
+	cp4Store(lanes, min);
+	return cpfmin(cpfmin(lanes[0], lanes[1]), cpfmin(lanes[2], lanes[3])) - d;
+}
+
+// Four wide cpPolyShapeContainsVert().
+static inline cpBool
+PolyContainsVert(const cpPolyShape *poly, const cpVect v)
+{
+	int count = cpPolyShapeSoACount(poly);
+	const cpFloat *nx = poly->tSoA + 2*count, *ny = nx + count, *d = ny + count;
+	
+	cpFloat4 vx = cp4Splat(v.x), vy = cp4Splat(v.y), zero = cp4Splat(0.0f);
+	for(int i=0; i<count; i+=4){
+		cpFloat4 dist = cp4Sub(cp4Dot(cp4Load(nx + i), cp4Load(ny + i), vx, vy), cp4Load(d + i));
+		if(cp4Any(cp4Greater(dist, zero))) return cpFalse;
+	}
+	
+	return cpTrue;
+}
+
+// Four wide cpPolyShapeContainsVertPartial().
+static inline cpBool
+PolyContainsVertPartial(const cpPolyShape *poly, const cpVect v, const cpVect n)
+{
+	int count = cpPolyShapeSoACount(poly);
+	const cpFloat *nx = poly->tSoA + 2*count, *ny = nx + count, *d = ny + count;
+	
+	cpFloat4 vx = cp4Splat(v.x), vy = cp4Splat(v.y), zero = cp4Splat(0.0f);
+	cpFloat4 dirx = cp4Splat(n.x), diry = cp4Splat(n.y);
+	for(int i=0; i<count; i+=4){
+		cpFloat4 planex = cp4Load(nx + i), planey = cp4Load(ny + i);
+		cpMask4 skip = cp4Less(cp4Dot(planex, planey, dirx, diry), zero);
+		cpFloat4 dist = cp4Sub(cp4Dot(planex, planey, vx, vy), cp4Load(d + i));
+		if(cp4Any(cp4AndNot(cp4Greater(dist, zero), skip))) return cpFalse;
+	}
+	
+	return cpTrue;
+}
+
+#else
+
+#define PolyValueOnAxis cpPolyShapeValueOnAxis
+#define PolyContainsVert cpPolyShapeContainsVert
+#define PolyContainsVertPartial cpPolyShapeContainsVertPartial
+
+#endif
+
 // Find the minimum separating axis for the give poly and axis list.
 static inline int
 findMSA(const cpPolyShape *poly, const cpSplittingPlane *planes, const int num, cpFloat *min_out)
 {
 	int min_index = 0;
-	cpFloat min = cpPolyShapeValueOnAxis(poly, planes->n, planes->d);
+	cpFloat min = PolyValueOnAxis(poly, planes->n, planes->d);
 	if(min > 0.0f) return -1;
 	
 	for(int i=1; i<num; i++){
-		cpFloat dist = cpPolyShapeValueOnAxis(poly, planes[i].n, planes[i].d);
+		cpFloat dist = PolyValueOnAxis(poly, planes[i].n, planes[i].d);
 		if(dist > 0.0f) {
 			return -1;
 		} else if(dist > min){
@@ -130,13 +339,13 @@ findVertsFallback(cpContact *arr, const cpPolyShape *poly1, const cpPolyShape *p
 	
 	for(int i=0; i<poly1->numVerts; i++){
 		cpVect v = poly1->tVerts[i];
-		if(cpPolyShapeContainsVertPartial(poly2, v, cpvneg(n)))
+		if(PolyContainsVertPartial(poly2, v, cpvneg(n)))
 			cpContactInit(nextContactPoint(arr, &num), v, n, dist, CP_HASH_PAIR(poly1->shape.hashid, i));
 	}
 	
 	for(int i=0; i<poly2->numVerts; i++){
 		cpVect v = poly2->tVerts[i];
-		if(cpPolyShapeContainsVertPartial(poly1, v, n))
+		if(PolyContainsVertPartial(poly1, v, n))
 			cpContactInit(nextContactPoint(arr, &num), v, n, dist, CP_HASH_PAIR(poly2->shape.hashid, i));
 	}
 	
@@ -151,13 +360,13 @@ findVerts(cpContact *arr, const cpPolyShape *poly1, const cpPolyShape *poly2, co
 	
 	for(int i=0; i<poly1->numVerts; i++){
 		cpVect v = poly1->tVerts[i];
-		if(cpPolyShapeContainsVert(poly2, v))
+		if(PolyContainsVert(poly2, v))
 			cpContactInit(nextContactPoint(arr, &num), v, n, dist, CP_HASH_PAIR(poly1->shape.hashid, i));
 	}
 	
 	for(int i=0; i<poly2->numVerts; i++){
 		cpVect v = poly2->tVerts[i];
-		if(cpPolyShapeContainsVert(poly1, v))
+		if(PolyContainsVert(poly1, v))
 			cpContactInit(nextContactPoint(arr, &num), v, n, dist, CP_HASH_PAIR(poly2->shape.hashid, i));
 	}
 	
@@ -224,8 +433,8 @@ seg2poly(const cpShape *shape1, const cpShape *shape2, cpContact *arr)
 	cpSplittingPlane *planes = poly->tPlanes;
 	
 	cpFloat segD = cpvdot(seg->tn, seg->ta);
-	cpFloat minNorm = cpPolyShapeValueOnAxis(poly, seg->tn, segD) - seg->r;
-	cpFloat minNeg = cpPolyShapeValueOnAxis(poly, cpvneg(seg->tn), -segD) - seg->r;
+	cpFloat minNorm = PolyValueOnAxis(poly, seg->tn, segD) - seg->r;
+	cpFloat minNeg = PolyValueOnAxis(poly, cpvneg(seg->tn), -segD) - seg->r;
 	if(minNeg > 0.0f || minNorm > 0.0f) return 0;
 	
 	int mini = 0;
@@ -247,9 +456,9 @@ seg2poly(const cpShape *shape1, const cpShape *shape2, cpContact *arr)
 	
 	cpVect va = cpvadd(seg->ta, cpvmult(poly_n, seg->r));
 	cpVect vb = cpvadd(seg->tb, cpvmult(poly_n, seg->r));
-	if(cpPolyShapeContainsVert(poly, va))
+	if(PolyContainsVert(poly, va))
 		cpContactInit(nextContactPoint(arr, &num), va, poly_n, poly_min, CP_HASH_PAIR(seg->shape.hashid, 0));
-	if(cpPolyShapeContainsVert(poly, vb))
+	if(PolyContainsVert(poly, vb))
 		cpContactInit(nextContactPoint(arr, &num), vb, poly_n, poly_min, CP_HASH_PAIR(seg->shape.hashid, 1));
 	
 	// Floating point precision problems here.
@@ -22,6 +22,8 @@
 #include "chipmunk_private.h"
 #include "prime.h"
 
+#if !CP_USE_FLAT_HASH_SET
+
 typedef struct cpHashSetBin {
 	void *elt;
 	cpHashValue hash;
@@ -251,3 +253,5 @@ cpHashSetFilter(cpHashSet *set, cpHashSetFilterFunc func, void *data)
 		}
 	}
 }
+
+#endif
@@ -0,0 +1,417 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "chipmunk_private.h"
+
+#if CP_USE_FLAT_HASH_SET
+
+// A flat open addressing hash set in the style of SwissTable.
+// Each slot has a control byte that is either EMPTY, DELETED or the low 7 bits of
+// the mixed hash. Slots are probed in aligned groups of GROUP_WIDTH control bytes
+// so a whole group can be matched against a hash with a few SIMD instructions.
+// A lookup stops at the first group that contains an EMPTY slot.
+
+#define GROUP_WIDTH 16
+
+#define CTRL_EMPTY ((unsigned char)0x80)
+#define CTRL_DELETED ((unsigned char)0xFE)
+
+#if !defined(CP_NO_SIMD) && (defined(__SSE2__) || defined(_M_X64))
+	#define CP_HASH_SET_SSE2
+	#include <emmintrin.h>
+#elif !defined(CP_NO_SIMD) && (defined(__ARM_NEON__) || defined(__ARM_NEON))
+	#define CP_HASH_SET_NEON
+	#include <arm_neon.h>
+#endif
+
+// Group matches are bit masks with SLOT_BITS bits per slot.
+#ifdef CP_HASH_SET_NEON
+	typedef uint64_t GroupMask;
+	#define SLOT_BITS 4
+	#define SLOT_MASK ((GroupMask)0xF)
+#else
+	typedef unsigned int GroupMask;
+	#define SLOT_BITS 1
+	#define SLOT_MASK ((GroupMask)0x1)
+#endif
+
+typedef struct Slot {
+	cpHashValue hash;
+	void *elt;
+} Slot;
+
+struct cpHashSet {
+	unsigned int entries, size;
+	// Number of elements that can be added before EMPTY slots run too low.
+	unsigned int growthLeft;
+	
+	cpHashSetEqlFunc eql;
+	void *default_value;
+	
+	unsigned char *ctrl;
+	Slot *slots;
+};
+
+//MARK: Group Functions
+
+#if defined(CP_HASH_SET_SSE2)
+
+static inline GroupMask
+GroupMatch(const unsigned char *group, unsigned char tag)
+{
+	__m128i ctrl = _mm_loadu_si128((const __m128i *)group);
+	return (GroupMask)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)tag)));
+}
+
+static inline GroupMask
+GroupMatchEmpty(const unsigned char *group)
+{
+	return GroupMatch(group, CTRL_EMPTY);
+}
+
+// EMPTY and DELETED are the only control bytes with the high bit set.
+static inline GroupMask
+GroupMatchFree(const unsigned char *group)
+{
+	return (GroupMask)_mm_movemask_epi8(_mm_loadu_si128((const __m128i *)group));
+}
+
+#elif defined(CP_HASH_SET_NEON)
+
+// Narrow a byte mask to a 64 bit mask with four bits per slot.
+static inline GroupMask
+NarrowMask(uint8x16_t mask)
+{
+	uint8x8_t narrow = vshrn_n_u16(vreinterpretq_u16_u8(mask), 4);
+	return vget_lane_u64(vreinterpret_u64_u8(narrow), 0);
+}
+
+static inline GroupMask
+GroupMatch(const unsigned char *group, unsigned char tag)
+{
+	return NarrowMask(vceqq_u8(vld1q_u8(group), vdupq_n_u8(tag)));
+}
+
+static inline GroupMask
+GroupMatchEmpty(const unsigned char *group)
+{
+	return GroupMatch(group, CTRL_EMPTY);
+}
+
+static inline GroupMask
+GroupMatchFree(const unsigned char *group)
+{
+	return NarrowMask(vcgeq_u8(vld1q_u8(group), vdupq_n_u8(CTRL_EMPTY)));
+}
+
+#else
+
+static inline GroupMask
+GroupMatch(const unsigned char *group, unsigned char tag)
+{
+	GroupMask mask = 0;
+	for(int i=0; i<GROUP_WIDTH; i++) mask |= (GroupMask)(group[i] == tag) << i;
+	return mask;
+}
+
+static inline GroupMask
+GroupMatchEmpty(const unsigned char *group)
+{
+	return GroupMatch(group, CTRL_EMPTY);
+}
+
+static inline GroupMask
+GroupMatchFree(const unsigned char *group)
+{
+	GroupMask mask = 0;
+	for(int i=0; i<GROUP_WIDTH; i++) mask |= (GroupMask)(group[i] >> 7) << i;
+	return mask;
+}
+
+#endif
+
+static inline int
+MaskFirst(GroupMask mask)
+{
+#if defined(__GNUC__)
+	return (sizeof(GroupMask) > sizeof(unsigned int) ? __builtin_ctzll(mask) : __builtin_ctz((unsigned int)mask))/SLOT_BITS;
+#else
+	int i = 0;
+	while(!(mask & SLOT_MASK)){mask >>= SLOT_BITS; i++;}
+	return i;
+#endif
+}
+
+static inline GroupMask
+MaskClear(GroupMask mask, int i)
+{
+	return mask & ~(SLOT_MASK << (i*SLOT_BITS));
+}
+
+//MARK: Hashing Functions
+
+// Chipmunk's hash values are often sequential or multiples of CP_HASH_COEF.
+// Mix them so both the group index and the tag get well distributed bits.
+static inline cpHashValue
+MixHash(cpHashValue hash)
+{
+	hash ^= hash >> 15;
+	hash *= (cpHashValue)0x2c1b3c6dU;
+	hash ^= hash >> 12;
+	hash *= (cpHashValue)0x297a2d39U;
+	hash ^= hash >> 15;
+	return hash;
+}
+
+static inline unsigned char
+HashTag(cpHashValue mixed)
+{
+	return (unsigned char)(mixed & 0x7F);
+}
+
+static inline unsigned int
+HashGroup(cpHashSet *set, cpHashValue mixed)
+{
+	return (unsigned int)(mixed >> 7) & (set->size/GROUP_WIDTH - 1);
+}
+
+// Triangular probing visits every group once when the group count is a power of two.
+static inline unsigned int
+NextGroup(cpHashSet *set, unsigned int group, unsigned int probe)
+{
+	return (group + probe) & (set->size/GROUP_WIDTH - 1);
+}
+
+// Keep at least 1/8th of the slots EMPTY so lookups stay short.
+static inline unsigned int
+MaxEntries(unsigned int size)
+{
+	return size - size/8;
+}
+
+//MARK: Memory Management Functions
+
+static void
+TableAlloc(cpHashSet *set, unsigned int size)
+{
+	set->size = size;
+	set->ctrl = (unsigned char *)cpcalloc(size, sizeof(unsigned char));
+	set->slots = (Slot *)cpcalloc(size, sizeof(Slot));
+	memset(set->ctrl, CTRL_EMPTY, size);
+	
+	set->growthLeft = MaxEntries(size) - set->entries;
+}
+
+void
+cpHashSetFree(cpHashSet *set)
+{
+	if(set){
+		cpfree(set->ctrl);
+		cpfree(set->slots);
+		
+		cpfree(set);
+	}
+}
+
+cpHashSet *
+cpHashSetNew(int size, cpHashSetEqlFunc eqlFunc)
+{
+	cpHashSet *set = (cpHashSet *)cpcalloc(1, sizeof(cpHashSet));
+	
+	set->entries = 0;
+	
+	set->eql = eqlFunc;
+	set->default_value = NULL;
+	
+	unsigned int tableSize = GROUP_WIDTH;
+	while(MaxEntries(tableSize) < (unsigned int)size) tableSize *= 2;
+	TableAlloc(set, tableSize);
+	
+	return set;
+}
+
+void
+cpHashSetSetDefaultValue(cpHashSet *set, void *default_value)
+{
+	set->default_value = default_value;
+}
+
+int
+cpHashSetCount(cpHashSet *set)
+{
+	return set->entries;
+}
+
+//MARK: Lookup Functions
+
+// Returns the index of the element's slot or -1.
+static inline int
+FindSlot(cpHashSet *set, cpHashValue hash, void *ptr)
+{
+	cpHashValue mixed = MixHash(hash);
+	unsigned char tag = HashTag(mixed);
+	unsigned int group = HashGroup(set, mixed);
+	
+	for(unsigned int probe=1;; probe++){
+		const unsigned char *ctrl = set->ctrl + group*GROUP_WIDTH;
+		
+		for(GroupMask mask = GroupMatch(ctrl, tag); mask;){
+			int i = MaskFirst(mask);
+			mask = MaskClear(mask, i);
+			
+			int idx = group*GROUP_WIDTH + i;
+			Slot *slot = set->slots + idx;
+			if(slot->hash == hash && set->eql(ptr, slot->elt)) return idx;
+		}
+		
+		if(GroupMatchEmpty(ctrl)) return -1;
+		group = NextGroup(set, group, probe);
+	}
+}
+
+// Returns the index of the first EMPTY or DELETED slot for a hash.
+static inline int
+FindFreeSlot(cpHashSet *set, cpHashValue mixed)
+{
+	unsigned int group = HashGroup(set, mixed);
+	
+	for(unsigned int probe=1;; probe++){
+		GroupMask mask = GroupMatchFree(set->ctrl + group*GROUP_WIDTH);
+		if(mask) return group*GROUP_WIDTH + MaskFirst(mask);
+		
+		group = NextGroup(set, group, probe);
+	}
+}
+
+static void
+cpHashSetResize(cpHashSet *set)
+{
+	unsigned int oldSize = set->size;
+	unsigned char *oldCtrl = set->ctrl;
+	Slot *oldSlots = set->slots;
+	
+	// Only grow when the table is really full, otherwise just clear out the DELETED slots.
+	unsigned int newSize = (set->entries >= MaxEntries(oldSize)/2 ? oldSize*2 : oldSize);
+	TableAlloc(set, newSize);
+	
+	for(unsigned int i=0; i<oldSize; i++){
+		if(oldCtrl[i] & 0x80) continue;
+		
+		Slot *slot = oldSlots + i;
+		cpHashValue mixed = MixHash(slot->hash);
+		int idx = FindFreeSlot(set, mixed);
+		
+		set->ctrl[idx] = HashTag(mixed);
+		set->slots[idx] = *slot;
+	}
+	
+	cpfree(oldCtrl);
+	cpfree(oldSlots);
+}
+
+// Remove the element in a slot. The slot only needs to stay DELETED if a probe
+// may have continued past its group, which never happens while the group has an EMPTY slot.
+static inline void
+ClearSlot(cpHashSet *set, int idx)
+{
+	if(GroupMatchEmpty(set->ctrl + (idx & ~(GROUP_WIDTH - 1)))){
+		set->ctrl[idx] = CTRL_EMPTY;
+		set->growthLeft++;
+	} else {
+		set->ctrl[idx] = CTRL_DELETED;
+	}
+	
+	set->slots[idx].elt = NULL;
+	set->entries--;
+}
+
+//MARK: Public Functions
+
+void *
+cpHashSetInsert(cpHashSet *set, cpHashValue hash, void *ptr, void *data, cpHashSetTransFunc trans)
+{
+	int idx = FindSlot(set, hash, ptr);
+	if(idx >= 0) return set->slots[idx].elt;
+	
+	cpHashValue mixed = MixHash(hash);
+	idx = FindFreeSlot(set, mixed);
+	
+	// Reusing a DELETED slot doesn't use up an EMPTY one.
+	if(set->ctrl[idx] == CTRL_EMPTY){
+		if(set->growthLeft == 0){
+			cpHashSetResize(set);
+			idx = FindFreeSlot(set, mixed);
+		}
+		
+		set->growthLeft--;
+	}
+	
+	void *elt = (trans ? trans(ptr, data) : data);
+	
+	set->ctrl[idx] = HashTag(mixed);
+	set->slots[idx].hash = hash;
+	set->slots[idx].elt = elt;
+	set->entries++;
+	
+	return elt;
+}
+
+void *
+cpHashSetRemove(cpHashSet *set, cpHashValue hash, void *ptr)
+{
+	int idx = FindSlot(set, hash, ptr);
+	
+	if(idx >= 0){
+		void *elt = set->slots[idx].elt;
+		ClearSlot(set, idx);
+		
+		return elt;
+	}
+	
+	return NULL;
+}
+
+void *
+cpHashSetFind(cpHashSet *set, cpHashValue hash, void *ptr)
+{
+	int idx = FindSlot(set, hash, ptr);
+	return (idx >= 0 ? set->slots[idx].elt : set->default_value);
+}
+
+void
+cpHashSetEach(cpHashSet *set, cpHashSetIteratorFunc func, void *data)
+{
+	for(unsigned int i=0; i<set->size; i++){
+		if(!(set->ctrl[i] & 0x80)) func(set->slots[i].elt, data);
+	}
+}
+
+void
+cpHashSetFilter(cpHashSet *set, cpHashSetFilterFunc func, void *data)
+{
+	for(unsigned int i=0; i<set->size; i++){
+		if(!(set->ctrl[i] & 0x80) && !func(set->slots[i].elt, data)) ClearSlot(set, i);
+	}
+}
+
+#endif
@@ -0,0 +1,596 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "chipmunk_private.h"
+#include "cpHastySpace.h"
+
+#if defined(__linux__) || defined(__APPLE__)
+#define CP_HASTY_PTHREADS
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+//MARK: Basic Structures
+
+// Each body remembers the colors used by its arbiters and constraints in a
+// 64 bit mask. Items that can't get one of the 64 colors go to a last color
+// that is solved by the calling thread alone.
+#define MAX_COLORS 64
+#define SERIAL_COLOR MAX_COLORS
+
+// Number of spins before a thread waiting at the barrier starts yielding.
+#define SPIN_LIMIT 1000
+
+typedef struct cpHastySpace cpHastySpace;
+typedef void (*WorkFunc)(cpHastySpace *hasty, unsigned long thread);
+
+#ifdef CP_HASTY_PTHREADS
+typedef struct Worker {
+	cpHastySpace *hasty;
+	unsigned long thread;
+	unsigned long generation;
+	pthread_t pthread;
+} Worker;
+#endif
+
+struct cpHastySpace {
+	cpSpace space;
+	
+	unsigned long num_threads;
+	
+	// Solver work for the current step, sorted by color.
+	cpArbiter **arbiters;
+	cpConstraint **constraints;
+	unsigned char *colors;
+	int capacity;
+	
+	int num_colors;
+	int arbiterStart[MAX_COLORS + 2];
+	int constraintStart[MAX_COLORS + 2];
+	
+	// Work items for the parallel cpBBTree reindex query.
+	cpBBTreeParallelWorkFunc treeWork;
+	void *treeData;
+	int treeCount;
+	volatile int treeNext;
+	
+#ifdef CP_HASTY_PTHREADS
+	WorkFunc work;
+	Worker workers[CP_HASTY_MAX_THREADS];
+	
+	pthread_mutex_t mutex;
+	pthread_cond_t workCond;
+	pthread_cond_t doneCond;
+	
+	unsigned long generation;
+	unsigned long busy;
+	cpBool quit;
+	
+	volatile unsigned long barrierCount;
+	volatile unsigned long barrierSense;
+#endif
+};
+
+//MARK: Solver Coloring
+
+static inline int
+LowestClearBit(uint64_t mask)
+{
+#if defined(__GNUC__)
+	return __builtin_ctzll(~mask);
+#else
+	int bit = 0;
+	while(mask & ((uint64_t)1 << bit)) bit++;
+	return bit;
+#endif
+}
+
+// Bodies with infinite mass and moment are never changed by the solver,
+// so any number of items in a color may share them.
+static inline cpBool
+BodyIsFixed(cpBody *body)
+{
+	return (body->m_inv == 0.0f && body->i_inv == 0.0f);
+}
+
+static inline int
+PickColor(cpBody *a, cpBody *b)
+{
+	uint64_t used = a->solverColors | b->solverColors;
+	if(used == ~(uint64_t)0) return SERIAL_COLOR;
+	
+	int color = LowestClearBit(used);
+	uint64_t bit = (uint64_t)1 << color;
+	if(!BodyIsFixed(a)) a->solverColors |= bit;
+	if(!BodyIsFixed(b)) b->solverColors |= bit;
+	
+	return color;
+}
+
+// Turn per color counts into start offsets. Returns one past the highest used regular color.
+static int
+CountsToOffsets(int *start)
+{
+	int num_colors = 0;
+	for(int i=0; i<SERIAL_COLOR; i++) if(start[i]) num_colors = i + 1;
+	
+	int offset = 0;
+	for(int i=0; i<=SERIAL_COLOR; i++){
+		int count = start[i];
+		start[i] = offset;
+		offset += count;
+	}
+	start[SERIAL_COLOR + 1] = offset;
+	
+	return num_colors;
+}
+
+static void
+cpHastySpaceColor(cpHastySpace *hasty)
+{
+	cpArray *arbiters = hasty->space.arbiters;
+	cpArray *constraints = hasty->space.constraints;
+	int numArbiters = arbiters->num;
+	int numConstraints = constraints->num;
+	
+	int count = numArbiters + numConstraints;
+	if(count > hasty->capacity){
+		hasty->capacity = count*2;
+		hasty->arbiters = (cpArbiter **)cprealloc(hasty->arbiters, hasty->capacity*sizeof(cpArbiter *));
+		hasty->constraints = (cpConstraint **)cprealloc(hasty->constraints, hasty->capacity*sizeof(cpConstraint *));
+		hasty->colors = (unsigned char *)cprealloc(hasty->colors, hasty->capacity*sizeof(unsigned char));
+	}
+	
+	for(int i=0; i<numArbiters; i++){
+		cpArbiter *arb = (cpArbiter *)arbiters->arr[i];
+		arb->body_a->solverColors = arb->body_b->solverColors = 0;
+	}
+	
+	for(int i=0; i<numConstraints; i++){
+		cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+		constraint->a->solverColors = constraint->b->solverColors = 0;
+	}
+	
+	// Colors are picked in array order, which keeps the solver order
+	// independent of the number of threads.
+	unsigned char *colors = hasty->colors;
+	int *arbiterStart = hasty->arbiterStart;
+	int *constraintStart = hasty->constraintStart;
+	memset(arbiterStart, 0, sizeof(hasty->arbiterStart));
+	memset(constraintStart, 0, sizeof(hasty->constraintStart));
+	
+	for(int i=0; i<numArbiters; i++){
+		cpArbiter *arb = (cpArbiter *)arbiters->arr[i];
+		int color = PickColor(arb->body_a, arb->body_b);
+		colors[i] = color;
+		arbiterStart[color]++;
+	}
+	
+	for(int i=0; i<numConstraints; i++){
+		cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+		int color = PickColor(constraint->a, constraint->b);
+		colors[numArbiters + i] = color;
+		constraintStart[color]++;
+	}
+	
+	int arbiterColors = CountsToOffsets(arbiterStart);
+	int constraintColors = CountsToOffsets(constraintStart);
+	hasty->num_colors = (arbiterColors > constraintColors ? arbiterColors : constraintColors);
+	
+	// Stable counting sort by color. Use the next offsets as cursors
+	// and shift them back afterwards.
+	int cursor[MAX_COLORS + 1];
+	
+	memcpy(cursor, arbiterStart, sizeof(cursor));
+	for(int i=0; i<numArbiters; i++){
+		hasty->arbiters[cursor[colors[i]]++] = (cpArbiter *)arbiters->arr[i];
+	}
+	
+	memcpy(cursor, constraintStart, sizeof(cursor));
+	for(int i=0; i<numConstraints; i++){
+		hasty->constraints[cursor[colors[numArbiters + i]]++] = (cpConstraint *)constraints->arr[i];
+	}
+}
+
+//MARK: Threaded Solver
+
+static void
+SolveColor(cpHastySpace *hasty, int color, unsigned long thread, unsigned long num_threads)
+{
+	int start = hasty->arbiterStart[color];
+	int count = hasty->arbiterStart[color + 1] - start;
+	int end = start + (int)(count*(thread + 1)/num_threads);
+	for(int i=start + (int)(count*thread/num_threads); i<end; i++){
+		cpArbiterApplyImpulse(hasty->arbiters[i]);
+	}
+	
+	start = hasty->constraintStart[color];
+	count = hasty->constraintStart[color + 1] - start;
+	end = start + (int)(count*(thread + 1)/num_threads);
+	for(int i=start + (int)(count*thread/num_threads); i<end; i++){
+		cpConstraint *constraint = hasty->constraints[i];
+		constraint->klass->applyImpulse(constraint);
+	}
+}
+
+#ifdef CP_HASTY_PTHREADS
+
+// Sense reversing spin barrier. The colors are usually small, so sleeping
+// on a condition variable between them would cost more than the solving.
+static void
+Barrier(cpHastySpace *hasty, unsigned long *sense)
+{
+	unsigned long num_threads = hasty->num_threads;
+	if(num_threads == 1) return;
+	
+	unsigned long next = !*sense;
+	*sense = next;
+	
+	if(__sync_add_and_fetch(&hasty->barrierCount, 1) == num_threads){
+		hasty->barrierCount = 0;
+		__sync_synchronize();
+		hasty->barrierSense = next;
+	} else {
+		for(int spin=0; hasty->barrierSense != next; spin++){
+			if(spin >= SPIN_LIMIT) sched_yield();
+		}
+		__sync_synchronize();
+	}
+}
+
+#else
+
+static inline void Barrier(cpHastySpace *hasty, unsigned long *sense){}
+
+#endif
+
+static void
+Solve(cpHastySpace *hasty, unsigned long thread)
+{
+	unsigned long num_threads = hasty->num_threads;
+#ifdef CP_HASTY_PTHREADS
+	unsigned long sense = hasty->barrierSense;
+#else
+	unsigned long sense = 0;
+#endif
+	
+	int num_colors = hasty->num_colors;
+	cpBool serial = (
+		hasty->arbiterStart[SERIAL_COLOR] != hasty->arbiterStart[SERIAL_COLOR + 1] ||
+		hasty->constraintStart[SERIAL_COLOR] != hasty->constraintStart[SERIAL_COLOR + 1]
+	);
+	
+	for(int i=0; i<hasty->space.iterations; i++){
+		for(int color=0; color<num_colors; color++){
+			SolveColor(hasty, color, thread, num_threads);
+			Barrier(hasty, &sense);
+		}
+		
+		if(serial){
+			if(thread == 0) SolveColor(hasty, SERIAL_COLOR, 0, 1);
+			Barrier(hasty, &sense);
+		}
+	}
+}
+
+#ifdef CP_HASTY_PTHREADS
+
+static void *
+WorkerMain(void *data)
+{
+	Worker *worker = (Worker *)data;
+	cpHastySpace *hasty = worker->hasty;
+	
+	unsigned long generation = worker->generation;
+	
+	pthread_mutex_lock(&hasty->mutex);
+	for(;;){
+		while(hasty->generation == generation && !hasty->quit){
+			pthread_cond_wait(&hasty->workCond, &hasty->mutex);
+		}
+		
+		if(hasty->quit) break;
+		
+		generation = hasty->generation;
+		pthread_mutex_unlock(&hasty->mutex);
+		
+		hasty->work(hasty, worker->thread);
+		
+		pthread_mutex_lock(&hasty->mutex);
+		if(--hasty->busy == 0) pthread_cond_signal(&hasty->doneCond);
+	}
+	pthread_mutex_unlock(&hasty->mutex);
+	
+	return NULL;
+}
+
+#endif
+
+static void
+RunWorkers(cpHastySpace *hasty, WorkFunc work)
+{
+#ifdef CP_HASTY_PTHREADS
+	if(hasty->num_threads > 1){
+		pthread_mutex_lock(&hasty->mutex);
+		hasty->work = work;
+		hasty->busy = hasty->num_threads - 1;
+		hasty->generation++;
+		pthread_cond_broadcast(&hasty->workCond);
+		pthread_mutex_unlock(&hasty->mutex);
+		
+		work(hasty, 0);
+		
+		pthread_mutex_lock(&hasty->mutex);
+		while(hasty->busy > 0) pthread_cond_wait(&hasty->doneCond, &hasty->mutex);
+		pthread_mutex_unlock(&hasty->mutex);
+		
+		return;
+	}
+#endif
+	
+	work(hasty, 0);
+}
+
+//MARK: Threaded Collision Detection
+
+static void
+TreeWork(cpHastySpace *hasty, unsigned long thread)
+{
+	// The items are handed out dynamically, not by thread.
+	(void)thread;
+	
+	for(;;){
+#ifdef CP_HASTY_PTHREADS
+		int item = __sync_fetch_and_add(&hasty->treeNext, 1);
+#else
+		int item = hasty->treeNext++;
+#endif
+		if(item >= hasty->treeCount) break;
+		
+		hasty->treeWork(hasty->treeData, item);
+	}
+}
+
+// cpBBTreeParallelFunc that hands the work items to the solver threads.
+// Items are taken in any order, the tree makes the result independent of it.
+static void
+TreeParallel(cpBBTreeParallelWorkFunc work, void *data, int count, cpHastySpace *hasty)
+{
+	if(hasty->num_threads == 1 || count <= 1){
+		for(int i=0; i<count; i++) work(data, i);
+		return;
+	}
+	
+	hasty->treeWork = work;
+	hasty->treeData = data;
+	hasty->treeCount = count;
+	hasty->treeNext = 0;
+	
+	RunWorkers(hasty, TreeWork);
+}
+
+//MARK: Memory Management Functions
+
+cpSpace *
+cpHastySpaceNew(void)
+{
+	cpHastySpace *hasty = (cpHastySpace *)cpcalloc(1, sizeof(cpHastySpace));
+	cpSpaceInit((cpSpace *)hasty);
+	
+	hasty->num_threads = 1;
+	
+	// The default spatial index is a cpBBTree, query it on the solver threads too.
+	cpBBTreeSetParallelFunc(hasty->space.activeShapes, (cpBBTreeParallelFunc)TreeParallel, hasty);
+	
+#ifdef CP_HASTY_PTHREADS
+	pthread_mutex_init(&hasty->mutex, NULL);
+	pthread_cond_init(&hasty->workCond, NULL);
+	pthread_cond_init(&hasty->doneCond, NULL);
+#endif
+	
+	return (cpSpace *)hasty;
+}
+
+void
+cpHastySpaceFree(cpSpace *space)
+{
+	cpHastySpace *hasty = (cpHastySpace *)space;
+	if(hasty){
+		cpHastySpaceSetThreads(space, 1);
+		
+#ifdef CP_HASTY_PTHREADS
+		pthread_cond_destroy(&hasty->doneCond);
+		pthread_cond_destroy(&hasty->workCond);
+		pthread_mutex_destroy(&hasty->mutex);
+#endif
+		
+		cpfree(hasty->arbiters);
+		cpfree(hasty->constraints);
+		cpfree(hasty->colors);
+		
+		cpSpaceDestroy(space);
+		cpfree(hasty);
+	}
+}
+
+//MARK: Thread Management Functions
+
+void
+cpHastySpaceSetThreads(cpSpace *space, unsigned long threads)
+{
+#ifdef CP_HASTY_PTHREADS
+	cpHastySpace *hasty = (cpHastySpace *)space;
+	
+	if(threads == 0){
+		long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+		threads = (cpus > 0 ? (unsigned long)cpus : 1);
+	}
+	
+	if(threads > CP_HASTY_MAX_THREADS) threads = CP_HASTY_MAX_THREADS;
+	if(threads == hasty->num_threads) return;
+	
+	// Stop the current workers.
+	pthread_mutex_lock(&hasty->mutex);
+	hasty->quit = cpTrue;
+	pthread_cond_broadcast(&hasty->workCond);
+	pthread_mutex_unlock(&hasty->mutex);
+	
+	for(unsigned long i=1; i<hasty->num_threads; i++){
+		pthread_join(hasty->workers[i].pthread, NULL);
+	}
+	
+	hasty->quit = cpFalse;
+	hasty->num_threads = 1;
+	
+	// Thread 0 is the calling thread.
+	for(unsigned long i=1; i<threads; i++){
+		Worker *worker = hasty->workers + i;
+		worker->hasty = hasty;
+		worker->thread = i;
+		
+		// A worker may start after the next step was issued, so it must not
+		// read the current generation itself.
+		worker->generation = hasty->generation;
+		if(pthread_create(&worker->pthread, NULL, WorkerMain, worker) != 0) break;
+		
+		hasty->num_threads++;
+	}
+#endif
+}
+
+unsigned long
+cpHastySpaceGetThreads(cpSpace *space)
+{
+	return ((cpHastySpace *)space)->num_threads;
+}
+
+//MARK: Stepping
+
+void
+cpHastySpaceStep(cpSpace *space, cpFloat dt)
+{
+	cpHastySpace *hasty = (cpHastySpace *)space;
+	
+	// don't step if the timestep is 0!
+	if(dt == 0.0f) return;
+	
+	space->stamp++;
+	
+	cpFloat prev_dt = space->curr_dt;
+	space->curr_dt = dt;
+		
+	cpArray *bodies = space->bodies;
+	cpArray *constraints = space->constraints;
+	cpArray *arbiters = space->arbiters;
+	
+	// Reset and empty the arbiter lists.
+	for(int i=0; i<arbiters->num; i++){
+		cpArbiter *arb = (cpArbiter *)arbiters->arr[i];
+		arb->state = cpArbiterStateNormal;
+		
+		// If both bodies are awake, unthread the arbiter from the contact graph.
+		if(!cpBodyIsSleeping(arb->body_a) && !cpBodyIsSleeping(arb->body_b)){
+			cpArbiterUnthread(arb);
+		}
+	}
+	arbiters->num = 0;
+
+	cpSpaceLock(space); {
+		// Integrate positions
+		for(int i=0; i<bodies->num; i++){
+			cpBody *body = (cpBody *)bodies->arr[i];
+			body->position_func(body, dt);
+		}
+		
+		// Find colliding pairs.
+		cpSpacePushFreshContactBuffer(space);
+		cpSpatialIndexEach(space->activeShapes, (cpSpatialIndexIteratorFunc)cpShapeUpdateFunc, NULL);
+		cpSpatialIndexReindexQuery(space->activeShapes, (cpSpatialIndexQueryFunc)cpSpaceCollideShapes, space);
+	} cpSpaceUnlock(space, cpFalse);
+	
+	if(space->sortArbiters) cpSpaceSortArbiters(space);
+	
+	// Rebuild the contact graph (and detect sleeping components if sleeping is enabled)
+	cpSpaceProcessComponents(space, dt);
+	
+	cpSpaceLock(space); {
+		// Clear out old cached arbiters and call separate callbacks
+		cpHashSetFilter(space->cachedArbiters, (cpHashSetFilterFunc)cpSpaceArbiterSetFilter, space);
+
+		// Prestep the arbiters and constraints.
+		cpFloat slop = space->collisionSlop;
+		cpFloat biasCoef = 1.0f - cpfpow(space->collisionBias, dt);
+		for(int i=0; i<arbiters->num; i++){
+			cpArbiterPreStep((cpArbiter *)arbiters->arr[i], dt, slop, biasCoef);
+		}
+
+		for(int i=0; i<constraints->num; i++){
+			cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+			
+			cpConstraintPreSolveFunc preSolve = constraint->preSolve;
+			if(preSolve) preSolve(constraint, space);
+			
+			constraint->klass->preStep(constraint, dt);
+		}
+	
+		// Integrate velocities.
+		cpFloat damping = cpfpow(space->damping, dt);
+		cpVect gravity = space->gravity;
+		for(int i=0; i<bodies->num; i++){
+			cpBody *body = (cpBody *)bodies->arr[i];
+			body->velocity_func(body, gravity, damping, dt);
+		}
+		
+		// Apply cached impulses
+		cpFloat dt_coef = (prev_dt == 0.0f ? 0.0f : dt/prev_dt);
+		for(int i=0; i<arbiters->num; i++){
+			cpArbiterApplyCachedImpulse((cpArbiter *)arbiters->arr[i], dt_coef);
+		}
+		
+		for(int i=0; i<constraints->num; i++){
+			cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+			constraint->klass->applyCachedImpulse(constraint, dt_coef);
+		}
+		
+		// Run the impulse solver.
+		cpHastySpaceColor(hasty);
+		RunWorkers(hasty, Solve);
+		
+		// Run the constraint post-solve callbacks
+		for(int i=0; i<constraints->num; i++){
+			cpConstraint *constraint = (cpConstraint *)constraints->arr[i];
+			
+			cpConstraintPostSolveFunc postSolve = constraint->postSolve;
+			if(postSolve) postSolve(constraint, space);
+		}
+		
+		// run the post-solve callbacks
+		for(int i=0; i<arbiters->num; i++){
+			cpArbiter *arb = (cpArbiter *) arbiters->arr[i];
+			
+			cpCollisionHandler *handler = arb->handler;
+			handler->postSolve(arb, space, handler->data);
+		}
+	} cpSpaceUnlock(space, cpTrue);
+}
@@ -63,12 +63,42 @@ cpPolyShapeTransformAxes(cpPolyShape *poly, cpVect p, cpVect rot)
 	}
 }
 
+#if CP_POLY_SOA
+// Copy the transformed data to the SoA arrays, padded by repeating the last entry.
+// A repeated vertex or plane doesn't change a min or containment result.
+static void
+cpPolyShapeTransformSoA(cpPolyShape *poly)
+{
+	int numVerts = poly->numVerts;
+	int count = cpPolyShapeSoACount(poly);
+	
+	cpFloat *x = poly->tSoA, *y = x + count;
+	cpFloat *nx = y + count, *ny = nx + count, *d = ny + count;
+	
+	for(int i=0; i<count; i++){
+		int j = (i < numVerts ? i : numVerts - 1);
+		cpVect v = poly->tVerts[j];
+		cpSplittingPlane plane = poly->tPlanes[j];
+		
+		x[i] = v.x;
+		y[i] = v.y;
+		nx[i] = plane.n.x;
+		ny[i] = plane.n.y;
+		d[i] = plane.d;
+	}
+}
+#endif
+
 static cpBB
 cpPolyShapeCacheData(cpPolyShape *poly, cpVect p, cpVect rot)
 {
 	cpPolyShapeTransformAxes(poly, p, rot);
 	cpBB bb = poly->shape.bb = cpPolyShapeTransformVerts(poly, p, rot);
 	
+#if CP_POLY_SOA
+	cpPolyShapeTransformSoA(poly);
+#endif
+	
 	return bb;
 }
 
@@ -77,6 +107,7 @@ cpPolyShapeDestroy(cpPolyShape *poly)
 {
 	cpfree(poly->verts);
 	cpfree(poly->planes);
+	cpfree(poly->tSoA);
 }
 
 static void
@@ -192,6 +223,12 @@ setUpVerts(cpPolyShape *poly, int numVerts, cpVect *verts, cpVect offset)
 	poly->tVerts = poly->verts + numVerts;
 	poly->tPlanes = poly->planes + numVerts;
 	
+#if CP_POLY_SOA
+	poly->tSoA = (cpFloat *)cpcalloc(5*cpPolyShapeSoACount(poly), sizeof(cpFloat));
+#else
+	poly->tSoA = NULL;
+#endif
+	
 	for(int i=0; i<numVerts; i++){
 		cpVect a = cpvadd(offset, verts[i]);
 		cpVect b = cpvadd(offset, verts[(i+1)%numVerts]);
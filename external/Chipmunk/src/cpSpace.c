@@ -105,6 +105,9 @@ cpSpaceInit(cpSpace *space)
 	cpBBTreeSetVelocityFunc(space->activeShapes, (cpBBTreeVelocityFunc)shapeVelocityFunc);
 	
 	space->allocatedBuffers = cpArrayNew(0);
+	space->allocFunc = NULL;
+	space->freeFunc = NULL;
+	space->allocData = NULL;
 	
 	space->bodies = cpArrayNew(0);
 	space->sleepingComponents = cpArrayNew(0);
@@ -116,6 +119,7 @@ cpSpaceInit(cpSpace *space)
 	
 	space->arbiters = cpArrayNew(0);
 	space->pooledArbiters = cpArrayNew(0);
+	space->sortArbiters = cpFalse;
 	
 	space->contactBuffersHead = NULL;
 	space->cachedArbiters = cpHashSetNew(0, (cpHashSetEqlFunc)arbiterSetEql);
@@ -144,7 +148,10 @@ cpSpaceNew(void)
 void
 cpSpaceDestroy(cpSpace *space)
 {
-	cpSpaceEachBody(space, (cpSpaceBodyIteratorFunc)cpBodyActivate, NULL);
+	// Waking a component removes it from the array, so it can't be iterated.
+	// Otherwise some components are skipped and the contacts of their arbiters leak.
+	cpArray *components = space->sleepingComponents;
+	while(components->num) cpBodyActivate((cpBody *)components->arr[components->num - 1]);
 	
 	cpSpatialIndexFree(space->staticShapes);
 	cpSpatialIndexFree(space->activeShapes);
@@ -161,10 +168,13 @@ cpSpaceDestroy(cpSpace *space)
 	cpArrayFree(space->pooledArbiters);
 	
 	if(space->allocatedBuffers){
-		cpArrayFreeEach(space->allocatedBuffers, cpfree);
-		cpArrayFree(space->allocatedBuffers);
+		cpArray *buffers = space->allocatedBuffers;
+		for(int i=0; i<buffers->num; i++) cpSpaceFreePooled(space, buffers->arr[i], CP_BUFFER_BYTES);
+		cpArrayFree(buffers);
 	}
 	
+	cpSpaceFreeContactBuffers(space);
+	
 	if(space->postStepCallbacks){
 		cpArrayFreeEach(space->postStepCallbacks, cpfree);
 		cpArrayFree(space->postStepCallbacks);
@@ -183,6 +193,42 @@ cpSpaceFree(cpSpace *space)
 	}
 }
 
+void
+cpSpaceSetAllocator(cpSpace *space, cpSpaceAllocFunc allocFunc, cpSpaceFreeFunc freeFunc, void *data)
+{
+	cpAssertHard(!space->contactBuffersHead && space->allocatedBuffers->num == 0,
+		"The allocator of a space must be set before it is stepped.");
+	cpAssertHard(!allocFunc == !freeFunc, "The allocation and free functions must be set together.");
+	
+	space->allocFunc = allocFunc;
+	space->freeFunc = freeFunc;
+	space->allocData = data;
+}
+
+void *
+cpSpaceAllocPooled(cpSpace *space, size_t size)
+{
+	if(space->allocFunc){
+		void *ptr = space->allocFunc(size, space->allocData);
+		cpAssertHard(ptr || !size, "The allocation function of the space returned NULL.");
+		
+		if(ptr) memset(ptr, 0, size);
+		return ptr;
+	} else {
+		return cpcalloc(1, size);
+	}
+}
+
+void
+cpSpaceFreePooled(cpSpace *space, void *ptr, size_t size)
+{
+	if(space->freeFunc){
+		if(ptr) space->freeFunc(ptr, size, space->allocData);
+	} else {
+		cpfree(ptr);
+	}
+}
+
 #define cpAssertSpaceUnlocked(space) \
 	cpAssertHard(!space->locked, \
 		"This addition/removal cannot be done safely during a call to cpSpaceStep() or during a query. " \
@@ -537,12 +583,9 @@ copyShapes(cpShape *shape, cpSpatialIndex *index)
 	cpSpatialIndexInsert(index, shape, shape->hashid);
 }
 
-void
-cpSpaceUseSpatialHash(cpSpace *space, cpFloat dim, int count)
+static void
+ReplaceIndexes(cpSpace *space, cpSpatialIndex *staticShapes, cpSpatialIndex *activeShapes)
 {
-	cpSpatialIndex *staticShapes = cpSpaceHashNew(dim, count, (cpSpatialIndexBBFunc)cpShapeGetBB, NULL);
-	cpSpatialIndex *activeShapes = cpSpaceHashNew(dim, count, (cpSpatialIndexBBFunc)cpShapeGetBB, staticShapes);
-	
 	cpSpatialIndexEach(space->staticShapes, (cpSpatialIndexIteratorFunc)copyShapes, staticShapes);
 	cpSpatialIndexEach(space->activeShapes, (cpSpatialIndexIteratorFunc)copyShapes, activeShapes);
 	
@@ -552,3 +595,19 @@ cpSpaceUseSpatialHash(cpSpace *space, cpFloat dim, int count)
 	space->staticShapes = staticShapes;
 	space->activeShapes = activeShapes;
 }
+
+void
+cpSpaceUseSpatialHash(cpSpace *space, cpFloat dim, int count)
+{
+	cpSpatialIndex *staticShapes = cpSpaceHashNew(dim, count, (cpSpatialIndexBBFunc)cpShapeGetBB, NULL);
+	cpSpatialIndex *activeShapes = cpSpaceHashNew(dim, count, (cpSpatialIndexBBFunc)cpShapeGetBB, staticShapes);
+	ReplaceIndexes(space, staticShapes, activeShapes);
+}
+
+void
+cpSpaceUseSpatialGrid(cpSpace *space, cpBB bounds, cpFloat dim)
+{
+	cpSpatialIndex *staticShapes = cpSpaceHashNewGrid(bounds, dim, (cpSpatialIndexBBFunc)cpShapeGetBB, NULL);
+	cpSpatialIndex *activeShapes = cpSpaceHashNewGrid(bounds, dim, (cpSpatialIndexBBFunc)cpShapeGetBB, staticShapes);
+	ReplaceIndexes(space, staticShapes, activeShapes);
+}
@@ -63,7 +63,7 @@ cpSpaceActivateBody(cpSpace *space, cpBody *body)
 				arb->handler = cpSpaceLookupHandler(space, a->collision_type, b->collision_type);
 				cpArrayPush(space->arbiters, arb);
 				
-				cpfree(contacts);
+				cpSpaceFreePooled(space, contacts, numContacts*sizeof(cpContact));
 			}
 		}
 		
@@ -93,7 +93,7 @@ cpSpaceDeactivateBody(cpSpace *space, cpBody *body)
 			
 			// Save contact values to a new block of memory so they won't time out
 			size_t bytes = arb->numContacts*sizeof(cpContact);
-			cpContact *contacts = (cpContact *)cpcalloc(1, bytes);
+			cpContact *contacts = (cpContact *)cpSpaceAllocPooled(space, bytes);
 			memcpy(contacts, arb->contacts, bytes);
 			arb->contacts = contacts;
 		}
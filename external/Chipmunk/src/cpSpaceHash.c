@@ -39,6 +39,17 @@ struct cpSpaceHash {
 	cpArray *allocatedBuffers;
 	
 	cpTimestamp stamp;
+	
+	// Dense grid mode. gridWidth is 0 when the cells are hashed.
+	cpBB gridBounds;
+	int gridX, gridY;
+	int gridWidth, gridHeight;
+	
+	// Automatic resizing, the object sizes are sampled while rehashing everything.
+	cpBool autoResize;
+	int autoResizes;
+	cpFloat sampleSum;
+	int sampleCount;
 };
 
 
@@ -168,6 +179,21 @@ cpSpaceHashAllocTable(cpSpaceHash *hash, int numcells)
 	hash->table = (cpSpaceHashBin **)cpcalloc(numcells, sizeof(cpSpaceHashBin *));
 }
 
+// Frees the old table, and allocate one cell for each grid coordinate inside the bounds.
+static void
+cpSpaceHashAllocGrid(cpSpaceHash *hash)
+{
+	cpBB bounds = hash->gridBounds;
+	cpFloat dim = hash->celldim;
+	
+	hash->gridX = (int)cpffloor(bounds.l/dim);
+	hash->gridY = (int)cpffloor(bounds.b/dim);
+	hash->gridWidth = (int)cpffloor(bounds.r/dim) - hash->gridX + 1;
+	hash->gridHeight = (int)cpffloor(bounds.t/dim) - hash->gridY + 1;
+	
+	cpSpaceHashAllocTable(hash, hash->gridWidth*hash->gridHeight);
+}
+
 static inline cpSpatialIndexClass *Klass();
 
 cpSpatialIndex *
@@ -187,6 +213,11 @@ cpSpaceHashInit(cpSpaceHash *hash, cpFloat celldim, int numcells, cpSpatialIndex
 	
 	hash->stamp = 1;
 	
+	hash->gridWidth = hash->gridHeight = 0;
+	
+	hash->autoResize = cpFalse;
+	hash->autoResizes = 0;
+	
 	return (cpSpatialIndex *)hash;
 }
 
@@ -196,6 +227,23 @@ cpSpaceHashNew(cpFloat celldim, int cells, cpSpatialIndexBBFunc bbfunc, cpSpatia
 	return cpSpaceHashInit(cpSpaceHashAlloc(), celldim, cells, bbfunc, staticIndex);
 }
 
+cpSpatialIndex *
+cpSpaceHashInitGrid(cpSpaceHash *hash, cpBB bounds, cpFloat celldim, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex)
+{
+	cpSpaceHashInit(hash, celldim, 0, bbfunc, staticIndex);
+	
+	hash->gridBounds = bounds;
+	cpSpaceHashAllocGrid(hash);
+	
+	return (cpSpatialIndex *)hash;
+}
+
+cpSpatialIndex *
+cpSpaceHashNewGrid(cpBB bounds, cpFloat celldim, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex)
+{
+	return cpSpaceHashInitGrid(cpSpaceHashAlloc(), bounds, celldim, bbfunc, staticIndex);
+}
+
 static void
 cpSpaceHashDestroy(cpSpaceHash *hash)
 {
@@ -229,6 +277,34 @@ hash_func(cpHashValue x, cpHashValue y, cpHashValue n)
 	return (x*1640531513ul ^ y*2654435789ul) % n;
 }
 
+static inline int
+clamp_int(int i, int min, int max)
+{
+	return (i < min ? min : (i > max ? max : i));
+}
+
+// Table index of a cell. Dense grids clamp the coordinates so the border cells also hold everything outside the bounds.
+static inline cpHashValue
+cell_index(cpSpaceHash *hash, int x, int y)
+{
+	int width = hash->gridWidth;
+	
+	if(width){
+		x = clamp_int(x - hash->gridX, 0, width - 1);
+		y = clamp_int(y - hash->gridY, 0, hash->gridHeight - 1);
+		return x + y*width;
+	} else {
+		return hash_func(x, y, hash->numcells);
+	}
+}
+
+static inline void
+sampleBB(cpSpaceHash *hash, cpBB bb)
+{
+	hash->sampleSum += cpfmax(bb.r - bb.l, bb.t - bb.b);
+	hash->sampleCount++;
+}
+
 // Much faster than (int)floor(f)
 // Profiling showed floor() to be a sizable performance hog
 static inline int
@@ -248,10 +324,9 @@ hashHandle(cpSpaceHash *hash, cpHandle *hand, cpBB bb)
 	int b = floor_int(bb.b/dim);
 	int t = floor_int(bb.t/dim);
 	
-	int n = hash->numcells;
 	for(int i=l; i<=r; i++){
 		for(int j=b; j<=t; j++){
-			cpHashValue idx = hash_func(i,j,n);
+			cpHashValue idx = cell_index(hash, i, j);
 			cpSpaceHashBin *bin = hash->table[idx];
 			
 			// Don't add an object twice to the same cell.
@@ -292,14 +367,23 @@ cpSpaceHashRehashObject(cpSpaceHash *hash, void *obj, cpHashValue hashid)
 static void
 rehash_helper(cpHandle *hand, cpSpaceHash *hash)
 {
-	hashHandle(hash, hand, hash->spatialIndex.bbfunc(hand->obj));
+	cpBB bb = hash->spatialIndex.bbfunc(hand->obj);
+	sampleBB(hash, bb);
+	hashHandle(hash, hand, bb);
 }
 
+static void cpSpaceHashAutoResize(cpSpaceHash *hash);
+
 static void
 cpSpaceHashRehash(cpSpaceHash *hash)
 {
 	clearTable(hash);
+	
+	hash->sampleSum = 0.0f;
+	hash->sampleCount = 0;
 	cpHashSetEach(hash->handleSet, (cpHashSetIteratorFunc)rehash_helper, hash);
+	
+	cpSpaceHashAutoResize(hash);
 }
 
 static void
@@ -383,13 +467,12 @@ cpSpaceHashQuery(cpSpaceHash *hash, void *obj, cpBB bb, cpSpatialIndexQueryFunc
 	int b = floor_int(bb.b/dim);
 	int t = floor_int(bb.t/dim);
 	
-	int n = hash->numcells;
 	cpSpaceHashBin **table = hash->table;
 	
 	// Iterate over the cells and query them.
 	for(int i=l; i<=r; i++){
 		for(int j=b; j<=t; j++){
-			query_helper(hash, &table[hash_func(i,j,n)], obj, func, data);
+			query_helper(hash, &table[cell_index(hash, i, j)], obj, func, data);
 		}
 	}
 	
@@ -412,10 +495,10 @@ queryRehash_helper(cpHandle *hand, queryRehashContext *context)
 	void *data = context->data;
 
 	cpFloat dim = hash->celldim;
-	int n = hash->numcells;
 
 	void *obj = hand->obj;
 	cpBB bb = hash->spatialIndex.bbfunc(obj);
+	sampleBB(hash, bb);
 
 	int l = floor_int(bb.l/dim);
 	int r = floor_int(bb.r/dim);
@@ -426,7 +509,7 @@ queryRehash_helper(cpHandle *hand, queryRehashContext *context)
 
 	for(int i=l; i<=r; i++){
 		for(int j=b; j<=t; j++){
-			cpHashValue idx = hash_func(i,j,n);
+			cpHashValue idx = cell_index(hash, i, j);
 			cpSpaceHashBin *bin = table[idx];
 			
 			if(containsHandle(bin, hand)) continue;
@@ -450,10 +533,15 @@ cpSpaceHashReindexQuery(cpSpaceHash *hash, cpSpatialIndexQueryFunc func, void *d
 {
 	clearTable(hash);
 	
+	hash->sampleSum = 0.0f;
+	hash->sampleCount = 0;
+	
 	queryRehashContext context = {hash, func, data};
 	cpHashSetEach(hash->handleSet, (cpHashSetIteratorFunc)queryRehash_helper, &context);
 	
 	cpSpatialIndexCollideStatic((cpSpatialIndex *)hash, hash->spatialIndex.staticIndex, func, data);
+	
+	cpSpaceHashAutoResize(hash);
 }
 
 static inline cpFloat
@@ -521,11 +609,10 @@ cpSpaceHashSegmentQuery(cpSpaceHash *hash, void *obj, cpVect a, cpVect b, cpFloa
 	cpFloat next_h = (temp_h ? temp_h*dt_dx : dt_dx);
 	cpFloat next_v = (temp_v ? temp_v*dt_dy : dt_dy);
 	
-	int n = hash->numcells;
 	cpSpaceHashBin **table = hash->table;
 
 	while(t < t_exit){
-		cpHashValue idx = hash_func(cell_x, cell_y, n);
+		cpHashValue idx = cell_index(hash, cell_x, cell_y);
 		t_exit = cpfmin(t_exit, segmentQuery_helper(hash, &table[idx], obj, func, data));
 
 		if (next_v < next_h){
@@ -555,7 +642,151 @@ cpSpaceHashResize(cpSpaceHash *hash, cpFloat celldim, int numcells)
 	clearTable(hash);
 	
 	hash->celldim = celldim;
-	cpSpaceHashAllocTable(hash, next_prime(numcells));
+	if(hash->gridWidth){
+		cpSpaceHashAllocGrid(hash);
+	} else {
+		cpSpaceHashAllocTable(hash, next_prime(numcells));
+	}
+}
+
+// Resize when the cell size is off from the average object size by more than this factor.
+#define AUTO_RESIZE_DIM_RATIO 1.5f
+// Hashed tables aim for this many cells per object and are resized when off by more than a factor of 4.
+#define AUTO_RESIZE_CELLS_PER_OBJECT 10
+#define AUTO_RESIZE_MIN_CELLS 1000
+
+// Called after everything was rehashed and sampled.
+static void
+cpSpaceHashAutoResize(cpSpaceHash *hash)
+{
+	int count = hash->sampleCount;
+	if(!hash->autoResize || count == 0) return;
+	
+	cpFloat celldim = hash->celldim;
+	cpFloat dim = hash->sampleSum/count;
+	if(dim > 0.0f && (dim > celldim*AUTO_RESIZE_DIM_RATIO || dim*AUTO_RESIZE_DIM_RATIO < celldim)) celldim = dim;
+	
+	int numcells = hash->numcells;
+	if(hash->gridWidth){
+		// Don't let a dense grid grow past the size of a well tuned hash table.
+		cpBB bounds = hash->gridBounds;
+		cpFloat cells = (cpffloor(bounds.r/celldim) - cpffloor(bounds.l/celldim) + 1)*(cpffloor(bounds.t/celldim) - cpffloor(bounds.b/celldim) + 1);
+		if(cells > numcells && cells > 4*AUTO_RESIZE_CELLS_PER_OBJECT*count) return;
+	} else {
+		int target = count*AUTO_RESIZE_CELLS_PER_OBJECT;
+		if(target < AUTO_RESIZE_MIN_CELLS) target = AUTO_RESIZE_MIN_CELLS;
+		if(numcells*4 < target || numcells > target*4) numcells = target;
+	}
+	
+	if(celldim == hash->celldim && numcells == hash->numcells) return;
+	
+	cpSpaceHashResize(hash, celldim, numcells);
+	hash->autoResizes++;
+	
+	// Resizing cleared the table, put everything back.
+	cpHashSetEach(hash->handleSet, (cpHashSetIteratorFunc)rehash_helper, hash);
+}
+
+void
+cpSpaceHashSetAutoResize(cpSpatialIndex *index, cpBool autoResize)
+{
+	if(index->klass != Klass()){
+		cpAssertWarn(cpFalse, "Ignoring cpSpaceHashSetAutoResize() call to non-cpSpaceHash spatial index.");
+		return;
+	}
+	
+	((cpSpaceHash *)index)->autoResize = autoResize;
+}
+
+// Records the first grid coordinate that used a table cell while gathering the statistics.
+typedef struct CellOwner {
+	int x, y;
+	cpBool used, colliding;
+} CellOwner;
+
+typedef struct statsContext {
+	cpSpaceHash *hash;
+	CellOwner *owners;
+	cpSpaceHashStats *stats;
+} statsContext;
+
+static void
+stats_helper(cpHandle *hand, statsContext *context)
+{
+	cpSpaceHash *hash = context->hash;
+	cpFloat dim = hash->celldim;
+	cpBB bb = hash->spatialIndex.bbfunc(hand->obj);
+	
+	int l = floor_int(bb.l/dim);
+	int r = floor_int(bb.r/dim);
+	int b = floor_int(bb.b/dim);
+	int t = floor_int(bb.t/dim);
+	
+	for(int i=l; i<=r; i++){
+		for(int j=b; j<=t; j++){
+			CellOwner *owner = context->owners + cell_index(hash, i, j);
+			
+			if(!owner->used){
+				owner->x = i; owner->y = j;
+				owner->used = cpTrue;
+			} else if(!owner->colliding && (owner->x != i || owner->y != j) && !hash->gridWidth){
+				owner->colliding = cpTrue;
+				context->stats->collidingCells++;
+			}
+		}
+	}
+}
+
+void
+cpSpaceHashGetStats(cpSpatialIndex *index, cpSpaceHashStats *stats)
+{
+	if(index->klass != Klass()){
+		cpAssertWarn(cpFalse, "Ignoring cpSpaceHashGetStats() call to non-cpSpaceHash spatial index.");
+		return;
+	}
+	
+	cpSpaceHash *hash = (cpSpaceHash *)index;
+	int numcells = hash->numcells;
+	
+	stats->numcells = numcells;
+	stats->celldim = hash->celldim;
+	stats->objects = cpHashSetCount(hash->handleSet);
+	stats->entries = 0;
+	stats->usedCells = 0;
+	stats->longestChain = 0;
+	stats->collidingCells = 0;
+	stats->autoResizes = hash->autoResizes;
+	
+	for(int i=0; i<numcells; i++){
+		int length = 0;
+		for(cpSpaceHashBin *bin = hash->table[i]; bin; bin = bin->next){
+			if(bin->handle->obj) length++;
+		}
+		
+		stats->entries += length;
+		if(length) stats->usedCells++;
+		if(length > stats->longestChain) stats->longestChain = length;
+	}
+	
+	stats->averageOccupancy = (stats->usedCells ? (cpFloat)stats->entries/(cpFloat)stats->usedCells : 0.0f);
+	
+	CellOwner *owners = (CellOwner *)cpcalloc(numcells, sizeof(CellOwner));
+	statsContext context = {hash, owners, stats};
+	cpHashSetEach(hash->handleSet, (cpHashSetIteratorFunc)stats_helper, &context);
+	cpfree(owners);
+}
+
+void
+cpSpaceHashGetPoolBytes(cpSpatialIndex *index, size_t *live, size_t *pooled)
+{
+	if(index->klass != Klass()) return;
+	cpSpaceHash *hash = (cpSpaceHash *)index;
+	
+	size_t bytes = hash->pooledHandles->num*sizeof(cpHandle);
+	for(cpSpaceHashBin *bin = hash->pooledBins; bin; bin = bin->next) bytes += sizeof(cpSpaceHashBin);
+	
+	*live += hash->allocatedBuffers->num*CP_BUFFER_BYTES - bytes;
+	*pooled += bytes;
 }
 
 static int
@@ -610,8 +841,6 @@ cpSpaceHashRenderDebug(cpSpatialIndex *index)
 	cpBB bb = cpBBNew(-320, -240, 320, 240);
 	
 	cpFloat dim = hash->celldim;
-	int n = hash->numcells;
-	
 	int l = (int)floor(bb.l/dim);
 	int r = (int)floor(bb.r/dim);
 	int b = (int)floor(bb.b/dim);
@@ -621,7 +850,7 @@ cpSpaceHashRenderDebug(cpSpatialIndex *index)
 		for(int j=b; j<=t; j++){
 			int cell_count = 0;
 			
-			int index = hash_func(i,j,n);
+			int index = cell_index(hash, i, j);
 			for(cpSpaceHashBin *bin = hash->table[index]; bin; bin = bin->next)
 				cell_count++;
 			
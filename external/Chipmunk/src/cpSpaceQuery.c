@@ -310,3 +310,238 @@ cpSpaceShapeQuery(cpSpace *space, cpShape *shape, cpSpaceShapeQueryFunc func, vo
 	
 	return context.anyCollision;
 }
+
+//MARK: Batch Query Functions
+
+// The batch queries are split into packets that each traverse the spatial indexes once.
+// The packets run on the threads of the active index's parallel function (see cpHastySpace.c).
+static void
+RunBatch(cpSpace *space, int count, cpBBTreeParallelWorkFunc work, void *batch)
+{
+	int packets = (count + CP_BBTREE_PACKET_SIZE - 1)/CP_BBTREE_PACKET_SIZE;
+	
+	if(space->locked){
+		// The worker threads may be busy with the step that is calling back.
+		for(int i=0; i<packets; i++) work(batch, i);
+	} else {
+		cpSpaceLock(space); {
+			cpBBTreeRunParallel(space->activeShapes, work, batch, packets);
+		} cpSpaceUnlock(space, cpTrue);
+	}
+}
+
+static inline int
+PacketStart(int packet)
+{
+	return packet*CP_BBTREE_PACKET_SIZE;
+}
+
+static inline int
+PacketCount(int count, int packet)
+{
+	int remaining = count - PacketStart(packet);
+	return (remaining < CP_BBTREE_PACKET_SIZE ? remaining : CP_BBTREE_PACKET_SIZE);
+}
+
+struct PointQueryBatch {
+	cpSpace *space;
+	int count;
+	const cpVect *points;
+	cpLayers layers;
+	cpGroup group;
+	cpShape **out;
+};
+
+static void
+PointQueryFirstBatchItem(struct PointQueryBatch *batch, cpShape *shape, int item, void *unused)
+{
+	if(
+		!(shape->group && batch->group == shape->group) && (batch->layers&shape->layers) &&
+		!shape->sensor && cpShapePointQuery(shape, batch->points[item])
+	){
+		batch->out[item] = shape;
+	}
+}
+
+static void
+PointQueryFirstBatchPacket(struct PointQueryBatch *batch, int packet)
+{
+	int start = PacketStart(packet), count = PacketCount(batch->count, packet);
+	
+	struct PointQueryBatch context = *batch;
+	context.points += start;
+	context.out += start;
+	
+	cpBB bbs[CP_BBTREE_PACKET_SIZE];
+	for(int i=0; i<count; i++){
+		bbs[i] = cpBBNewForCircle(context.points[i], 0.0f);
+		context.out[i] = NULL;
+	}
+	
+	cpSpace *space = batch->space;
+	cpBBTreeQueryPacket(space->activeShapes, &context, count, bbs, (cpBBTreePacketQueryFunc)PointQueryFirstBatchItem, NULL);
+	cpBBTreeQueryPacket(space->staticShapes, &context, count, bbs, (cpBBTreePacketQueryFunc)PointQueryFirstBatchItem, NULL);
+}
+
+void
+cpSpacePointQueryFirstBatch(cpSpace *space, int count, const cpVect *points, cpLayers layers, cpGroup group, cpShape **out)
+{
+	struct PointQueryBatch batch = {space, count, points, layers, group, out};
+	RunBatch(space, count, (cpBBTreeParallelWorkFunc)PointQueryFirstBatchPacket, &batch);
+}
+
+struct NearestPointQueryBatch {
+	cpSpace *space;
+	int count;
+	const cpVect *points;
+	cpFloat maxDistance;
+	cpLayers layers;
+	cpGroup group;
+	cpNearestPointQueryInfo *out;
+};
+
+static void
+NearestPointQueryNearestBatchItem(struct NearestPointQueryBatch *batch, cpShape *shape, int item, void *unused)
+{
+	if(
+		!(shape->group && batch->group == shape->group) && (batch->layers&shape->layers) && !shape->sensor
+	){
+		cpNearestPointQueryInfo info;
+		cpShapeNearestPointQuery(shape, batch->points[item], &info);
+		
+		if(info.d < batch->out[item].d) batch->out[item] = info;
+	}
+}
+
+static void
+NearestPointQueryNearestBatchPacket(struct NearestPointQueryBatch *batch, int packet)
+{
+	int start = PacketStart(packet), count = PacketCount(batch->count, packet);
+	
+	struct NearestPointQueryBatch context = *batch;
+	context.points += start;
+	context.out += start;
+	
+	cpNearestPointQueryInfo info = {NULL, cpvzero, batch->maxDistance};
+	cpBB bbs[CP_BBTREE_PACKET_SIZE];
+	for(int i=0; i<count; i++){
+		bbs[i] = cpBBNewForCircle(context.points[i], cpfmax(batch->maxDistance, 0.0f));
+		context.out[i] = info;
+	}
+	
+	cpSpace *space = batch->space;
+	cpBBTreeQueryPacket(space->activeShapes, &context, count, bbs, (cpBBTreePacketQueryFunc)NearestPointQueryNearestBatchItem, NULL);
+	cpBBTreeQueryPacket(space->staticShapes, &context, count, bbs, (cpBBTreePacketQueryFunc)NearestPointQueryNearestBatchItem, NULL);
+}
+
+void
+cpSpaceNearestPointQueryNearestBatch(cpSpace *space, int count, const cpVect *points, cpFloat maxDistance, cpLayers layers, cpGroup group, cpNearestPointQueryInfo *out)
+{
+	struct NearestPointQueryBatch batch = {space, count, points, maxDistance, layers, group, out};
+	RunBatch(space, count, (cpBBTreeParallelWorkFunc)NearestPointQueryNearestBatchPacket, &batch);
+}
+
+struct SegmentQueryBatch {
+	cpSpace *space;
+	int count;
+	const cpVect *starts, *ends;
+	cpLayers layers;
+	cpGroup group;
+	cpSegmentQueryInfo *out;
+};
+
+static cpFloat
+SegmentQueryFirstBatchItem(struct SegmentQueryBatch *batch, cpShape *shape, int item, void *unused)
+{
+	cpSegmentQueryInfo info;
+	cpSegmentQueryInfo *out = batch->out + item;
+	
+	if(
+		!(shape->group && batch->group == shape->group) && (batch->layers&shape->layers) &&
+		!shape->sensor &&
+		cpShapeSegmentQuery(shape, batch->starts[item], batch->ends[item], &info) &&
+		info.t < out->t
+	){
+		(*out) = info;
+	}
+	
+	return out->t;
+}
+
+static void
+SegmentQueryFirstBatchPacket(struct SegmentQueryBatch *batch, int packet)
+{
+	int start = PacketStart(packet), count = PacketCount(batch->count, packet);
+	
+	struct SegmentQueryBatch context = *batch;
+	context.starts += start;
+	context.ends += start;
+	context.out += start;
+	
+	cpSegmentQueryInfo info = {NULL, 1.0f, cpvzero};
+	cpFloat t_exit[CP_BBTREE_PACKET_SIZE];
+	for(int i=0; i<count; i++){
+		context.out[i] = info;
+		t_exit[i] = 1.0f;
+	}
+	
+	cpSpace *space = batch->space;
+	cpBBTreeSegmentQueryPacket(space->staticShapes, &context, count, context.starts, context.ends, t_exit, (cpBBTreePacketSegmentQueryFunc)SegmentQueryFirstBatchItem, NULL);
+	
+	for(int i=0; i<count; i++) t_exit[i] = context.out[i].t;
+	cpBBTreeSegmentQueryPacket(space->activeShapes, &context, count, context.starts, context.ends, t_exit, (cpBBTreePacketSegmentQueryFunc)SegmentQueryFirstBatchItem, NULL);
+}
+
+void
+cpSpaceSegmentQueryFirstBatch(cpSpace *space, int count, const cpVect *starts, const cpVect *ends, cpLayers layers, cpGroup group, cpSegmentQueryInfo *out)
+{
+	struct SegmentQueryBatch batch = {space, count, starts, ends, layers, group, out};
+	RunBatch(space, count, (cpBBTreeParallelWorkFunc)SegmentQueryFirstBatchPacket, &batch);
+}
+
+struct BBQueryBatch {
+	cpSpace *space;
+	int count;
+	const cpBB *bbs;
+	cpLayers layers;
+	cpGroup group;
+	cpShape **shapes;
+	int maxShapes;
+	int *counts;
+};
+
+static void
+BBQueryBatchItem(struct BBQueryBatch *batch, cpShape *shape, int item, void *unused)
+{
+	if(
+		!(shape->group && batch->group == shape->group) && (batch->layers&shape->layers) &&
+		cpBBIntersects(batch->bbs[item], shape->bb)
+	){
+		int count = batch->counts[item]++;
+		if(count < batch->maxShapes) batch->shapes[item*batch->maxShapes + count] = shape;
+	}
+}
+
+static void
+BBQueryBatchPacket(struct BBQueryBatch *batch, int packet)
+{
+	int start = PacketStart(packet), count = PacketCount(batch->count, packet);
+	
+	struct BBQueryBatch context = *batch;
+	context.bbs += start;
+	context.shapes += start*batch->maxShapes;
+	context.counts += start;
+	
+	for(int i=0; i<count; i++) context.counts[i] = 0;
+	
+	cpSpace *space = batch->space;
+	cpBBTreeQueryPacket(space->activeShapes, &context, count, context.bbs, (cpBBTreePacketQueryFunc)BBQueryBatchItem, NULL);
+	cpBBTreeQueryPacket(space->staticShapes, &context, count, context.bbs, (cpBBTreePacketQueryFunc)BBQueryBatchItem, NULL);
+}
+
+void
+cpSpaceBBQueryBatch(cpSpace *space, int count, const cpBB *bbs, cpLayers layers, cpGroup group, cpShape **shapes, int maxShapes, int *counts)
+{
+	struct BBQueryBatch batch = {space, count, bbs, layers, group, shapes, maxShapes, counts};
+	RunBatch(space, count, (cpBBTreeParallelWorkFunc)BBQueryBatchPacket, &batch);
+}
@@ -0,0 +1,548 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "chipmunk_private.h"
+#include "cpSpaceSnapshot.h"
+
+//MARK: Snapshot Format
+
+// The data is a header followed by these records in order:
+//   bodies       BodyRecord, the awake bodies in space->bodies order, then the sleeping ones
+//   components   cpBody *, the roots in space->sleepingComponents order
+//   roused       cpBody *, space->rousedBodies
+//   constraints  ConstraintRecord followed by its class specific bytes, the awake
+//                constraints in space->constraints order, then the sleeping ones
+//   arbiters     ArbiterRecord followed by its contacts, the cached arbiters and
+//                then the arbiters of sleeping bodies
+//   active       cpArbiter *, space->arbiters
+// Objects are referenced by address. Arbiters are never freed before their space,
+// so a restore reuses the same arbiter structs and their contact graph pointers stay valid.
+
+#define SNAPSHOT_MAGIC 0x4350534E
+#define SNAPSHOT_VERSION 1
+
+typedef struct Header {
+	unsigned int magic, version;
+	
+	cpTimestamp stamp;
+	cpFloat curr_dt;
+	
+	int numBodies, numAwakeBodies;
+	int numComponents;
+	int numRoused;
+	int numConstraints, numAwakeConstraints;
+	int numArbiters;
+	int numActiveArbiters;
+} Header;
+
+typedef struct BodyRecord {
+	cpBody *body;
+	
+	cpVect p, v, f;
+	cpFloat a, w, t;
+	cpVect rot;
+	
+	cpVect v_bias;
+	cpFloat w_bias;
+	
+	cpComponentNode node;
+} BodyRecord;
+
+typedef struct ConstraintRecord {
+	cpConstraint *constraint;
+	size_t size;
+} ConstraintRecord;
+
+typedef struct ArbiterRecord {
+	cpArbiter *arb;
+	cpShape *a, *b;
+	
+	cpFloat e, u;
+	cpVect surface_vr;
+	
+	struct cpArbiterThread thread_a, thread_b;
+	// Set if the arbiter is the head of the body's arbiter list.
+	cpBool head_a, head_b;
+	
+	// Set if the contacts live in a contact buffer, otherwise the arbiter belongs
+	// to a sleeping body and owns its contacts.
+	cpBool cached;
+	cpBool swappedColl;
+	cpArbiterState state;
+	cpTimestamp stamp;
+	
+	int numContacts;
+} ArbiterRecord;
+
+struct cpSpaceSnapshot {
+	size_t size, capacity;
+	unsigned char *data;
+};
+
+//MARK: Reading and Writing
+
+static void
+Write(cpSpaceSnapshot *snapshot, const void *ptr, size_t size)
+{
+	size_t required = snapshot->size + size;
+	if(required > snapshot->capacity){
+		size_t capacity = (snapshot->capacity ? snapshot->capacity : 1024);
+		while(capacity < required) capacity *= 2;
+		
+		snapshot->data = (unsigned char *)cprealloc(snapshot->data, capacity);
+		snapshot->capacity = capacity;
+	}
+	
+	memcpy(snapshot->data + snapshot->size, ptr, size);
+	snapshot->size = required;
+}
+
+static void
+WritePointers(cpSpaceSnapshot *snapshot, cpArray *arr)
+{
+	Write(snapshot, arr->arr, arr->num*sizeof(void *));
+}
+
+// The data may come from cpSpaceSnapshotSetData() and is not necessarily aligned,
+// so records are copied out instead of being accessed in place.
+typedef struct Reader {
+	const unsigned char *data;
+	size_t size;
+} Reader;
+
+static void
+Read(Reader *reader, void *ptr, size_t size)
+{
+	cpAssertHard(size <= reader->size, "Snapshot data is truncated.");
+	
+	memcpy(ptr, reader->data, size);
+	reader->data += size;
+	reader->size -= size;
+}
+
+static void
+ReadPointers(Reader *reader, cpArray *arr, int count)
+{
+	while(arr->max < count){
+		arr->max = 3*(arr->max + 1)/2;
+		arr->arr = (void **)cprealloc(arr->arr, arr->max*sizeof(void *));
+	}
+	
+	Read(reader, arr->arr, count*sizeof(void *));
+	arr->num = count;
+}
+
+//MARK: Constraints
+
+// Only the built in constraints are supported, their state lives after the cpConstraint header.
+static size_t
+ConstraintSize(cpConstraint *constraint)
+{
+	const cpConstraintClass *klass = constraint->klass;
+	
+	if(klass == cpPinJointGetClass()) return sizeof(cpPinJoint);
+	if(klass == cpSlideJointGetClass()) return sizeof(cpSlideJoint);
+	if(klass == cpPivotJointGetClass()) return sizeof(cpPivotJoint);
+	if(klass == cpGrooveJointGetClass()) return sizeof(cpGrooveJoint);
+	if(klass == cpDampedSpringGetClass()) return sizeof(cpDampedSpring);
+	if(klass == cpDampedRotarySpringGetClass()) return sizeof(cpDampedRotarySpring);
+	if(klass == cpRotaryLimitJointGetClass()) return sizeof(cpRotaryLimitJoint);
+	if(klass == cpRatchetJointGetClass()) return sizeof(cpRatchetJoint);
+	if(klass == cpGearJointGetClass()) return sizeof(cpGearJoint);
+	if(klass == cpSimpleMotorGetClass()) return sizeof(cpSimpleMotor);
+	
+	cpAssertHard(cpFalse, "cpSpaceSnapshot only supports the built in constraint types.");
+	return 0;
+}
+
+static void
+WriteConstraint(cpSpaceSnapshot *snapshot, cpConstraint *constraint)
+{
+	size_t size = ConstraintSize(constraint) - sizeof(cpConstraint);
+	ConstraintRecord record = {constraint, size};
+	
+	Write(snapshot, &record, sizeof(record));
+	Write(snapshot, constraint + 1, size);
+}
+
+//MARK: Capture
+
+static void
+WriteBody(cpSpaceSnapshot *snapshot, cpBody *body)
+{
+	BodyRecord record = {
+		body,
+		body->p, body->v, body->f,
+		body->a, body->w, body->t,
+		body->rot,
+		body->v_bias, body->w_bias,
+		body->node,
+	};
+	
+	Write(snapshot, &record, sizeof(record));
+}
+
+static void
+WriteArbiter(cpArbiter *arb, cpSpaceSnapshot *snapshot, cpBool cached)
+{
+	ArbiterRecord record = {
+		arb, arb->a, arb->b,
+		arb->e, arb->u, arb->surface_vr,
+		arb->thread_a, arb->thread_b,
+		(arb->body_a->arbiterList == arb), (arb->body_b->arbiterList == arb),
+		cached, arb->swappedColl, arb->state, arb->stamp,
+		arb->numContacts,
+	};
+	
+	Write(snapshot, &record, sizeof(record));
+	Write(snapshot, arb->contacts, arb->numContacts*sizeof(cpContact));
+}
+
+static void
+WriteCachedArbiter(cpArbiter *arb, cpSpaceSnapshot *snapshot)
+{
+	WriteArbiter(arb, snapshot, cpTrue);
+}
+
+// Same test as cpSpaceDeactivateBody() uses to visit each arbiter and constraint once.
+static inline cpBool
+BodyOwns(cpBody *body, cpBody *bodyA)
+{
+	return (body == bodyA || cpBodyIsStatic(bodyA));
+}
+
+void
+cpSpaceSnapshotCapture(cpSpaceSnapshot *snapshot, cpSpace *space)
+{
+	cpAssertHard(!space->locked, "cpSpaceSnapshotCapture() cannot be called while the space is locked.");
+	space->sortArbiters = cpTrue;
+	
+	// The counts are filled below, the header is written again at the end.
+	Header header = {SNAPSHOT_MAGIC, SNAPSHOT_VERSION, space->stamp, space->curr_dt, 0, 0, 0, 0, 0, 0, 0, 0};
+	snapshot->size = 0;
+	Write(snapshot, &header, sizeof(header));
+	
+	// Bodies
+	cpArray *bodies = space->bodies;
+	for(int i=0; i<bodies->num; i++) WriteBody(snapshot, (cpBody *)bodies->arr[i]);
+	header.numAwakeBodies = header.numBodies = bodies->num;
+	
+	cpArray *components = space->sleepingComponents;
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body){
+			WriteBody(snapshot, body);
+			header.numBodies++;
+		}
+	}
+	
+	WritePointers(snapshot, components);
+	header.numComponents = components->num;
+	
+	WritePointers(snapshot, space->rousedBodies);
+	header.numRoused = space->rousedBodies->num;
+	
+	// Constraints
+	cpArray *constraints = space->constraints;
+	for(int i=0; i<constraints->num; i++) WriteConstraint(snapshot, (cpConstraint *)constraints->arr[i]);
+	header.numAwakeConstraints = header.numConstraints = constraints->num;
+	
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body){
+			CP_BODY_FOREACH_CONSTRAINT(body, constraint){
+				if(BodyOwns(body, constraint->a)){
+					WriteConstraint(snapshot, constraint);
+					header.numConstraints++;
+				}
+			}
+		}
+	}
+	
+	// Arbiters
+	cpHashSetEach(space->cachedArbiters, (cpHashSetIteratorFunc)WriteCachedArbiter, snapshot);
+	header.numArbiters = cpHashSetCount(space->cachedArbiters);
+	
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body){
+			CP_BODY_FOREACH_ARBITER(body, arb){
+				if(BodyOwns(body, arb->body_a)){
+					WriteArbiter(arb, snapshot, cpFalse);
+					header.numArbiters++;
+				}
+			}
+		}
+	}
+	
+	WritePointers(snapshot, space->arbiters);
+	header.numActiveArbiters = space->arbiters->num;
+	
+	memcpy(snapshot->data, &header, sizeof(header));
+}
+
+//MARK: Restore
+
+// Return all the arbiters to the pool and clear the contact graph.
+static void
+ClearArbiter(cpArbiter *arb, cpSpace *space)
+{
+	arb->body_a->arbiterList = NULL;
+	arb->body_b->arbiterList = NULL;
+	
+	arb->thread_a.next = arb->thread_a.prev = NULL;
+	arb->thread_b.next = arb->thread_b.prev = NULL;
+	
+	arb->contacts = NULL;
+	arb->numContacts = 0;
+	cpArrayPush(space->pooledArbiters, arb);
+}
+
+static cpBool
+ClearCachedArbiter(cpArbiter *arb, cpSpace *space)
+{
+	ClearArbiter(arb, space);
+	return cpFalse;
+}
+
+static void
+ClearArbiters(cpSpace *space)
+{
+	cpHashSetFilter(space->cachedArbiters, (cpHashSetFilterFunc)ClearCachedArbiter, space);
+	
+	cpArray *components = space->sleepingComponents;
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body){
+			for(cpArbiter *arb = body->arbiterList; arb;){
+				cpArbiter *next = cpArbiterNext(arb, body);
+				
+				if(BodyOwns(body, arb->body_a)){
+					// Sleeping arbiters own their contacts, see cpSpaceDeactivateBody().
+					cpSpaceFreePooled(space, arb->contacts, arb->numContacts*sizeof(cpContact));
+					ClearArbiter(arb, space);
+				}
+				
+				arb = next;
+			}
+		}
+	}
+	
+	space->arbiters->num = 0;
+}
+
+static int
+CountBodies(cpSpace *space)
+{
+	int count = space->bodies->num;
+	
+	cpArray *components = space->sleepingComponents;
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body) count++;
+	}
+	
+	return count;
+}
+
+// Update the shapes of a restored body and move them between the spatial indexes
+// if the body fell asleep or woke up since the snapshot was taken.
+static void
+RestoreShapes(cpSpace *space, cpBody *body)
+{
+	cpBool sleeping = cpBodyIsSleeping(body);
+	
+	CP_BODY_FOREACH_SHAPE(body, shape){
+		cpShapeUpdate(shape, body->p, body->rot);
+		
+		cpBool active = cpSpatialIndexContains(space->activeShapes, shape, shape->hashid);
+		if(sleeping && active){
+			cpSpatialIndexRemove(space->activeShapes, shape, shape->hashid);
+			cpSpatialIndexInsert(space->staticShapes, shape, shape->hashid);
+		} else if(sleeping){
+			cpSpatialIndexReindexObject(space->staticShapes, shape, shape->hashid);
+		} else if(!active){
+			cpSpatialIndexRemove(space->staticShapes, shape, shape->hashid);
+			cpSpatialIndexInsert(space->activeShapes, shape, shape->hashid);
+		}
+	}
+}
+
+void
+cpSpaceSnapshotRestore(cpSpaceSnapshot *snapshot, cpSpace *space)
+{
+	cpAssertHard(!space->locked, "cpSpaceSnapshotRestore() cannot be called while the space is locked.");
+	
+	Reader reader = {snapshot->data, snapshot->size};
+	Header header;
+	Read(&reader, &header, sizeof(header));
+	cpAssertHard(header.magic == SNAPSHOT_MAGIC && header.version == SNAPSHOT_VERSION, "Invalid snapshot data.");
+	cpAssertHard(header.numBodies == CountBodies(space), "The space doesn't have the same bodies as the snapshot.");
+	
+	// The arbiters are cleared first since it needs the current sleeping components.
+	ClearArbiters(space);
+	
+	space->stamp = header.stamp;
+	space->curr_dt = header.curr_dt;
+	space->sortArbiters = cpTrue;
+	
+	// Bodies
+	cpArray *bodies = space->bodies;
+	bodies->num = 0;
+	
+	for(int i=0; i<header.numBodies; i++){
+		BodyRecord record;
+		Read(&reader, &record, sizeof(record));
+		
+		cpBody *body = record.body;
+		body->p = record.p;
+		body->v = record.v;
+		body->f = record.f;
+		body->a = record.a;
+		body->w = record.w;
+		body->t = record.t;
+		body->rot = record.rot;
+		body->v_bias = record.v_bias;
+		body->w_bias = record.w_bias;
+		body->node = record.node;
+		
+		if(i < header.numAwakeBodies) cpArrayPush(bodies, body);
+	}
+	
+	ReadPointers(&reader, space->sleepingComponents, header.numComponents);
+	ReadPointers(&reader, space->rousedBodies, header.numRoused);
+	
+	for(int i=0; i<bodies->num; i++) RestoreShapes(space, (cpBody *)bodies->arr[i]);
+	
+	cpArray *components = space->sleepingComponents;
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body) RestoreShapes(space, body);
+	}
+	
+	// Constraints
+	cpArray *constraints = space->constraints;
+	constraints->num = 0;
+	
+	for(int i=0; i<header.numConstraints; i++){
+		ConstraintRecord record;
+		Read(&reader, &record, sizeof(record));
+		Read(&reader, record.constraint + 1, record.size);
+		
+		if(i < header.numAwakeConstraints) cpArrayPush(constraints, record.constraint);
+	}
+	
+	// Arbiters
+	const unsigned char *arbiterData = reader.data;
+	size_t arbiterSize = reader.size;
+	
+	// Take the snapshot's arbiters out of the pool. Pooled arbiters have no contacts,
+	// so a negative count marks the ones that are needed.
+	for(int i=0; i<header.numArbiters; i++){
+		ArbiterRecord record;
+		Read(&reader, &record, sizeof(record));
+		reader.data += record.numContacts*sizeof(cpContact);
+		reader.size -= record.numContacts*sizeof(cpContact);
+		
+		record.arb->numContacts = -1;
+	}
+	
+	cpArray *pool = space->pooledArbiters;
+	int count = 0;
+	for(int i=0; i<pool->num; i++){
+		cpArbiter *arb = (cpArbiter *)pool->arr[i];
+		if(arb->numContacts == 0) pool->arr[count++] = arb;
+	}
+	pool->num = count;
+	
+	reader.data = arbiterData;
+	reader.size = arbiterSize;
+	cpSpacePushFreshContactBuffer(space);
+	
+	for(int i=0; i<header.numArbiters; i++){
+		ArbiterRecord record;
+		Read(&reader, &record, sizeof(record));
+		
+		cpArbiter *arb = cpArbiterInit(record.arb, record.a, record.b);
+		arb->e = record.e;
+		arb->u = record.u;
+		arb->surface_vr = record.surface_vr;
+		arb->thread_a = record.thread_a;
+		arb->thread_b = record.thread_b;
+		arb->swappedColl = record.swappedColl;
+		arb->state = record.state;
+		arb->stamp = record.stamp;
+		arb->handler = cpSpaceLookupHandler(space, record.a->collision_type, record.b->collision_type);
+		
+		if(record.head_a) arb->body_a->arbiterList = arb;
+		if(record.head_b) arb->body_b->arbiterList = arb;
+		
+		int numContacts = arb->numContacts = record.numContacts;
+		if(record.cached){
+			if(numContacts){
+				arb->contacts = cpContactBufferGetArray(space);
+				Read(&reader, arb->contacts, numContacts*sizeof(cpContact));
+				cpSpacePushContacts(space, numContacts);
+			}
+			
+			cpShape *shape_pair[] = {record.a, record.b};
+			cpHashValue arbHashID = CP_HASH_PAIR((cpHashValue)record.a, (cpHashValue)record.b);
+			cpHashSetInsert(space->cachedArbiters, arbHashID, shape_pair, arb, NULL);
+		} else {
+			arb->contacts = (cpContact *)cpSpaceAllocPooled(space, numContacts*sizeof(cpContact));
+			Read(&reader, arb->contacts, numContacts*sizeof(cpContact));
+		}
+	}
+	
+	ReadPointers(&reader, space->arbiters, header.numActiveArbiters);
+}
+
+//MARK: Memory Management Functions
+
+cpSpaceSnapshot *
+cpSpaceSnapshotNew(void)
+{
+	return (cpSpaceSnapshot *)cpcalloc(1, sizeof(cpSpaceSnapshot));
+}
+
+void
+cpSpaceSnapshotFree(cpSpaceSnapshot *snapshot)
+{
+	if(snapshot){
+		cpfree(snapshot->data);
+		cpfree(snapshot);
+	}
+}
+
+size_t
+cpSpaceSnapshotGetSize(cpSpaceSnapshot *snapshot)
+{
+	return snapshot->size;
+}
+
+const void *
+cpSpaceSnapshotGetData(cpSpaceSnapshot *snapshot)
+{
+	return snapshot->data;
+}
+
+void
+cpSpaceSnapshotSetData(cpSpaceSnapshot *snapshot, const void *data, size_t size)
+{
+	snapshot->size = 0;
+	Write(snapshot, data, size);
+}
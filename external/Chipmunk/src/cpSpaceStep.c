@@ -114,12 +114,34 @@ typedef struct cpContactBuffer {
 	cpContact contacts[CP_CONTACTS_BUFFER_SIZE];
 } cpContactBuffer;
 
+// The buffers are only reachable through the ring, see cpSpaceFreeContactBuffers().
 static cpContactBufferHeader *
 cpSpaceAllocContactBuffer(cpSpace *space)
 {
-	cpContactBuffer *buffer = (cpContactBuffer *)cpcalloc(1, sizeof(cpContactBuffer));
-	cpArrayPush(space->allocatedBuffers, buffer);
-	return (cpContactBufferHeader *)buffer;
+	return (cpContactBufferHeader *)cpSpaceAllocPooled(space, sizeof(cpContactBuffer));
+}
+
+// Contacts in a stale buffer are too old to be referenced by a cached arbiter.
+static inline cpBool
+cpContactBufferIsStale(cpSpace *space, cpContactBufferHeader *buffer)
+{
+	return (space->stamp - buffer->stamp > space->collisionPersistence);
+}
+
+void
+cpSpaceFreeContactBuffers(cpSpace *space)
+{
+	cpContactBufferHeader *head = space->contactBuffersHead;
+	if(!head) return;
+	
+	for(cpContactBufferHeader *buffer = head->next; buffer != head;){
+		cpContactBufferHeader *next = buffer->next;
+		cpSpaceFreePooled(space, buffer, sizeof(cpContactBuffer));
+		buffer = next;
+	}
+	
+	cpSpaceFreePooled(space, head, sizeof(cpContactBuffer));
+	space->contactBuffersHead = NULL;
 }
 
 static cpContactBufferHeader *
@@ -142,7 +164,7 @@ cpSpacePushFreshContactBuffer(cpSpace *space)
 	if(!head){
 		// No buffers have been allocated, make one
 		space->contactBuffersHead = cpContactBufferHeaderInit(cpSpaceAllocContactBuffer(space), stamp, NULL);
-	} else if(stamp - head->next->stamp > space->collisionPersistence){
+	} else if(cpContactBufferIsStale(space, head->next)){
 		// The tail buffer is available, rotate the ring
 	cpContactBufferHeader *tail = head->next;
 		space->contactBuffersHead = cpContactBufferHeaderInit(tail, stamp, tail);
@@ -178,8 +200,151 @@ cpSpacePopContacts(cpSpace *space, int count){
 	space->contactBuffersHead->numContacts -= count;
 }
 
+//MARK: Memory Pool Functions
+
+void
+cpSpaceGetMemoryStats(cpSpace *space, cpSpaceMemoryStats *stats)
+{
+	stats->contactsLive = stats->contactsPooled = 0;
+	cpContactBufferHeader *head = space->contactBuffersHead;
+	if(head){
+		cpContactBufferHeader *buffer = head;
+		do {
+			if(buffer != head && cpContactBufferIsStale(space, buffer)){
+				stats->contactsPooled += sizeof(cpContactBuffer);
+			} else {
+				stats->contactsLive += sizeof(cpContactBuffer);
+			}
+			
+			buffer = buffer->next;
+		} while(buffer != head);
+	}
+	
+	stats->arbitersPooled = space->pooledArbiters->num*sizeof(cpArbiter);
+	stats->arbitersLive = space->allocatedBuffers->num*CP_BUFFER_BYTES - stats->arbitersPooled;
+	
+	// Sleeping arbiters are owned by one of their bodies, see cpSpaceDeactivateBody().
+	stats->sleepingContacts = 0;
+	cpArray *components = space->sleepingComponents;
+	for(int i=0; i<components->num; i++){
+		CP_BODY_FOREACH_COMPONENT((cpBody *)components->arr[i], body){
+			CP_BODY_FOREACH_ARBITER(body, arb){
+				cpBody *bodyA = arb->body_a;
+				if(body == bodyA || cpBodyIsStatic(bodyA)) stats->sleepingContacts += arb->numContacts*sizeof(cpContact);
+			}
+		}
+	}
+	
+	stats->indexLive = stats->indexPooled = 0;
+	cpSpatialIndex *indexes[] = {space->staticShapes, space->activeShapes};
+	for(int i=0; i<2; i++){
+		cpBBTreeGetPoolBytes(indexes[i], &stats->indexLive, &stats->indexPooled);
+		cpSpaceHashGetPoolBytes(indexes[i], &stats->indexLive, &stats->indexPooled);
+	}
+}
+
+static int
+PointerOrder(void **a, void **b)
+{
+	uintptr_t pa = (uintptr_t)*a, pb = (uintptr_t)*b;
+	return (pa < pb ? -1 : (pa > pb ? 1 : 0));
+}
+
+static void
+ShrinkArray(cpArray *arr)
+{
+	int max = (arr->num > 4 ? arr->num : 4);
+	if(max < arr->max){
+		arr->max = max;
+		arr->arr = (void **)cprealloc(arr->arr, max*sizeof(void *));
+	}
+}
+
+// Free the stale contact buffers in the ring. The head is always kept.
+static void
+TrimContactBuffers(cpSpace *space)
+{
+	cpContactBufferHeader *head = space->contactBuffersHead;
+	if(!head) return;
+	
+	cpContactBufferHeader *prev = head;
+	for(cpContactBufferHeader *buffer = head->next; buffer != head;){
+		cpContactBufferHeader *next = buffer->next;
+		
+		if(cpContactBufferIsStale(space, buffer)){
+			prev->next = next;
+			cpSpaceFreePooled(space, buffer, sizeof(cpContactBuffer));
+		} else {
+			prev = buffer;
+		}
+		
+		buffer = next;
+	}
+}
+
+// Free the arbiter buffers that only hold pooled arbiters.
+static void
+TrimArbiters(cpSpace *space)
+{
+	cpArray *buffers = space->allocatedBuffers;
+	cpArray *pool = space->pooledArbiters;
+	int count = CP_BUFFER_BYTES/sizeof(cpArbiter);
+	
+	// With both arrays sorted by address, the pooled arbiters of each buffer are a contiguous run.
+	qsort(buffers->arr, buffers->num, sizeof(void *), (int (*)(const void *, const void *))PointerOrder);
+	qsort(pool->arr, pool->num, sizeof(void *), (int (*)(const void *, const void *))PointerOrder);
+	
+	int numBuffers = 0, numPooled = 0;
+	for(int i=0, j=0; i<buffers->num; i++){
+		cpArbiter *buffer = (cpArbiter *)buffers->arr[i];
+		
+		int first = j;
+		while(j < pool->num && (uintptr_t)pool->arr[j] < (uintptr_t)(buffer + count)) j++;
+		
+		if(j - first == count){
+			cpSpaceFreePooled(space, buffer, CP_BUFFER_BYTES);
+		} else {
+			buffers->arr[numBuffers++] = buffer;
+			for(int k=first; k<j; k++) pool->arr[numPooled++] = pool->arr[k];
+		}
+	}
+	
+	buffers->num = numBuffers;
+	pool->num = numPooled;
+	
+	ShrinkArray(buffers);
+	ShrinkArray(pool);
+}
+
+void
+cpSpaceTrimMemory(cpSpace *space)
+{
+	cpAssertHard(!space->locked, "cpSpaceTrimMemory() cannot be called while the space is locked.");
+	
+	TrimContactBuffers(space);
+	TrimArbiters(space);
+}
+
 //MARK: Collision Detection Functions
 
+static int
+ArbiterOrder(cpArbiter **arb1, cpArbiter **arb2)
+{
+	cpHashValue a1 = (*arb1)->a->hashid, a2 = (*arb2)->a->hashid;
+	if(a1 != a2) return (a1 < a2 ? -1 : 1);
+	
+	cpHashValue b1 = (*arb1)->b->hashid, b2 = (*arb2)->b->hashid;
+	return (b1 < b2 ? -1 : (b1 > b2 ? 1 : 0));
+}
+
+// Sort the arbiters found by the collision detection by their shape hash ids.
+void
+cpSpaceSortArbiters(cpSpace *space)
+{
+	cpArray *arbiters = space->arbiters;
+	qsort(arbiters->arr, arbiters->num, sizeof(void *), (int (*)(const void *, const void *))ArbiterOrder);
+}
+
 static void *
 cpSpaceArbiterSetTrans(cpShape **shapes, cpSpace *space)
 {
@@ -188,7 +353,7 @@ cpSpaceArbiterSetTrans(cpShape **shapes, cpSpace *space)
 		int count = CP_BUFFER_BYTES/sizeof(cpArbiter);
 		cpAssertHard(count, "Internal Error: Buffer size too small.");
 		
-		cpArbiter *buffer = (cpArbiter *)cpcalloc(1, CP_BUFFER_BYTES);
+		cpArbiter *buffer = (cpArbiter *)cpSpaceAllocPooled(space, CP_BUFFER_BYTES);
 		cpArrayPush(space->allocatedBuffers, buffer);
 		
 		for(int i=0; i<count; i++) cpArrayPush(space->pooledArbiters, buffer + i);
@@ -227,7 +392,8 @@ cpSpaceCollideShapes(cpShape *a, cpShape *b, cpSpace *space)
 	if(sensor && handler == &cpDefaultCollisionHandler) return;
 	
 	// Shape 'a' should have the lower shape type. (required by cpCollideShapes() )
-	if(a->klass->type > b->klass->type){
+	// When sorting arbiters, similar shapes are ordered by hash id so the order doesn't depend on the spatial index.
+	if(a->klass->type > b->klass->type || (space->sortArbiters && a->klass->type == b->klass->type && a->hashid > b->hashid)){
 		cpShape *temp = a;
 		a = b;
 		b = temp;
@@ -359,6 +525,9 @@ cpSpaceStep(cpSpace *space, cpFloat dt)
 		cpSpatialIndexReindexQuery(space->activeShapes, (cpSpatialIndexQueryFunc)cpSpaceCollideShapes, space);
 	} cpSpaceUnlock(space, cpFalse);
 	
+	// Make the solver order independent of the spatial index (see cpSpaceSnapshot.h).
+	if(space->sortArbiters) cpSpaceSortArbiters(space);
+	
 	// Rebuild the contact graph (and detect sleeping components if sleeping is enabled)
 	cpSpaceProcessComponents(space, dt);
 	
@@ -0,0 +1,615 @@
+/* Copyright (c) 2012 cocos2d-iphone.org
+ * 
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ * 
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ * 
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+
+#include "chipmunk_private.h"
+
+static inline cpSpatialIndexClass *Klass();
+
+//MARK: Basic Structures
+
+// Persistent sweep and prune on both axes. Each axis keeps a sorted array
+// of min and max endpoints that is repaired with an insertion sort, which is
+// close to linear when objects move coherently. Every swap of a min and a
+// max endpoint updates the set of overlapping pairs, so reporting collisions
+// only walks the pairs.
+
+typedef struct Handle {
+	void *obj;
+	cpBB bb;
+	cpHashValue hashid;
+	
+	// Number of pairs this handle is in.
+	int pairs;
+} Handle;
+
+typedef struct Endpoint {
+	cpFloat value;
+	Handle *handle;
+	cpBool isMax;
+} Endpoint;
+
+typedef struct Pair {
+	Handle *a, *b;
+} Pair;
+
+struct cpSweep2D {
+	cpSpatialIndex spatialIndex;
+	
+	int num, max;
+	Endpoint *axes[2];
+	
+	// Axis with the larger variance of object centers, used for queries.
+	int queryAxis;
+	// Largest extent of any object along each axis.
+	cpFloat maxExtent[2];
+	
+	cpHashSet *handleSet;
+	cpHashSet *pairSet;
+	
+	cpArray *pooledHandles;
+	cpArray *pooledPairs;
+	cpArray *allocatedBuffers;
+};
+
+static inline cpFloat
+BBMin(cpBB bb, int axis)
+{
+	return (axis == 0 ? bb.l : bb.b);
+}
+
+static inline cpFloat
+BBMax(cpBB bb, int axis)
+{
+	return (axis == 0 ? bb.r : bb.t);
+}
+
+// Min endpoints sort before max endpoints with the same value
+// so that touching bounding boxes overlap like cpBBIntersects().
+static inline cpBool
+EndpointLess(Endpoint a, Endpoint b)
+{
+	return (a.value < b.value || (a.value == b.value && !a.isMax && b.isMax));
+}
+
+static inline Endpoint
+MakeEndpoint(Handle *hand, int axis, cpBool isMax)
+{
+	Endpoint endpoint = {(isMax ? BBMax(hand->bb, axis) : BBMin(hand->bb, axis)), hand, isMax};
+	return endpoint;
+}
+
+//MARK: Handle Functions
+
+static void *
+PopPooled(cpSweep2D *sweep, cpArray *pool, size_t size)
+{
+	if(pool->num == 0){
+		// Pool is exhausted, make more
+		int count = (int)(CP_BUFFER_BYTES/size);
+		cpAssertHard(count, "Internal Error: Buffer size is too small.");
+		
+		char *buffer = (char *)cpcalloc(1, CP_BUFFER_BYTES);
+		cpArrayPush(sweep->allocatedBuffers, buffer);
+		
+		for(int i=0; i<count; i++) cpArrayPush(pool, buffer + i*size);
+	}
+	
+	return cpArrayPop(pool);
+}
+
+static cpBool handleSetEql(void *obj, Handle *hand){return (obj == hand->obj);}
+
+static void *
+handleSetTrans(void *obj, cpSweep2D *sweep)
+{
+	Handle *hand = (Handle *)PopPooled(sweep, sweep->pooledHandles, sizeof(Handle));
+	hand->obj = obj;
+	hand->bb = sweep->spatialIndex.bbfunc(obj);
+	hand->pairs = 0;
+	
+	return hand;
+}
+
+//MARK: Pair Functions
+
+static cpBool pairSetEql(Pair *a, Pair *b){return (a->a == b->a && a->b == b->b);}
+
+static void *
+pairSetTrans(Pair *pair, cpSweep2D *sweep)
+{
+	Pair *copy = (Pair *)PopPooled(sweep, sweep->pooledPairs, sizeof(Pair));
+	(*copy) = (*pair);
+	
+	copy->a->pairs++;
+	copy->b->pairs++;
+	
+	return copy;
+}
+
+// Pairs are ordered and hashed by the hash ids instead of the handle addresses
+// so that the callback order doesn't change from one run to the next.
+static inline Pair
+MakePair(Handle *a, Handle *b)
+{
+	cpBool less = (a->hashid < b->hashid);
+	Pair pair = {(less ? a : b), (less ? b : a)};
+	return pair;
+}
+
+static void
+PairAdd(cpSweep2D *sweep, Handle *a, Handle *b)
+{
+	if(cpBBIntersects(a->bb, b->bb)){
+		Pair pair = MakePair(a, b);
+		cpHashSetInsert(sweep->pairSet, CP_HASH_PAIR(pair.a->hashid, pair.b->hashid), &pair, sweep, (cpHashSetTransFunc)pairSetTrans);
+	}
+}
+
+static void
+PairRemove(cpSweep2D *sweep, Handle *a, Handle *b)
+{
+	Pair pair = MakePair(a, b);
+	Pair *removed = (Pair *)cpHashSetRemove(sweep->pairSet, CP_HASH_PAIR(pair.a->hashid, pair.b->hashid), &pair);
+	
+	if(removed){
+		removed->a->pairs--;
+		removed->b->pairs--;
+		cpArrayPush(sweep->pooledPairs, removed);
+	}
+}
+
+//MARK: Endpoint Sorting
+
+// Move the endpoint at index i towards the front until it's in order.
+static void
+SortDown(cpSweep2D *sweep, Endpoint *endpoints, int i)
+{
+	Endpoint e = endpoints[i];
+	
+	for(; i>0 && EndpointLess(e, endpoints[i - 1]); i--){
+		Endpoint f = endpoints[i - 1];
+		
+		if(e.isMax != f.isMax && e.handle != f.handle){
+			// A min moving below a max may start an overlap,
+			// a max moving below a min ends one.
+			if(e.isMax){
+				PairRemove(sweep, e.handle, f.handle);
+			} else {
+				PairAdd(sweep, e.handle, f.handle);
+			}
+		}
+		
+		endpoints[i] = f;
+	}
+	
+	endpoints[i] = e;
+}
+
+static void
+SortAxis(cpSweep2D *sweep, int axis)
+{
+	Endpoint *endpoints = sweep->axes[axis];
+	for(int i=1, count=2*sweep->num; i<count; i++) SortDown(sweep, endpoints, i);
+}
+
+//MARK: Memory Management Functions
+
+cpSweep2D *
+cpSweep2DAlloc(void)
+{
+	return (cpSweep2D *)cpcalloc(1, sizeof(cpSweep2D));
+}
+
+static void
+ResizeAxes(cpSweep2D *sweep, int size)
+{
+	sweep->max = size;
+	for(int axis=0; axis<2; axis++){
+		sweep->axes[axis] = (Endpoint *)cprealloc(sweep->axes[axis], 2*size*sizeof(Endpoint));
+	}
+}
+
+cpSpatialIndex *
+cpSweep2DInit(cpSweep2D *sweep, cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex)
+{
+	cpSpatialIndexInit((cpSpatialIndex *)sweep, Klass(), bbfunc, staticIndex);
+	
+	sweep->num = 0;
+	ResizeAxes(sweep, 32);
+	
+	sweep->queryAxis = 0;
+	sweep->maxExtent[0] = sweep->maxExtent[1] = 0.0f;
+	
+	sweep->handleSet = cpHashSetNew(0, (cpHashSetEqlFunc)handleSetEql);
+	sweep->pairSet = cpHashSetNew(0, (cpHashSetEqlFunc)pairSetEql);
+	
+	sweep->pooledHandles = cpArrayNew(0);
+	sweep->pooledPairs = cpArrayNew(0);
+	sweep->allocatedBuffers = cpArrayNew(0);
+	
+	return (cpSpatialIndex *)sweep;
+}
+
+cpSpatialIndex *
+cpSweep2DNew(cpSpatialIndexBBFunc bbfunc, cpSpatialIndex *staticIndex)
+{
+	return cpSweep2DInit(cpSweep2DAlloc(), bbfunc, staticIndex);
+}
+
+static void
+cpSweep2DDestroy(cpSweep2D *sweep)
+{
+	cpfree(sweep->axes[0]);
+	cpfree(sweep->axes[1]);
+	sweep->axes[0] = sweep->axes[1] = NULL;
+	
+	cpHashSetFree(sweep->handleSet);
+	cpHashSetFree(sweep->pairSet);
+	
+	if(sweep->allocatedBuffers) cpArrayFreeEach(sweep->allocatedBuffers, cpfree);
+	cpArrayFree(sweep->allocatedBuffers);
+	cpArrayFree(sweep->pooledHandles);
+	cpArrayFree(sweep->pooledPairs);
+}
+
+//MARK: Misc
+
+static int
+cpSweep2DCount(cpSweep2D *sweep)
+{
+	return sweep->num;
+}
+
+static void
+cpSweep2DEach(cpSweep2D *sweep, cpSpatialIndexIteratorFunc func, void *data)
+{
+	Endpoint *endpoints = sweep->axes[0];
+	for(int i=0, count=2*sweep->num; i<count; i++){
+		if(!endpoints[i].isMax) func(endpoints[i].handle->obj, data);
+	}
+}
+
+static int
+cpSweep2DContains(cpSweep2D *sweep, void *obj, cpHashValue hashid)
+{
+	return (cpHashSetFind(sweep->handleSet, hashid, obj) != NULL);
+}
+
+//MARK: Basic Operations
+
+static inline void
+GrowExtent(cpSweep2D *sweep, cpBB bb)
+{
+	sweep->maxExtent[0] = cpfmax(sweep->maxExtent[0], bb.r - bb.l);
+	sweep->maxExtent[1] = cpfmax(sweep->maxExtent[1], bb.t - bb.b);
+}
+
+// Index of the first endpoint with a value not less than the given value.
+static int
+LowerBound(Endpoint *endpoints, int count, cpFloat value)
+{
+	int lo = 0, hi = count;
+	while(lo < hi){
+		int mid = (lo + hi)/2;
+		if(endpoints[mid].value < value){
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	
+	return lo;
+}
+
+// Call func for every other handle whose bounding box overlaps the one of hand.
+static void
+QueryHandles(cpSweep2D *sweep, Handle *hand, void (*func)(cpSweep2D *sweep, Handle *a, Handle *b))
+{
+	int axis = sweep->queryAxis;
+	Endpoint *endpoints = sweep->axes[axis];
+	int count = 2*sweep->num;
+	
+	cpBB bb = hand->bb;
+	cpFloat max = BBMax(bb, axis);
+	for(int i=LowerBound(endpoints, count, BBMin(bb, axis) - sweep->maxExtent[axis]); i<count && endpoints[i].value <= max; i++){
+		Endpoint e = endpoints[i];
+		if(!e.isMax && e.handle != hand && cpBBIntersects(bb, e.handle->bb)) func(sweep, hand, e.handle);
+	}
+}
+
+static void
+InsertEndpoint(Endpoint *endpoints, int count, Endpoint e)
+{
+	int lo = 0, hi = count;
+	while(lo < hi){
+		int mid = (lo + hi)/2;
+		if(EndpointLess(endpoints[mid], e)){
+			lo = mid + 1;
+		} else {
+			hi = mid;
+		}
+	}
+	
+	memmove(endpoints + lo + 1, endpoints + lo, (count - lo)*sizeof(Endpoint));
+	endpoints[lo] = e;
+}
+
+static void
+RemoveEndpoints(Endpoint *endpoints, int count, Handle *hand, int axis)
+{
+	// Start looking where the min endpoint should be, but fall back
+	// to the whole array in case the value doesn't compare (NaN).
+	int start = LowerBound(endpoints, count, BBMin(hand->bb, axis));
+	for(int pass=0; pass<2; pass++){
+		int j = start;
+		for(int i=start; i<count; i++){
+			if(endpoints[i].handle != hand) endpoints[j++] = endpoints[i];
+		}
+		
+		if(count - j == 2) return;
+		start = 0;
+	}
+}
+
+static void
+cpSweep2DInsert(cpSweep2D *sweep, void *obj, cpHashValue hashid)
+{
+	Handle *hand = (Handle *)cpHashSetInsert(sweep->handleSet, hashid, obj, sweep, (cpHashSetTransFunc)handleSetTrans);
+	hand->hashid = hashid;
+	
+	if(sweep->num == sweep->max) ResizeAxes(sweep, sweep->max*2);
+	int count = 2*sweep->num;
+	
+	for(int axis=0; axis<2; axis++){
+		Endpoint *endpoints = sweep->axes[axis];
+		InsertEndpoint(endpoints, count + 0, MakeEndpoint(hand, axis, cpFalse));
+		InsertEndpoint(endpoints, count + 1, MakeEndpoint(hand, axis, cpTrue));
+	}
+	
+	sweep->num++;
+	GrowExtent(sweep, hand->bb);
+	
+	QueryHandles(sweep, hand, PairAdd);
+}
+
+static cpBool
+PairFilterRemoved(Pair *pair, cpSweep2D *sweep)
+{
+	if(pair->a->obj == NULL || pair->b->obj == NULL){
+		pair->a->pairs--;
+		pair->b->pairs--;
+		cpArrayPush(sweep->pooledPairs, pair);
+		return cpFalse;
+	}
+	
+	return cpTrue;
+}
+
+static void
+cpSweep2DRemove(cpSweep2D *sweep, void *obj, cpHashValue hashid)
+{
+	Handle *hand = (Handle *)cpHashSetRemove(sweep->handleSet, hashid, obj);
+	if(!hand) return;
+	
+	// The pair set matches the current bounding boxes,
+	// so the partners are exactly the overlapping handles.
+	QueryHandles(sweep, hand, PairRemove);
+	
+	int count = 2*sweep->num;
+	for(int axis=0; axis<2; axis++) RemoveEndpoints(sweep->axes[axis], count, hand, axis);
+	sweep->num--;
+	
+	// Only bounding boxes that don't compare (NaN) can leave pairs behind.
+	if(hand->pairs > 0){
+		hand->obj = NULL;
+		cpHashSetFilter(sweep->pairSet, (cpHashSetFilterFunc)PairFilterRemoved, sweep);
+	}
+	
+	cpArrayPush(sweep->pooledHandles, hand);
+}
+
+//MARK: Reindexing Functions
+
+static void
+UpdateEndpoints(cpSweep2D *sweep, int axis)
+{
+	Endpoint *endpoints = sweep->axes[axis];
+	for(int i=0, count=2*sweep->num; i<count; i++){
+		Endpoint *e = endpoints + i;
+		e->value = (e->isMax ? BBMax(e->handle->bb, axis) : BBMin(e->handle->bb, axis));
+	}
+}
+
+static void
+cpSweep2DReindex(cpSweep2D *sweep)
+{
+	int count = 2*sweep->num;
+	if(count == 0) return;
+	
+	// Update the bounding boxes and gather the statistics for picking the query axis.
+	cpFloat extent[2] = {0.0f, 0.0f};
+	cpFloat sum[2] = {0.0f, 0.0f}, sumSq[2] = {0.0f, 0.0f};
+	
+	Endpoint *endpoints = sweep->axes[0];
+	for(int i=0; i<count; i++){
+		if(endpoints[i].isMax) continue;
+		
+		Handle *hand = endpoints[i].handle;
+		cpBB bb = hand->bb = sweep->spatialIndex.bbfunc(hand->obj);
+		
+		cpFloat x = bb.l + bb.r, y = bb.b + bb.t;
+		sum[0] += x; sumSq[0] += x*x;
+		sum[1] += y; sumSq[1] += y*y;
+		
+		extent[0] = cpfmax(extent[0], bb.r - bb.l);
+		extent[1] = cpfmax(extent[1], bb.t - bb.b);
+	}
+	
+	sweep->maxExtent[0] = extent[0];
+	sweep->maxExtent[1] = extent[1];
+	
+	// Comparing n^2*variance avoids the divisions.
+	cpFloat n = (cpFloat)sweep->num;
+	cpFloat varX = n*sumSq[0] - sum[0]*sum[0];
+	cpFloat varY = n*sumSq[1] - sum[1]*sum[1];
+	sweep->queryAxis = (varY > varX ? 1 : 0);
+	
+	// All bounding boxes must be current before sorting so that
+	// the overlap tests done by the swaps see the final positions.
+	for(int axis=0; axis<2; axis++){
+		UpdateEndpoints(sweep, axis);
+		SortAxis(sweep, axis);
+	}
+}
+
+static void
+cpSweep2DReindexObject(cpSweep2D *sweep, void *obj, cpHashValue hashid)
+{
+	Handle *hand = (Handle *)cpHashSetFind(sweep->handleSet, hashid, obj);
+	if(!hand) return;
+	
+	hand->bb = sweep->spatialIndex.bbfunc(obj);
+	GrowExtent(sweep, hand->bb);
+	
+	int count = 2*sweep->num;
+	for(int axis=0; axis<2; axis++){
+		Endpoint *endpoints = sweep->axes[axis];
+		
+		for(int i=0; i<count; i++){
+			Endpoint *e = endpoints + i;
+			if(e->handle == hand) e->value = (e->isMax ? BBMax(hand->bb, axis) : BBMin(hand->bb, axis));
+		}
+		
+		SortAxis(sweep, axis);
+	}
+}
+
+//MARK: Query Functions
+
+static void
+cpSweep2DQuery(cpSweep2D *sweep, void *obj, cpBB bb, cpSpatialIndexQueryFunc func, void *data)
+{
+	int axis = sweep->queryAxis;
+	Endpoint *endpoints = sweep->axes[axis];
+	int count = 2*sweep->num;
+	
+	// Any overlapping object has its min endpoint in [min - maxExtent, max].
+	cpFloat max = BBMax(bb, axis);
+	for(int i=LowerBound(endpoints, count, BBMin(bb, axis) - sweep->maxExtent[axis]); i<count && endpoints[i].value <= max; i++){
+		Endpoint e = endpoints[i];
+		if(!e.isMax && e.handle->obj != obj && cpBBIntersects(bb, e.handle->bb)) func(obj, e.handle->obj, data);
+	}
+}
+
+// Fraction along the segment where it enters bb, INFINITY if it misses.
+// cpBBSegmentQuery() misses boxes whose edges line up with an end of the segment.
+static inline cpFloat
+BBSegmentQuery(cpBB bb, cpVect a, cpVect b)
+{
+	cpVect delta = cpvsub(b, a);
+	cpFloat tmin = -INFINITY, tmax = INFINITY;
+	
+	if(delta.x == 0.0f){
+		if(a.x < bb.l || bb.r < a.x) return INFINITY;
+	} else {
+		cpFloat t1 = (bb.l - a.x)/delta.x;
+		cpFloat t2 = (bb.r - a.x)/delta.x;
+		tmin = cpfmax(tmin, cpfmin(t1, t2));
+		tmax = cpfmin(tmax, cpfmax(t1, t2));
+	}
+	
+	if(delta.y == 0.0f){
+		if(a.y < bb.b || bb.t < a.y) return INFINITY;
+	} else {
+		cpFloat t1 = (bb.b - a.y)/delta.y;
+		cpFloat t2 = (bb.t - a.y)/delta.y;
+		tmin = cpfmax(tmin, cpfmin(t1, t2));
+		tmax = cpfmin(tmax, cpfmax(t1, t2));
+	}
+	
+	return (tmin <= tmax && 0.0f <= tmax && tmin <= 1.0f ? cpfmax(tmin, 0.0f) : INFINITY);
+}
+
+static void
+cpSweep2DSegmentQuery(cpSweep2D *sweep, void *obj, cpVect a, cpVect b, cpFloat t_exit, cpSpatialIndexSegmentQueryFunc func, void *data)
+{
+	cpBB bb = cpBBExpand(cpBBNew(a.x, a.y, a.x, a.y), b);
+	
+	int axis = sweep->queryAxis;
+	Endpoint *endpoints = sweep->axes[axis];
+	int count = 2*sweep->num;
+	
+	cpFloat max = BBMax(bb, axis);
+	for(int i=LowerBound(endpoints, count, BBMin(bb, axis) - sweep->maxExtent[axis]); i<count && endpoints[i].value <= max; i++){
+		Endpoint e = endpoints[i];
+		if(!e.isMax && cpBBIntersects(bb, e.handle->bb) && BBSegmentQuery(e.handle->bb, a, b) < t_exit){
+			t_exit = cpfmin(t_exit, func(obj, e.handle->obj, data));
+		}
+	}
+}
+
+//MARK: Reindex/Query
+
+typedef struct QueryContext {
+	cpSpatialIndexQueryFunc func;
+	void *data;
+} QueryContext;
+
+static void
+PairQuery(Pair *pair, QueryContext *context)
+{
+	context->func(pair->a->obj, pair->b->obj, context->data);
+}
+
+static void
+cpSweep2DReindexQuery(cpSweep2D *sweep, cpSpatialIndexQueryFunc func, void *data)
+{
+	cpSweep2DReindex(sweep);
+	
+	QueryContext context = {func, data};
+	cpHashSetEach(sweep->pairSet, (cpHashSetIteratorFunc)PairQuery, &context);
+	
+	// Reindex query is also responsible for colliding against the static index.
+	// Fortunately there is a helper function for that.
+	cpSpatialIndexCollideStatic((cpSpatialIndex *)sweep, sweep->spatialIndex.staticIndex, func, data);
+}
+
+static cpSpatialIndexClass klass = {
+	(cpSpatialIndexDestroyImpl)cpSweep2DDestroy,
+	
+	(cpSpatialIndexCountImpl)cpSweep2DCount,
+	(cpSpatialIndexEachImpl)cpSweep2DEach,
+	(cpSpatialIndexContainsImpl)cpSweep2DContains,
+	
+	(cpSpatialIndexInsertImpl)cpSweep2DInsert,
+	(cpSpatialIndexRemoveImpl)cpSweep2DRemove,
+	
+	(cpSpatialIndexReindexImpl)cpSweep2DReindex,
+	(cpSpatialIndexReindexObjectImpl)cpSweep2DReindexObject,
+	(cpSpatialIndexReindexQueryImpl)cpSweep2DReindexQuery,
+	
+	(cpSpatialIndexQueryImpl)cpSweep2DQuery,
+	(cpSpatialIndexSegmentQueryImpl)cpSweep2DSegmentQuery,
+};
+
+static inline cpSpatialIndexClass *Klass(){return &klass;}
@@ -0,0 +1,313 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+// Uploads the quads of an emulated CCTextureAtlas to a mock GL that counts bytes.
+// The full path re-uploads every drawn quad when anything changed, like CCTextureAtlas used to.
+// The ranged path mirrors -[CCTextureAtlas uploadQuadsFromIndex:amount:] with ccDirtyRanges
+// and 1 to 3 vertex buffers. After every draw the contents of the mock buffer are compared
+// with the quads, the program fails if they differ.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ccDirtyRanges.h"
+
+#define QUAD_SIZE	96
+#define MAX_VBOS	3
+
+typedef struct Quad {
+	unsigned char bytes[QUAD_SIZE];
+} Quad;
+
+// glBufferData() and glBufferSubData() on a GL_ARRAY_BUFFER
+typedef struct MockVBO {
+	Quad *data;
+	unsigned long long bytes;
+	unsigned int calls;
+} MockVBO;
+
+static void
+MockBufferData(MockVBO *vbo, size_t size, const void *data)
+{
+	memcpy(vbo->data, data, size);
+	vbo->bytes += size;
+	vbo->calls++;
+}
+
+static void
+MockBufferSubData(MockVBO *vbo, size_t offset, size_t size, const void *data)
+{
+	memcpy((char *)vbo->data + offset, data, size);
+	vbo->bytes += size;
+	vbo->calls++;
+}
+
+typedef struct Atlas {
+	Quad *quads;
+	unsigned int capacity, total;
+
+	int ranged;
+	unsigned int vboCount, currentVBO;
+	MockVBO vbos[MAX_VBOS];
+	ccDirtyRanges dirtyRanges[MAX_VBOS];
+	int dirty;
+} Atlas;
+
+static unsigned int seed = 12345;
+
+static unsigned int
+RandomInt(unsigned int n)
+{
+	seed = 1664525*seed + 1013904223;
+	return (seed >> 8)%n;
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+static void
+RandomQuad(Quad *quad)
+{
+	for( int i = 0; i < QUAD_SIZE; i++ )
+		quad->bytes[i] = (unsigned char)RandomInt(256);
+}
+
+static Atlas *
+MakeAtlas(unsigned int capacity, int ranged, unsigned int vboCount)
+{
+	Atlas *atlas = calloc(1, sizeof(Atlas));
+	atlas->quads = calloc(capacity, sizeof(Quad));
+	atlas->capacity = atlas->total = capacity;
+	atlas->ranged = ranged;
+	atlas->vboCount = vboCount;
+
+	for( unsigned int i = 0; i < capacity; i++ )
+		RandomQuad(atlas->quads + i);
+
+	for( unsigned int i = 0; i < vboCount; i++ ) {
+		atlas->vbos[i].data = calloc(capacity, sizeof(Quad));
+		memcpy(atlas->vbos[i].data, atlas->quads, capacity*sizeof(Quad));
+	}
+
+	return atlas;
+}
+
+static void
+FreeAtlas(Atlas *atlas)
+{
+	for( unsigned int i = 0; i < atlas->vboCount; i++ )
+		free(atlas->vbos[i].data);
+	free(atlas->quads);
+	free(atlas);
+}
+
+// -[CCTextureAtlas markDirtyQuadsFromIndex:amount:]
+static void
+MarkDirty(Atlas *atlas, unsigned int index, unsigned int amount)
+{
+	atlas->dirty = 1;
+	for( unsigned int i = 0; i < atlas->vboCount; i++ )
+		ccDirtyRangesAdd(&atlas->dirtyRanges[i], index, index + amount);
+}
+
+// -[CCTextureAtlas updateQuad:atIndex:]
+static void
+UpdateQuad(Atlas *atlas, unsigned int index)
+{
+	RandomQuad(atlas->quads + index);
+	MarkDirty(atlas, index, 1);
+}
+
+// -[CCTextureAtlas insertQuadFromIndex:atIndex:], the atlas stays full
+static void
+MoveQuad(Atlas *atlas, unsigned int oldIndex, unsigned int newIndex)
+{
+	if( oldIndex == newIndex )
+		return;
+
+	unsigned int howMany = oldIndex > newIndex ? oldIndex - newIndex : newIndex - oldIndex;
+	unsigned int dst = oldIndex, src = oldIndex + 1;
+	if( oldIndex > newIndex ) {
+		dst = newIndex + 1;
+		src = newIndex;
+	}
+
+	Quad backup = atlas->quads[oldIndex];
+	memmove(atlas->quads + dst, atlas->quads + src, howMany*sizeof(Quad));
+	atlas->quads[newIndex] = backup;
+
+	MarkDirty(atlas, oldIndex < newIndex ? oldIndex : newIndex, howMany + 1);
+}
+
+typedef struct UploadContext {
+	MockVBO *vbo;
+	const Quad *quads;
+} UploadContext;
+
+static void
+UploadQuads(unsigned int begin, unsigned int end, void *data)
+{
+	UploadContext *context = data;
+	MockBufferSubData(context->vbo, begin*sizeof(Quad), (end - begin)*sizeof(Quad), context->quads + begin);
+}
+
+// -[CCTextureAtlas drawNumberOfQuads:fromIndex:]
+static void
+Draw(Atlas *atlas, unsigned int start, unsigned int n)
+{
+	if( !atlas->ranged ) {
+		if( atlas->dirty )
+			MockBufferSubData(&atlas->vbos[0], start*sizeof(Quad), n*sizeof(Quad), atlas->quads + start);
+	} else if( ccDirtyRangesCount(&atlas->dirtyRanges[atlas->currentVBO], start, start + n) ) {
+		atlas->currentVBO = (atlas->currentVBO + 1)%atlas->vboCount;
+		ccDirtyRanges *ranges = &atlas->dirtyRanges[atlas->currentVBO];
+		MockVBO *vbo = &atlas->vbos[atlas->currentVBO];
+
+		if( 2*ccDirtyRangesCount(ranges, start, start + n) > atlas->capacity ) {
+			MockBufferData(vbo, atlas->capacity*sizeof(Quad), atlas->quads);
+			ccDirtyRangesClear(ranges);
+		} else {
+			UploadContext context = {vbo, atlas->quads};
+			ccDirtyRangesFlush(ranges, start, start + n, UploadQuads, &context);
+		}
+	}
+	atlas->dirty = 0;
+
+	if( memcmp(atlas->vbos[atlas->currentVBO].data + start, atlas->quads + start, n*sizeof(Quad)) != 0 ) {
+		printf("error: the drawn buffer doesn't match the quads\n");
+		exit(1);
+	}
+}
+
+typedef void (*Scenario)(Atlas *atlas);
+
+// a few sprites at random indexes change every frame
+static void
+FewSprites(Atlas *atlas)
+{
+	for( int i = 0; i < 3; i++ )
+		UpdateQuad(atlas, RandomInt(atlas->capacity));
+	Draw(atlas, 0, atlas->total);
+}
+
+// a hundred sprites at random indexes
+static void
+ManySprites(Atlas *atlas)
+{
+	for( int i = 0; i < 100; i++ )
+		UpdateQuad(atlas, RandomInt(atlas->capacity));
+	Draw(atlas, 0, atlas->total);
+}
+
+// a block of 200 sprites, like the children of one node
+static void
+Block(Atlas *atlas)
+{
+	unsigned int first = RandomInt(atlas->capacity - 200);
+	for( unsigned int i = first; i < first + 200; i++ )
+		UpdateQuad(atlas, i);
+	Draw(atlas, 0, atlas->total);
+}
+
+// one sprite is reordered
+static void
+Reorder(Atlas *atlas)
+{
+	MoveQuad(atlas, RandomInt(atlas->capacity), RandomInt(atlas->capacity));
+	Draw(atlas, 0, atlas->total);
+}
+
+// every sprite changes
+static void
+AllSprites(Atlas *atlas)
+{
+	for( unsigned int i = 0; i < atlas->capacity; i++ )
+		UpdateQuad(atlas, i);
+	Draw(atlas, 0, atlas->total);
+}
+
+// two particle systems share the atlas and are drawn separately, one of them changes
+static void
+PartialDraw(Atlas *atlas)
+{
+	unsigned int half = atlas->capacity/2;
+	for( int i = 0; i < 3; i++ )
+		UpdateQuad(atlas, RandomInt(half));
+	Draw(atlas, 0, half);
+	Draw(atlas, half, atlas->capacity - half);
+}
+
+static void
+Run(const char *name, Scenario scenario, unsigned int capacity, unsigned int frames)
+{
+	printf("%-13s", name);
+
+	for( unsigned int mode = 0; mode < 4; mode++ ) {
+		seed = 12345;
+		Atlas *atlas = MakeAtlas(capacity, mode > 0, mode > 0 ? mode : 1);
+
+		double start = Now();
+		for( unsigned int frame = 0; frame < frames; frame++ )
+			scenario(atlas);
+		double time = (Now() - start)/frames;
+
+		unsigned long long bytes = 0;
+		unsigned int calls = 0;
+		for( unsigned int i = 0; i < atlas->vboCount; i++ ) {
+			bytes += atlas->vbos[i].bytes;
+			calls += atlas->vbos[i].calls;
+		}
+
+		printf("  %9.1f KB %5.1f calls %6.3f ms", bytes/1024.0/frames, (double)calls/frames, time);
+		FreeAtlas(atlas);
+	}
+
+	printf("\n");
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int frames = (argc > 1 ? (unsigned int)atoi(argv[1]) : 200);
+	unsigned int capacity = 10000;
+
+	printf("%u quads, per frame: full upload | ranged, 1 VBO | ranged, 2 VBOs | ranged, 3 VBOs\n", capacity);
+	Run("few sprites", FewSprites, capacity, frames);
+	Run("many sprites", ManySprites, capacity, frames);
+	Run("block", Block, capacity, frames);
+	Run("reorder", Reorder, capacity, frames);
+	Run("all sprites", AllSprites, capacity, frames);
+	Run("partial draw", PartialDraw, capacity, frames);
+
+	return 0;
+}
@@ -0,0 +1,331 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+// Reorders the sprites of a flat CCSpriteBatchNode, like -[CCSpriteBatchNode sortAllChildren].
+// The old path is the insertion sort of the children followed by one swap of the descendants
+// and of the quads per moved sprite. The new path keeps it while few sprites move, otherwise
+// it sorts with ccOrderSort and moves the descendants and the quads with ccOrderPermute().
+// Both paths must produce the same children, descendants and quads, the program fails otherwise.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "ccOrderSort.h"
+
+#define QUAD_SIZE	96
+
+typedef struct Sprite {
+	long zOrder;
+	unsigned long orderOfArrival;
+	unsigned int atlasIndex;
+	float y;
+} Sprite;
+
+typedef struct Quad {
+	unsigned char bytes[QUAD_SIZE];
+} Quad;
+
+typedef struct Batch {
+	Sprite **children;
+	Sprite **descendants;
+	Quad *quads;
+	unsigned int count;
+} Batch;
+
+static unsigned int seed = 12345;
+
+static unsigned int
+RandomInt(unsigned int n)
+{
+	seed = 1664525*seed + 1013904223;
+	return (seed >> 8)%n;
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+static Batch *
+MakeBatch(Sprite *sprites, unsigned int count)
+{
+	Batch *batch = calloc(1, sizeof(Batch));
+	batch->children = calloc(count, sizeof(Sprite *));
+	batch->descendants = calloc(count, sizeof(Sprite *));
+	batch->quads = calloc(count, sizeof(Quad));
+	batch->count = count;
+
+	for( unsigned int i = 0; i < count; i++ ) {
+		batch->children[i] = batch->descendants[i] = sprites + i;
+		sprites[i].atlasIndex = i;
+		memset(batch->quads + i, (int)(i*7), sizeof(Quad));
+		memcpy(batch->quads[i].bytes, &i, sizeof(i));
+	}
+
+	return batch;
+}
+
+static void
+FreeBatch(Batch *batch)
+{
+	free(batch->children);
+	free(batch->descendants);
+	free(batch->quads);
+	free(batch);
+}
+
+// -[CCSpriteBatchNode swap:withNewIndex:]
+static void
+Swap(Batch *batch, unsigned int oldIndex, unsigned int newIndex)
+{
+	Sprite *tempItem = batch->descendants[oldIndex];
+	Quad tempQuad = batch->quads[oldIndex];
+
+	batch->descendants[newIndex]->atlasIndex = oldIndex;
+
+	batch->descendants[oldIndex] = batch->descendants[newIndex];
+	batch->quads[oldIndex] = batch->quads[newIndex];
+	batch->descendants[newIndex] = tempItem;
+	batch->quads[newIndex] = tempQuad;
+}
+
+static void
+SortOld(Batch *batch)
+{
+	Sprite **x = batch->children;
+	int length = (int)batch->count;
+
+	for( int i = 1; i < length; i++ ) {
+		Sprite *tempItem = x[i];
+		int j = i - 1;
+
+		while( j >= 0 && ( tempItem->zOrder < x[j]->zOrder || ( tempItem->zOrder == x[j]->zOrder && tempItem->orderOfArrival < x[j]->orderOfArrival ) ) ) {
+			x[j+1] = x[j];
+			j--;
+		}
+		x[j+1] = tempItem;
+	}
+
+	for( unsigned int i = 0; i < batch->count; i++ ) {
+		Sprite *sprite = x[i];
+		unsigned int oldIndex = sprite->atlasIndex;
+		sprite->atlasIndex = i;
+		sprite->orderOfArrival = 0;
+		if( oldIndex != i )
+			Swap(batch, oldIndex, i);
+	}
+}
+
+static void
+SortNew(Batch *batch, ccOrderSort *sort, ccOrderPermutation *perm)
+{
+	unsigned int count = batch->count;
+	Sprite **x = batch->children;
+
+	// -[CCNode sortChildrenByZOrder]: the insertion sort in place while few sprites move
+	unsigned long moves = 0, maxMoves = ccOrderSortInsertionMoves(count);
+	unsigned int i;
+	for( i = 1; i < count && moves <= maxMoves; i++ ) {
+		Sprite *tempItem = x[i];
+		unsigned int j = i;
+
+		while( j > 0 && ( tempItem->zOrder < x[j-1]->zOrder || ( tempItem->zOrder == x[j-1]->zOrder && tempItem->orderOfArrival < x[j-1]->orderOfArrival ) ) ) {
+			x[j] = x[j-1];
+			j--;
+		}
+		x[j] = tempItem;
+		moves += i - j;
+	}
+
+	// -[CCSpriteBatchNode sortAllChildren]: few sprites moved, swap them into place
+	if( i >= count && moves <= maxMoves ) {
+		for( i = 0; i < count; i++ ) {
+			Sprite *sprite = x[i];
+			unsigned int oldIndex = sprite->atlasIndex;
+			sprite->atlasIndex = i;
+			sprite->orderOfArrival = 0;
+			if( oldIndex != i )
+				Swap(batch, oldIndex, i);
+		}
+		return;
+	}
+
+	// the rest of the children are sorted with ccOrderSort
+	ccOrderSortReserve(sort, count);
+	for( i = 0; i < count; i++ ) {
+		sort->entries[i].zOrder = x[i]->zOrder;
+		sort->entries[i].orderOfArrival = x[i]->orderOfArrival;
+		sort->entries[i].object = x[i];
+	}
+	if( ccOrderSortEntries(sort, count) ) {
+		for( i = 0; i < count; i++ )
+			x[i] = sort->entries[i].object;
+	}
+
+	// -[CCSpriteBatchNode moveSprite:toAtlasIndex:swap:] and reorderAtlas
+	ccOrderPermutationReserve(perm, count);
+	for( i = 0; i < count; i++ )
+		perm->from[i] = x[i]->atlasIndex;
+
+	if( ! ccOrderPermutationIsValid(perm, count) ) {
+		printf("error: the atlas indexes are not a permutation\n");
+		exit(1);
+	}
+
+	unsigned int first = 0;
+	while( first < count && perm->from[first] == first )
+		first++;
+
+	if( first < count ) {
+		ccOrderPermute(perm, batch->descendants, sizeof(Sprite *), count);
+		ccOrderPermute(perm, batch->quads, sizeof(Quad), count);
+	}
+
+	for( i = 0; i < count; i++ ) {
+		batch->descendants[i]->atlasIndex = i;
+		batch->descendants[i]->orderOfArrival = 0;
+	}
+}
+
+typedef void (*Scenario)(Sprite *sprites, unsigned int count, unsigned int frame);
+
+// isometric sprites that walk a little, the zOrder is their row
+static void
+Walk(Sprite *sprites, unsigned int count, unsigned int frame)
+{
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( frame == 0 )
+			sprites[i].y = (float)RandomInt(4*count);
+		else
+			sprites[i].y += (float)RandomInt(17) - 8.0f;
+
+		sprites[i].zOrder = -(long)sprites[i].y;
+	}
+}
+
+// every sprite gets a random zOrder
+static void
+Shuffle(Sprite *sprites, unsigned int count, unsigned int frame)
+{
+	(void)frame;
+
+	for( unsigned int i = 0; i < count; i++ )
+		sprites[i].zOrder = (long)RandomInt(count);
+}
+
+// a single sprite is reordered, like reorderChild:z:
+static void
+One(Sprite *sprites, unsigned int count, unsigned int frame)
+{
+	if( frame == 0 ) {
+		for( unsigned int i = 0; i < count; i++ )
+			sprites[i].zOrder = (long)i;
+	} else {
+		Sprite *sprite = sprites + RandomInt(count);
+		sprite->zOrder = (long)RandomInt(count);
+		sprite->orderOfArrival = frame;
+	}
+}
+
+static double
+RunPath(int useNew, Scenario scenario, Sprite *sprites, unsigned int count, unsigned int frames, Batch **result)
+{
+	seed = 12345;
+	memset(sprites, 0, count*sizeof(Sprite));
+	Batch *batch = MakeBatch(sprites, count);
+	ccOrderSort *sort = ccOrderSortNew();
+	ccOrderPermutation *perm = ccOrderPermutationNew();
+
+	double time = 0.0;
+	for( unsigned int frame = 0; frame < frames; frame++ ) {
+		scenario(sprites, count, frame);
+
+		double start = Now();
+		if( useNew )
+			SortNew(batch, sort, perm);
+		else
+			SortOld(batch);
+		time += Now() - start;
+	}
+
+	ccOrderSortFree(sort);
+	ccOrderPermutationFree(perm);
+	*result = batch;
+	return time/frames;
+}
+
+static void
+Run(const char *name, Scenario scenario, unsigned int count, unsigned int frames)
+{
+	Sprite *oldSprites = calloc(count, sizeof(Sprite));
+	Sprite *newSprites = calloc(count, sizeof(Sprite));
+	Batch *oldBatch, *newBatch;
+
+	double oldTime = RunPath(0, scenario, oldSprites, count, frames, &oldBatch);
+	double newTime = RunPath(1, scenario, newSprites, count, frames, &newBatch);
+
+	for( unsigned int i = 0; i < count; i++ ) {
+		if( oldBatch->children[i] - oldSprites != newBatch->children[i] - newSprites ||
+			oldBatch->descendants[i] - oldSprites != newBatch->descendants[i] - newSprites ||
+			newBatch->descendants[i]->atlasIndex != i ) {
+			printf("error: %s, %u sprites: the sprites are not in the same order\n", name, count);
+			exit(1);
+		}
+	}
+
+	if( memcmp(oldBatch->quads, newBatch->quads, count*sizeof(Quad)) != 0 ) {
+		printf("error: %s, %u sprites: the quads are not in the same order\n", name, count);
+		exit(1);
+	}
+
+	printf("%-8s %6u sprites: insertion sort + swaps %9.3f ms  ccOrderSort + permute %7.3f ms (%.1fx)\n",
+		name, count, oldTime, newTime, oldTime/newTime);
+
+	FreeBatch(oldBatch);
+	FreeBatch(newBatch);
+	free(oldSprites);
+	free(newSprites);
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int frames = (argc > 1 ? (unsigned int)atoi(argv[1]) : 20);
+
+	unsigned int counts[] = {100, 1000, 5000, 20000};
+	for( int i = 0; i < 4; i++ ) {
+		Run("walk", Walk, counts[i], frames);
+		Run("shuffle", Shuffle, counts[i], frames);
+		Run("one", One, counts[i], frames);
+	}
+
+	return 0;
+}
@@ -0,0 +1,480 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+
+
+// Runs particle systems in gravity and radius mode. The per particle path is the loop of
+// -[CCParticleSystem update:], with tCCParticle and a call through a function pointer that
+// stands in for the updateQuadWithParticle:newPosition: IMP. The other path keeps the particles
+// in a ccParticleArrays. Both paths must end up with the same particles and quads.
+// ParticleBenchmarkScalar runs the same work with CC_NO_SIMD. CCParticleSystemQuad doesn't
+// use the arrays then, see CC_PARTICLE_ARRAYS_SIMD.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "ccParticleArrays.h"
+
+#define kCCParticleStartSizeEqualToEndSize -1
+#define kCCParticleStartRadiusEqualToEndRadius -1
+#define DEGREES_TO_RADIANS(__ANGLE__) ((__ANGLE__) * 0.01745329252f)
+
+typedef struct Point { float x, y; } Point;
+typedef struct Color { float r, g, b, a; } Color;
+
+// tCCParticle, CGFloat is a float
+typedef struct Particle {
+	Point pos;
+	Point startPos;
+	Color color;
+	Color deltaColor;
+	float size, deltaSize;
+	float rotation, deltaRotation;
+	float timeToLive;
+	unsigned int atlasIndex;
+	union {
+		struct { Point dir; float radialAccel, tangentialAccel; } A;
+		struct { float angle, degreesPerSecond, radius, deltaRadius; } B;
+	} mode;
+} Particle;
+
+// The properties read from the plist of a CCParticleSystem
+typedef struct Config {
+	const char *name;
+	int radiusMode;
+	float life, lifeVar;
+	float angle, angleVar;
+	Point posVar;
+	Color startColor, startColorVar, endColor, endColorVar;
+	float startSize, startSizeVar, endSize, endSizeVar;
+	float startSpin, startSpinVar, endSpin, endSpinVar;
+	// Mode A
+	Point gravity;
+	float speed, speedVar, radialAccel, radialAccelVar, tangentialAccel, tangentialAccelVar;
+	// Mode B
+	float startRadius, startRadiusVar, endRadius, endRadiusVar, rotatePerSecond, rotatePerSecondVar;
+} Config;
+
+typedef struct System {
+	const Config *config;
+	unsigned int totalParticles;
+	unsigned int particleCount;
+	float emissionRate, emitCounter;
+	// kCCPositionTypeFree: the emitter moves and the particles stay behind
+	Point position;
+	int opacityModifyRGB;
+
+	Particle *particles;
+	unsigned int particleIdx;
+	ccParticleArrays *arrays;
+	float *quads;
+	unsigned int seed;
+} System;
+
+static float
+Random(System *s)
+{
+	s->seed = 1664525*s->seed + 1013904223;
+	return (float)(s->seed >> 8)/(float)(1 << 23) - 1.0f;
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+static float
+Clamp(float x)
+{
+	return x < 0 ? 0 : (x > 1 ? 1 : x);
+}
+
+// -[CCParticleSystem initParticle:]
+static void
+InitParticle(System *s, Particle *p)
+{
+	const Config *c = s->config;
+
+	p->timeToLive = c->life + c->lifeVar*Random(s);
+	p->timeToLive = p->timeToLive > 0 ? p->timeToLive : 0;
+
+	p->pos.x = c->posVar.x*Random(s);
+	p->pos.y = c->posVar.y*Random(s);
+
+	Color start, end;
+	start.r = Clamp(c->startColor.r + c->startColorVar.r*Random(s));
+	start.g = Clamp(c->startColor.g + c->startColorVar.g*Random(s));
+	start.b = Clamp(c->startColor.b + c->startColorVar.b*Random(s));
+	start.a = Clamp(c->startColor.a + c->startColorVar.a*Random(s));
+	end.r = Clamp(c->endColor.r + c->endColorVar.r*Random(s));
+	end.g = Clamp(c->endColor.g + c->endColorVar.g*Random(s));
+	end.b = Clamp(c->endColor.b + c->endColorVar.b*Random(s));
+	end.a = Clamp(c->endColor.a + c->endColorVar.a*Random(s));
+
+	p->color = start;
+	p->deltaColor.r = (end.r - start.r)/p->timeToLive;
+	p->deltaColor.g = (end.g - start.g)/p->timeToLive;
+	p->deltaColor.b = (end.b - start.b)/p->timeToLive;
+	p->deltaColor.a = (end.a - start.a)/p->timeToLive;
+
+	float startS = c->startSize + c->startSizeVar*Random(s);
+	startS = startS > 0 ? startS : 0;
+	p->size = startS;
+	if( c->endSize == kCCParticleStartSizeEqualToEndSize )
+		p->deltaSize = 0;
+	else {
+		float endS = c->endSize + c->endSizeVar*Random(s);
+		endS = endS > 0 ? endS : 0;
+		p->deltaSize = (endS - startS)/p->timeToLive;
+	}
+
+	float startA = c->startSpin + c->startSpinVar*Random(s);
+	float endA = c->endSpin + c->endSpinVar*Random(s);
+	p->rotation = startA;
+	p->deltaRotation = (endA - startA)/p->timeToLive;
+
+	p->startPos = s->position;
+
+	float a = DEGREES_TO_RADIANS(c->angle + c->angleVar*Random(s));
+
+	if( ! c->radiusMode ) {
+		float speed = c->speed + c->speedVar*Random(s);
+		p->mode.A.dir.x = cosf(a)*speed;
+		p->mode.A.dir.y = sinf(a)*speed;
+		p->mode.A.radialAccel = c->radialAccel + c->radialAccelVar*Random(s);
+		p->mode.A.tangentialAccel = c->tangentialAccel + c->tangentialAccelVar*Random(s);
+	} else {
+		float startRadius = c->startRadius + c->startRadiusVar*Random(s);
+		float endRadius = c->endRadius + c->endRadiusVar*Random(s);
+		p->mode.B.radius = startRadius;
+		if( c->endRadius == kCCParticleStartRadiusEqualToEndRadius )
+			p->mode.B.deltaRadius = 0;
+		else
+			p->mode.B.deltaRadius = (endRadius - startRadius)/p->timeToLive;
+		p->mode.B.angle = a;
+		p->mode.B.degreesPerSecond = DEGREES_TO_RADIANS(c->rotatePerSecond + c->rotatePerSecondVar*Random(s));
+	}
+}
+
+// The emission of -[CCParticleSystem update:], returns how many particles to add
+static unsigned int
+Emit(System *s, float dt)
+{
+	unsigned int count = s->particleCount, added = 0;
+	float rate = 1.0f/s->emissionRate;
+
+	if( count < s->totalParticles )
+		s->emitCounter += dt;
+
+	while( count + added < s->totalParticles && s->emitCounter > rate ) {
+		added++;
+		s->emitCounter -= rate;
+	}
+
+	return added;
+}
+
+static unsigned char
+ColorByte(float f)
+{
+	// clamped, the conversion of CCParticleSystemQuad is undefined out of [0, 256)
+	return f > 0 ? (f < 255 ? (unsigned char)f : 255) : 0;
+}
+
+// -[CCParticleSystemQuad updateQuadWithParticle:newPosition:]
+__attribute__((noinline)) static void
+UpdateQuadWithParticle(System *s, Particle *p, Point newPos)
+{
+	float *quad = s->quads + CC_PARTICLE_QUAD_FLOATS*s->particleIdx;
+
+	unsigned char color[4];
+	if( s->opacityModifyRGB ) {
+		color[0] = ColorByte(p->color.r*p->color.a*255); color[1] = ColorByte(p->color.g*p->color.a*255);
+		color[2] = ColorByte(p->color.b*p->color.a*255);
+	} else {
+		color[0] = ColorByte(p->color.r*255); color[1] = ColorByte(p->color.g*255); color[2] = ColorByte(p->color.b*255);
+	}
+	color[3] = ColorByte(p->color.a*255);
+	for( int k = 0; k < 4; k++ )
+		memcpy(quad + 6*k + 3, color, 4);
+
+	float size_2 = p->size/2;
+	float ax, ay, bx, by, cx, cy, dx, dy;
+	if( p->rotation ) {
+		float x1 = -size_2, y1 = -size_2, x2 = size_2, y2 = size_2;
+		float x = newPos.x, y = newPos.y;
+		float r = -DEGREES_TO_RADIANS(p->rotation);
+		float cr = cosf(r), sr = sinf(r);
+		ax = x1 * cr - y1 * sr + x; ay = x1 * sr + y1 * cr + y;
+		bx = x2 * cr - y1 * sr + x; by = x2 * sr + y1 * cr + y;
+		cx = x2 * cr - y2 * sr + x; cy = x2 * sr + y2 * cr + y;
+		dx = x1 * cr - y2 * sr + x; dy = x1 * sr + y2 * cr + y;
+	} else {
+		ax = newPos.x - size_2; ay = newPos.y - size_2;
+		bx = newPos.x + size_2; by = newPos.y - size_2;
+		cx = newPos.x + size_2; cy = newPos.y + size_2;
+		dx = newPos.x - size_2; dy = newPos.y + size_2;
+	}
+
+	quad[0] = dx; quad[1] = dy;
+	quad[6] = ax; quad[7] = ay;
+	quad[12] = cx; quad[13] = cy;
+	quad[18] = bx; quad[19] = by;
+}
+
+typedef void (*UpdateQuadFunc)(System *, Particle *, Point);
+
+// -[CCParticleSystem update:] with tCCParticle
+static void
+UpdateParticles(System *s, float dt, UpdateQuadFunc updateQuad)
+{
+	const Config *c = s->config;
+
+	for( unsigned int added = Emit(s, dt); added > 0; added-- )
+		InitParticle(s, &s->particles[s->particleCount++]);
+
+	Point currentPosition = s->position;
+	s->particleIdx = 0;
+
+	while( s->particleIdx < s->particleCount ) {
+		Particle *p = &s->particles[s->particleIdx];
+
+		p->timeToLive -= dt;
+
+		if( p->timeToLive > 0 ) {
+			if( ! c->radiusMode ) {
+				Point radial = {0, 0}, tangential;
+				if( p->pos.x || p->pos.y ) {
+					float l = 1.0f/sqrtf(p->pos.x*p->pos.x + p->pos.y*p->pos.y);
+					radial.x = p->pos.x*l;
+					radial.y = p->pos.y*l;
+				}
+				tangential = radial;
+				radial.x *= p->mode.A.radialAccel;
+				radial.y *= p->mode.A.radialAccel;
+
+				float newy = tangential.x;
+				tangential.x = -tangential.y;
+				tangential.y = newy;
+				tangential.x *= p->mode.A.tangentialAccel;
+				tangential.y *= p->mode.A.tangentialAccel;
+
+				p->mode.A.dir.x += (radial.x + tangential.x + c->gravity.x)*dt;
+				p->mode.A.dir.y += (radial.y + tangential.y + c->gravity.y)*dt;
+				p->pos.x += p->mode.A.dir.x*dt;
+				p->pos.y += p->mode.A.dir.y*dt;
+			} else {
+				p->mode.B.angle += p->mode.B.degreesPerSecond*dt;
+				p->mode.B.radius += p->mode.B.deltaRadius*dt;
+				p->pos.x = - cosf(p->mode.B.angle)*p->mode.B.radius;
+				p->pos.y = - sinf(p->mode.B.angle)*p->mode.B.radius;
+			}
+
+			p->color.r += p->deltaColor.r*dt;
+			p->color.g += p->deltaColor.g*dt;
+			p->color.b += p->deltaColor.b*dt;
+			p->color.a += p->deltaColor.a*dt;
+
+			p->size += p->deltaSize*dt;
+			p->size = 0 > p->size ? 0 : p->size;
+
+			p->rotation += p->deltaRotation*dt;
+
+			Point diff = {currentPosition.x - p->startPos.x, currentPosition.y - p->startPos.y};
+			Point newPos = {p->pos.x - diff.x, p->pos.y - diff.y};
+			updateQuad(s, p, newPos);
+
+			s->particleIdx++;
+		} else {
+			if( s->particleIdx != s->particleCount - 1 )
+				s->particles[s->particleIdx] = s->particles[s->particleCount - 1];
+			s->particleCount--;
+		}
+	}
+}
+
+// -[CCParticleSystem update:] with ccParticleArrays
+static void
+UpdateArrays(System *s, float dt)
+{
+	ccParticleArrays *a = s->arrays;
+
+	for( unsigned int added = Emit(s, dt); added > 0; added-- ) {
+		Particle p;
+		InitParticle(s, &p);
+
+		unsigned int i = a->count++;
+		a->timeToLive[i] = p.timeToLive;
+		a->posX[i] = p.pos.x; a->posY[i] = p.pos.y;
+		a->startPosX[i] = p.startPos.x; a->startPosY[i] = p.startPos.y;
+		a->colorR[i] = p.color.r; a->colorG[i] = p.color.g; a->colorB[i] = p.color.b; a->colorA[i] = p.color.a;
+		a->deltaColorR[i] = p.deltaColor.r; a->deltaColorG[i] = p.deltaColor.g;
+		a->deltaColorB[i] = p.deltaColor.b; a->deltaColorA[i] = p.deltaColor.a;
+		a->size[i] = p.size; a->deltaSize[i] = p.deltaSize;
+		a->rotation[i] = p.rotation; a->deltaRotation[i] = p.deltaRotation;
+		if( ! s->config->radiusMode ) {
+			a->mode.A.dirX[i] = p.mode.A.dir.x; a->mode.A.dirY[i] = p.mode.A.dir.y;
+			a->mode.A.radialAccel[i] = p.mode.A.radialAccel; a->mode.A.tangentialAccel[i] = p.mode.A.tangentialAccel;
+		} else {
+			a->mode.B.angle[i] = p.mode.B.angle; a->mode.B.degreesPerSecond[i] = p.mode.B.degreesPerSecond;
+			a->mode.B.radius[i] = p.mode.B.radius; a->mode.B.deltaRadius[i] = p.mode.B.deltaRadius;
+		}
+		s->particleCount++;
+	}
+
+	if( ! s->config->radiusMode )
+		s->particleCount = ccParticleArraysUpdateGravity(a, dt, s->config->gravity.x, s->config->gravity.y);
+	else
+		s->particleCount = ccParticleArraysUpdateRadius(a, dt);
+
+	ccParticleArraysUpdateQuads(a, s->quads, s->position.x, s->position.y, 1, 0, 0, s->opacityModifyRGB);
+}
+
+static void
+InitSystem(System *s, const Config *c, unsigned int totalParticles, int arrays)
+{
+	memset(s, 0, sizeof(*s));
+	s->config = c;
+	s->totalParticles = totalParticles;
+	s->emissionRate = totalParticles/c->life;
+	s->opacityModifyRGB = 1;
+	s->seed = 12345;
+	s->quads = calloc(totalParticles, CC_PARTICLE_QUAD_FLOATS*sizeof(float));
+	if( arrays )
+		s->arrays = ccParticleArraysNew(totalParticles);
+	else
+		s->particles = calloc(totalParticles, sizeof(Particle));
+}
+
+static void
+FreeSystem(System *s)
+{
+	ccParticleArraysFree(s->arrays);
+	free(s->particles);
+	free(s->quads);
+}
+
+// Runs warmup frames, then returns the time of a frame in ms
+static double
+Run(System *s, unsigned int warmup, unsigned int frames)
+{
+	const float dt = 1.0f/60;
+	double start = 0;
+
+	for( unsigned int frame = 0; frame < warmup + frames; frame++ ) {
+		if( frame == warmup )
+			start = Now();
+
+		// the emitter moves in a circle
+		s->position.x = 240 + 100*cosf(frame*0.02f);
+		s->position.y = 160 + 100*sinf(frame*0.02f);
+
+		if( s->arrays )
+			UpdateArrays(s, dt);
+		else
+			UpdateParticles(s, dt, UpdateQuadWithParticle);
+	}
+
+	return (Now() - start)/frames;
+}
+
+// Doesn't depend on the order of the quads
+static double
+Checksum(const System *s)
+{
+	double sum = 0;
+	for( unsigned int i = 0; i < s->particleCount; i++ ) {
+		const float *quad = s->quads + CC_PARTICLE_QUAD_FLOATS*i;
+		for( int k = 0; k < 4; k++ ) {
+			const unsigned char *color = (const unsigned char *)(quad + 6*k + 3);
+			sum += quad[6*k] + 2.0*quad[6*k + 1] + color[0] + color[1] + color[2] + color[3];
+		}
+	}
+
+	return sum;
+}
+
+static const Config configs[] = {
+	// CCParticleGalaxy
+	{ "gravity", 0, 4, 1, 90, 360, {0, 0},
+		{0.12f, 0.25f, 0.76f, 1}, {0, 0, 0, 0}, {0, 0, 0, 1}, {0, 0, 0, 0},
+		37, 10, kCCParticleStartSizeEqualToEndSize, 0, 0, 0, 0, 0,
+		{0, 0}, 60, 10, -80, 0, 80, 0,
+		0, 0, 0, 0, 0, 0 },
+	// CCParticleFire with spinning particles
+	{ "gravity, spin", 0, 3, 0.25f, 90, 10, {40, 20},
+		{0.76f, 0.25f, 0.12f, 1}, {0, 0, 0, 0}, {0, 0, 0, 1}, {0, 0, 0, 0},
+		54, 10, kCCParticleStartSizeEqualToEndSize, 0, 0, 90, 360, 180,
+		{0, 0}, 60, 20, 0, 0, 0, 0,
+		0, 0, 0, 0, 0, 0 },
+	// CCParticleSpiral like, spinning
+	{ "radius, spin", 1, 12, 0, 90, 0, {0, 0},
+		{0.5f, 0.5f, 0.5f, 1}, {0.5f, 0.5f, 0.5f, 0}, {0.5f, 0.5f, 0.5f, 1}, {0.5f, 0.5f, 0.5f, 0},
+		20, 0, 20, 0, 0, 45, 0, 45,
+		{0, 0}, 0, 0, 0, 0, 0, 0,
+		150, 0, 10, 0, 90, 30 },
+};
+
+int
+main(int argc, char **argv)
+{
+	unsigned int frames = (argc > 1 ? (unsigned int)atoi(argv[1]) : 100);
+	unsigned int counts[] = {1000, 10000, 50000};
+	int failed = 0;
+
+	for( unsigned int c = 0; c < sizeof(configs)/sizeof(configs[0]); c++ ) {
+		for( int i = 0; i < 3; i++ ) {
+			System particles, arrays;
+			InitSystem(&particles, &configs[c], counts[i], 0);
+			InitSystem(&arrays, &configs[c], counts[i], 1);
+
+			// long enough to fill the systems
+			unsigned int warmup = (unsigned int)(60*(configs[c].life + configs[c].lifeVar)) + 1;
+			double particlesTime = Run(&particles, warmup, frames);
+			double arraysTime = Run(&arrays, warmup, frames);
+
+			double particlesChecksum = Checksum(&particles), arraysChecksum = Checksum(&arrays);
+			printf("%-14s %6u particles: tCCParticle %7.3f ms  arrays %7.3f ms (%.2fx)  checksum %.9g / %.9g\n",
+				configs[c].name, particles.particleCount, particlesTime, arraysTime, particlesTime/arraysTime,
+				particlesChecksum, arraysChecksum);
+
+			if( particles.particleCount != arrays.particleCount ||
+			    fabs(particlesChecksum - arraysChecksum) > 1e-6*fabs(particlesChecksum) ) {
+				printf("error: the particles are different\n");
+				failed = 1;
+			}
+
+			FreeSystem(&particles);
+			FreeSystem(&arrays);
+		}
+	}
+
+	return failed;
+}
@@ -0,0 +1,426 @@
+/*
+ * cocos2d for iPhone: http://www.cocos2d-iphone.org
+ *
+ * Copyright (c) 2012 Zynga Inc.
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in
+ * all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+ * THE SOFTWARE.
+ */
+
+// Visits synthetic node trees the way CCNode does. The matrix stack visit pushes,
+// multiplies and pops a matrix per node (CCNode -visit and -transform). The cached
+// visit flushes the moved nodes into a ccTransformCache, updates it and loads one
+// matrix per node (CCNode -visitCached). Each draw reads the current modelview
+// matrix, both visits must print the same checksum.
+//
+// The spawn runs move nodes to another layer every frame, like a scene that adds and
+// removes sprites. They compare rebuilding the cache with inserting and removing the
+// subtrees (CCNode -childEntersTransformCache: and -childLeavesTransformCache:).
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "kazmath/kazmath.h"
+#include "kazmath/GL/matrix.h"
+
+#include "ccTransformCache.h"
+
+typedef struct Node {
+	float x, y, rotation, scale, vertexZ;
+	float anchorX, anchorY;
+
+	// cached nodeToParentTransform, see CCNode
+	int isTransformDirty;
+	float a, b, c, d, tx, ty;
+
+	struct Node **children;
+	unsigned int childCount;
+
+	unsigned int slot;
+} Node;
+
+typedef struct Tree {
+	const char *name;
+	Node *nodes;
+	unsigned int count;
+} Tree;
+
+static unsigned int seed = 12345;
+
+static unsigned int
+RandomInt(unsigned int n)
+{
+	seed = 1664525*seed + 1013904223;
+	return (seed >> 8)%n;
+}
+
+static float
+RandomFloat(float min, float max)
+{
+	return min + (max - min)*(float)RandomInt(1 << 16)/(float)(1 << 16);
+}
+
+static double
+Now(void)
+{
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec*1e3 + t.tv_nsec*1e-6;
+}
+
+// Same as CCNode -nodeToParentTransform without skew.
+static void
+NodeToParentTransform(Node *node)
+{
+	if( !node->isTransformDirty )
+		return;
+
+	float c = 1, s = 0;
+	if( node->rotation ) {
+		float radians = -node->rotation*(float)M_PI/180.0f;
+		c = cosf(radians);
+		s = sinf(radians);
+	}
+
+	float x = node->x + c*-node->anchorX*node->scale + -s*-node->anchorY*node->scale;
+	float y = node->y + s*-node->anchorX*node->scale + c*-node->anchorY*node->scale;
+
+	node->a = c*node->scale; node->b = s*node->scale;
+	node->c = -s*node->scale; node->d = c*node->scale;
+	node->tx = x; node->ty = y;
+
+	node->isTransformDirty = 0;
+}
+
+static double checksum;
+
+// Stands in for a draw call: reads the matrix the node would be drawn with.
+static void
+Draw(void)
+{
+	kmMat4 m;
+	kmGLGetMatrix(KM_GL_MODELVIEW, &m);
+	checksum += m.mat[0] + m.mat[5] + m.mat[12] + m.mat[13] + m.mat[14];
+}
+
+//MARK: Matrix stack
+
+static void
+VisitStack(Node *node)
+{
+	kmGLPushMatrix();
+
+	NodeToParentTransform(node);
+
+	kmMat4 m;
+	memset(&m, 0, sizeof(m));
+	m.mat[0] = node->a; m.mat[4] = node->c; m.mat[12] = node->tx;
+	m.mat[1] = node->b; m.mat[5] = node->d; m.mat[13] = node->ty;
+	m.mat[10] = m.mat[15] = 1.0f;
+	m.mat[14] = node->vertexZ;
+	kmGLMultMatrix(&m);
+
+	Draw();
+	for( unsigned int i = 0; i < node->childCount; i++ )
+		VisitStack(node->children[i]);
+
+	kmGLPopMatrix();
+}
+
+//MARK: Transform cache
+
+static void
+UpdateLocal(ccTransformCache *cache, unsigned int slot, void *data)
+{
+	Node *node = data;
+	NodeToParentTransform(node);
+	ccTransformCacheSetLocal(cache, slot, node->a, node->b, node->c, node->d, node->tx, node->ty, node->vertexZ);
+}
+
+static void
+AddToCache(ccTransformCache *cache, Node *node, int parent)
+{
+	node->slot = ccTransformCacheAdd(cache, parent, node);
+	UpdateLocal(cache, node->slot, node);
+
+	for( unsigned int i = 0; i < node->childCount; i++ )
+		AddToCache(cache, node->children[i], node->slot);
+}
+
+static void
+VisitCached(ccTransformCache *cache, Node *node)
+{
+	kmGLLoadMatrix((const kmMat4 *)ccTransformCacheGetModelview(cache, node->slot));
+	Draw();
+
+	for( unsigned int i = 0; i < node->childCount; i++ )
+		VisitCached(cache, node->children[i]);
+}
+
+static void
+VisitWithCache(ccTransformCache *cache, Node *root)
+{
+	ccTransformCacheFlush(cache, UpdateLocal);
+
+	kmMat4 base;
+	kmGLGetMatrix(KM_GL_MODELVIEW, &base);
+	ccTransformCacheSetBase(cache, base.mat);
+	ccTransformCacheUpdate(cache);
+
+	kmGLPushMatrix();
+	VisitCached(cache, root);
+	kmGLPopMatrix();
+}
+
+//MARK: Trees
+
+static Node *
+AllocNodes(unsigned int count)
+{
+	Node *nodes = calloc(count, sizeof(Node));
+	for( unsigned int i = 0; i < count; i++ ) {
+		Node *node = nodes + i;
+		node->x = RandomFloat(-100.0f, 100.0f);
+		node->y = RandomFloat(-100.0f, 100.0f);
+		node->rotation = RandomFloat(-10.0f, 10.0f);
+		node->scale = RandomFloat(0.95f, 1.05f);
+		node->anchorX = RandomFloat(0.0f, 16.0f);
+		node->anchorY = RandomFloat(0.0f, 16.0f);
+		node->vertexZ = (i%7 == 0 ? 0.5f : 0.0f);
+		node->isTransformDirty = 1;
+	}
+
+	return nodes;
+}
+
+static void
+AddChild(Node *parent, Node *child)
+{
+	parent->children = realloc(parent->children, (parent->childCount + 1)*sizeof(Node *));
+	parent->children[parent->childCount++] = child;
+}
+
+// Chains of depth nodes under the root, like nested layers.
+static Tree
+DeepTree(unsigned int count, unsigned int depth)
+{
+	Tree tree = {"deep", AllocNodes(count), count};
+	for( unsigned int i = 1; i < count; i++ )
+		AddChild((i - 1)%depth == 0 ? tree.nodes : tree.nodes + i - 1, tree.nodes + i);
+
+	return tree;
+}
+
+// A few layers with many sprites each.
+static Tree
+WideTree(unsigned int count, unsigned int layers)
+{
+	Tree tree = {"wide", AllocNodes(count), count};
+	for( unsigned int i = 1; i <= layers; i++ )
+		AddChild(tree.nodes, tree.nodes + i);
+
+	for( unsigned int i = layers + 1; i < count; i++ )
+		AddChild(tree.nodes + 1 + i%layers, tree.nodes + i);
+
+	return tree;
+}
+
+static void
+FreeTree(Tree tree)
+{
+	for( unsigned int i = 0; i < tree.count; i++ )
+		free(tree.nodes[i].children);
+
+	free(tree.nodes);
+}
+
+// Moves one node out of every `every`. The cache is told about it the way the CCNode setters do.
+static void
+MoveNodes(Tree tree, ccTransformCache *cache, unsigned int frame, unsigned int every)
+{
+	for( unsigned int i = frame%every; i < tree.count; i += every ) {
+		Node *node = tree.nodes + i;
+		node->rotation += 1.0f;
+		node->isTransformDirty = 1;
+
+		if( cache )
+			ccTransformCacheQueue(cache, node->slot);
+	}
+}
+
+static void
+Run(Tree (*make)(unsigned int, unsigned int), unsigned int count, unsigned int shape, unsigned int every, unsigned int frames)
+{
+	Tree tree;
+	double stackTime, cacheTime, stackChecksum, cacheChecksum;
+
+	seed = 12345;
+	tree = make(count, shape);
+	checksum = 0.0;
+	double start = Now();
+	for( unsigned int frame = 0; frame < frames; frame++ ) {
+		MoveNodes(tree, NULL, frame, every);
+		VisitStack(tree.nodes);
+	}
+	stackTime = (Now() - start)/frames;
+	stackChecksum = checksum;
+	FreeTree(tree);
+
+	seed = 12345;
+	tree = make(count, shape);
+	ccTransformCache *cache = ccTransformCacheNew();
+	ccTransformCacheClear(cache);
+	AddToCache(cache, tree.nodes, -1);
+
+	checksum = 0.0;
+	start = Now();
+	for( unsigned int frame = 0; frame < frames; frame++ ) {
+		MoveNodes(tree, cache, frame, every);
+		VisitWithCache(cache, tree.nodes);
+	}
+	cacheTime = (Now() - start)/frames;
+	cacheChecksum = checksum;
+	ccTransformCacheFree(cache);
+	FreeTree(tree);
+
+	printf("%-5s %6u nodes, %s: matrix stack %7.3f ms  cache %7.3f ms  (%.2fx)  checksum %.6g / %.6g\n",
+		tree.name, count, every == 1 ? "all moving   " : "1/50th moving",
+		stackTime, cacheTime, stackTime/cacheTime, stackChecksum, cacheChecksum);
+}
+
+//MARK: Spawning
+
+static void
+RemoveChild(Node *parent, Node *child)
+{
+	unsigned int i = 0;
+	while( parent->children[i] != child )
+		i++;
+
+	memmove(parent->children + i, parent->children + i + 1, (parent->childCount - i - 1)*sizeof(Node *));
+	parent->childCount--;
+}
+
+// Moves `spawn` sprites to another layer, the way removeChild: and addChild: do.
+// The layers are the children of the root, see WideTree().
+static void
+SpawnNodes(Tree tree, ccTransformCache *cache, unsigned int layers, unsigned int spawn, int rebuild)
+{
+	Node *root = tree.nodes;
+	if( rebuild )
+		ccTransformCacheInvalidate(cache);
+
+	for( unsigned int i = 0; i < spawn; i++ ) {
+		Node *from = root->children[RandomInt(layers)];
+		Node *to = root->children[RandomInt(layers)];
+		if( from->childCount == 0 )
+			continue;
+
+		Node *node = from->children[0];
+		RemoveChild(from, node);
+		if( !cache->invalid )
+			ccTransformCacheRemove(cache, node->slot);
+
+		node->x = RandomFloat(-100.0f, 100.0f);
+		node->isTransformDirty = 1;
+
+		AddChild(to, node);
+		if( !cache->invalid ) {
+			unsigned int slot = ccTransformCacheInsert(cache, to->slot, 1);
+			AddToCache(cache, node, to->slot);
+			ccTransformCacheUpdateSubtree(cache, slot);
+		}
+	}
+
+	if( cache->invalid ) {
+		ccTransformCacheClear(cache);
+		AddToCache(cache, root, -1);
+	}
+}
+
+static double
+RunSpawnCache(unsigned int count, unsigned int layers, unsigned int spawn, unsigned int frames, int rebuild)
+{
+	seed = 12345;
+	Tree tree = WideTree(count, layers);
+	ccTransformCache *cache = ccTransformCacheNew();
+	ccTransformCacheClear(cache);
+	AddToCache(cache, tree.nodes, -1);
+
+	checksum = 0.0;
+	double start = Now();
+	for( unsigned int frame = 0; frame < frames; frame++ ) {
+		SpawnNodes(tree, cache, layers, spawn, rebuild);
+		MoveNodes(tree, cache, frame, 50);
+		VisitWithCache(cache, tree.nodes);
+	}
+	double time = (Now() - start)/frames;
+
+	ccTransformCacheFree(cache);
+	FreeTree(tree);
+	return time;
+}
+
+static int
+RunSpawn(unsigned int count, unsigned int layers, unsigned int spawn, unsigned int frames)
+{
+	double rebuildTime = RunSpawnCache(count, layers, spawn, frames, 1);
+	double rebuildChecksum = checksum;
+	double insertTime = RunSpawnCache(count, layers, spawn, frames, 0);
+	double insertChecksum = checksum;
+
+	printf("spawn %6u nodes, %3u moved/frame: rebuild %7.3f ms  insert %7.3f ms  (%.2fx)  checksum %.6g / %.6g\n",
+		count, spawn, rebuildTime, insertTime, rebuildTime/insertTime, rebuildChecksum, insertChecksum);
+
+	return rebuildChecksum == insertChecksum;
+}
+
+int
+main(int argc, char **argv)
+{
+	unsigned int frames = (argc > 1 ? (unsigned int)atoi(argv[1]) : 100);
+
+	kmGLMatrixMode(KM_GL_PROJECTION);
+	kmGLLoadIdentity();
+	kmGLMatrixMode(KM_GL_MODELVIEW);
+	kmGLLoadIdentity();
+
+	unsigned int counts[] = {1000, 10000};
+	for( int i = 0; i < 2; i++ ) {
+		Run(DeepTree, counts[i], 8, 1, frames);
+		Run(DeepTree, counts[i], 8, 50, frames);
+		Run(WideTree, counts[i], 4, 1, frames);
+		Run(WideTree, counts[i], 4, 50, frames);
+	}
+
+	int ok = 1;
+	for( int i = 0; i < 2; i++ ) {
+		ok &= RunSpawn(counts[i], 4, 1, frames);
+		ok &= RunSpawn(counts[i], 4, 10, frames);
+	}
+
+	if( !ok ) {
+		printf("the checksums of the spawn runs don't match\n");
+		return 1;
+	}
+
+	return 0;
+}
@@ -35,6 +35,13 @@ enum {
 	return YES;
 }
 
+// the body moves the sprite, not its properties: the transform must be computed again before each draw
+-(void) visit
+{
+	[self markTransformDirty];
+	[super visit];
+}
+
 // returns the transform matrix according the Chipmunk Body values
 -(CGAffineTransform) nodeToParentTransform
 {